@@ -10,6 +10,7 @@
 
 #include "utils/common.h"
 #include "crypto/sha1.h"
+#include "crypto/pbkdf2_batch.h"
 #include "radius/radius_client.h"
 #include "common/ieee802_11_defs.h"
 #include "common/eapol_common.h"
@@ -93,6 +94,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 #endif /* CONFIG_IEEE80211R */
 
 	bss->radius_das_time_window = 300;
+	bss->radius_acl_cache_size = 1024;
 
 	bss->sae_anti_clogging_threshold = 5;
 }
@@ -209,7 +211,8 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	char buf[128], *pos;
 	int line = 0, ret = 0, len, ok;
 	u8 addr[ETH_ALEN];
-	struct hostapd_wpa_psk *psk;
+	struct hostapd_wpa_psk *psk, *list = NULL, *tail = NULL;
+	struct pbkdf2_batch *batch;
 
 	if (!fname)
 		return 0;
@@ -220,6 +223,17 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		return -1;
 	}
 
+	/*
+	 * Passphrases are converted to PSKs in a single batch at the end. The
+	 * entries are collected on a local list until then so that none of
+	 * them is used before the PSK has been derived.
+	 */
+	batch = pbkdf2_batch_init();
+	if (!batch) {
+		fclose(f);
+		return -1;
+	}
+
 	while (fgets(buf, sizeof(buf), f)) {
 		line++;
 
@@ -258,7 +272,7 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		if (*pos == '\0') {
 			wpa_printf(MSG_ERROR, "No PSK on line %d in '%s'",
 				   line, fname);
-			os_free(psk);
+			bin_clear_free(psk, sizeof(*psk));
 			ret = -1;
 			break;
 		}
@@ -268,25 +282,42 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		len = os_strlen(pos);
 		if (len == 64 && hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
 			ok = 1;
-		else if (len >= 8 && len < 64) {
-			pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				    4096, psk->psk, PMK_LEN);
+		else if (len >= 8 && len < 64 &&
+			 pbkdf2_batch_add(batch, pos, ssid->ssid,
+					  ssid->ssid_len, psk->psk) == 0)
 			ok = 1;
-		}
 		if (!ok) {
 			wpa_printf(MSG_ERROR, "Invalid PSK '%s' on line %d in "
 				   "'%s'", pos, line, fname);
-			os_free(psk);
+			bin_clear_free(psk, sizeof(*psk));
 			ret = -1;
 			break;
 		}
 
-		psk->next = ssid->wpa_psk;
-		ssid->wpa_psk = psk;
+		if (!tail)
+			tail = psk;
+		psk->next = list;
+		list = psk;
 	}
 
 	fclose(f);
 
+	if (ret == 0 && pbkdf2_batch_run(batch, NULL) < 0) {
+		wpa_printf(MSG_ERROR, "Failed to derive PSKs for '%s'", fname);
+		ret = -1;
+	}
+	pbkdf2_batch_free(batch);
+
+	if (ret < 0) {
+		hostapd_config_clear_wpa_psk(&list);
+		return ret;
+	}
+
+	if (tail) {
+		tail->next = ssid->wpa_psk;
+		ssid->wpa_psk = list;
+	}
+
 	return ret;
 }
 
@@ -315,6 +346,7 @@ static int hostapd_derive_psk(struct hostapd_ssid *ssid)
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 {
 	struct hostapd_ssid *ssid = &conf->ssid;
+	int ret = 0;
 
 	if (ssid->wpa_passphrase != NULL) {
 		if (ssid->wpa_psk != NULL) {
@@ -323,8 +355,10 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 		} else {
 			wpa_printf(MSG_DEBUG, "Deriving WPA PSK based on "
 				   "passphrase");
-			if (hostapd_derive_psk(ssid) < 0)
-				return -1;
+			if (hostapd_derive_psk(ssid) < 0) {
+				ret = -1;
+				goto out;
+			}
 		}
 		ssid->wpa_psk->group = 1;
 	}
@@ -332,10 +366,14 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 	if (ssid->wpa_psk_file) {
 		if (hostapd_config_read_wpa_psk(ssid->wpa_psk_file,
 						&conf->ssid))
-			return -1;
+			ret = -1;
 	}
 
-	return 0;
+out:
+	/* The list may have been modified even if an error is returned */
+	hostapd_config_wpa_psk_changed(ssid);
+
+	return ret;
 }
 
 
@@ -428,6 +466,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 		return;
 
 	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	hostapd_config_wpa_psk_changed(&conf->ssid);
 
 	str_clear_free(conf->ssid.wpa_passphrase);
 	os_free(conf->ssid.wpa_psk_file);
@@ -704,24 +743,256 @@ const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan, int vlan_id)
 }
 
 
-const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
-			   const u8 *addr, const u8 *p2p_dev_addr,
-			   const u8 *prev_psk)
+/*
+ * WPA PSK lookup index
+ *
+ * hostapd_get_psk() returns the PSKs that can be used with a station in the
+ * order they are in the ssid.wpa_psk list: all group PSKs and the PSKs bound
+ * to the station address (or P2P Device Address). With a large wpa_psk_file,
+ * walking the list for each call and trying every group PSK in msg 2/4 MIC
+ * verification gets expensive, so an index is built on the first lookup:
+ * per-station entries are hashed by address, group PSKs are kept in a sorted
+ * position array, and the PSK that was last found to match for a station is
+ * returned first. The index needs to be dropped with
+ * hostapd_config_wpa_psk_changed() whenever the ssid.wpa_psk list is modified.
+ */
+
+#define HOSTAPD_WPA_PSK_MATCH_CACHE 256
+
+struct hostapd_wpa_psk_entry {
+	struct hostapd_wpa_psk *psk;
+	int addr_next; /* next entry in the same addr hash bucket */
+	int p2p_next; /* next entry in the same p2p_dev_addr hash bucket */
+	int ptr_next; /* next entry in the same PSK pointer hash bucket */
+};
+
+struct hostapd_wpa_psk_match {
+	u8 addr[ETH_ALEN];
+	u8 p2p;
+	int pos; /* matching entry or -1 if unused */
+};
+
+struct hostapd_wpa_psk_index {
+	struct hostapd_wpa_psk_entry *entries; /* in ssid.wpa_psk order */
+	int *group; /* positions of the group PSKs in increasing order */
+	unsigned int num_group;
+	int *addr_hash;
+	int *p2p_hash;
+	int *ptr_hash;
+	unsigned int hash_mask;
+	struct hostapd_wpa_psk_match match[HOSTAPD_WPA_PSK_MATCH_CACHE];
+};
+
+
+static unsigned int hostapd_wpa_psk_addr_hash(const u8 *addr)
+{
+	u32 hash = 2166136261U;
+	int i;
+
+	for (i = 0; i < ETH_ALEN; i++) {
+		hash ^= addr[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+
+static unsigned int hostapd_wpa_psk_ptr_hash(const u8 *psk)
 {
+	return (unsigned int) ((unsigned long) psk >> 3) * 2654435761U;
+}
+
+
+static void hostapd_wpa_psk_index_free(struct hostapd_wpa_psk_index *idx)
+{
+	if (!idx)
+		return;
+	os_free(idx->entries);
+	os_free(idx->group);
+	os_free(idx->addr_hash);
+	os_free(idx->p2p_hash);
+	os_free(idx->ptr_hash);
+	os_free(idx);
+}
+
+
+/**
+ * hostapd_config_wpa_psk_changed - Notify that ssid->wpa_psk list was modified
+ * @ssid: SSID configuration
+ *
+ * This drops the PSK lookup index (including the information on which PSK
+ * each station last used) so that it gets rebuilt on the next lookup.
+ */
+void hostapd_config_wpa_psk_changed(struct hostapd_ssid *ssid)
+{
+	hostapd_wpa_psk_index_free(ssid->wpa_psk_index);
+	ssid->wpa_psk_index = NULL;
+}
+
+
+static struct hostapd_wpa_psk_index *
+hostapd_wpa_psk_index_build(const struct hostapd_ssid *ssid)
+{
+	struct hostapd_wpa_psk_index *idx;
 	struct hostapd_wpa_psk *psk;
-	int next_ok = prev_psk == NULL;
+	unsigned int i, num = 0, size;
+	int n, *head;
 
-	if (p2p_dev_addr && !is_zero_ether_addr(p2p_dev_addr)) {
-		wpa_printf(MSG_DEBUG, "Searching a PSK for " MACSTR
-			   " p2p_dev_addr=" MACSTR " prev_psk=%p",
-			   MAC2STR(addr), MAC2STR(p2p_dev_addr), prev_psk);
-		addr = NULL; /* Use P2P Device Address for matching */
-	} else {
-		wpa_printf(MSG_DEBUG, "Searching a PSK for " MACSTR
-			   " prev_psk=%p",
-			   MAC2STR(addr), prev_psk);
+	for (psk = ssid->wpa_psk; psk; psk = psk->next)
+		num++;
+	if (num == 0)
+		return NULL;
+	for (size = 16; size < 2 * num; size <<= 1)
+		;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+	idx->entries = os_calloc(num, sizeof(struct hostapd_wpa_psk_entry));
+	idx->group = os_calloc(num, sizeof(int));
+	idx->addr_hash = os_calloc(size, sizeof(int));
+	idx->p2p_hash = os_calloc(size, sizeof(int));
+	idx->ptr_hash = os_calloc(size, sizeof(int));
+	if (!idx->entries || !idx->group || !idx->addr_hash ||
+	    !idx->p2p_hash || !idx->ptr_hash) {
+		hostapd_wpa_psk_index_free(idx);
+		return NULL;
+	}
+
+	idx->hash_mask = size - 1;
+	for (i = 0; i < size; i++) {
+		idx->addr_hash[i] = -1;
+		idx->p2p_hash[i] = -1;
+		idx->ptr_hash[i] = -1;
+	}
+	for (i = 0; i < HOSTAPD_WPA_PSK_MATCH_CACHE; i++)
+		idx->match[i].pos = -1;
+
+	n = 0;
+	for (psk = ssid->wpa_psk; psk; psk = psk->next) {
+		idx->entries[n].psk = psk;
+		if (psk->group)
+			idx->group[idx->num_group++] = n;
+		n++;
 	}
 
+	/* Add entries backwards so that each bucket is in list order */
+	while (n-- > 0) {
+		struct hostapd_wpa_psk_entry *e = &idx->entries[n];
+
+		head = &idx->ptr_hash[hostapd_wpa_psk_ptr_hash(e->psk->psk) &
+				      idx->hash_mask];
+		e->ptr_next = *head;
+		*head = n;
+
+		e->addr_next = -1;
+		e->p2p_next = -1;
+		if (e->psk->group)
+			continue;
+
+		head = &idx->addr_hash[hostapd_wpa_psk_addr_hash(e->psk->addr) &
+				       idx->hash_mask];
+		e->addr_next = *head;
+		*head = n;
+
+		if (is_zero_ether_addr(e->psk->p2p_dev_addr))
+			continue;
+		head = &idx->p2p_hash[hostapd_wpa_psk_addr_hash(
+					      e->psk->p2p_dev_addr) &
+				      idx->hash_mask];
+		e->p2p_next = *head;
+		*head = n;
+	}
+
+	return idx;
+}
+
+
+static struct hostapd_wpa_psk_index *
+hostapd_wpa_psk_index_get(const struct hostapd_bss_config *conf)
+{
+	/*
+	 * The index is only a cache of the configured PSKs, so it is built
+	 * through the const configuration pointer used for PSK lookups.
+	 */
+	struct hostapd_ssid *ssid = (struct hostapd_ssid *) &conf->ssid;
+
+	if (!ssid->wpa_psk_index)
+		ssid->wpa_psk_index = hostapd_wpa_psk_index_build(ssid);
+	return ssid->wpa_psk_index;
+}
+
+
+static struct hostapd_wpa_psk_match *
+hostapd_wpa_psk_match_slot(struct hostapd_wpa_psk_index *idx, const u8 *key,
+			   int p2p)
+{
+	return &idx->match[(hostapd_wpa_psk_addr_hash(key) ^ p2p) %
+			   HOSTAPD_WPA_PSK_MATCH_CACHE];
+}
+
+
+static int hostapd_wpa_psk_pos(struct hostapd_wpa_psk_index *idx,
+			       const u8 *psk)
+{
+	int pos;
+
+	pos = idx->ptr_hash[hostapd_wpa_psk_ptr_hash(psk) & idx->hash_mask];
+	while (pos >= 0 && idx->entries[pos].psk->psk != psk)
+		pos = idx->entries[pos].ptr_next;
+	return pos;
+}
+
+
+/* Find the first PSK for key after position prev, skipping position skip */
+static int hostapd_wpa_psk_next(struct hostapd_wpa_psk_index *idx,
+				const u8 *key, int p2p, int prev, int skip)
+{
+	const struct hostapd_wpa_psk_entry *e;
+	int pos, station = -1, group = -1;
+	unsigned int lo = 0, hi = idx->num_group;
+
+	pos = p2p ? idx->p2p_hash[hostapd_wpa_psk_addr_hash(key) &
+				   idx->hash_mask] :
+		idx->addr_hash[hostapd_wpa_psk_addr_hash(key) &
+			       idx->hash_mask];
+	while (pos >= 0) {
+		e = &idx->entries[pos];
+		if (pos > prev && pos != skip &&
+		    os_memcmp(p2p ? e->psk->p2p_dev_addr : e->psk->addr, key,
+			      ETH_ALEN) == 0) {
+			station = pos;
+			break;
+		}
+		pos = p2p ? e->p2p_next : e->addr_next;
+	}
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (idx->group[mid] <= prev)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < idx->num_group && idx->group[lo] == skip)
+		lo++;
+	if (lo < idx->num_group)
+		group = idx->group[lo];
+
+	if (station < 0 || (group >= 0 && group < station))
+		return group;
+	return station;
+}
+
+
+static const u8 * hostapd_get_psk_list(const struct hostapd_bss_config *conf,
+				       const u8 *addr, const u8 *p2p_dev_addr,
+				       const u8 *prev_psk)
+{
+	struct hostapd_wpa_psk *psk;
+	int next_ok = prev_psk == NULL;
+
 	for (psk = conf->ssid.wpa_psk; psk != NULL; psk = psk->next) {
 		if (next_ok &&
 		    (psk->group ||
@@ -739,6 +1010,102 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 }
 
 
+const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
+			   const u8 *addr, const u8 *p2p_dev_addr,
+			   const u8 *prev_psk)
+{
+	struct hostapd_wpa_psk_index *idx;
+	struct hostapd_wpa_psk_match *match;
+	const u8 *key;
+	int p2p, prev, cached, pos;
+
+	if (p2p_dev_addr && !is_zero_ether_addr(p2p_dev_addr)) {
+		wpa_printf(MSG_DEBUG, "Searching a PSK for " MACSTR
+			   " p2p_dev_addr=" MACSTR " prev_psk=%p",
+			   MAC2STR(addr), MAC2STR(p2p_dev_addr), prev_psk);
+		addr = NULL; /* Use P2P Device Address for matching */
+	} else {
+		wpa_printf(MSG_DEBUG, "Searching a PSK for " MACSTR
+			   " prev_psk=%p",
+			   MAC2STR(addr), prev_psk);
+	}
+
+	idx = hostapd_wpa_psk_index_get(conf);
+	if (!idx || (!addr && !p2p_dev_addr))
+		return hostapd_get_psk_list(conf, addr, p2p_dev_addr,
+					    prev_psk);
+
+	p2p = addr == NULL;
+	key = p2p ? p2p_dev_addr : addr;
+
+	/*
+	 * The PSK that matched last time for this station is returned first
+	 * and skipped when reached in the list order.
+	 */
+	match = hostapd_wpa_psk_match_slot(idx, key, p2p);
+	cached = -1;
+	if (match->pos >= 0 && match->p2p == p2p &&
+	    os_memcmp(match->addr, key, ETH_ALEN) == 0) {
+		const struct hostapd_wpa_psk *psk =
+			idx->entries[match->pos].psk;
+
+		if (psk->group ||
+		    os_memcmp(p2p ? psk->p2p_dev_addr : psk->addr, key,
+			      ETH_ALEN) == 0)
+			cached = match->pos;
+	}
+
+	if (!prev_psk) {
+		if (cached >= 0)
+			return idx->entries[cached].psk->psk;
+		prev = -1;
+	} else {
+		prev = hostapd_wpa_psk_pos(idx, prev_psk);
+		if (prev < 0)
+			return NULL;
+		if (prev == cached)
+			prev = -1;
+	}
+
+	pos = hostapd_wpa_psk_next(idx, key, p2p, prev, cached);
+	return pos >= 0 ? idx->entries[pos].psk->psk : NULL;
+}
+
+
+/**
+ * hostapd_wpa_psk_matched - Report the PSK that a station was found to use
+ * @conf: BSS configuration
+ * @addr: Station address
+ * @p2p_dev_addr: P2P Device Address of the station or %NULL
+ * @psk: PSK returned by hostapd_get_psk() that resulted in a valid MIC
+ *
+ * The reported PSK is tried first on the following hostapd_get_psk() lookups
+ * for the same station.
+ */
+void hostapd_wpa_psk_matched(const struct hostapd_bss_config *conf,
+			     const u8 *addr, const u8 *p2p_dev_addr,
+			     const u8 *psk)
+{
+	struct hostapd_wpa_psk_index *idx = conf->ssid.wpa_psk_index;
+	struct hostapd_wpa_psk_match *match;
+	const u8 *key;
+	int p2p, pos;
+
+	if (!idx)
+		return;
+	pos = hostapd_wpa_psk_pos(idx, psk);
+	if (pos < 0)
+		return; /* not from ssid.wpa_psk, e.g., a RADIUS provided PSK */
+
+	p2p = p2p_dev_addr && !is_zero_ether_addr(p2p_dev_addr);
+	key = p2p ? p2p_dev_addr : addr;
+	match = hostapd_wpa_psk_match_slot(idx, key, p2p);
+	os_memcpy(match->addr, key, ETH_ALEN);
+	match->p2p = p2p;
+	match->pos = pos;
+}
+
+
 static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 				    struct hostapd_config *conf,
 				    int full_config)
@@ -95,6 +95,8 @@ struct hostapd_ssid {
 	secpolicy security_policy;
 
 	struct hostapd_wpa_psk *wpa_psk;
+	/* Lookup index for wpa_psk; built on demand by hostapd_get_psk() */
+	struct hostapd_wpa_psk_index *wpa_psk_index;
 	char *wpa_passphrase;
 	char *wpa_psk_file;
 
@@ -292,6 +294,9 @@ struct hostapd_bss_config {
 		DENY_UNLESS_ACCEPTED = 1,
 		USE_EXTERNAL_RADIUS_AUTH = 2
 	} macaddr_acl;
+	/* Maximum number of cached RADIUS ACL results (0 = no limit); the least
+	 * recently used entry is evicted when the cache is full */
+	unsigned int radius_acl_cache_size;
 	struct mac_acl_entry *accept_mac;
 	int num_accept_mac;
 	struct mac_acl_entry *deny_mac;
@@ -373,6 +378,7 @@ struct hostapd_bss_config {
 	int radius_server_auth_port;
 	int radius_server_acct_port;
 	int radius_server_ipv6;
+	int radius_server_eap_threads;
 
 	int use_pae_group_addr; /* Whether to send EAPOL frames to PAE group
 				 * address instead of individual address
@@ -382,6 +388,8 @@ struct hostapd_bss_config {
 	int ap_max_inactivity;
 	int ignore_broadcast_ssid;
 	int no_probe_resp_if_max_sta;
+	/* window (msec) for coalescing Probe Request frames; 0 = disabled */
+	unsigned int probe_req_coalesce_ms;
 
 	int wmm_enabled;
 	int wmm_uapsd;
@@ -567,6 +575,8 @@ struct hostapd_bss_config {
 
 	unsigned int sae_anti_clogging_threshold;
 	int *sae_groups;
+	int sae_threads; /* worker threads for SAE commits (pool shared by all
+			  * BSSs in the process); 0 = inline */
 
 	char *wowlan_triggers; /* Wake-on-WLAN triggers */
 
@@ -715,6 +725,7 @@ struct hostapd_config * hostapd_config_defaults(void);
 void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free_eap_user(struct hostapd_eap_user *user);
 void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **p);
+void hostapd_config_wpa_psk_changed(struct hostapd_ssid *ssid);
 void hostapd_config_free_bss(struct hostapd_bss_config *conf);
 void hostapd_config_free(struct hostapd_config *conf);
 int hostapd_maclist_found(struct mac_acl_entry *list, int num_entries,
@@ -723,6 +734,9 @@ int hostapd_rate_found(int *list, int rate);
 const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk);
+void hostapd_wpa_psk_matched(const struct hostapd_bss_config *conf,
+			     const u8 *addr, const u8 *p2p_dev_addr,
+			     const u8 *psk);
 int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf);
 int hostapd_vlan_valid(struct hostapd_vlan *vlan,
 		       struct vlan_description *vlan_desc);
@@ -117,6 +117,7 @@ static int hostapd_setup_radius_srv(struct hostapd_data *hapd)
 	srv.tnc = conf->tnc;
 	srv.wps = hapd->wps;
 	srv.ipv6 = conf->radius_server_ipv6;
+	srv.eap_threads = conf->radius_server_eap_threads;
 	srv.get_eap_user = hostapd_radius_get_eap_user;
 	srv.eap_req_id_text = conf->eap_req_id_text;
 	srv.eap_req_id_text_len = conf->eap_req_id_text_len;
@@ -368,7 +368,7 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 				   int is_p2p, size_t *resp_len)
 {
 	struct ieee80211_mgmt *resp;
-	u8 *pos, *epos, *csa_pos;
+	u8 *pos, *epos, *csa_pos, *bss_load_pos;
 	size_t buflen;
 
 #define MAX_PROBERESP_LEN 768
@@ -446,7 +446,10 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 	/* RSN, MDIE, WPA */
 	pos = hostapd_eid_wpa(hapd, pos, epos - pos);
 
-	pos = hostapd_eid_bss_load(hapd, pos, epos - pos);
+	bss_load_pos = hostapd_eid_bss_load(hapd, pos, epos - pos);
+	hapd->bss_load_off_proberesp = bss_load_pos != pos ?
+		pos + 2 - (u8 *) resp : 0;
+	pos = bss_load_pos;
 
 	pos = hostapd_eid_rm_enabled_capab(hapd, pos, epos - pos);
 
@@ -538,6 +541,289 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 }
 
 
+static const u8 * hostapd_get_probe_resp(struct hostapd_data *hapd,
+					  const struct ieee80211_mgmt *req,
+					  int is_p2p, size_t *resp_len)
+{
+	struct ieee80211_mgmt *resp;
+	u8 *pos;
+
+	is_p2p = !!is_p2p;
+	if (!hapd->probe_resp_tmpl[is_p2p]) {
+		hapd->probe_resp_tmpl[is_p2p] =
+			hostapd_gen_probe_resp(hapd, NULL, is_p2p,
+					       &hapd->probe_resp_tmpl_len[is_p2p]);
+		if (!hapd->probe_resp_tmpl[is_p2p])
+			return NULL;
+	}
+
+	/* Patch in the fields that may change without a Beacon update */
+	resp = (struct ieee80211_mgmt *) hapd->probe_resp_tmpl[is_p2p];
+	os_memcpy(resp->da, req->sa, ETH_ALEN);
+
+	if (hapd->bss_load_off_proberesp
+#ifdef CONFIG_TESTING_OPTIONS
+	    && !hapd->conf->bss_load_test_set
+#endif /* CONFIG_TESTING_OPTIONS */
+		) {
+		pos = hapd->probe_resp_tmpl[is_p2p] +
+			hapd->bss_load_off_proberesp;
+		WPA_PUT_LE16(pos, hapd->num_sta);
+		pos[2] = hapd->iface->channel_utilization;
+	}
+
+	if (hapd->cs_c_off_proberesp &&
+	    hapd->cs_c_off_proberesp < hapd->probe_resp_tmpl_len[is_p2p])
+		hapd->probe_resp_tmpl[is_p2p][hapd->cs_c_off_proberesp] =
+			hapd->cs_count;
+	if (hapd->cs_c_off_ecsa_proberesp &&
+	    hapd->cs_c_off_ecsa_proberesp < hapd->probe_resp_tmpl_len[is_p2p])
+		hapd->probe_resp_tmpl[is_p2p][hapd->cs_c_off_ecsa_proberesp] =
+			hapd->cs_count;
+
+	*resp_len = hapd->probe_resp_tmpl_len[is_p2p];
+	return hapd->probe_resp_tmpl[is_p2p];
+}
+
+
+#define PROBE_REQ_FILTER_SIZE 64
+/* Number of fully processed Probe Request frames allowed per SA in a burst */
+#define PROBE_REQ_SA_BURST 8
+
+struct hostapd_probe_req_entry {
+	struct os_reltime seen;
+	u8 sa[ETH_ALEN];
+	u8 ssid[SSID_MAX_LEN];
+	u8 ssid_len;
+	u8 valid:1;
+	u8 multicast_da:1;
+	u8 respond:1; /* 0 = ignored, 1 = passed the static checks */
+	u8 is_p2p:1;
+	u8 noack:1;
+	size_t ie_len;
+	u32 ie_hash;
+};
+
+struct hostapd_probe_req_bucket {
+	struct os_reltime refill;
+	u8 sa[ETH_ALEN];
+	u8 tokens;
+};
+
+
+static unsigned int probe_req_age_ms(struct os_reltime *now,
+				     struct os_reltime *then)
+{
+	struct os_reltime age;
+
+	os_reltime_sub(now, then, &age);
+	if (age.sec >= 86400)
+		return 86400000;
+	return age.sec * 1000 + age.usec / 1000;
+}
+
+
+/*
+ * Token bucket for the full processing of Probe Request frames from a SA.
+ * This limits STAs that avoid coalescing by changing the SSID or other
+ * elements in each frame. Up to PROBE_REQ_SA_BURST tokens are available and
+ * one is added for each coalescing window. Returns 1 if the frame can be
+ * processed or 0 if the SA has run out of tokens.
+ */
+static int probe_req_sa_allowed(struct hostapd_data *hapd, const u8 *sa,
+				struct os_reltime *now)
+{
+	struct hostapd_probe_req_bucket *bucket;
+	unsigned int hash = 0, window = hapd->conf->probe_req_coalesce_ms;
+	unsigned int add;
+	int i;
+
+	if (!hapd->probe_req_limit) {
+		hapd->probe_req_limit = os_calloc(PROBE_REQ_FILTER_SIZE,
+						  sizeof(*bucket));
+		if (!hapd->probe_req_limit)
+			return 1;
+	}
+
+	for (i = 0; i < ETH_ALEN; i++)
+		hash = hash * 31 + sa[i];
+	bucket = &hapd->probe_req_limit[hash % PROBE_REQ_FILTER_SIZE];
+
+	if (os_memcmp(bucket->sa, sa, ETH_ALEN) != 0 ||
+	    os_reltime_initialized(&bucket->refill) == 0) {
+		os_memcpy(bucket->sa, sa, ETH_ALEN);
+		bucket->tokens = PROBE_REQ_SA_BURST;
+		bucket->refill = *now;
+	} else {
+		add = probe_req_age_ms(now, &bucket->refill) / window;
+		if (add) {
+			if (add > PROBE_REQ_SA_BURST - bucket->tokens)
+				add = PROBE_REQ_SA_BURST - bucket->tokens;
+			bucket->tokens += add;
+			bucket->refill = *now;
+		}
+	}
+
+	if (bucket->tokens == 0)
+		return 0;
+	bucket->tokens--;
+	return 1;
+}
+
+
+/*
+ * Find the slot for a Probe Request frame in the direct mapped table of
+ * recently processed frames. The SSID is located without parsing the full
+ * set of elements since this is done for every received frame. A match
+ * requires the same elements, too; this is checked with a hash of them.
+ */
+static struct hostapd_probe_req_entry *
+probe_req_filter_slot(struct hostapd_data *hapd,
+		      const struct ieee80211_mgmt *mgmt,
+		      const u8 *ie, size_t ie_len,
+		      struct os_reltime *now, int *match)
+{
+	struct hostapd_probe_req_entry *entry;
+	const u8 *pos = ie, *end = ie + ie_len, *ssid = NULL;
+	u8 ssid_len = 0;
+	unsigned int hash = 0;
+	u32 ie_hash = 2166136261U;
+	size_t j;
+	int i;
+
+	*match = 0;
+
+	while (end - pos >= 2 && end - pos - 2 >= pos[1]) {
+		if (pos[0] == WLAN_EID_SSID) {
+			ssid = pos + 2;
+			ssid_len = pos[1];
+			break;
+		}
+		pos += 2 + pos[1];
+	}
+	if (!ssid || ssid_len > SSID_MAX_LEN)
+		return NULL;
+
+	if (!hapd->probe_req_filter) {
+		hapd->probe_req_filter = os_calloc(PROBE_REQ_FILTER_SIZE,
+						   sizeof(*entry));
+		if (!hapd->probe_req_filter)
+			return NULL;
+	}
+
+	for (i = 0; i < ETH_ALEN; i++)
+		hash = hash * 31 + mgmt->sa[i];
+	for (i = 0; i < ssid_len; i++)
+		hash = hash * 31 + ssid[i];
+	entry = &hapd->probe_req_filter[hash % PROBE_REQ_FILTER_SIZE];
+
+	/* FNV-1a over all the elements */
+	for (j = 0; j < ie_len; j++)
+		ie_hash = (ie_hash ^ ie[j]) * 16777619U;
+
+	if (entry->valid &&
+	    os_memcmp(entry->sa, mgmt->sa, ETH_ALEN) == 0 &&
+	    entry->ssid_len == ssid_len &&
+	    os_memcmp(entry->ssid, ssid, ssid_len) == 0 &&
+	    entry->ie_len == ie_len &&
+	    entry->ie_hash == ie_hash &&
+	    entry->multicast_da == !!is_multicast_ether_addr(mgmt->da) &&
+	    probe_req_age_ms(now, &entry->seen) <
+	    hapd->conf->probe_req_coalesce_ms) {
+		*match = 1;
+		return entry;
+	}
+
+	/* Start tracking this SA/SSID; the result is filled in later */
+	os_memset(entry, 0, sizeof(*entry));
+	entry->valid = 1;
+	entry->seen = *now;
+	os_memcpy(entry->sa, mgmt->sa, ETH_ALEN);
+	os_memcpy(entry->ssid, ssid, ssid_len);
+	entry->ssid_len = ssid_len;
+	entry->ie_len = ie_len;
+	entry->ie_hash = ie_hash;
+	entry->multicast_da = !!is_multicast_ether_addr(mgmt->da);
+
+	return entry;
+}
+
+
+/*
+ * Checks that depend on the current STA state instead of the frame and the
+ * Beacon information. These are done for coalesced frames, too.
+ */
+static int probe_req_ignore_sta_state(struct hostapd_data *hapd,
+				      const struct ieee80211_mgmt *mgmt)
+{
+	if (hapd->conf->no_probe_resp_if_seen_on &&
+	    is_multicast_ether_addr(mgmt->da) &&
+	    is_multicast_ether_addr(mgmt->bssid) &&
+	    sta_track_seen_on(hapd->iface, mgmt->sa,
+			      hapd->conf->no_probe_resp_if_seen_on)) {
+		wpa_printf(MSG_MSGDUMP, "%s: Ignore Probe Request from " MACSTR
+			   " since STA has been seen on %s",
+			   hapd->conf->iface, MAC2STR(mgmt->sa),
+			   hapd->conf->no_probe_resp_if_seen_on);
+		return 1;
+	}
+
+	if (hapd->conf->no_probe_resp_if_max_sta &&
+	    is_multicast_ether_addr(mgmt->da) &&
+	    is_multicast_ether_addr(mgmt->bssid) &&
+	    hapd->num_sta >= hapd->conf->max_num_sta &&
+	    !ap_get_sta(hapd, mgmt->sa)) {
+		wpa_printf(MSG_MSGDUMP, "%s: Ignore Probe Request from " MACSTR
+			   " since no room for additional STA",
+			   hapd->conf->iface, MAC2STR(mgmt->sa));
+		return 1;
+	}
+
+#ifdef CONFIG_TESTING_OPTIONS
+	if (hapd->iconf->ignore_probe_probability > 0.0 &&
+	    drand48() < hapd->iconf->ignore_probe_probability) {
+		wpa_printf(MSG_INFO,
+			   "TESTING: ignoring probe request from " MACSTR,
+			   MAC2STR(mgmt->sa));
+		return 1;
+	}
+#endif /* CONFIG_TESTING_OPTIONS */
+
+	return 0;
+}
+
+
+static void hostapd_send_probe_resp(struct hostapd_data *hapd,
+				    const struct ieee80211_mgmt *req,
+				    int is_p2p, int noack)
+{
+	const u8 *resp;
+	size_t resp_len;
+	u16 csa_offs[2];
+	size_t csa_offs_len;
+
+	resp = hostapd_get_probe_resp(hapd, req, is_p2p, &resp_len);
+	if (resp == NULL)
+		return;
+
+	csa_offs_len = 0;
+	if (hapd->csa_in_progress) {
+		if (hapd->cs_c_off_proberesp)
+			csa_offs[csa_offs_len++] =
+				hapd->cs_c_off_proberesp;
+
+		if (hapd->cs_c_off_ecsa_proberesp)
+			csa_offs[csa_offs_len++] =
+				hapd->cs_c_off_ecsa_proberesp;
+	}
+
+	if (hostapd_drv_send_mlme_csa(hapd, resp, resp_len, noack,
+				      csa_offs_len ? csa_offs : NULL,
+				      csa_offs_len) < 0)
+		wpa_printf(MSG_INFO, "handle_probe_req: send failed");
+}
+
+
 enum ssid_match_result {
 	NO_SSID_MATCH,
 	EXACT_SSID_MATCH,
@@ -697,23 +983,51 @@ void handle_probe_req(struct hostapd_data *hapd,
 		      const struct ieee80211_mgmt *mgmt, size_t len,
 		      int ssi_signal)
 {
-	u8 *resp;
 	struct ieee802_11_elems elems;
 	const u8 *ie;
 	size_t ie_len;
-	size_t i, resp_len;
+	size_t i;
 	int noack;
 	enum ssid_match_result res;
-	int ret;
-	u16 csa_offs[2];
-	size_t csa_offs_len;
+	struct hostapd_probe_req_entry *entry = NULL;
+	struct os_reltime now;
+	int match;
 
 	if (len < IEEE80211_HDRLEN)
 		return;
 	ie = ((const u8 *) mgmt) + IEEE80211_HDRLEN;
+	ie_len = len - IEEE80211_HDRLEN;
+
+	if (hapd->conf->probe_req_coalesce_ms) {
+		/*
+		 * Repeated Probe Request frames from the same STA for the same
+		 * SSID within the window get the same result as the first one
+		 * without going through the full processing again. Other
+		 * frames are processed only while the SA has tokens left.
+		 */
+		os_get_reltime(&now);
+		entry = probe_req_filter_slot(hapd, mgmt, ie, ie_len, &now,
+					      &match);
+		if (entry && match) {
+			if (!entry->respond ||
+			    probe_req_ignore_sta_state(hapd, mgmt)) {
+				hapd->probe_req_dropped++;
+				return;
+			}
+			hapd->probe_req_coalesced++;
+			hostapd_send_probe_resp(hapd, mgmt, entry->is_p2p,
+						entry->noack);
+			return;
+		}
+		if (!probe_req_sa_allowed(hapd, mgmt->sa, &now)) {
+			hapd->probe_req_limited++;
+			return;
+		}
+	}
+	hapd->probe_req_processed++;
+
 	if (hapd->iconf->track_sta_max_num)
 		sta_track_add(hapd->iface, mgmt->sa);
-	ie_len = len - IEEE80211_HDRLEN;
 
 	for (i = 0; hapd->probereq_cb && i < hapd->num_probereq_cb; i++)
 		if (hapd->probereq_cb[i].cb(hapd->probereq_cb[i].ctx,
@@ -876,44 +1190,6 @@ void handle_probe_req(struct hostapd_data *hapd,
 	/* TODO: verify that supp_rates contains at least one matching rate
 	 * with AP configuration */
 
-	if (hapd->conf->no_probe_resp_if_seen_on &&
-	    is_multicast_ether_addr(mgmt->da) &&
-	    is_multicast_ether_addr(mgmt->bssid) &&
-	    sta_track_seen_on(hapd->iface, mgmt->sa,
-			      hapd->conf->no_probe_resp_if_seen_on)) {
-		wpa_printf(MSG_MSGDUMP, "%s: Ignore Probe Request from " MACSTR
-			   " since STA has been seen on %s",
-			   hapd->conf->iface, MAC2STR(mgmt->sa),
-			   hapd->conf->no_probe_resp_if_seen_on);
-		return;
-	}
-
-	if (hapd->conf->no_probe_resp_if_max_sta &&
-	    is_multicast_ether_addr(mgmt->da) &&
-	    is_multicast_ether_addr(mgmt->bssid) &&
-	    hapd->num_sta >= hapd->conf->max_num_sta &&
-	    !ap_get_sta(hapd, mgmt->sa)) {
-		wpa_printf(MSG_MSGDUMP, "%s: Ignore Probe Request from " MACSTR
-			   " since no room for additional STA",
-			   hapd->conf->iface, MAC2STR(mgmt->sa));
-		return;
-	}
-
-#ifdef CONFIG_TESTING_OPTIONS
-	if (hapd->iconf->ignore_probe_probability > 0.0 &&
-	    drand48() < hapd->iconf->ignore_probe_probability) {
-		wpa_printf(MSG_INFO,
-			   "TESTING: ignoring probe request from " MACSTR,
-			   MAC2STR(mgmt->sa));
-		return;
-	}
-#endif /* CONFIG_TESTING_OPTIONS */
-
-	resp = hostapd_gen_probe_resp(hapd, mgmt, elems.p2p != NULL,
-				      &resp_len);
-	if (resp == NULL)
-		return;
-
 	/*
 	 * If this is a broadcast probe request, apply no ack policy to avoid
 	 * excessive retries.
@@ -921,25 +1197,16 @@ void handle_probe_req(struct hostapd_data *hapd,
 	noack = !!(res == WILDCARD_SSID_MATCH &&
 		   is_broadcast_ether_addr(mgmt->da));
 
-	csa_offs_len = 0;
-	if (hapd->csa_in_progress) {
-		if (hapd->cs_c_off_proberesp)
-			csa_offs[csa_offs_len++] =
-				hapd->cs_c_off_proberesp;
-
-		if (hapd->cs_c_off_ecsa_proberesp)
-			csa_offs[csa_offs_len++] =
-				hapd->cs_c_off_ecsa_proberesp;
+	if (entry && hapd->probe_req_filter) {
+		entry->respond = 1;
+		entry->is_p2p = elems.p2p != NULL;
+		entry->noack = noack;
 	}
 
-	ret = hostapd_drv_send_mlme_csa(hapd, resp, resp_len, noack,
-					csa_offs_len ? csa_offs : NULL,
-					csa_offs_len);
-
-	if (ret < 0)
-		wpa_printf(MSG_INFO, "handle_probe_req: send failed");
+	if (probe_req_ignore_sta_state(hapd, mgmt))
+		return;
 
-	os_free(resp);
+	hostapd_send_probe_resp(hapd, mgmt, elems.p2p != NULL, noack);
 
 	wpa_printf(MSG_EXCESSIVE, "STA " MACSTR " sent probe request for %s "
 		   "SSID", MAC2STR(mgmt->sa),
@@ -985,6 +1252,30 @@ static u8 * hostapd_probe_resp_offloads(struct hostapd_data *hapd,
 #endif /* NEED_AP_MLME */
 
 
+/**
+ * hostapd_flush_probe_resp_tmpl - Discard the Probe Response frame templates
+ * @hapd: Pointer to BSS data
+ *
+ * This needs to be called whenever any of the information included in Probe
+ * Response frames changes. The templates are rebuilt when the next Probe
+ * Request frame is processed.
+ */
+void hostapd_flush_probe_resp_tmpl(struct hostapd_data *hapd)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(hapd->probe_resp_tmpl); i++) {
+		os_free(hapd->probe_resp_tmpl[i]);
+		hapd->probe_resp_tmpl[i] = NULL;
+		hapd->probe_resp_tmpl_len[i] = 0;
+	}
+
+	/* The cached decisions may depend on the changed information, too */
+	os_free(hapd->probe_req_filter);
+	hapd->probe_req_filter = NULL;
+}
+
+
 void sta_track_del(struct hostapd_sta_info *info)
 {
 #ifdef CONFIG_TAXONOMY
@@ -1299,6 +1590,8 @@ int ieee802_11_set_beacon(struct hostapd_data *hapd)
 	struct wpabuf *beacon, *proberesp, *assocresp;
 	int res, ret = -1;
 
+	hostapd_flush_probe_resp_tmpl(hapd);
+
 	if (hapd->csa_in_progress) {
 		wpa_printf(MSG_ERROR, "Cannot set beacons during CSA period");
 		return -1;
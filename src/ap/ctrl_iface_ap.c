@@ -639,3 +639,25 @@ void hostapd_ctrl_iface_pmksa_flush(struct hostapd_data *hapd)
 {
 	wpa_auth_pmksa_flush(hapd->wpa_auth);
 }
+
+
+int hostapd_ctrl_iface_probe_req_stats(struct hostapd_data *hapd, char *buf,
+				       size_t buflen)
+{
+	int ret;
+
+	ret = os_snprintf(buf, buflen,
+			  "coalesce_window=%u\n"
+			  "processed=%u\n"
+			  "coalesced=%u\n"
+			  "dropped=%u\n"
+			  "limited=%u\n",
+			  hapd->conf->probe_req_coalesce_ms,
+			  hapd->probe_req_processed,
+			  hapd->probe_req_coalesced,
+			  hapd->probe_req_dropped,
+			  hapd->probe_req_limited);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+	return ret;
+}
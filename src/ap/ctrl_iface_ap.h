@@ -32,5 +32,7 @@ int hostapd_ctrl_iface_stop_ap(struct hostapd_data *hapd);
 int hostapd_ctrl_iface_pmksa_list(struct hostapd_data *hapd, char *buf,
 				  size_t len);
 void hostapd_ctrl_iface_pmksa_flush(struct hostapd_data *hapd);
+int hostapd_ctrl_iface_probe_req_stats(struct hostapd_data *hapd, char *buf,
+				       size_t buflen);
 
 #endif /* CTRL_IFACE_AP_H */
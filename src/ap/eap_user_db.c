@@ -8,6 +8,7 @@
 
 #include "includes.h"
 #ifdef CONFIG_SQLITE
+#include <sys/stat.h>
 #include <sqlite3.h>
 #endif /* CONFIG_SQLITE */
 
@@ -129,80 +130,445 @@ static int get_wildcard_cb(void *ctx, int argc, char *argv[], char *col[])
 }
 
 
+/*
+ * The database handle and the prepared statements are kept open across
+ * lookups and the users found in recent lookups are cached. The cache is
+ * flushed whenever PRAGMA data_version indicates that another connection has
+ * committed changes to the database (this covers WAL mode writes that do not
+ * modify the main database file) and the database is reopened if the file is
+ * replaced. Lookups that did not find a user are not cached so that newly
+ * added users are found immediately.
+ */
+
+#define EAP_USER_DB_CACHE_SIZE 256
+#define EAP_USER_DB_HASH_SIZE 64
+
+struct eap_user_db_entry {
+	struct dl_list list; /* LRU order, most recently used first */
+	struct eap_user_db_entry *hnext;
+	u8 *key;
+	size_t key_len;
+	int phase2;
+	struct hostapd_eap_user user;
+};
+
+struct eap_user_db {
+	char *fname;
+	sqlite3 *db;
+	sqlite3_stmt *user_stmt;
+	sqlite3_stmt *wildcard_stmt;
+	sqlite3_stmt *version_stmt;
+	sqlite3_int64 data_version;
+	struct stat st;
+	struct dl_list cache; /* struct eap_user_db_entry */
+	struct eap_user_db_entry *hash[EAP_USER_DB_HASH_SIZE];
+	unsigned int num_entries;
+};
+
+
+static void eap_user_db_clear_user(struct hostapd_eap_user *user)
+{
+	bin_clear_free(user->identity, user->identity_len);
+	bin_clear_free(user->password, user->password_len);
+	os_memset(user, 0, sizeof(*user));
+}
+
+
+static void eap_user_db_entry_free(struct eap_user_db_entry *entry)
+{
+	bin_clear_free(entry->key, entry->key_len);
+	eap_user_db_clear_user(&entry->user);
+	os_free(entry);
+}
+
+
+static void eap_user_db_flush(struct eap_user_db *udb)
+{
+	struct eap_user_db_entry *entry, *tmp;
+
+	dl_list_for_each_safe(entry, tmp, &udb->cache,
+			      struct eap_user_db_entry, list) {
+		dl_list_del(&entry->list);
+		eap_user_db_entry_free(entry);
+	}
+	os_memset(udb->hash, 0, sizeof(udb->hash));
+	udb->num_entries = 0;
+}
+
+
+static void eap_user_db_close(struct eap_user_db *udb)
+{
+	sqlite3_finalize(udb->user_stmt);
+	udb->user_stmt = NULL;
+	sqlite3_finalize(udb->wildcard_stmt);
+	udb->wildcard_stmt = NULL;
+	sqlite3_finalize(udb->version_stmt);
+	udb->version_stmt = NULL;
+	sqlite3_close(udb->db);
+	udb->db = NULL;
+}
+
+
+static int eap_user_db_open(struct eap_user_db *udb)
+{
+	if (sqlite3_open(udb->fname, &udb->db)) {
+		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
+			   udb->fname, sqlite3_errmsg(udb->db));
+		goto fail;
+	}
+
+	if (sqlite3_prepare_v2(udb->db,
+			       "SELECT * FROM users WHERE identity=? AND phase2=?;",
+			       -1, &udb->user_stmt, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(udb->db,
+			       "SELECT identity,methods FROM wildcards;",
+			       -1, &udb->wildcard_stmt, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(udb->db, "PRAGMA data_version;",
+			       -1, &udb->version_stmt, NULL) != SQLITE_OK) {
+		wpa_printf(MSG_INFO, "DB: Failed to prepare statements: %s  db: %s",
+			   sqlite3_errmsg(udb->db), udb->fname);
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	eap_user_db_close(udb);
+	return -1;
+}
+
+
+static int eap_user_db_data_version(struct eap_user_db *udb,
+				    sqlite3_int64 *version)
+{
+	int res;
+
+	res = sqlite3_step(udb->version_stmt);
+	if (res == SQLITE_ROW)
+		*version = sqlite3_column_int64(udb->version_stmt, 0);
+	sqlite3_reset(udb->version_stmt);
+
+	return res == SQLITE_ROW ? 0 : -1;
+}
+
+
+static void eap_user_db_free(struct eap_user_db *udb)
+{
+	if (!udb)
+		return;
+	eap_user_db_flush(udb);
+	eap_user_db_close(udb);
+	os_free(udb->fname);
+	os_free(udb);
+}
+
+
+static struct eap_user_db * eap_user_db_get(struct hostapd_data *hapd)
+{
+	struct eap_user_db *udb = hapd->eap_user_db;
+	const char *fname = hapd->conf->eap_user_sqlite;
+	sqlite3_int64 version;
+	struct stat st;
+
+	if (udb && os_strcmp(udb->fname, fname) != 0) {
+		/* Configuration was changed */
+		eap_user_db_free(udb);
+		hapd->eap_user_db = udb = NULL;
+	}
+
+	if (!udb) {
+		udb = os_zalloc(sizeof(*udb));
+		if (!udb)
+			return NULL;
+		udb->fname = os_strdup(fname);
+		if (!udb->fname) {
+			os_free(udb);
+			return NULL;
+		}
+		dl_list_init(&udb->cache);
+		hapd->eap_user_db = udb;
+	}
+
+	/* The open handle would keep using a replaced database file */
+	if (stat(fname, &st) < 0)
+		os_memset(&st, 0, sizeof(st));
+	if (st.st_ino != udb->st.st_ino || st.st_dev != udb->st.st_dev) {
+		if (udb->db)
+			wpa_printf(MSG_DEBUG,
+				   "DB: Database %s replaced - reopen", fname);
+		eap_user_db_flush(udb);
+		eap_user_db_close(udb);
+		udb->st = st;
+	}
+
+	if (!udb->db) {
+		if (eap_user_db_open(udb) < 0 ||
+		    eap_user_db_data_version(udb, &udb->data_version) < 0) {
+			eap_user_db_close(udb);
+			return NULL;
+		}
+		return udb;
+	}
+
+	if (eap_user_db_data_version(udb, &version) < 0) {
+		eap_user_db_flush(udb);
+		eap_user_db_close(udb);
+		return NULL;
+	}
+	if (version != udb->data_version) {
+		wpa_printf(MSG_DEBUG, "DB: Database %s changed - flush cache",
+			   fname);
+		eap_user_db_flush(udb);
+		udb->data_version = version;
+	}
+
+	return udb;
+}
+
+
+static struct eap_user_db_entry *
+eap_user_db_cache_get(struct eap_user_db *udb, unsigned int hash,
+		      const u8 *identity, size_t identity_len, int phase2)
+{
+	struct eap_user_db_entry *entry;
+
+	for (entry = udb->hash[hash]; entry; entry = entry->hnext) {
+		if (entry->phase2 == phase2 && entry->key_len == identity_len &&
+		    os_memcmp(entry->key, identity, identity_len) == 0)
+			break;
+	}
+	if (entry) {
+		dl_list_del(&entry->list);
+		dl_list_add(&udb->cache, &entry->list);
+	}
+
+	return entry;
+}
+
+
+static void eap_user_db_cache_remove(struct eap_user_db *udb,
+				     struct eap_user_db_entry *entry,
+				     unsigned int hash)
+{
+	struct eap_user_db_entry **pos;
+
+	for (pos = &udb->hash[hash]; *pos; pos = &(*pos)->hnext) {
+		if (*pos == entry) {
+			*pos = entry->hnext;
+			break;
+		}
+	}
+	dl_list_del(&entry->list);
+	udb->num_entries--;
+	eap_user_db_entry_free(entry);
+}
+
+
+static unsigned int eap_user_db_hash(const u8 *identity, size_t identity_len)
+{
+	u32 hash = 2166136261U;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < identity_len; i++) {
+		hash ^= identity[i];
+		hash *= 16777619;
+	}
+
+	return hash % EAP_USER_DB_HASH_SIZE;
+}
+
+
+static int eap_user_db_copy_user(struct hostapd_eap_user *dst,
+				 const struct hostapd_eap_user *src)
+{
+	/* identity and password are always null terminated strings here */
+	*dst = *src;
+	dst->identity = NULL;
+	dst->password = NULL;
+	if (src->identity) {
+		dst->identity = (u8 *) os_strdup((const char *) src->identity);
+		if (!dst->identity)
+			goto fail;
+	}
+	if (src->password) {
+		dst->password = (u8 *) os_strdup((const char *) src->password);
+		if (!dst->password)
+			goto fail;
+	}
+	return 0;
+
+fail:
+	eap_user_db_clear_user(dst);
+	return -1;
+}
+
+
+static void eap_user_db_cache_add(struct eap_user_db *udb, unsigned int hash,
+				  const u8 *identity, size_t identity_len,
+				  int phase2, const struct hostapd_eap_user *user)
+{
+	struct eap_user_db_entry *entry;
+
+	if (!user)
+		return;
+
+	if (udb->num_entries >= EAP_USER_DB_CACHE_SIZE) {
+		entry = dl_list_last(&udb->cache, struct eap_user_db_entry,
+				     list);
+		if (entry)
+			eap_user_db_cache_remove(
+				udb, entry,
+				eap_user_db_hash(entry->key, entry->key_len));
+	}
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return;
+	entry->key = os_malloc(identity_len + 1);
+	if (!entry->key) {
+		os_free(entry);
+		return;
+	}
+	os_memcpy(entry->key, identity, identity_len);
+	entry->key_len = identity_len;
+	entry->phase2 = phase2;
+	if (eap_user_db_copy_user(&entry->user, user) < 0) {
+		eap_user_db_entry_free(entry);
+		return;
+	}
+
+	entry->hnext = udb->hash[hash];
+	udb->hash[hash] = entry;
+	dl_list_add(&udb->cache, &entry->list);
+	udb->num_entries++;
+}
+
+
+/*
+ * Run a prepared statement and call the callback for each row in the same
+ * way as sqlite3_exec() would do.
+ */
+static int eap_user_db_run(struct eap_user_db *udb, sqlite3_stmt *stmt,
+			   int (*cb)(void *ctx, int argc, char *argv[],
+				     char *col[]),
+			   void *ctx)
+{
+	int i, argc, res, ret = 0;
+	char **argv = NULL, **col = NULL;
+
+	argc = sqlite3_column_count(stmt);
+	argv = os_calloc(argc + 1, sizeof(char *));
+	col = os_calloc(argc + 1, sizeof(char *));
+	if (!argv || !col) {
+		ret = -1;
+		goto out;
+	}
+
+	for (i = 0; i < argc; i++)
+		col[i] = (char *) sqlite3_column_name(stmt, i);
+
+	while ((res = sqlite3_step(stmt)) == SQLITE_ROW) {
+		for (i = 0; i < argc; i++)
+			argv[i] = (char *) sqlite3_column_text(stmt, i);
+		cb(ctx, argc, argv, col);
+	}
+	if (res != SQLITE_DONE) {
+		wpa_printf(MSG_DEBUG,
+			   "DB: Failed to complete SQL operation: %s  db: %s",
+			   sqlite3_errmsg(udb->db), udb->fname);
+		ret = -1;
+	}
+
+out:
+	os_free(argv);
+	os_free(col);
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return ret;
+}
+
+
 static const struct hostapd_eap_user *
 eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 		    size_t identity_len, int phase2)
 {
-	sqlite3 *db;
+	struct eap_user_db *udb;
+	struct eap_user_db_entry *entry;
 	struct hostapd_eap_user *user = NULL;
-	char id_str[256], cmd[300];
+	unsigned int hash;
 	size_t i;
 
-	if (identity_len >= sizeof(id_str)) {
+	if (identity_len >= 256) {
 		wpa_printf(MSG_DEBUG, "%s: identity len too big: %d >= %d",
-			   __func__, (int) identity_len,
-			   (int) (sizeof(id_str)));
+			   __func__, (int) identity_len, 256);
 		return NULL;
 	}
-	os_memcpy(id_str, identity, identity_len);
-	id_str[identity_len] = '\0';
 	for (i = 0; i < identity_len; i++) {
-		if (id_str[i] >= 'a' && id_str[i] <= 'z')
+		if (identity[i] >= 'a' && identity[i] <= 'z')
 			continue;
-		if (id_str[i] >= 'A' && id_str[i] <= 'Z')
+		if (identity[i] >= 'A' && identity[i] <= 'Z')
 			continue;
-		if (id_str[i] >= '0' && id_str[i] <= '9')
+		if (identity[i] >= '0' && identity[i] <= '9')
 			continue;
-		if (id_str[i] == '-' || id_str[i] == '_' || id_str[i] == '.' ||
-		    id_str[i] == ',' || id_str[i] == '@' || id_str[i] == '\\' ||
-		    id_str[i] == '!' || id_str[i] == '#' || id_str[i] == '%' ||
-		    id_str[i] == '=' || id_str[i] == ' ')
+		if (identity[i] == '-' || identity[i] == '_' ||
+		    identity[i] == '.' || identity[i] == ',' ||
+		    identity[i] == '@' || identity[i] == '\\' ||
+		    identity[i] == '!' || identity[i] == '#' ||
+		    identity[i] == '%' || identity[i] == '=' ||
+		    identity[i] == ' ')
 			continue;
 		wpa_printf(MSG_INFO, "DB: Unsupported character in identity");
 		return NULL;
 	}
 
-	bin_clear_free(hapd->tmp_eap_user.identity,
-		       hapd->tmp_eap_user.identity_len);
-	bin_clear_free(hapd->tmp_eap_user.password,
-		       hapd->tmp_eap_user.password_len);
-	os_memset(&hapd->tmp_eap_user, 0, sizeof(hapd->tmp_eap_user));
+	eap_user_db_clear_user(&hapd->tmp_eap_user);
+
+	udb = eap_user_db_get(hapd);
+	if (!udb)
+		return NULL;
+
+	hash = eap_user_db_hash(identity, identity_len);
+	entry = eap_user_db_cache_get(udb, hash, identity, identity_len,
+				      phase2);
+	if (entry) {
+		wpa_printf(MSG_DEBUG, "DB: Use cached result for identity");
+		if (eap_user_db_copy_user(&hapd->tmp_eap_user,
+					  &entry->user) < 0)
+			return NULL;
+		return &hapd->tmp_eap_user;
+	}
+
 	hapd->tmp_eap_user.phase2 = phase2;
 	hapd->tmp_eap_user.identity = os_zalloc(identity_len + 1);
 	if (hapd->tmp_eap_user.identity == NULL)
 		return NULL;
 	os_memcpy(hapd->tmp_eap_user.identity, identity, identity_len);
 
-	if (sqlite3_open(hapd->conf->eap_user_sqlite, &db)) {
-		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
-			   hapd->conf->eap_user_sqlite, sqlite3_errmsg(db));
-		sqlite3_close(db);
+	wpa_printf(MSG_DEBUG, "DB: SELECT * FROM users WHERE identity=? AND phase2=%d",
+		   phase2);
+	if (sqlite3_bind_text(udb->user_stmt, 1,
+			      (const char *) hapd->tmp_eap_user.identity,
+			      identity_len, SQLITE_STATIC) != SQLITE_OK ||
+	    sqlite3_bind_int(udb->user_stmt, 2, phase2) != SQLITE_OK) {
+		wpa_printf(MSG_DEBUG, "DB: Failed to bind parameters: %s",
+			   sqlite3_errmsg(udb->db));
+		sqlite3_reset(udb->user_stmt);
+		sqlite3_clear_bindings(udb->user_stmt);
 		return NULL;
 	}
-
-	os_snprintf(cmd, sizeof(cmd),
-		    "SELECT * FROM users WHERE identity='%s' AND phase2=%d;",
-		    id_str, phase2);
-	wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-	if (sqlite3_exec(db, cmd, get_user_cb, &hapd->tmp_eap_user, NULL) !=
-	    SQLITE_OK) {
-		wpa_printf(MSG_DEBUG,
-			   "DB: Failed to complete SQL operation: %s  db: %s",
-			   sqlite3_errmsg(db), hapd->conf->eap_user_sqlite);
-	} else if (hapd->tmp_eap_user.next)
+	if (eap_user_db_run(udb, udb->user_stmt, get_user_cb,
+			    &hapd->tmp_eap_user) < 0)
+		return NULL; /* do not cache failed lookups */
+	if (hapd->tmp_eap_user.next)
 		user = &hapd->tmp_eap_user;
 
 	if (user == NULL && !phase2) {
-		os_snprintf(cmd, sizeof(cmd),
-			    "SELECT identity,methods FROM wildcards;");
-		wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-		if (sqlite3_exec(db, cmd, get_wildcard_cb, &hapd->tmp_eap_user,
-				 NULL) != SQLITE_OK) {
-			wpa_printf(MSG_DEBUG,
-				   "DB: Failed to complete SQL operation: %s  db: %s",
-				   sqlite3_errmsg(db),
-				   hapd->conf->eap_user_sqlite);
-		} else if (hapd->tmp_eap_user.next) {
+		wpa_printf(MSG_DEBUG, "DB: SELECT identity,methods FROM wildcards;");
+		if (eap_user_db_run(udb, udb->wildcard_stmt, get_wildcard_cb,
+				    &hapd->tmp_eap_user) < 0)
+			return NULL;
+		if (hapd->tmp_eap_user.next) {
 			user = &hapd->tmp_eap_user;
 			os_free(user->identity);
 			user->identity = user->password;
@@ -212,11 +578,28 @@ eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 		}
 	}
 
-	sqlite3_close(db);
+	eap_user_db_cache_add(udb, hash, identity, identity_len, phase2, user);
 
 	return user;
 }
 
+
+/**
+ * hostapd_eap_user_db_deinit - Close EAP user database
+ * @hapd: hostapd BSS data
+ */
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd)
+{
+	eap_user_db_free(hapd->eap_user_db);
+	hapd->eap_user_db = NULL;
+}
+
+#else /* CONFIG_SQLITE */
+
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd)
+{
+}
+
 #endif /* CONFIG_SQLITE */
 
 
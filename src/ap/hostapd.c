@@ -45,6 +45,7 @@
 #include "ndisc_snoop.h"
 #include "neighbor_db.h"
 #include "rrm.h"
+#include "sae_pool.h"
 
 
 static int hostapd_flush_old_stations(struct hostapd_data *hapd, u16 reason);
@@ -87,6 +88,7 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 		 * have changed.
 		 */
 		hostapd_config_clear_wpa_psk(&hapd->conf->ssid.wpa_psk);
+		hostapd_config_wpa_psk_changed(&hapd->conf->ssid);
 	}
 	if (hostapd_setup_wpa_psk(hapd->conf)) {
 		wpa_printf(MSG_ERROR, "Failed to re-configure WPA PSK "
@@ -267,6 +269,9 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	os_free(hapd->probereq_cb);
 	hapd->probereq_cb = NULL;
 	hapd->num_probereq_cb = 0;
+	hostapd_flush_probe_resp_tmpl(hapd);
+	os_free(hapd->probe_req_limit);
+	hapd->probe_req_limit = NULL;
 
 #ifdef CONFIG_P2P
 	wpabuf_free(hapd->p2p_beacon_ie);
@@ -334,12 +339,18 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	bin_clear_free(hapd->tmp_eap_user.password,
 		       hapd->tmp_eap_user.password_len);
 #endif /* CONFIG_SQLITE */
+	hostapd_eap_user_db_deinit(hapd);
 
 #ifdef CONFIG_MESH
 	wpabuf_free(hapd->mesh_pending_auth);
 	hapd->mesh_pending_auth = NULL;
 #endif /* CONFIG_MESH */
 
+#ifdef CONFIG_SAE
+	sae_pool_put(hapd->sae_pool);
+	hapd->sae_pool = NULL;
+#endif /* CONFIG_SAE */
+
 	hostapd_clean_rrm(hapd);
 }
 
@@ -2001,6 +2012,8 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 	hapd->ctrl_sock = -1;
 	dl_list_init(&hapd->ctrl_dst);
 	dl_list_init(&hapd->nr_db);
+	dl_list_init(&hapd->acl_cache);
+	dl_list_init(&hapd->acl_cache_age);
 
 	return hapd;
 }
@@ -3129,6 +3142,7 @@ static int hostapd_fill_csa_settings(struct hostapd_data *hapd,
 	hapd->cs_freq_params = settings->freq_params;
 	hapd->cs_count = settings->cs_count;
 	hapd->cs_block_tx = settings->block_tx;
+	hostapd_flush_probe_resp_tmpl(hapd);
 
 	ret = hostapd_build_beacon_data(hapd, &settings->beacon_csa);
 	if (ret) {
@@ -3155,6 +3169,7 @@ void hostapd_cleanup_cs_params(struct hostapd_data *hapd)
 	hapd->csa_in_progress = 0;
 	hapd->cs_c_off_ecsa_beacon = 0;
 	hapd->cs_c_off_ecsa_proberesp = 0;
+	hostapd_flush_probe_resp_tmpl(hapd);
 }
 
 
@@ -21,6 +21,8 @@ struct hostapd_data;
 struct sta_info;
 struct ieee80211_ht_capabilities;
 struct full_dynamic_vlan;
+struct hostapd_probe_req_entry;
+struct hostapd_probe_req_bucket;
 enum wps_event;
 union wps_event_data;
 #ifdef CONFIG_MESH
@@ -111,6 +113,12 @@ struct hostapd_neighbor_entry {
 	struct os_time lci_date;
 };
 
+
+/* RADIUS ACL cache hash table (indexed by the last octet of the address) */
+#define ACL_CACHE_HASH_SIZE 256
+#define ACL_CACHE_HASH(addr) ((addr)[5])
+
+
 /**
  * struct hostapd_data - hostapd per-BSS data structure
  */
@@ -154,7 +162,16 @@ struct hostapd_data {
 
 	struct iapp_data *iapp;
 
-	struct hostapd_cached_radius_acl *acl_cache;
+	/* RADIUS ACL cache; acl_cache is in most recently used first order and
+	 * acl_cache_age in expiration order */
+	struct dl_list acl_cache; /* struct hostapd_cached_radius_acl */
+	struct dl_list acl_cache_age;
+	struct hostapd_cached_radius_acl *acl_cache_hash[ACL_CACHE_HASH_SIZE];
+	unsigned int acl_cache_num;
+	unsigned int acl_cache_hits;
+	unsigned int acl_cache_misses;
+	unsigned int acl_cache_evictions;
+	unsigned int acl_cache_expirations;
 	struct hostapd_acl_query_data *acl_queries;
 
 	struct wpa_authenticator *wpa_auth;
@@ -201,6 +218,15 @@ struct hostapd_data {
 	struct hostapd_probereq_cb *probereq_cb;
 	size_t num_probereq_cb;
 
+	/* Recently processed Probe Request frames (per SA and SSID) */
+	struct hostapd_probe_req_entry *probe_req_filter;
+	/* Probe Request processing token buckets (per SA) */
+	struct hostapd_probe_req_bucket *probe_req_limit;
+	unsigned int probe_req_processed;
+	unsigned int probe_req_coalesced;
+	unsigned int probe_req_dropped;
+	unsigned int probe_req_limited;
+
 	void (*public_action_cb)(void *ctx, const u8 *buf, size_t len,
 				 int freq);
 	void *public_action_cb_ctx;
@@ -245,6 +271,15 @@ struct hostapd_data {
 	/* BSS Load */
 	unsigned int bss_load_update_timeout;
 
+	/*
+	 * Probe Response frame templates (index 1 with P2P IE included) that
+	 * are built on the first Probe Request frame after a Beacon frame
+	 * update and then only patched with the dynamic fields
+	 */
+	u8 *probe_resp_tmpl[2];
+	size_t probe_resp_tmpl_len[2];
+	unsigned int bss_load_off_proberesp;
+
 #ifdef CONFIG_P2P
 	struct p2p_data *p2p;
 	struct p2p_group *p2p_group;
@@ -278,6 +313,7 @@ struct hostapd_data {
 
 #ifdef CONFIG_SQLITE
 	struct hostapd_eap_user tmp_eap_user;
+	struct eap_user_db *eap_user_db;
 #endif /* CONFIG_SQLITE */
 
 #ifdef CONFIG_SAE
@@ -285,6 +321,7 @@ struct hostapd_data {
 	u8 sae_token_key[8];
 	struct os_reltime last_sae_token_key_update;
 	int dot11RSNASAERetransPeriod; /* msec */
+	struct sae_pool *sae_pool;
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
@@ -530,6 +567,7 @@ void hostapd_acs_channel_selected(struct hostapd_data *hapd,
 const struct hostapd_eap_user *
 hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 		     size_t identity_len, int phase2);
+void hostapd_eap_user_db_deinit(struct hostapd_data *hapd);
 
 struct hostapd_data * hostapd_get_iface(struct hapd_interfaces *interfaces,
 					const char *ifname);
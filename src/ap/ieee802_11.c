@@ -45,6 +45,7 @@
 #include "mbo_ap.h"
 #include "rrm.h"
 #include "taxonomy.h"
+#include "sae_pool.h"
 
 
 u8 * hostapd_eid_supp_rates(struct hostapd_data *hapd, u8 *eid)
@@ -772,6 +773,8 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 {
 	int resp = WLAN_STATUS_SUCCESS;
 	struct wpabuf *data = NULL;
+	struct os_reltime start;
+	int res, group = 0;
 
 	if (!sta->sae) {
 		if (auth_transaction != 1 ||
@@ -788,6 +791,16 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 		sta->sae->sync = 0;
 	}
 
+#ifdef CONFIG_SAE_THREADS
+	if (sta->sae_job) {
+		wpa_printf(MSG_DEBUG,
+			   "SAE: Drop frame from " MACSTR
+			   " while its commit is being processed",
+			   MAC2STR(sta->addr));
+		return;
+	}
+#endif /* CONFIG_SAE_THREADS */
+
 	if (sta->mesh_sae_pmksa_caching) {
 		wpa_printf(MSG_DEBUG,
 			   "SAE: Cancel use of mesh PMKSA caching because peer starts SAE authentication");
@@ -900,7 +913,27 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			goto reply;
 		}
 
+		if (!hapd->sae_pool)
+			hapd->sae_pool = sae_pool_get(hapd->conf->sae_threads);
+		if (!(hapd->conf->mesh & MESH_ENABLED)) {
+			res = sae_pool_commit(hapd->sae_pool, hapd, sta,
+					      mgmt->bssid);
+			if (res == 0)
+				return; /* auth_sae_commit_done() continues */
+			if (res > 0) {
+				resp = -1;
+				goto remove_sta;
+			}
+		}
+
+		if (sta->sae->state == SAE_NOTHING) {
+			group = sta->sae->group;
+			os_get_reltime(&start);
+		}
 		resp = sae_sm_step(hapd, sta, mgmt->bssid, auth_transaction);
+		if (group)
+			sae_pool_record(hapd->sae_pool, group,
+					resp != WLAN_STATUS_SUCCESS, &start);
 	} else if (auth_transaction == 2) {
 		hostapd_logger(hapd, sta->addr, HOSTAPD_MODULE_IEEE80211,
 			       HOSTAPD_LEVEL_DEBUG,
@@ -946,6 +979,53 @@ remove_sta:
 }
 
 
+/**
+ * auth_sae_commit_done - Complete SAE Commit processing from the worker pool
+ * @hapd: BSS data
+ * @sta: STA entry for which sae_pool_commit() was called
+ * @bssid: BSSID for the response
+ * @pwe_res: Result of sae_prepare_commit()
+ * @k_res: Result of sae_process_commit()
+ *
+ * This completes the Nothing -> Committed transition of sae_sm_step() for an
+ * infrastructure BSS once the PWE, own commit, and k have been derived in a
+ * worker thread.
+ */
+void auth_sae_commit_done(struct hostapd_data *hapd, struct sta_info *sta,
+			  const u8 *bssid, int pwe_res, int k_res)
+{
+	int resp;
+
+	if (pwe_res < 0) {
+		wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
+		resp = WLAN_STATUS_UNSPECIFIED_FAILURE;
+		goto reply;
+	}
+
+	resp = auth_sae_send_commit(hapd, sta, bssid, 0);
+	if (resp)
+		goto reply;
+	sta->sae->state = SAE_COMMITTED;
+
+	if (k_res < 0) {
+		resp = WLAN_STATUS_UNSPECIFIED_FAILURE;
+		goto reply;
+	}
+
+	sta->sae->sync = 0;
+	sae_set_retransmit_timer(hapd, sta);
+	return;
+
+reply:
+	send_auth_reply(hapd, sta->addr, bssid, WLAN_AUTH_SAE, 1, resp,
+			(u8 *) "", 0);
+	if (sta->added_unassoc) {
+		hostapd_drv_sta_remove(hapd, sta->addr);
+		sta->added_unassoc = 0;
+	}
+}
+
+
 /**
  * auth_sae_init_committed - Send COMMIT and start SAE in committed state
  * @hapd: BSS data for the device initiating the authentication
@@ -3025,8 +3105,7 @@ void ieee802_11_mgmt_cb(struct hostapd_data *hapd, const u8 *buf, size_t len,
 
 int ieee802_11_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
 {
-	/* TODO */
-	return 0;
+	return hostapd_acl_get_mib(hapd, buf, buflen);
 }
 
 
@@ -28,10 +28,12 @@
 
 
 struct hostapd_cached_radius_acl {
+	struct dl_list list; /* hapd->acl_cache (LRU order) */
+	struct dl_list age; /* hapd->acl_cache_age (expiration order) */
+	struct hostapd_cached_radius_acl *hnext; /* hapd->acl_cache_hash */
 	struct os_reltime timestamp;
 	macaddr addr;
 	int accepted; /* HOSTAPD_ACL_* */
-	struct hostapd_cached_radius_acl *next;
 	u32 session_timeout;
 	u32 acct_interim_interval;
 	struct vlan_description vlan_id;
@@ -44,6 +46,7 @@ struct hostapd_cached_radius_acl {
 struct hostapd_acl_query_data {
 	struct os_reltime timestamp;
 	u8 radius_id;
+	u8 radius_authenticator[16];
 	macaddr addr;
 	u8 *auth_msg; /* IEEE 802.11 authentication frame from station */
 	size_t auth_msg_len;
@@ -61,14 +64,82 @@ static void hostapd_acl_cache_free_entry(struct hostapd_cached_radius_acl *e)
 }
 
 
-static void hostapd_acl_cache_free(struct hostapd_cached_radius_acl *acl_cache)
+static void hostapd_acl_cache_free(struct hostapd_data *hapd)
 {
-	struct hostapd_cached_radius_acl *prev;
+	struct hostapd_cached_radius_acl *entry, *tmp;
 
-	while (acl_cache) {
-		prev = acl_cache;
-		acl_cache = acl_cache->next;
-		hostapd_acl_cache_free_entry(prev);
+	dl_list_for_each_safe(entry, tmp, &hapd->acl_cache,
+			      struct hostapd_cached_radius_acl, list) {
+		dl_list_del(&entry->list);
+		dl_list_del(&entry->age);
+		hostapd_acl_cache_free_entry(entry);
+	}
+	os_memset(hapd->acl_cache_hash, 0, sizeof(hapd->acl_cache_hash));
+	hapd->acl_cache_num = 0;
+}
+
+
+static struct hostapd_cached_radius_acl *
+hostapd_acl_cache_find(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct hostapd_cached_radius_acl *entry;
+
+	entry = hapd->acl_cache_hash[ACL_CACHE_HASH(addr)];
+	while (entry && os_memcmp(entry->addr, addr, ETH_ALEN) != 0)
+		entry = entry->hnext;
+	return entry;
+}
+
+
+static void hostapd_acl_cache_remove(struct hostapd_data *hapd,
+				     struct hostapd_cached_radius_acl *entry,
+				     int expire_drv)
+{
+	struct hostapd_cached_radius_acl **pos;
+
+	pos = &hapd->acl_cache_hash[ACL_CACHE_HASH(entry->addr)];
+	while (*pos && *pos != entry)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = entry->hnext;
+	dl_list_del(&entry->list);
+	dl_list_del(&entry->age);
+	hapd->acl_cache_num--;
+
+	if (expire_drv)
+		hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
+	hostapd_acl_cache_free_entry(entry);
+}
+
+
+static void hostapd_acl_cache_add(struct hostapd_data *hapd,
+				  struct hostapd_cached_radius_acl *cache)
+{
+	struct hostapd_cached_radius_acl *entry;
+	unsigned int max = hapd->conf->radius_acl_cache_size;
+
+	/* Replace a previous (expired) result for the same station */
+	entry = hostapd_acl_cache_find(hapd, cache->addr);
+	if (entry)
+		hostapd_acl_cache_remove(hapd, entry, 0);
+
+	cache->hnext = hapd->acl_cache_hash[ACL_CACHE_HASH(cache->addr)];
+	hapd->acl_cache_hash[ACL_CACHE_HASH(cache->addr)] = cache;
+	dl_list_add(&hapd->acl_cache, &cache->list);
+	/* All entries have the same lifetime, so appending to the end keeps
+	 * acl_cache_age sorted by expiration time */
+	dl_list_add_tail(&hapd->acl_cache_age, &cache->age);
+	hapd->acl_cache_num++;
+
+	while (max && hapd->acl_cache_num > max) {
+		entry = dl_list_last(&hapd->acl_cache,
+				     struct hostapd_cached_radius_acl, list);
+		if (!entry || entry == cache)
+			break;
+		wpa_printf(MSG_DEBUG, "Evicting least recently used ACL cache "
+			   "entry for " MACSTR, MAC2STR(entry->addr));
+		hostapd_acl_cache_remove(hapd, entry, 1);
+		hapd->acl_cache_evictions++;
 	}
 }
 
@@ -98,38 +169,40 @@ static int hostapd_acl_cache_get(struct hostapd_data *hapd, const u8 *addr,
 
 	os_get_reltime(&now);
 
-	for (entry = hapd->acl_cache; entry; entry = entry->next) {
-		if (os_memcmp(entry->addr, addr, ETH_ALEN) != 0)
-			continue;
-
-		if (os_reltime_expired(&now, &entry->timestamp,
-				       RADIUS_ACL_TIMEOUT))
-			return -1; /* entry has expired */
-		if (entry->accepted == HOSTAPD_ACL_ACCEPT_TIMEOUT)
-			if (session_timeout)
-				*session_timeout = entry->session_timeout;
-		if (acct_interim_interval)
-			*acct_interim_interval =
-				entry->acct_interim_interval;
-		if (vlan_id)
-			*vlan_id = entry->vlan_id;
-		copy_psk_list(psk, entry->psk);
-		if (identity) {
-			if (entry->identity)
-				*identity = os_strdup(entry->identity);
-			else
-				*identity = NULL;
-		}
-		if (radius_cui) {
-			if (entry->radius_cui)
-				*radius_cui = os_strdup(entry->radius_cui);
-			else
-				*radius_cui = NULL;
-		}
-		return entry->accepted;
+	entry = hostapd_acl_cache_find(hapd, addr);
+	if (!entry ||
+	    os_reltime_expired(&now, &entry->timestamp, RADIUS_ACL_TIMEOUT)) {
+		/* no entry or entry has expired */
+		hapd->acl_cache_misses++;
+		return -1;
 	}
+	hapd->acl_cache_hits++;
 
-	return -1;
+	/* Move to the front of the LRU list */
+	dl_list_del(&entry->list);
+	dl_list_add(&hapd->acl_cache, &entry->list);
+
+	if (entry->accepted == HOSTAPD_ACL_ACCEPT_TIMEOUT)
+		if (session_timeout)
+			*session_timeout = entry->session_timeout;
+	if (acct_interim_interval)
+		*acct_interim_interval = entry->acct_interim_interval;
+	if (vlan_id)
+		*vlan_id = entry->vlan_id;
+	copy_psk_list(psk, entry->psk);
+	if (identity) {
+		if (entry->identity)
+			*identity = os_strdup(entry->identity);
+		else
+			*identity = NULL;
+	}
+	if (radius_cui) {
+		if (entry->radius_cui)
+			*radius_cui = os_strdup(entry->radius_cui);
+		else
+			*radius_cui = NULL;
+	}
+	return entry->accepted;
 }
 #endif /* CONFIG_NO_RADIUS */
 
@@ -159,6 +232,9 @@ static int hostapd_radius_acl_query(struct hostapd_data *hapd, const u8 *addr,
 		wpa_printf(MSG_INFO, "Could not make Request Authenticator");
 		goto fail;
 	}
+	os_memcpy(query->radius_authenticator,
+		  radius_msg_get_hdr(msg)->authenticator,
+		  sizeof(query->radius_authenticator));
 
 	os_snprintf(buf, sizeof(buf), RADIUS_ADDR_FORMAT, MAC2STR(addr));
 	if (!radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME, (u8 *) buf,
@@ -353,29 +429,19 @@ int hostapd_allowed_address(struct hostapd_data *hapd, const u8 *addr,
 static void hostapd_acl_expire_cache(struct hostapd_data *hapd,
 				     struct os_reltime *now)
 {
-	struct hostapd_cached_radius_acl *prev, *entry, *tmp;
-
-	prev = NULL;
-	entry = hapd->acl_cache;
-
-	while (entry) {
-		if (os_reltime_expired(now, &entry->timestamp,
-				       RADIUS_ACL_TIMEOUT)) {
-			wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
-				   " has expired.", MAC2STR(entry->addr));
-			if (prev)
-				prev->next = entry->next;
-			else
-				hapd->acl_cache = entry->next;
-			hostapd_drv_set_radius_acl_expire(hapd, entry->addr);
-			tmp = entry;
-			entry = entry->next;
-			hostapd_acl_cache_free_entry(tmp);
-			continue;
-		}
-
-		prev = entry;
-		entry = entry->next;
+	struct hostapd_cached_radius_acl *entry, *tmp;
+
+	/* acl_cache_age is sorted by expiration time, so only the expired
+	 * entries from the beginning of the list need to be processed */
+	dl_list_for_each_safe(entry, tmp, &hapd->acl_cache_age,
+			      struct hostapd_cached_radius_acl, age) {
+		if (!os_reltime_expired(now, &entry->timestamp,
+					RADIUS_ACL_TIMEOUT))
+			break;
+		wpa_printf(MSG_DEBUG, "Cached ACL entry for " MACSTR
+			   " has expired.", MAC2STR(entry->addr));
+		hostapd_acl_cache_remove(hapd, entry, 1);
+		hapd->acl_cache_expirations++;
 	}
 }
 
@@ -514,7 +580,10 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 	query = hapd->acl_queries;
 	prev = NULL;
 	while (query) {
-		if (query->radius_id == hdr->identifier)
+		if (query->radius_id == hdr->identifier &&
+		    os_memcmp(query->radius_authenticator,
+			      radius_msg_get_hdr(req)->authenticator,
+			      sizeof(query->radius_authenticator)) == 0)
 			break;
 		prev = query;
 		query = query->next;
@@ -610,8 +679,7 @@ hostapd_acl_recv_radius(struct radius_msg *msg, struct radius_msg *req,
 			cache->accepted = HOSTAPD_ACL_REJECT;
 	} else
 		cache->accepted = HOSTAPD_ACL_REJECT;
-	cache->next = hapd->acl_cache;
-	hapd->acl_cache = cache;
+	hostapd_acl_cache_add(hapd, cache);
 
 #ifdef CONFIG_DRIVER_RADIUS_ACL
 	hostapd_drv_set_radius_acl_auth(hapd, query->addr, cache->accepted,
@@ -664,7 +732,7 @@ void hostapd_acl_deinit(struct hostapd_data *hapd)
 	struct hostapd_acl_query_data *query, *prev;
 
 #ifndef CONFIG_NO_RADIUS
-	hostapd_acl_cache_free(hapd->acl_cache);
+	hostapd_acl_cache_free(hapd);
 #endif /* CONFIG_NO_RADIUS */
 
 	query = hapd->acl_queries;
@@ -676,6 +744,43 @@ void hostapd_acl_deinit(struct hostapd_data *hapd)
 }
 
 
+/**
+ * hostapd_acl_get_mib - Get RADIUS ACL cache counters
+ * @hapd: hostapd BSS data
+ * @buf: Buffer for the text output
+ * @buflen: Length of buf in octets
+ * Returns: Number of octets written into buf
+ */
+int hostapd_acl_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen)
+{
+#ifndef CONFIG_NO_RADIUS
+	int ret;
+
+	if (hapd->conf->macaddr_acl != USE_EXTERNAL_RADIUS_AUTH)
+		return 0;
+
+	ret = os_snprintf(buf, buflen,
+			  "radiusAclCacheEntries=%u\n"
+			  "radiusAclCacheMaxEntries=%u\n"
+			  "radiusAclCacheHits=%u\n"
+			  "radiusAclCacheMisses=%u\n"
+			  "radiusAclCacheEvictions=%u\n"
+			  "radiusAclCacheExpirations=%u\n",
+			  hapd->acl_cache_num,
+			  hapd->conf->radius_acl_cache_size,
+			  hapd->acl_cache_hits,
+			  hapd->acl_cache_misses,
+			  hapd->acl_cache_evictions,
+			  hapd->acl_cache_expirations);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+	return ret;
+#else /* CONFIG_NO_RADIUS */
+	return 0;
+#endif /* CONFIG_NO_RADIUS */
+}
+
+
 void hostapd_free_psk_list(struct hostapd_sta_wpa_psk_short *psk)
 {
 	if (psk && psk->ref) {
@@ -28,5 +28,6 @@ int hostapd_acl_init(struct hostapd_data *hapd);
 void hostapd_acl_deinit(struct hostapd_data *hapd);
 void hostapd_free_psk_list(struct hostapd_sta_wpa_psk_short *psk);
 void hostapd_acl_expire(struct hostapd_data *hapd);
+int hostapd_acl_get_mib(struct hostapd_data *hapd, char *buf, size_t buflen);
 
 #endif /* IEEE802_11_AUTH_H */
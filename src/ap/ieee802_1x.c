@@ -615,6 +615,9 @@ static void ieee802_1x_encapsulate_radius(struct hostapd_data *hapd,
 		wpa_printf(MSG_INFO, "Could not make Request Authenticator");
 		goto fail;
 	}
+	os_memcpy(sm->radius_authenticator,
+		  radius_msg_get_hdr(msg)->authenticator,
+		  sizeof(sm->radius_authenticator));
 
 	if (sm->identity &&
 	    !radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
@@ -1614,6 +1617,7 @@ static void ieee802_1x_check_hs20(struct hostapd_data *hapd,
 
 struct sta_id_search {
 	u8 identifier;
+	const u8 *authenticator;
 	struct eapol_state_machine *sm;
 };
 
@@ -1626,7 +1630,9 @@ static int ieee802_1x_select_radius_identifier(struct hostapd_data *hapd,
 	struct eapol_state_machine *sm = sta->eapol_sm;
 
 	if (sm && sm->radius_identifier >= 0 &&
-	    sm->radius_identifier == id_search->identifier) {
+	    sm->radius_identifier == id_search->identifier &&
+	    os_memcmp(sm->radius_authenticator, id_search->authenticator,
+		      sizeof(sm->radius_authenticator)) == 0) {
 		id_search->sm = sm;
 		return 1;
 	}
@@ -1635,10 +1641,16 @@ static int ieee802_1x_select_radius_identifier(struct hostapd_data *hapd,
 
 
 static struct eapol_state_machine *
-ieee802_1x_search_radius_identifier(struct hostapd_data *hapd, u8 identifier)
+ieee802_1x_search_radius_identifier(struct hostapd_data *hapd,
+				    struct radius_msg *req)
 {
+	struct radius_hdr *hdr = radius_msg_get_hdr(req);
 	struct sta_id_search id_search;
-	id_search.identifier = identifier;
+
+	/* The same identifier can be pending on more than one RADIUS client
+	 * source socket, so match the Request Authenticator as well. */
+	id_search.identifier = hdr->identifier;
+	id_search.authenticator = hdr->authenticator;
 	id_search.sm = NULL;
 	ap_for_each_sta(hapd, ieee802_1x_select_radius_identifier, &id_search);
 	return id_search.sm;
@@ -1673,7 +1685,7 @@ ieee802_1x_receive_auth(struct radius_msg *msg, struct radius_msg *req,
 
 	os_memset(&vlan_desc, 0, sizeof(vlan_desc));
 
-	sm = ieee802_1x_search_radius_identifier(hapd, hdr->identifier);
+	sm = ieee802_1x_search_radius_identifier(hapd, req);
 	if (sm == NULL) {
 		wpa_printf(MSG_DEBUG, "IEEE 802.1X: Could not find matching "
 			   "station for this RADIUS message");
@@ -0,0 +1,539 @@
+/*
+ * hostapd / SAE commit worker pool and statistics
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Deriving the PWE and the shared secret k for an SAE Commit message takes a
+ * large number of bignum/EC operations (and even more so with the FFC groups).
+ * With CONFIG_SAE_THREADS and sae_threads > 0, this computation is done in a
+ * bounded pool of worker threads for new SAE authentications so that a burst
+ * of Commit messages does not block the eloop thread. The results are
+ * returned to the eloop thread through a pipe and the SAE state machine and
+ * frame transmission are handled there.
+ *
+ * A single pool (and a single set of statistics) is shared by all BSSs in
+ * the process so that the number of worker threads stays bounded regardless
+ * of the number of BSSs.
+ */
+
+#include "utils/includes.h"
+#ifdef CONFIG_SAE_THREADS
+#include <pthread.h>
+#endif /* CONFIG_SAE_THREADS */
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/sae.h"
+#include "hostapd.h"
+#include "sta_info.h"
+#include "ieee802_11.h"
+#include "sae_pool.h"
+
+#define SAE_POOL_MAX_THREADS 16
+#define SAE_POOL_MAX_PENDING_PER_THREAD 16
+#define SAE_POOL_MAX_GROUPS 8
+
+struct sae_group_stats {
+	int group;
+	unsigned int commits;
+	unsigned int failures;
+	unsigned int dropped;
+	unsigned int offloaded;
+	u64 compute_usec;
+	unsigned int compute_max_usec;
+	u64 latency_usec;
+	unsigned int latency_max_usec;
+};
+
+#ifdef CONFIG_SAE_THREADS
+
+/**
+ * struct sae_pool_job - SAE Commit message to be processed in a worker thread
+ */
+struct sae_pool_job {
+	struct dl_list list;
+	struct hostapd_data *hapd;
+	struct sta_info *sta; /* %NULL if the STA entry was removed */
+	struct sae_data *sae;
+	u8 addr[ETH_ALEN];
+	u8 own_addr[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
+	char *password;
+	int group;
+
+	/* Results from the worker thread */
+	int pwe_res;
+	int k_res;
+	struct os_reltime queued;
+	struct os_reltime started;
+	struct os_reltime finished;
+};
+
+#endif /* CONFIG_SAE_THREADS */
+
+/**
+ * struct sae_pool - SAE commit worker pool
+ */
+struct sae_pool {
+	unsigned int refcount;
+	struct sae_group_stats groups[SAE_POOL_MAX_GROUPS];
+	unsigned int num_groups;
+
+#ifdef CONFIG_SAE_THREADS
+	pthread_t threads[SAE_POOL_MAX_THREADS];
+	int num_threads;
+	unsigned int pending; /* queued or in progress */
+	unsigned int max_pending;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct dl_list jobs; /* struct sae_pool_job */
+	struct dl_list done; /* struct sae_pool_job */
+	int done_pipe[2];
+	int stop;
+#endif /* CONFIG_SAE_THREADS */
+};
+
+static struct sae_pool *sae_pool_global = NULL;
+
+
+static struct sae_group_stats * sae_pool_group(struct sae_pool *pool,
+					       int group)
+{
+	struct sae_group_stats *stats;
+	unsigned int i;
+
+	for (i = 0; i < pool->num_groups; i++) {
+		if (pool->groups[i].group == group)
+			return &pool->groups[i];
+	}
+	if (pool->num_groups == SAE_POOL_MAX_GROUPS)
+		return NULL;
+	stats = &pool->groups[pool->num_groups++];
+	stats->group = group;
+	return stats;
+}
+
+
+static unsigned int sae_pool_usec(struct os_reltime *a,
+				  struct os_reltime *b)
+{
+	struct os_reltime diff;
+
+	os_reltime_sub(a, b, &diff);
+	if (diff.sec < 0)
+		return 0;
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void sae_pool_account(struct sae_pool *pool, int group, int failed,
+			     unsigned int compute, unsigned int latency)
+{
+	struct sae_group_stats *stats;
+
+	stats = sae_pool_group(pool, group);
+	if (!stats)
+		return;
+	stats->commits++;
+	if (failed)
+		stats->failures++;
+	stats->compute_usec += compute;
+	if (compute > stats->compute_max_usec)
+		stats->compute_max_usec = compute;
+	stats->latency_usec += latency;
+	if (latency > stats->latency_max_usec)
+		stats->latency_max_usec = latency;
+}
+
+
+/**
+ * sae_pool_record - Record statistics for an inline SAE commit computation
+ * @pool: SAE pool from sae_pool_init()
+ * @group: Finite cyclic group
+ * @failed: Whether the commit processing failed
+ * @start: Time at which processing of the received Commit started
+ */
+void sae_pool_record(struct sae_pool *pool, int group, int failed,
+		     struct os_reltime *start)
+{
+	struct os_reltime now;
+	unsigned int usec;
+
+	if (!pool)
+		return;
+	os_get_reltime(&now);
+	usec = sae_pool_usec(&now, start);
+	sae_pool_account(pool, group, failed, usec, usec);
+}
+
+
+/**
+ * sae_pool_stats - Write SAE commit statistics into a text buffer
+ * @pool: SAE pool from sae_pool_init()
+ * @buf: Buffer for the text
+ * @buflen: Length of the buffer
+ * Returns: Number of bytes written to buf
+ */
+int sae_pool_stats(struct sae_pool *pool, char *buf, size_t buflen)
+{
+	char *pos = buf, *end = buf + buflen;
+	unsigned int i, threads = 0, pending = 0;
+	int ret;
+
+	if (pool) {
+#ifdef CONFIG_SAE_THREADS
+		threads = pool->num_threads;
+		pending = pool->pending;
+#endif /* CONFIG_SAE_THREADS */
+	}
+
+	ret = os_snprintf(pos, end - pos, "threads=%u\npending=%u\n",
+			  threads, pending);
+	if (os_snprintf_error(end - pos, ret))
+		return pos - buf;
+	pos += ret;
+
+	for (i = 0; pool && i < pool->num_groups; i++) {
+		struct sae_group_stats *s = &pool->groups[i];
+		unsigned int n = s->commits ? s->commits : 1;
+
+		ret = os_snprintf(pos, end - pos,
+				  "group=%d commits=%u failures=%u dropped=%u offloaded=%u compute_avg_usec=%u compute_max_usec=%u latency_avg_usec=%u latency_max_usec=%u\n",
+				  s->group, s->commits, s->failures,
+				  s->dropped, s->offloaded,
+				  (unsigned int) (s->compute_usec / n),
+				  s->compute_max_usec,
+				  (unsigned int) (s->latency_usec / n),
+				  s->latency_max_usec);
+		if (os_snprintf_error(end - pos, ret))
+			break;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
+
+
+#ifdef CONFIG_SAE_THREADS
+
+static void sae_pool_job_free(struct sae_pool_job *job)
+{
+	if (job->sta) {
+		job->sta->sae_job = NULL;
+	} else if (job->sae) {
+		/* The STA entry was removed while the job was pending */
+		sae_clear_data(job->sae);
+		os_free(job->sae);
+	}
+	str_clear_free(job->password);
+	os_free(job);
+}
+
+
+static void * sae_pool_thread(void *arg)
+{
+	struct sae_pool *pool = arg;
+	struct sae_pool_job *job;
+	int notify;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->stop) {
+		job = dl_list_first(&pool->jobs, struct sae_pool_job, list);
+		if (!job) {
+			pthread_cond_wait(&pool->cond, &pool->lock);
+			continue;
+		}
+		dl_list_del(&job->list);
+		pthread_mutex_unlock(&pool->lock);
+
+		os_get_reltime(&job->started);
+		job->pwe_res = sae_prepare_commit(job->own_addr, job->addr,
+						  (u8 *) job->password,
+						  os_strlen(job->password),
+						  job->sae);
+		if (job->pwe_res == 0)
+			job->k_res = sae_process_commit(job->sae);
+		os_get_reltime(&job->finished);
+
+		pthread_mutex_lock(&pool->lock);
+		/* Wake up the eloop thread only if it may be waiting */
+		notify = dl_list_empty(&pool->done);
+		dl_list_add_tail(&pool->done, &job->list);
+		if (notify && write(pool->done_pipe[1], "", 1) < 0) {
+			wpa_printf(MSG_INFO, "SAE: write(done_pipe): %s",
+				   strerror(errno));
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+
+static void sae_pool_jobs_done(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct sae_pool *pool = eloop_ctx;
+	struct sae_pool_job *job;
+	struct os_reltime now;
+	char buf[16];
+
+	if (read(sock, buf, sizeof(buf)) < 0) {
+		wpa_printf(MSG_INFO, "SAE: read(done_pipe): %s",
+			   strerror(errno));
+		return;
+	}
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		job = dl_list_first(&pool->done, struct sae_pool_job, list);
+		if (job) {
+			dl_list_del(&job->list);
+			pool->pending--;
+		}
+		pthread_mutex_unlock(&pool->lock);
+		if (!job)
+			break;
+
+		if (job->sta) {
+			job->sta->sae_job = NULL;
+			auth_sae_commit_done(job->hapd, job->sta, job->bssid,
+					     job->pwe_res, job->k_res);
+			job->sta = NULL;
+			job->sae = NULL;
+		} else {
+			wpa_printf(MSG_DEBUG,
+				   "SAE: Discard commit result for removed STA "
+				   MACSTR, MAC2STR(job->addr));
+		}
+
+		os_get_reltime(&now);
+		sae_pool_account(pool, job->group,
+				 job->pwe_res < 0 || job->k_res < 0,
+				 sae_pool_usec(&job->finished, &job->started),
+				 sae_pool_usec(&now, &job->queued));
+		sae_pool_job_free(job);
+	}
+}
+
+
+/**
+ * sae_pool_commit - Process a received SAE Commit message in a worker thread
+ * @pool: SAE pool from sae_pool_init()
+ * @hapd: BSS data
+ * @sta: STA entry with the parsed peer commit in sta->sae
+ * @bssid: BSSID for the response
+ * Returns: 0 if queued, 1 if the pool is full and the frame is to be dropped,
+ * or -1 if the message needs to be processed inline (including BSSs with
+ * sae_threads=0)
+ *
+ * On completion, auth_sae_commit_done() is called in the eloop thread. The
+ * sta->sae data is owned by the worker until then.
+ */
+int sae_pool_commit(struct sae_pool *pool, struct hostapd_data *hapd,
+		    struct sta_info *sta, const u8 *bssid)
+{
+	struct sae_pool_job *job;
+	struct sae_group_stats *stats;
+
+	if (!pool || pool->num_threads == 0 || hapd->conf->sae_threads <= 0 ||
+	    sta->sae_job || sta->sae->state != SAE_NOTHING ||
+	    !hapd->conf->ssid.wpa_passphrase)
+		return -1;
+
+	if (pool->pending >= pool->max_pending) {
+		stats = sae_pool_group(pool, sta->sae->group);
+		if (stats)
+			stats->dropped++;
+		wpa_printf(MSG_DEBUG,
+			   "SAE: Worker queue full - drop commit from " MACSTR,
+			   MAC2STR(sta->addr));
+		return 1;
+	}
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->password = os_strdup(hapd->conf->ssid.wpa_passphrase);
+	if (!job->password) {
+		os_free(job);
+		return -1;
+	}
+	job->hapd = hapd;
+	job->sta = sta;
+	job->sae = sta->sae;
+	job->group = sta->sae->group;
+	os_memcpy(job->addr, sta->addr, ETH_ALEN);
+	os_memcpy(job->own_addr, hapd->own_addr, ETH_ALEN);
+	os_memcpy(job->bssid, bssid, ETH_ALEN);
+	os_get_reltime(&job->queued);
+	sta->sae_job = job;
+
+	stats = sae_pool_group(pool, job->group);
+	if (stats)
+		stats->offloaded++;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->pending++;
+	dl_list_add_tail(&pool->jobs, &job->list);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+
+/**
+ * sae_pool_sta_removed - Detach a pending SAE commit job from a STA entry
+ * @sta: STA entry that is being freed
+ *
+ * The SAE data is handed over to the job and freed once the worker thread
+ * has completed the computation.
+ */
+void sae_pool_sta_removed(struct sta_info *sta)
+{
+	if (!sta->sae_job)
+		return;
+	sta->sae_job->sta = NULL;
+	sta->sae_job = NULL;
+	sta->sae = NULL;
+}
+
+
+static void sae_pool_stop(struct sae_pool *pool)
+{
+	struct sae_pool_job *job, *tmp;
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+	pool->num_threads = 0;
+
+	dl_list_for_each_safe(job, tmp, &pool->jobs, struct sae_pool_job,
+			      list) {
+		dl_list_del(&job->list);
+		sae_pool_job_free(job);
+	}
+	dl_list_for_each_safe(job, tmp, &pool->done, struct sae_pool_job,
+			      list) {
+		dl_list_del(&job->list);
+		sae_pool_job_free(job);
+	}
+	pool->pending = 0;
+
+	eloop_unregister_read_sock(pool->done_pipe[0]);
+	close(pool->done_pipe[0]);
+	close(pool->done_pipe[1]);
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+}
+
+
+static int sae_pool_start(struct sae_pool *pool, int threads)
+{
+	if (threads > SAE_POOL_MAX_THREADS)
+		threads = SAE_POOL_MAX_THREADS;
+
+	if (pipe(pool->done_pipe) < 0) {
+		wpa_printf(MSG_ERROR, "SAE: pipe: %s", strerror(errno));
+		return -1;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	dl_list_init(&pool->jobs);
+	dl_list_init(&pool->done);
+
+	if (eloop_register_read_sock(pool->done_pipe[0], sae_pool_jobs_done,
+				     pool, NULL)) {
+		sae_pool_stop(pool);
+		return -1;
+	}
+
+	while (pool->num_threads < threads) {
+		if (pthread_create(&pool->threads[pool->num_threads], NULL,
+				   sae_pool_thread, pool) != 0)
+			break;
+		pool->num_threads++;
+	}
+
+	if (pool->num_threads == 0) {
+		sae_pool_stop(pool);
+		return -1;
+	}
+	pool->max_pending = pool->num_threads *
+		SAE_POOL_MAX_PENDING_PER_THREAD;
+
+	wpa_printf(MSG_DEBUG, "SAE: Started %d commit worker threads",
+		   pool->num_threads);
+	return 0;
+}
+
+#endif /* CONFIG_SAE_THREADS */
+
+
+/**
+ * sae_pool_get - Get a reference to the shared SAE commit processing data
+ * @threads: Number of worker threads requested by the BSS or 0 to process
+ *	commits inline
+ * Returns: Pointer to the pool or %NULL on failure
+ *
+ * The pool is shared by all BSSs in the process. The worker threads are
+ * started when the first BSS with threads > 0 gets a reference; later values
+ * do not change the number of threads. The reference is released with
+ * sae_pool_put().
+ */
+struct sae_pool * sae_pool_get(int threads)
+{
+	struct sae_pool *pool = sae_pool_global;
+
+	if (!pool) {
+		pool = os_zalloc(sizeof(*pool));
+		if (!pool)
+			return NULL;
+		sae_pool_global = pool;
+	}
+	pool->refcount++;
+
+#ifdef CONFIG_SAE_THREADS
+	if (threads > 0 && pool->num_threads == 0 &&
+	    sae_pool_start(pool, threads) < 0) {
+		wpa_printf(MSG_INFO,
+			   "SAE: Could not start worker threads - process commits inline");
+		pool->num_threads = 0;
+	}
+#else /* CONFIG_SAE_THREADS */
+	if (threads > 0)
+		wpa_printf(MSG_INFO,
+			   "SAE: sae_threads requires CONFIG_SAE_THREADS - process commits inline");
+#endif /* CONFIG_SAE_THREADS */
+
+	return pool;
+}
+
+
+/**
+ * sae_pool_put - Release a reference to the shared SAE commit processing data
+ * @pool: SAE pool from sae_pool_get() or %NULL
+ *
+ * The worker threads are stopped when the last reference is released. The
+ * STA entries of the BSS must have been freed before this so that no pending
+ * job refers to them (see sae_pool_sta_removed()).
+ */
+void sae_pool_put(struct sae_pool *pool)
+{
+	if (!pool || --pool->refcount > 0)
+		return;
+#ifdef CONFIG_SAE_THREADS
+	if (pool->num_threads)
+		sae_pool_stop(pool);
+#endif /* CONFIG_SAE_THREADS */
+	if (pool == sae_pool_global)
+		sae_pool_global = NULL;
+	os_free(pool);
+}
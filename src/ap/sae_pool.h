@@ -0,0 +1,39 @@
+/*
+ * hostapd / SAE commit worker pool and statistics
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef SAE_POOL_H
+#define SAE_POOL_H
+
+struct hostapd_data;
+struct sta_info;
+struct sae_pool;
+
+struct sae_pool * sae_pool_get(int threads);
+void sae_pool_put(struct sae_pool *pool);
+void sae_pool_record(struct sae_pool *pool, int group, int failed,
+		     struct os_reltime *start);
+int sae_pool_stats(struct sae_pool *pool, char *buf, size_t buflen);
+
+#ifdef CONFIG_SAE_THREADS
+int sae_pool_commit(struct sae_pool *pool, struct hostapd_data *hapd,
+		    struct sta_info *sta, const u8 *bssid);
+void sae_pool_sta_removed(struct sta_info *sta);
+#else /* CONFIG_SAE_THREADS */
+static inline int sae_pool_commit(struct sae_pool *pool,
+				  struct hostapd_data *hapd,
+				  struct sta_info *sta, const u8 *bssid)
+{
+	return -1;
+}
+
+static inline void sae_pool_sta_removed(struct sta_info *sta)
+{
+}
+#endif /* CONFIG_SAE_THREADS */
+
+#endif /* SAE_POOL_H */
@@ -34,6 +34,7 @@
 #include "wnm_ap.h"
 #include "mbo_ap.h"
 #include "ndisc_snoop.h"
+#include "sae_pool.h"
 #include "sta_info.h"
 #include "vlan.h"
 
@@ -330,6 +331,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	os_free(sta->hs20_session_info_url);
 
 #ifdef CONFIG_SAE
+	sae_pool_sta_removed(sta);
 	sae_clear_data(sta->sae);
 	os_free(sta->sae);
 #endif /* CONFIG_SAE */
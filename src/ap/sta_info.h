@@ -193,6 +193,9 @@ struct sta_info {
 #ifdef CONFIG_SAE
 	struct sae_data *sae;
 	unsigned int mesh_sae_pmksa_caching:1;
+#ifdef CONFIG_SAE_THREADS
+	struct sae_pool_job *sae_job; /* commit computation in progress */
+#endif /* CONFIG_SAE_THREADS */
 #endif /* CONFIG_SAE */
 
 	u32 session_timeout; /* valid only if session_timeout_set == 1 */
@@ -82,6 +82,16 @@ static inline void wpa_auth_psk_failure_report(
 }
 
 
+static inline void wpa_auth_psk_match_report(
+	struct wpa_authenticator *wpa_auth, const u8 *addr,
+	const u8 *p2p_dev_addr, const u8 *psk)
+{
+	if (wpa_auth->cb.psk_match_report)
+		wpa_auth->cb.psk_match_report(wpa_auth->cb.ctx, addr,
+					      p2p_dev_addr, psk);
+}
+
+
 static inline void wpa_auth_set_eapol(struct wpa_authenticator *wpa_auth,
 				      const u8 *addr, wpa_eapol_variable var,
 				      int value)
@@ -862,6 +872,9 @@ static int wpa_try_alt_snonce(struct wpa_state_machine *sm, u8 *data,
 
 	wpa_printf(MSG_DEBUG,
 		   "WPA: Earlier SNonce resulted in matching MIC");
+	if (wpa_key_mgmt_wpa_psk(sm->wpa_key_mgmt))
+		wpa_auth_psk_match_report(sm->wpa_auth, sm->addr,
+					  sm->p2p_dev_addr, pmk);
 	sm->alt_snonce_valid = 0;
 	os_memcpy(sm->SNonce, sm->alt_SNonce, WPA_NONCE_LEN);
 	os_memcpy(&sm->PTK, &PTK, sizeof(PTK));
@@ -2120,6 +2133,8 @@ SM_STATE(WPA_PTK, PTKCALCNEGOTIATING)
 		 */
 		os_memcpy(sm->PMK, pmk, PMK_LEN);
 		sm->pmk_len = PMK_LEN;
+		wpa_auth_psk_match_report(sm->wpa_auth, sm->addr,
+					  sm->p2p_dev_addr, pmk);
 	}
 
 	sm->MICVerified = TRUE;
@@ -161,6 +161,15 @@ static void hostapd_wpa_auth_psk_failure_report(void *ctx, const u8 *addr)
 }
 
 
+static void hostapd_wpa_auth_psk_match_report(void *ctx, const u8 *addr,
+					      const u8 *p2p_dev_addr,
+					      const u8 *psk)
+{
+	struct hostapd_data *hapd = ctx;
+	hostapd_wpa_psk_matched(hapd->conf, addr, p2p_dev_addr, psk);
+}
+
+
 static void hostapd_wpa_auth_set_eapol(void *ctx, const u8 *addr,
 				       wpa_eapol_variable var, int value)
 {
@@ -609,6 +618,7 @@ int hostapd_setup_wpa(struct hostapd_data *hapd)
 	cb.disconnect = hostapd_wpa_auth_disconnect;
 	cb.mic_failure_report = hostapd_wpa_auth_mic_failure_report;
 	cb.psk_failure_report = hostapd_wpa_auth_psk_failure_report;
+	cb.psk_match_report = hostapd_wpa_auth_psk_match_report;
 	cb.set_eapol = hostapd_wpa_auth_set_eapol;
 	cb.get_eapol = hostapd_wpa_auth_get_eapol;
 	cb.get_psk = hostapd_wpa_auth_get_psk;
@@ -133,6 +133,7 @@ static int hostapd_wps_new_psk_cb(void *ctx, const u8 *mac_addr,
 
 	p->next = ssid->wpa_psk;
 	ssid->wpa_psk = p;
+	hostapd_config_wpa_psk_changed(ssid);
 
 	if (ssid->wpa_psk_file) {
 		FILE *f;
@@ -373,6 +374,7 @@ static int hapd_wps_reconfig_in_memory(struct hostapd_data *hapd,
 				bss->ssid.wpa_passphrase = NULL;
 			}
 		}
+		hostapd_config_wpa_psk_changed(&bss->ssid);
 		bss->auth_algs = 1;
 	} else {
 		/*
@@ -866,6 +868,7 @@ static void hostapd_wps_clear_ies(struct hostapd_data *hapd, int deinit_only)
 
 	wpabuf_free(hapd->wps_probe_resp_ie);
 	hapd->wps_probe_resp_ie = NULL;
+	hostapd_flush_probe_resp_tmpl(hapd);
 
 	if (deinit_only) {
 		if (hapd->drv_priv)
@@ -131,6 +131,37 @@ int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 }
 
 
+int ctrl_iface_attach_bin(struct dl_list *ctrl_dst,
+			  struct sockaddr_storage *from, socklen_t fromlen,
+			  const char *events)
+{
+	struct wpa_ctrl_dst *dst;
+	u32 mask;
+
+	mask = strtoul(events, NULL, 16);
+	if (!mask)
+		return -1;
+
+	dl_list_for_each(dst, ctrl_dst, struct wpa_ctrl_dst, list) {
+		if (!sockaddr_compare(from, fromlen,
+				      &dst->addr, dst->addrlen)) {
+			sockaddr_print(MSG_DEBUG,
+				       "CTRL_IFACE changed binary monitor events",
+				       from, fromlen);
+			dst->bin_events = mask;
+			return 0;
+		}
+	}
+
+	if (ctrl_iface_attach(ctrl_dst, from, fromlen) < 0)
+		return -1;
+	dst = dl_list_first(ctrl_dst, struct wpa_ctrl_dst, list);
+	dst->bin_events = mask;
+	wpa_printf(MSG_DEBUG, "CTRL_IFACE binary events 0x%x", mask);
+	return 0;
+}
+
+
 int ctrl_iface_detach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		      socklen_t fromlen)
 {
@@ -23,6 +23,7 @@ struct wpa_ctrl_dst {
 	socklen_t addrlen;
 	int debug_level;
 	int errors;
+	u32 bin_events; /* binary event subscription; 0 = text monitor */
 };
 
 void sockaddr_print(int level, const char *msg, struct sockaddr_storage *sock,
@@ -30,6 +31,9 @@ void sockaddr_print(int level, const char *msg, struct sockaddr_storage *sock,
 
 int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		       socklen_t fromlen);
+int ctrl_iface_attach_bin(struct dl_list *ctrl_dst,
+			  struct sockaddr_storage *from, socklen_t fromlen,
+			  const char *events);
 int ctrl_iface_detach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		      socklen_t fromlen);
 int ctrl_iface_level(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
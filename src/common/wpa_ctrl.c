@@ -594,6 +594,61 @@ int wpa_ctrl_detach(struct wpa_ctrl *ctrl)
 }
 
 
+int wpa_ctrl_attach_bin(struct wpa_ctrl *ctrl, unsigned int events)
+{
+	char cmd[30], buf[10];
+	size_t len = sizeof(buf);
+	int ret;
+
+	ret = os_snprintf(cmd, sizeof(cmd), "ATTACH_BIN %x", events);
+	if (os_snprintf_error(sizeof(cmd), ret))
+		return -1;
+	ret = wpa_ctrl_request(ctrl, cmd, os_strlen(cmd), buf, &len, NULL);
+	if (ret < 0)
+		return ret;
+	if (len == 3 && os_memcmp(buf, "OK\n", 3) == 0)
+		return 0;
+	return -1;
+}
+
+
+int wpa_ctrl_bin_event(const char *msg, size_t len,
+		       const unsigned char **attrs, size_t *attrs_len)
+{
+	const u8 *pos = (const u8 *) msg;
+
+	if (len < WPA_CTRL_BIN_PREFIX_LEN + 2 ||
+	    os_memcmp(msg, WPA_CTRL_BIN_PREFIX, WPA_CTRL_BIN_PREFIX_LEN) != 0)
+		return -1;
+	pos += WPA_CTRL_BIN_PREFIX_LEN;
+	*attrs = pos + 2;
+	*attrs_len = len - WPA_CTRL_BIN_PREFIX_LEN - 2;
+	return WPA_GET_BE16(pos);
+}
+
+
+const unsigned char * wpa_ctrl_bin_attr(const unsigned char *attrs,
+					size_t attrs_len, int type,
+					size_t *len)
+{
+	const u8 *pos = attrs, *end = attrs + attrs_len;
+	u16 alen;
+
+	while (end - pos >= 4) {
+		alen = WPA_GET_BE16(pos + 2);
+		if (alen > end - pos - 4)
+			break;
+		if (WPA_GET_BE16(pos) == type) {
+			*len = alen;
+			return pos + 4;
+		}
+		pos += 4 + alen;
+	}
+
+	return NULL;
+}
+
+
 #ifdef CTRL_IFACE_SOCKET
 
 int wpa_ctrl_recv(struct wpa_ctrl *ctrl, char *reply, size_t *reply_len)
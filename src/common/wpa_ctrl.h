@@ -336,6 +336,42 @@ enum wpa_vendor_elem_frame {
 };
 
 
+/*
+ * Binary event messages
+ *
+ * Monitors that register with the "ATTACH_BIN <hex event mask>" command
+ * receive selected events as binary messages instead of the text events.
+ * Each message starts with WPA_CTRL_BIN_PREFIX followed by the event type
+ * (enum wpa_ctrl_bin_event, 16-bit big endian) and a sequence of attributes,
+ * each of which is encoded as 16-bit big endian type, 16-bit big endian
+ * length, and value. Integer attributes are 32-bit big endian values.
+ */
+#define WPA_CTRL_BIN_PREFIX "<B>"
+#define WPA_CTRL_BIN_PREFIX_LEN 3
+
+enum wpa_ctrl_bin_event {
+	WPA_CTRL_BIN_EV_BSS_ADDED = 0,
+	WPA_CTRL_BIN_EV_BSS_REMOVED = 1,
+	WPA_CTRL_BIN_EV_SCAN_RESULTS = 2,
+	WPA_CTRL_BIN_EV_STATE_CHANGE = 3,
+	WPA_CTRL_BIN_EV_DISCONNECTED = 4,
+	WPA_CTRL_BIN_EV_MAX /* must be <= 32 */
+};
+
+enum wpa_ctrl_bin_attr {
+	WPA_CTRL_BIN_ATTR_IFNAME = 1, /* string without nul termination */
+	WPA_CTRL_BIN_ATTR_ID = 2, /* u32: BSS entry id */
+	WPA_CTRL_BIN_ATTR_BSSID = 3, /* 6 octets */
+	WPA_CTRL_BIN_ATTR_SSID = 4, /* 0..32 octets */
+	WPA_CTRL_BIN_ATTR_FREQ = 5, /* u32: MHz */
+	WPA_CTRL_BIN_ATTR_SIGNAL = 6, /* u32: signed dBm */
+	WPA_CTRL_BIN_ATTR_STATE = 7, /* u32: enum wpa_states */
+	WPA_CTRL_BIN_ATTR_OLD_STATE = 8, /* u32: enum wpa_states */
+	WPA_CTRL_BIN_ATTR_NETWORK_ID = 9, /* u32: signed network id */
+	WPA_CTRL_BIN_ATTR_REASON = 10, /* u32: IEEE 802.11 reason code */
+	WPA_CTRL_BIN_ATTR_LOCALLY_GENERATED = 11, /* flag (zero length) */
+};
+
 /* wpa_supplicant/hostapd control interface access */
 
 /**
@@ -430,6 +466,46 @@ int wpa_ctrl_attach(struct wpa_ctrl *ctrl);
 int wpa_ctrl_detach(struct wpa_ctrl *ctrl);
 
 
+/**
+ * wpa_ctrl_attach_bin - Register as a binary event monitor
+ * @ctrl: Control interface data from wpa_ctrl_open()
+ * @events: Bitmap of subscribed events (BIT(enum wpa_ctrl_bin_event))
+ * Returns: 0 on success, -1 on failure, -2 on timeout
+ *
+ * This function registers the control interface connection as a monitor that
+ * receives only the selected events in binary format. Text events are not
+ * delivered to binary monitors. Calling this again replaces the subscription
+ * mask. The registration is removed with wpa_ctrl_detach().
+ */
+int wpa_ctrl_attach_bin(struct wpa_ctrl *ctrl, unsigned int events);
+
+
+/**
+ * wpa_ctrl_bin_event - Parse the header of a binary event message
+ * @msg: Message received with wpa_ctrl_recv()
+ * @len: Length of the message
+ * @attrs: Pointer for returning the start of the attributes
+ * @attrs_len: Pointer for returning the length of the attributes
+ * Returns: Event type (enum wpa_ctrl_bin_event) or -1 if msg is not a binary
+ * event message
+ */
+int wpa_ctrl_bin_event(const char *msg, size_t len,
+		       const unsigned char **attrs, size_t *attrs_len);
+
+
+/**
+ * wpa_ctrl_bin_attr - Find an attribute in a binary event message
+ * @attrs: Attributes from wpa_ctrl_bin_event()
+ * @attrs_len: Length of the attributes
+ * @type: Attribute type (enum wpa_ctrl_bin_attr)
+ * @len: Pointer for returning the length of the attribute value
+ * Returns: Pointer to the attribute value or %NULL if not found
+ */
+const unsigned char * wpa_ctrl_bin_attr(const unsigned char *attrs,
+					size_t attrs_len, int type,
+					size_t *len);
+
+
 /**
  * wpa_ctrl_recv - Receive a pending control interface message
  * @ctrl: Control interface data from wpa_ctrl_open()
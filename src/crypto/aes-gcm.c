@@ -13,6 +13,21 @@
 #include "aes.h"
 #include "aes_wrap.h"
 
+/*
+ * GHASH with the PCLMULQDQ carry-less multiplication instruction is selected
+ * at run time when the CPU supports it; gf_mult() is used otherwise.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+	!defined(CONFIG_NO_AES_NI)
+#define GHASH_CLMUL
+#define GHASH_CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#endif /* x86 && !CONFIG_NO_AES_NI */
+
+int ghash_clmul_disabled = 0;
+
 static void inc32(u8 *block)
 {
 	u32 val;
@@ -33,66 +48,201 @@ static void xor_block(u8 *dst, const u8 *src)
 }
 
 
-static void shift_right_block(u8 *v)
-{
-	u32 val;
+/*
+ * GHASH key: hash subkey H and the multiples of H for the 4-bit table-driven
+ * multiplication (Shoup's method). HH/HL are the high/low halves of
+ * i * H for each 4-bit value i in the bit-reflected representation of GCM.
+ */
+struct ghash_key {
+	u8 H[AES_BLOCK_SIZE];
+	u64 HH[16];
+	u64 HL[16];
+};
 
-	val = WPA_GET_BE32(v + 12);
-	val >>= 1;
-	if (v[11] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 12, val);
-
-	val = WPA_GET_BE32(v + 8);
-	val >>= 1;
-	if (v[7] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 8, val);
-
-	val = WPA_GET_BE32(v + 4);
-	val >>= 1;
-	if (v[3] & 0x01)
-		val |= 0x80000000;
-	WPA_PUT_BE32(v + 4, val);
-
-	val = WPA_GET_BE32(v);
-	val >>= 1;
-	WPA_PUT_BE32(v, val);
-}
 
+/* Reduction of the four bits shifted out of Z, multiplied by R */
+static const u16 ghash_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
 
-/* Multiplication in GF(2^128) */
-static void gf_mult(const u8 *x, const u8 *y, u8 *z)
+
+static void ghash_key_setup(struct ghash_key *gk)
 {
-	u8 v[16];
+	u64 vh, vl;
+	u32 t;
 	int i, j;
 
-	os_memset(z, 0, 16); /* Z_0 = 0^128 */
-	os_memcpy(v, y, 16); /* V_0 = Y */
-
-	for (i = 0; i < 16; i++) {
-		for (j = 0; j < 8; j++) {
-			if (x[i] & BIT(7 - j)) {
-				/* Z_(i + 1) = Z_i XOR V_i */
-				xor_block(z, v);
-			} else {
-				/* Z_(i + 1) = Z_i */
-			}
-
-			if (v[15] & 0x01) {
-				/* V_(i + 1) = (V_i >> 1) XOR R */
-				shift_right_block(v);
-				/* R = 11100001 || 0^120 */
-				v[0] ^= 0xe1;
-			} else {
-				/* V_(i + 1) = V_i >> 1 */
-				shift_right_block(v);
-			}
+	vh = WPA_GET_BE64(gk->H);
+	vl = WPA_GET_BE64(gk->H + 8);
+
+	/* 8 corresponds to 1 (the first bit) in the reflected order */
+	gk->HH[0] = 0;
+	gk->HL[0] = 0;
+	gk->HH[8] = vh;
+	gk->HL[8] = vl;
+
+	/* 4, 2, 1: V_(i + 1) = V_i >> 1 (XOR R if the LSB was set) */
+	for (i = 4; i > 0; i >>= 1) {
+		t = (vl & 1) * 0xe1000000U;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ ((u64) t << 32);
+		gk->HH[i] = vh;
+		gk->HL[i] = vl;
+	}
+
+	/* The remaining entries are XOR combinations of the powers */
+	for (i = 2; i <= 8; i *= 2) {
+		vh = gk->HH[i];
+		vl = gk->HL[i];
+		for (j = 1; j < i; j++) {
+			gk->HH[i + j] = vh ^ gk->HH[j];
+			gk->HL[i + j] = vl ^ gk->HL[j];
+		}
+	}
+}
+
+
+/* Multiplication in GF(2^128): y = y dot H */
+static void gf_mult_table(const struct ghash_key *gk, u8 *y)
+{
+	u64 zh, zl;
+	u8 lo, hi, rem;
+	int i;
+
+	lo = y[15] & 0x0f;
+	zh = gk->HH[lo];
+	zl = gk->HL[lo];
+
+	for (i = 15; i >= 0; i--) {
+		lo = y[i] & 0x0f;
+		hi = y[i] >> 4;
+
+		if (i != 15) {
+			rem = zl & 0x0f;
+			zl = (zh << 60) | (zl >> 4);
+			zh = zh >> 4;
+			zh ^= (u64) ghash_last4[rem] << 48;
+			zh ^= gk->HH[lo];
+			zl ^= gk->HL[lo];
 		}
+
+		rem = zl & 0x0f;
+		zl = (zh << 60) | (zl >> 4);
+		zh = zh >> 4;
+		zh ^= (u64) ghash_last4[rem] << 48;
+		zh ^= gk->HH[hi];
+		zl ^= gk->HL[hi];
 	}
+
+	WPA_PUT_BE64(y, zh);
+	WPA_PUT_BE64(y + 8, zl);
 }
 
 
+#ifdef GHASH_CLMUL
+
+static int ghash_clmul_available(void)
+{
+	static int clmul = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (clmul < 0) {
+		clmul = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			(ecx & bit_PCLMUL) && (ecx & bit_SSSE3);
+		wpa_printf(MSG_DEBUG, "GCM: PCLMULQDQ %ssupported",
+			   clmul ? "" : "not ");
+	}
+
+	return clmul && !ghash_clmul_disabled;
+}
+
+
+/*
+ * Multiplication in GF(2^128) on byte-reflected operands; see Intel white
+ * paper "Intel Carry-Less Multiplication Instruction and its Usage for
+ * Computing the GCM Mode" (Gueron, Kounavis), Figure 5.
+ */
+static inline __m128i GHASH_CLMUL_TARGET gf_mult_clmul(__m128i a, __m128i b)
+{
+	__m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+	/* 256-bit carry-less product t6:t3 */
+	t3 = _mm_clmulepi64_si128(a, b, 0x00);
+	t4 = _mm_clmulepi64_si128(a, b, 0x10);
+	t5 = _mm_clmulepi64_si128(a, b, 0x01);
+	t6 = _mm_clmulepi64_si128(a, b, 0x11);
+	t4 = _mm_xor_si128(t4, t5);
+	t5 = _mm_slli_si128(t4, 8);
+	t4 = _mm_srli_si128(t4, 8);
+	t3 = _mm_xor_si128(t3, t5);
+	t6 = _mm_xor_si128(t6, t4);
+
+	/* Shift the product left by one bit for the reflected bit order */
+	t7 = _mm_srli_epi32(t3, 31);
+	t8 = _mm_srli_epi32(t6, 31);
+	t3 = _mm_slli_epi32(t3, 1);
+	t6 = _mm_slli_epi32(t6, 1);
+	t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	t3 = _mm_or_si128(t3, t7);
+	t6 = _mm_or_si128(t6, t8);
+	t6 = _mm_or_si128(t6, t9);
+
+	/* Reduce modulo x^128 + x^7 + x^2 + x + 1 */
+	t7 = _mm_slli_epi32(t3, 31);
+	t8 = _mm_slli_epi32(t3, 30);
+	t9 = _mm_slli_epi32(t3, 25);
+	t7 = _mm_xor_si128(t7, t8);
+	t7 = _mm_xor_si128(t7, t9);
+	t8 = _mm_srli_si128(t7, 4);
+	t7 = _mm_slli_si128(t7, 12);
+	t3 = _mm_xor_si128(t3, t7);
+	t2 = _mm_srli_epi32(t3, 1);
+	t4 = _mm_srli_epi32(t3, 2);
+	t5 = _mm_srli_epi32(t3, 7);
+	t2 = _mm_xor_si128(t2, t4);
+	t2 = _mm_xor_si128(t2, t5);
+	t2 = _mm_xor_si128(t2, t8);
+	t3 = _mm_xor_si128(t3, t2);
+
+	return _mm_xor_si128(t6, t3);
+}
+
+
+static void GHASH_CLMUL_TARGET ghash_clmul(const u8 *h, const u8 *x,
+					   size_t xlen, u8 *y)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					   8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i hv, yv, xv;
+	u8 tmp[16];
+
+	hv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) h), bswap);
+	yv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) y), bswap);
+
+	for (; xlen >= 16; xlen -= 16, x += 16) {
+		xv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) x),
+				      bswap);
+		yv = gf_mult_clmul(_mm_xor_si128(yv, xv), hv);
+	}
+
+	if (xlen) {
+		/* Add zero padded last block */
+		os_memcpy(tmp, x, xlen);
+		os_memset(tmp + xlen, 0, sizeof(tmp) - xlen);
+		xv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) tmp),
+				      bswap);
+		yv = gf_mult_clmul(_mm_xor_si128(yv, xv), hv);
+	}
+
+	_mm_storeu_si128((__m128i *) y, _mm_shuffle_epi8(yv, bswap));
+}
+
+#endif /* GHASH_CLMUL */
+
+
 static void ghash_start(u8 *y)
 {
 	/* Y_0 = 0^128 */
@@ -100,12 +250,20 @@ static void ghash_start(u8 *y)
 }
 
 
-static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
+static void ghash(const struct ghash_key *gk, const u8 *x, size_t xlen,
+		  u8 *y)
 {
 	size_t m, i;
 	const u8 *xpos = x;
 	u8 tmp[16];
 
+#ifdef GHASH_CLMUL
+	if (ghash_clmul_available()) {
+		ghash_clmul(gk->H, x, xlen, y);
+		return;
+	}
+#endif /* GHASH_CLMUL */
+
 	m = xlen / 16;
 
 	for (i = 0; i < m; i++) {
@@ -116,8 +274,7 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 		/* dot operation:
 		 * multiplication operation for binary Galois (finite) field of
 		 * 2^128 elements */
-		gf_mult(y, h, tmp);
-		os_memcpy(y, tmp, 16);
+		gf_mult_table(gk, y);
 	}
 
 	if (x + xlen > xpos) {
@@ -132,47 +289,55 @@ static void ghash(const u8 *h, const u8 *x, size_t xlen, u8 *y)
 		/* dot operation:
 		 * multiplication operation for binary Galois (finite) field of
 		 * 2^128 elements */
-		gf_mult(y, h, tmp);
-		os_memcpy(y, tmp, 16);
+		gf_mult_table(gk, y);
 	}
 
 	/* Return Y_m */
 }
 
 
+/* Number of counter blocks encrypted per batch in aes_gctr() */
+#define GCTR_BLOCKS 8
+
 static void aes_gctr(void *aes, const u8 *icb, const u8 *x, size_t xlen, u8 *y)
 {
-	size_t i, n, last;
-	u8 cb[AES_BLOCK_SIZE], tmp[AES_BLOCK_SIZE];
-	const u8 *xpos = x;
-	u8 *ypos = y;
+	u8 cb[GCTR_BLOCKS * AES_BLOCK_SIZE], ks[GCTR_BLOCKS * AES_BLOCK_SIZE];
+	size_t i, n, len;
+	u32 ctr;
 
 	if (xlen == 0)
 		return;
 
-	n = xlen / 16;
+	/* Only the last 32 bits of the counter blocks change (inc_32) */
+	for (i = 0; i < GCTR_BLOCKS; i++)
+		os_memcpy(&cb[i * AES_BLOCK_SIZE], icb, AES_BLOCK_SIZE - 4);
+	ctr = WPA_GET_BE32(icb + AES_BLOCK_SIZE - 4);
 
-	os_memcpy(cb, icb, AES_BLOCK_SIZE);
-	/* Full blocks */
-	for (i = 0; i < n; i++) {
-		aes_encrypt(aes, cb, ypos);
-		xor_block(ypos, xpos);
-		xpos += AES_BLOCK_SIZE;
-		ypos += AES_BLOCK_SIZE;
-		inc32(cb);
-	}
+	while (xlen) {
+		len = xlen < sizeof(ks) ? xlen : sizeof(ks);
+		n = (len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+
+		for (i = 0; i < n; i++) {
+			WPA_PUT_BE32(&cb[(i + 1) * AES_BLOCK_SIZE - 4], ctr);
+			ctr++;
+		}
+		aes_encrypt_blocks(aes, cb, ks, n);
+
+		/* The last, partial block uses only the needed key stream */
+		for (i = 0; i < len; i++)
+			y[i] = x[i] ^ ks[i];
 
-	last = x + xlen - xpos;
-	if (last) {
-		/* Last, partial block */
-		aes_encrypt(aes, cb, tmp);
-		for (i = 0; i < last; i++)
-			*ypos++ = *xpos++ ^ tmp[i];
+		x += len;
+		y += len;
+		xlen -= len;
 	}
+
+	os_memset(ks, 0, sizeof(ks));
 }
 
 
-static void * aes_gcm_init_hash_subkey(const u8 *key, size_t key_len, u8 *H)
+static void * aes_gcm_init_hash_subkey(const u8 *key, size_t key_len,
+				       struct ghash_key *gk)
 {
 	void *aes;
 
@@ -181,15 +346,17 @@ static void * aes_gcm_init_hash_subkey(const u8 *key, size_t key_len, u8 *H)
 		return NULL;
 
 	/* Generate hash subkey H = AES_K(0^128) */
-	os_memset(H, 0, AES_BLOCK_SIZE);
-	aes_encrypt(aes, H, H);
+	os_memset(gk->H, 0, AES_BLOCK_SIZE);
+	aes_encrypt(aes, gk->H, gk->H);
 	wpa_hexdump_key(MSG_EXCESSIVE, "Hash subkey H for GHASH",
-			H, AES_BLOCK_SIZE);
+			gk->H, AES_BLOCK_SIZE);
+	ghash_key_setup(gk);
 	return aes;
 }
 
 
-static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len, const u8 *H, u8 *J0)
+static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len,
+			       const struct ghash_key *gk, u8 *J0)
 {
 	u8 len_buf[16];
 
@@ -204,10 +371,10 @@ static void aes_gcm_prepare_j0(const u8 *iv, size_t iv_len, const u8 *H, u8 *J0)
 		 * J_0 = GHASH_H(IV || 0^(s+64) || [len(IV)]_64)
 		 */
 		ghash_start(J0);
-		ghash(H, iv, iv_len, J0);
+		ghash(gk, iv, iv_len, J0);
 		WPA_PUT_BE64(len_buf, 0);
 		WPA_PUT_BE64(len_buf + 8, iv_len * 8);
-		ghash(H, len_buf, sizeof(len_buf), J0);
+		ghash(gk, len_buf, sizeof(len_buf), J0);
 	}
 }
 
@@ -226,7 +393,8 @@ static void aes_gcm_gctr(void *aes, const u8 *J0, const u8 *in, size_t len,
 }
 
 
-static void aes_gcm_ghash(const u8 *H, const u8 *aad, size_t aad_len,
+static void aes_gcm_ghash(const struct ghash_key *gk,
+			  const u8 *aad, size_t aad_len,
 			  const u8 *crypt, size_t crypt_len, u8 *S)
 {
 	u8 len_buf[16];
@@ -238,11 +406,11 @@ static void aes_gcm_ghash(const u8 *H, const u8 *aad, size_t aad_len,
 	 * (i.e., zero padded to block size A || C and lengths of each in bits)
 	 */
 	ghash_start(S);
-	ghash(H, aad, aad_len, S);
-	ghash(H, crypt, crypt_len, S);
+	ghash(gk, aad, aad_len, S);
+	ghash(gk, crypt, crypt_len, S);
 	WPA_PUT_BE64(len_buf, aad_len * 8);
 	WPA_PUT_BE64(len_buf + 8, crypt_len * 8);
-	ghash(H, len_buf, sizeof(len_buf), S);
+	ghash(gk, len_buf, sizeof(len_buf), S);
 
 	wpa_hexdump_key(MSG_EXCESSIVE, "S = GHASH_H(...)", S, 16);
 }
@@ -255,21 +423,21 @@ int aes_gcm_ae(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	       const u8 *plain, size_t plain_len,
 	       const u8 *aad, size_t aad_len, u8 *crypt, u8 *tag)
 {
-	u8 H[AES_BLOCK_SIZE];
+	struct ghash_key gk;
 	u8 J0[AES_BLOCK_SIZE];
 	u8 S[16];
 	void *aes;
 
-	aes = aes_gcm_init_hash_subkey(key, key_len, H);
+	aes = aes_gcm_init_hash_subkey(key, key_len, &gk);
 	if (aes == NULL)
 		return -1;
 
-	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+	aes_gcm_prepare_j0(iv, iv_len, &gk, J0);
 
 	/* C = GCTR_K(inc_32(J_0), P) */
 	aes_gcm_gctr(aes, J0, plain, plain_len, crypt);
 
-	aes_gcm_ghash(H, aad, aad_len, crypt, plain_len, S);
+	aes_gcm_ghash(&gk, aad, aad_len, crypt, plain_len, S);
 
 	/* T = MSB_t(GCTR_K(J_0, S)) */
 	aes_gctr(aes, J0, S, sizeof(S), tag);
@@ -277,6 +445,7 @@ int aes_gcm_ae(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	/* Return (C, T) */
 
 	aes_encrypt_deinit(aes);
+	os_memset(&gk, 0, sizeof(gk));
 
 	return 0;
 }
@@ -289,26 +458,27 @@ int aes_gcm_ad(const u8 *key, size_t key_len, const u8 *iv, size_t iv_len,
 	       const u8 *crypt, size_t crypt_len,
 	       const u8 *aad, size_t aad_len, const u8 *tag, u8 *plain)
 {
-	u8 H[AES_BLOCK_SIZE];
+	struct ghash_key gk;
 	u8 J0[AES_BLOCK_SIZE];
 	u8 S[16], T[16];
 	void *aes;
 
-	aes = aes_gcm_init_hash_subkey(key, key_len, H);
+	aes = aes_gcm_init_hash_subkey(key, key_len, &gk);
 	if (aes == NULL)
 		return -1;
 
-	aes_gcm_prepare_j0(iv, iv_len, H, J0);
+	aes_gcm_prepare_j0(iv, iv_len, &gk, J0);
 
 	/* P = GCTR_K(inc_32(J_0), C) */
 	aes_gcm_gctr(aes, J0, crypt, crypt_len, plain);
 
-	aes_gcm_ghash(H, aad, aad_len, crypt, crypt_len, S);
+	aes_gcm_ghash(&gk, aad, aad_len, crypt, crypt_len, S);
 
 	/* T' = MSB_t(GCTR_K(J_0, S)) */
 	aes_gctr(aes, J0, S, sizeof(S), T);
 
 	aes_encrypt_deinit(aes);
+	os_memset(&gk, 0, sizeof(gk));
 
 	if (os_memcmp_const(tag, T, 16) != 0) {
 		wpa_printf(MSG_EXCESSIVE, "GCM: Tag mismatch");
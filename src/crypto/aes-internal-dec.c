@@ -20,6 +20,10 @@
 #include "crypto.h"
 #include "aes_i.h"
 
+#ifdef AES_NI
+#include <wmmintrin.h>
+#endif /* AES_NI */
+
 /**
  * Expand the cipher key into the decryption key schedule.
  *
@@ -69,6 +73,11 @@ void * aes_decrypt_init(const u8 *key, size_t len)
 		return NULL;
 	}
 	rk[AES_PRIV_NR_POS] = res;
+#ifdef AES_NI
+	rk[AES_PRIV_NI_POS] = aes_ni_available();
+	if (rk[AES_PRIV_NI_POS])
+		aes_ni_setup(rk, res);
+#endif /* AES_NI */
 	return rk;
 }
 
@@ -147,9 +156,36 @@ d##3 = TD0(s##3) ^ TD1(s##2) ^ TD2(s##1) ^ TD3(s##0) ^ rk[4 * i + 3]
 	PUTU32(pt + 12, s3);
 }
 
+#ifdef AES_NI
+/*
+ * The decryption key schedule from rijndaelKeySetupDec() is in the order and
+ * form (InvMixColumns applied to the middle round keys) that AESDEC expects.
+ */
+static void AES_NI_TARGET aes_ni_decrypt(const u32 rk[], int Nr,
+					 const u8 ct[16], u8 pt[16])
+{
+	const __m128i *k = (const __m128i *) rk;
+	__m128i s;
+	int i;
+
+	s = _mm_xor_si128(_mm_loadu_si128((const __m128i *) ct),
+			  _mm_loadu_si128(k));
+	for (i = 1; i < Nr; i++)
+		s = _mm_aesdec_si128(s, _mm_loadu_si128(k + i));
+	s = _mm_aesdeclast_si128(s, _mm_loadu_si128(k + Nr));
+	_mm_storeu_si128((__m128i *) pt, s);
+}
+#endif /* AES_NI */
+
 void aes_decrypt(void *ctx, const u8 *crypt, u8 *plain)
 {
 	u32 *rk = ctx;
+#ifdef AES_NI
+	if (rk[AES_PRIV_NI_POS]) {
+		aes_ni_decrypt(rk, rk[AES_PRIV_NR_POS], crypt, plain);
+		return;
+	}
+#endif /* AES_NI */
 	rijndaelDecrypt(ctx, rk[AES_PRIV_NR_POS], crypt, plain);
 }
 
@@ -20,6 +20,10 @@
 #include "crypto.h"
 #include "aes_i.h"
 
+#ifdef AES_NI
+#include <wmmintrin.h>
+#endif /* AES_NI */
+
 static void rijndaelEncrypt(const u32 rk[], int Nr, const u8 pt[16], u8 ct[16])
 {
 	u32 s0, s1, s2, s3, t0, t1, t2, t3;
@@ -95,6 +99,55 @@ d##3 = TE0(s##3) ^ TE1(s##0) ^ TE2(s##1) ^ TE3(s##2) ^ rk[4 * i + 3]
 }
 
 
+#ifdef AES_NI
+static void AES_NI_TARGET aes_ni_encrypt(const u32 rk[], int Nr,
+					 const u8 pt[16], u8 ct[16])
+{
+	const __m128i *k = (const __m128i *) rk;
+	__m128i s;
+	int i;
+
+	s = _mm_xor_si128(_mm_loadu_si128((const __m128i *) pt),
+			  _mm_loadu_si128(k));
+	for (i = 1; i < Nr; i++)
+		s = _mm_aesenc_si128(s, _mm_loadu_si128(k + i));
+	s = _mm_aesenclast_si128(s, _mm_loadu_si128(k + Nr));
+	_mm_storeu_si128((__m128i *) ct, s);
+}
+
+
+/*
+ * Encrypt four independent blocks with interleaved rounds so that the
+ * AESENC latency of one block is hidden behind the other three.
+ */
+static void AES_NI_TARGET aes_ni_encrypt4(const u32 rk[], int Nr,
+					  const u8 pt[64], u8 ct[64])
+{
+	const __m128i *k = (const __m128i *) rk;
+	__m128i s0, s1, s2, s3, t;
+	int i;
+
+	t = _mm_loadu_si128(k);
+	s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) pt), t);
+	s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (pt + 16)), t);
+	s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (pt + 32)), t);
+	s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (pt + 48)), t);
+	for (i = 1; i < Nr; i++) {
+		t = _mm_loadu_si128(k + i);
+		s0 = _mm_aesenc_si128(s0, t);
+		s1 = _mm_aesenc_si128(s1, t);
+		s2 = _mm_aesenc_si128(s2, t);
+		s3 = _mm_aesenc_si128(s3, t);
+	}
+	t = _mm_loadu_si128(k + Nr);
+	_mm_storeu_si128((__m128i *) ct, _mm_aesenclast_si128(s0, t));
+	_mm_storeu_si128((__m128i *) (ct + 16), _mm_aesenclast_si128(s1, t));
+	_mm_storeu_si128((__m128i *) (ct + 32), _mm_aesenclast_si128(s2, t));
+	_mm_storeu_si128((__m128i *) (ct + 48), _mm_aesenclast_si128(s3, t));
+}
+#endif /* AES_NI */
+
+
 void * aes_encrypt_init(const u8 *key, size_t len)
 {
 	u32 *rk;
@@ -108,6 +161,11 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 		return NULL;
 	}
 	rk[AES_PRIV_NR_POS] = res;
+#ifdef AES_NI
+	rk[AES_PRIV_NI_POS] = aes_ni_available();
+	if (rk[AES_PRIV_NI_POS])
+		aes_ni_setup(rk, res);
+#endif /* AES_NI */
 	return rk;
 }
 
@@ -115,10 +173,44 @@ void * aes_encrypt_init(const u8 *key, size_t len)
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 {
 	u32 *rk = ctx;
+#ifdef AES_NI
+	if (rk[AES_PRIV_NI_POS]) {
+		aes_ni_encrypt(rk, rk[AES_PRIV_NR_POS], plain, crypt);
+		return;
+	}
+#endif /* AES_NI */
 	rijndaelEncrypt(ctx, rk[AES_PRIV_NR_POS], plain, crypt);
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	u32 *rk = ctx;
+	int Nr = rk[AES_PRIV_NR_POS];
+
+#ifdef AES_NI
+	if (rk[AES_PRIV_NI_POS]) {
+		for (; num >= 4; num -= 4) {
+			aes_ni_encrypt4(rk, Nr, plain, crypt);
+			plain += 64;
+			crypt += 64;
+		}
+		for (; num; num--) {
+			aes_ni_encrypt(rk, Nr, plain, crypt);
+			plain += 16;
+			crypt += 16;
+		}
+		return;
+	}
+#endif /* AES_NI */
+	for (; num; num--) {
+		rijndaelEncrypt(rk, Nr, plain, crypt);
+		plain += 16;
+		crypt += 16;
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	os_memset(ctx, 0, AES_PRIV_SIZE);
@@ -20,6 +20,10 @@
 #include "crypto.h"
 #include "aes_i.h"
 
+#ifdef AES_NI
+#include <cpuid.h>
+#endif /* AES_NI */
+
 /*
  * rijndael-alg-fst.c
  *
@@ -843,3 +847,43 @@ int rijndaelKeySetupEnc(u32 rk[], const u8 cipherKey[], int keyBits)
 
 	return -1;
 }
+
+
+int aes_ni_disabled = 0;
+
+#ifdef AES_NI
+
+/**
+ * aes_ni_available - Check whether AES-NI instructions can be used
+ * Returns: 1 if the CPU supports AES-NI and it has not been disabled
+ */
+int aes_ni_available(void)
+{
+	static int aes_ni = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (aes_ni < 0) {
+		aes_ni = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			(ecx & bit_AES) && (edx & bit_SSE2);
+		wpa_printf(MSG_DEBUG, "AES: AES-NI %ssupported",
+			   aes_ni ? "" : "not ");
+	}
+
+	return aes_ni && !aes_ni_disabled;
+}
+
+
+/**
+ * aes_ni_setup - Convert a key schedule for use with AES-NI
+ * @rk: Encryption or decryption key schedule
+ * @Nr: Number of rounds
+ */
+void aes_ni_setup(u32 rk[], int Nr)
+{
+	int i;
+
+	for (i = 0; i < 4 * (Nr + 1); i++)
+		rk[i] = host_to_be32(rk[i]);
+}
+
+#endif /* AES_NI */
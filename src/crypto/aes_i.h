@@ -117,9 +117,30 @@ static inline u32 rotr(u32 val, int bits)
 (ct)[2] = (u8)((st) >>  8); (ct)[3] = (u8)(st); }
 #endif
 
-#define AES_PRIV_SIZE (4 * 4 * 15 + 4)
+#define AES_PRIV_SIZE (4 * 4 * 15 + 4 + 4)
 #define AES_PRIV_NR_POS (4 * 15)
+#define AES_PRIV_NI_POS (4 * 15 + 1)
 
 int rijndaelKeySetupEnc(u32 rk[], const u8 cipherKey[], int keyBits);
 
+/*
+ * AES-NI is used when the CPU supports it. The instructions are enabled with
+ * function attributes and selected at run time, so no special compiler flags
+ * are needed and the table-driven implementation remains the fallback. When
+ * in use, the round keys in the context are stored in byte order
+ * (rk[AES_PRIV_NI_POS] != 0).
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+	!defined(CONFIG_NO_AES_NI)
+#define AES_NI
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+int aes_ni_available(void);
+void aes_ni_setup(u32 rk[], int Nr);
+#endif /* x86 && !CONFIG_NO_AES_NI */
+
+/* For testing: use the table-driven implementation even if AES-NI is
+ * available (affects contexts initialized after this is set) */
+extern int aes_ni_disabled;
+
 #endif /* AES_I_H */
@@ -68,4 +68,7 @@ int __must_check aes_ccm_ad(const u8 *key, size_t key_len, const u8 *nonce,
 			    const u8 *aad, size_t aad_len, const u8 *auth,
 			    u8 *plain);
 
+/* For testing: use the portable GHASH even if PCLMULQDQ is available */
+extern int ghash_clmul_disabled;
+
 #endif /* AES_WRAP_H */
@@ -125,6 +125,18 @@ void * aes_encrypt_init(const u8 *key, size_t len);
  */
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt);
 
+/**
+ * aes_encrypt_blocks - Encrypt a number of independent AES blocks (ECB)
+ * @ctx: Context pointer from aes_encrypt_init()
+ * @plain: Plaintext data to be encrypted (num * 16 bytes)
+ * @crypt: Buffer for the encrypted data (num * 16 bytes)
+ * @num: Number of blocks
+ *
+ * This is equivalent to calling aes_encrypt() for each block, but allows the
+ * crypto backend to process the blocks in parallel, e.g., for CTR mode.
+ */
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num);
+
 /**
  * aes_encrypt_deinit - Deinitialize AES encryption
  * @ctx: Context pointer from aes_encrypt_init()
@@ -103,6 +103,16 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	symmetric_key *skey = ctx;
+	size_t i;
+
+	for (i = 0; i < num; i++)
+		aes_ecb_encrypt(plain + i * 16, crypt + i * 16, skey);
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	symmetric_key *skey = ctx;
@@ -7,14 +7,20 @@
  */
 
 #include "utils/includes.h"
+#include <sys/stat.h>
 
 #include "utils/common.h"
 #include "utils/module_tests.h"
 #include "crypto/aes_siv.h"
 #include "crypto/aes_wrap.h"
 #include "crypto/aes.h"
+#ifdef CONFIG_INTERNAL_AES
+#include "crypto/aes_i.h"
+#endif /* CONFIG_INTERNAL_AES */
 #include "crypto/ms_funcs.h"
+#include "crypto/pbkdf2_batch.h"
 #include "crypto/crypto.h"
+#include "crypto/dh_groups.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 
@@ -499,6 +505,334 @@ static int test_ecb(void)
 }
 
 
+static void set_crypto_accel(int enabled)
+{
+#ifdef CONFIG_INTERNAL_AES
+	aes_ni_disabled = !enabled;
+#endif /* CONFIG_INTERNAL_AES */
+	ghash_clmul_disabled = !enabled;
+}
+
+
+static int test_gcm(void)
+{
+	/* Test cases from "The Galois/Counter Mode of Operation (GCM)" */
+	struct gcm_test_vector {
+		char *key;
+		char *iv;
+		char *plaintext;
+		char *aad;
+		char *ciphertext;
+		char *tag;
+	} vectors[] = {
+		{
+			"00000000000000000000000000000000",
+			"000000000000000000000000",
+			"",
+			"",
+			"",
+			"58e2fccefa7e3061367f1d57a4e7455a"
+		},
+		{
+			"00000000000000000000000000000000",
+			"000000000000000000000000",
+			"00000000000000000000000000000000",
+			"",
+			"0388dace60b6a392f328c2b971b2fe78",
+			"ab6e47d42cec13bdf53a67b21257bddf"
+		},
+		{
+			"feffe9928665731c6d6a8f9467308308",
+			"cafebabefacedbaddecaf888",
+			"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+			"",
+			"42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+			"4d5c2af327cd64a62cf35abd2ba6fab4"
+		},
+		{
+			"feffe9928665731c6d6a8f9467308308",
+			"cafebabefacedbaddecaf888",
+			"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+			"feedfacedeadbeeffeedfacedeadbeefabaddad2",
+			"42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+			"5bc94fbc3221a5db94fae95ae7121a47"
+		},
+		{
+			"feffe9928665731c6d6a8f9467308308",
+			"9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+			"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+			"feedfacedeadbeeffeedfacedeadbeefabaddad2",
+			"8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca701e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+			"619cc5aefffe0bfa462af43c1699d050"
+		},
+		{
+			"0000000000000000000000000000000000000000000000000000000000000000",
+			"000000000000000000000000",
+			"00000000000000000000000000000000",
+			"",
+			"cea7403d4d606b6e074ec5d3baf39d18",
+			"d0d1c8a799996bf0265b98b5d48ab919"
+		},
+	};
+	/* Multi-block message (300 octets i & 0xff) with the key and IV of
+	 * test case 3 */
+	const u8 long_tag[16] = {
+		0x11, 0x6e, 0x76, 0xb2, 0xae, 0x01, 0x89, 0x1c,
+		0xa4, 0xdd, 0x37, 0xb2, 0x9e, 0x3d, 0x2e, 0x0a
+	};
+	const u8 long_last[16] = {
+		0x65, 0xaa, 0xf6, 0xd2, 0xae, 0x39, 0xb9, 0x0b,
+		0xec, 0x30, 0xae, 0x22, 0x4b, 0x15, 0xf6, 0x6f
+	};
+	int ret = 0;
+	unsigned int i, accel;
+	u8 key[32], iv[64], plain[64], aad[32], cipher[64], tag[16];
+	u8 out[64], otag[16], lplain[300], lcipher[300], lout[300];
+	size_t key_len, iv_len, plain_len, aad_len;
+
+	for (accel = 0; accel < 2; accel++) {
+		set_crypto_accel(accel);
+		for (i = 0; i < ARRAY_SIZE(vectors); i++) {
+			struct gcm_test_vector *tv = &vectors[i];
+
+			key_len = os_strlen(tv->key) / 2;
+			iv_len = os_strlen(tv->iv) / 2;
+			plain_len = os_strlen(tv->plaintext) / 2;
+			aad_len = os_strlen(tv->aad) / 2;
+			if (hexstr2bin(tv->key, key, key_len) ||
+			    hexstr2bin(tv->iv, iv, iv_len) ||
+			    hexstr2bin(tv->plaintext, plain, plain_len) ||
+			    hexstr2bin(tv->aad, aad, aad_len) ||
+			    hexstr2bin(tv->ciphertext, cipher, plain_len) ||
+			    hexstr2bin(tv->tag, tag, sizeof(tag))) {
+				wpa_printf(MSG_ERROR,
+					   "Invalid AES-GCM test vector %u", i);
+				ret++;
+				continue;
+			}
+
+			if (aes_gcm_ae(key, key_len, iv, iv_len,
+				       plain, plain_len, aad, aad_len,
+				       out, otag) < 0 ||
+			    os_memcmp(out, cipher, plain_len) != 0 ||
+			    os_memcmp(otag, tag, sizeof(tag)) != 0) {
+				wpa_printf(MSG_ERROR,
+					   "AES-GCM-AE %u (accel=%u) failed",
+					   i, accel);
+				ret++;
+			}
+
+			if (aes_gcm_ad(key, key_len, iv, iv_len,
+				       cipher, plain_len, aad, aad_len,
+				       tag, out) < 0 ||
+			    os_memcmp(out, plain, plain_len) != 0) {
+				wpa_printf(MSG_ERROR,
+					   "AES-GCM-AD %u (accel=%u) failed",
+					   i, accel);
+				ret++;
+			}
+		}
+
+		for (i = 0; i < sizeof(lplain); i++)
+			lplain[i] = i & 0xff;
+		if (hexstr2bin(vectors[2].key, key, 16) ||
+		    hexstr2bin(vectors[2].iv, iv, 12) ||
+		    aes_gcm_ae(key, 16, iv, 12, lplain, sizeof(lplain),
+			       NULL, 0, lcipher, otag) < 0 ||
+		    os_memcmp(otag, long_tag, sizeof(long_tag)) != 0 ||
+		    os_memcmp(lcipher + sizeof(lcipher) - 16, long_last,
+			      sizeof(long_last)) != 0 ||
+		    aes_gcm_ad(key, 16, iv, 12, lcipher, sizeof(lcipher),
+			       NULL, 0, otag, lout) < 0 ||
+		    os_memcmp(lout, lplain, sizeof(lplain)) != 0) {
+			wpa_printf(MSG_ERROR,
+				   "AES-GCM multi-block test (accel=%u) failed",
+				   accel);
+			ret++;
+		}
+	}
+	set_crypto_accel(1);
+
+	if (!ret)
+		wpa_printf(MSG_INFO, "AES-GCM test cases passed");
+
+	return ret;
+}
+
+
+static unsigned int mbit_per_sec(size_t bytes, struct os_reltime *start)
+{
+	struct os_reltime now;
+	u64 usec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &now);
+	usec = (u64) now.sec * 1000000 + now.usec;
+	if (usec == 0)
+		usec = 1;
+	return (u64) bytes * 8 / usec;
+}
+
+
+static int test_aes_speed(void)
+{
+	const size_t len = 256 * 1024;
+	const u8 key[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+			     0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+	const u8 iv[12] = { 0 };
+	u8 *buf, tag[16];
+	void *ctx;
+	struct os_reltime start;
+	unsigned int accel, ecb_enc[2], ecb_dec[2], gcm[2];
+	size_t i;
+
+	buf = os_zalloc(len);
+	if (!buf)
+		return -1;
+
+	for (accel = 0; accel < 2; accel++) {
+		set_crypto_accel(accel);
+
+		ctx = aes_encrypt_init(key, sizeof(key));
+		if (!ctx)
+			goto fail;
+		os_get_reltime(&start);
+		for (i = 0; i < len; i += AES_BLOCK_SIZE)
+			aes_encrypt(ctx, buf + i, buf + i);
+		ecb_enc[accel] = mbit_per_sec(len, &start);
+		aes_encrypt_deinit(ctx);
+
+		ctx = aes_decrypt_init(key, sizeof(key));
+		if (!ctx)
+			goto fail;
+		os_get_reltime(&start);
+		for (i = 0; i < len; i += AES_BLOCK_SIZE)
+			aes_decrypt(ctx, buf + i, buf + i);
+		ecb_dec[accel] = mbit_per_sec(len, &start);
+		aes_decrypt_deinit(ctx);
+
+		os_get_reltime(&start);
+		if (aes_gcm_ae(key, sizeof(key), iv, sizeof(iv), buf, len,
+			       NULL, 0, buf, tag) < 0)
+			goto fail;
+		gcm[accel] = mbit_per_sec(len, &start);
+	}
+	set_crypto_accel(1);
+	os_free(buf);
+
+	wpa_printf(MSG_INFO,
+		   "AES-128 throughput (Mbit/s, portable/accelerated): ECB encrypt %u/%u, ECB decrypt %u/%u, GCM %u/%u",
+		   ecb_enc[0], ecb_enc[1], ecb_dec[0], ecb_dec[1],
+		   gcm[0], gcm[1]);
+	return 0;
+
+fail:
+	set_crypto_accel(1);
+	os_free(buf);
+	return -1;
+}
+
+
+#ifdef CONFIG_DH_PRECOMP
+static unsigned int usec_since(struct os_reltime *start)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &now);
+	return now.sec * 1000000 + now.usec;
+}
+#endif /* CONFIG_DH_PRECOMP */
+
+
+static int test_dh_groups(void)
+{
+#ifdef CONFIG_DH_PRECOMP
+	const int groups[] = { 5, 14 };
+	u8 priv[257], base[256], res1[256], res2[256];
+	size_t i, j, priv_len, len1, len2;
+	const struct dh_group *dh;
+	struct os_reltime start;
+	unsigned int generic, fixed;
+	const int iter = 5;
+	int k;
+
+	wpa_printf(MSG_INFO, "DH group precomputation tests");
+
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		dh = dh_groups_get(groups[i]);
+		if (!dh)
+			continue;
+
+		for (j = 0; j < 6; j++) {
+			/* Full length, short, and longer than prime exponents */
+			priv_len = j < 4 ? dh->prime_len :
+				(j == 4 ? 20 : dh->prime_len + 1);
+			if (os_get_random(priv, priv_len) < 0 ||
+			    os_get_random(base, dh->prime_len) < 0)
+				return -1;
+			base[0] &= 0x7f;
+
+			len1 = len2 = sizeof(res1);
+			if (crypto_mod_exp(dh->generator, dh->generator_len,
+					   priv, priv_len,
+					   dh->prime, dh->prime_len,
+					   res1, &len1) < 0 ||
+			    dh_mod_exp(dh, NULL, 0, priv, priv_len,
+				       res2, &len2) < 0 ||
+			    len1 != len2 || os_memcmp(res1, res2, len1) != 0) {
+				wpa_printf(MSG_ERROR,
+					   "DH group %d fixed-base exponentiation mismatch",
+					   dh->id);
+				return -1;
+			}
+
+			len1 = len2 = sizeof(res1);
+			if (crypto_mod_exp(base, dh->prime_len,
+					   priv, priv_len,
+					   dh->prime, dh->prime_len,
+					   res1, &len1) < 0 ||
+			    dh_mod_exp(dh, base, dh->prime_len, priv, priv_len,
+				       res2, &len2) < 0 ||
+			    len1 != len2 || os_memcmp(res1, res2, len1) != 0) {
+				wpa_printf(MSG_ERROR,
+					   "DH group %d exponentiation mismatch",
+					   dh->id);
+				return -1;
+			}
+		}
+
+		os_get_reltime(&start);
+		for (k = 0; k < iter; k++) {
+			len1 = sizeof(res1);
+			if (crypto_mod_exp(dh->generator, dh->generator_len,
+					   priv, dh->prime_len,
+					   dh->prime, dh->prime_len,
+					   res1, &len1) < 0)
+				return -1;
+		}
+		generic = usec_since(&start) / iter;
+
+		os_get_reltime(&start);
+		for (k = 0; k < iter; k++) {
+			len1 = sizeof(res1);
+			if (dh_mod_exp(dh, NULL, 0, priv, dh->prime_len,
+				       res1, &len1) < 0)
+				return -1;
+		}
+		fixed = usec_since(&start) / iter;
+
+		wpa_printf(MSG_INFO,
+			   "DH group %d modexp (usec): generic %u, fixed-base %u",
+			   dh->id, generic, fixed);
+	}
+
+	wpa_printf(MSG_INFO, "DH group precomputation tests passed");
+#endif /* CONFIG_DH_PRECOMP */
+	return 0;
+}
+
+
 static int test_key_wrap(void)
 {
 	int ret = 0;
@@ -1497,6 +1831,126 @@ static const struct hmac_test {
 };
 
 
+static int test_pbkdf2_sha1_multi(void)
+{
+#ifndef CONFIG_NO_PBKDF2
+	const char *passphrase[16];
+	const u8 *ssid[16];
+	size_t ssid_len[16];
+	u8 psk[16][32], *buf[16];
+	struct os_reltime start, multi, single;
+	unsigned int i;
+	int ret = 0;
+
+	wpa_printf(MSG_INFO, "PBKDF2-SHA1 multi-passphrase test cases:");
+
+	for (i = 0; i < ARRAY_SIZE(psk); i++) {
+		const struct passphrase_test *test =
+			&passphrase_tests[i % NUM_PASSPHRASE_TESTS];
+
+		passphrase[i] = test->passphrase;
+		ssid[i] = (const u8 *) test->ssid;
+		ssid_len[i] = os_strlen(test->ssid);
+		buf[i] = psk[i];
+	}
+
+	os_memset(psk, 0, sizeof(psk));
+	os_get_reltime(&start);
+	if (pbkdf2_sha1_multi(ARRAY_SIZE(psk), passphrase, ssid, ssid_len,
+			      4096, buf, 32) < 0)
+		return -1;
+	os_get_reltime(&multi);
+	os_reltime_sub(&multi, &start, &multi);
+
+	for (i = 0; i < ARRAY_SIZE(psk); i++) {
+		if (os_memcmp(psk[i],
+			      passphrase_tests[i % NUM_PASSPHRASE_TESTS].psk,
+			      32) != 0) {
+			wpa_printf(MSG_INFO, "Test case %u - FAILED!", i);
+			ret++;
+		}
+	}
+
+	os_get_reltime(&start);
+	for (i = 0; i < ARRAY_SIZE(psk); i++) {
+		if (pbkdf2_sha1(passphrase[i], ssid[i], ssid_len[i], 4096,
+				psk[i], 32) < 0)
+			return -1;
+	}
+	os_get_reltime(&single);
+	os_reltime_sub(&single, &start, &single);
+
+	if (ret)
+		return -1;
+	wpa_printf(MSG_INFO,
+		   "PBKDF2-SHA1 multi-passphrase test cases passed (%u PSKs: %ld.%06ld s as a batch, %ld.%06ld s one at a time)",
+		   (unsigned int) ARRAY_SIZE(psk),
+		   multi.sec, multi.usec, single.sec, single.usec);
+#endif /* CONFIG_NO_PBKDF2 */
+	return 0;
+}
+
+
+static int test_pbkdf2_batch(void)
+{
+#ifndef CONFIG_NO_PBKDF2
+	struct pbkdf2_batch *batch;
+	u8 psk[2 * NUM_PASSPHRASE_TESTS][32];
+	const char *fname = "/tmp/wpas-pbkdf2-batch-test";
+	struct stat st;
+	unsigned int i, round;
+	int ret = 0;
+
+	wpa_printf(MSG_INFO, "PBKDF2-SHA1 batch test cases:");
+
+	/* First round derives the PSKs, second round uses the cache file */
+	unlink(fname);
+	for (round = 0; round < 2; round++) {
+		batch = pbkdf2_batch_init();
+		if (!batch)
+			return -1;
+		os_memset(psk, 0, sizeof(psk));
+		for (i = 0; i < ARRAY_SIZE(psk); i++) {
+			const struct passphrase_test *test =
+				&passphrase_tests[i % NUM_PASSPHRASE_TESTS];
+
+			if (pbkdf2_batch_add(batch, test->passphrase,
+					     (const u8 *) test->ssid,
+					     os_strlen(test->ssid),
+					     psk[i]) < 0)
+				ret++;
+		}
+		if (pbkdf2_batch_run(batch, fname) < 0)
+			ret++;
+		pbkdf2_batch_free(batch);
+		if (round == 0 &&
+		    (stat(fname, &st) < 0 || (st.st_mode & 0077))) {
+			wpa_printf(MSG_INFO,
+				   "PBKDF2 cache file missing or not private");
+			ret++;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(psk); i++) {
+			if (os_memcmp(psk[i],
+				      passphrase_tests[i % NUM_PASSPHRASE_TESTS].psk,
+				      32) != 0) {
+				wpa_printf(MSG_INFO,
+					   "Test case %u (round %u) - FAILED!",
+					   i, round);
+				ret++;
+			}
+		}
+	}
+	unlink(fname);
+
+	if (ret)
+		return -1;
+	wpa_printf(MSG_INFO, "PBKDF2-SHA1 batch test cases passed");
+#endif /* CONFIG_NO_PBKDF2 */
+	return 0;
+}
+
+
 static int test_sha256(void)
 {
 	unsigned int i;
@@ -1747,9 +2201,14 @@ int crypto_module_tests(void)
 	    test_eax() ||
 	    test_cbc() ||
 	    test_ecb() ||
+	    test_gcm() ||
+	    test_aes_speed() ||
+	    test_dh_groups() ||
 	    test_key_wrap() ||
 	    test_md5() ||
 	    test_sha1() ||
+	    test_pbkdf2_sha1_multi() ||
+	    test_pbkdf2_batch() ||
 	    test_sha256() ||
 	    test_fips186_2_prf() ||
 	    test_ms_funcs())
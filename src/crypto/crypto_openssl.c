@@ -295,6 +295,17 @@ void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
 }
 
 
+void aes_encrypt_blocks(void *ctx, const u8 *plain, u8 *crypt, size_t num)
+{
+	EVP_CIPHER_CTX *c = ctx;
+	int clen = num * 16;
+	if (EVP_EncryptUpdate(c, crypt, &clen, plain, num * 16) != 1) {
+		wpa_printf(MSG_ERROR, "OpenSSL: EVP_EncryptUpdate failed: %s",
+			   ERR_error_string(ERR_get_error(), NULL));
+	}
+}
+
+
 void aes_encrypt_deinit(void *ctx)
 {
 	EVP_CIPHER_CTX *c = ctx;
@@ -976,6 +987,22 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 }
 
 
+int pbkdf2_sha1_multi(size_t num, const char *passphrase[], const u8 *ssid[],
+		      const size_t ssid_len[], int iterations, u8 *buf[],
+		      size_t buflen)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (pbkdf2_sha1(passphrase[i], ssid[i], ssid_len[i],
+				iterations, buf[i], buflen) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+
 int hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
 		     const u8 *addr[], const size_t *len, u8 *mac)
 {
@@ -7,11 +7,17 @@
  */
 
 #include "includes.h"
+#if defined(CONFIG_DH_PRECOMP) && defined(CONFIG_CRYPTO_THREADS)
+#include <pthread.h>
+#endif /* CONFIG_DH_PRECOMP && CONFIG_CRYPTO_THREADS */
 
 #include "common.h"
 #include "crypto.h"
 #include "random.h"
 #include "dh_groups.h"
+#ifdef CONFIG_DH_PRECOMP
+#include "tls/bignum.h"
+#endif /* CONFIG_DH_PRECOMP */
 
 
 #ifdef ALL_DH_GROUPS
@@ -1184,6 +1190,156 @@ const struct dh_group * dh_groups_get(int id)
 }
 
 
+#ifdef CONFIG_DH_PRECOMP
+
+/* Number of comb teeth for fixed-base exponentiation with the group
+ * generator; the cached table has 2^DH_COMB_TEETH - 1 entries of prime
+ * length. */
+#define DH_COMB_TEETH 5
+
+/* Montgomery context and generator comb table for each entry in dh_groups[];
+ * built on first use */
+static struct bignum_mont *dh_precomp[NUM_DH_GROUPS];
+
+#ifdef CONFIG_CRYPTO_THREADS
+/* Serializes building of the tables for DH users in worker threads */
+static pthread_mutex_t dh_precomp_lock = PTHREAD_MUTEX_INITIALIZER;
+#define dh_precomp_lock() pthread_mutex_lock(&dh_precomp_lock)
+#define dh_precomp_unlock() pthread_mutex_unlock(&dh_precomp_lock)
+#else /* CONFIG_CRYPTO_THREADS */
+#define dh_precomp_lock() do { } while (0)
+#define dh_precomp_unlock() do { } while (0)
+#endif /* CONFIG_CRYPTO_THREADS */
+
+
+static struct bignum_mont * dh_group_precomp(const struct dh_group *dh)
+{
+	struct bignum *p, *g;
+	struct bignum_mont *ctx;
+	size_t i;
+
+	for (i = 0; i < NUM_DH_GROUPS; i++) {
+		if (&dh_groups[i] == dh)
+			break;
+	}
+	if (i == NUM_DH_GROUPS)
+		return NULL;
+
+	dh_precomp_lock();
+	if (dh_precomp[i]) {
+		ctx = dh_precomp[i];
+		dh_precomp_unlock();
+		return ctx;
+	}
+
+	p = bignum_init();
+	g = bignum_init();
+	if (!p || !g ||
+	    bignum_set_unsigned_bin(p, dh->prime, dh->prime_len) < 0 ||
+	    bignum_set_unsigned_bin(g, dh->generator, dh->generator_len) < 0) {
+		bignum_deinit(p);
+		bignum_deinit(g);
+		dh_precomp_unlock();
+		return NULL;
+	}
+
+	ctx = bignum_mont_init(p);
+	if (ctx && bignum_mont_set_base(ctx, g, dh->prime_len * 8,
+					DH_COMB_TEETH) < 0) {
+		bignum_mont_deinit(ctx);
+		ctx = NULL;
+	}
+	bignum_deinit(p);
+	bignum_deinit(g);
+	if (ctx)
+		wpa_printf(MSG_DEBUG, "DH: Precomputed group %d", dh->id);
+	dh_precomp[i] = ctx;
+	dh_precomp_unlock();
+
+	return ctx;
+}
+
+
+static int dh_precomp_exptmod(struct bignum_mont *ctx,
+			      const u8 *power, size_t power_len,
+			      u8 *result, size_t *result_len)
+{
+	struct bignum *e, *r;
+	int ret = -1;
+
+	e = bignum_init();
+	r = bignum_init();
+	if (e && r && bignum_set_unsigned_bin(e, power, power_len) == 0 &&
+	    bignum_mont_exptmod_base(ctx, e, r) == 0)
+		ret = bignum_get_unsigned_bin(r, result, result_len);
+	bignum_deinit(e);
+	bignum_deinit(r);
+	return ret;
+}
+
+#endif /* CONFIG_DH_PRECOMP */
+
+
+/**
+ * dh_mod_exp - Modular exponentiation in a Diffie-Hellman group
+ * @dh: Selected Diffie-Hellman group from dh_groups_get()
+ * @base: Base or %NULL to use the group generator
+ * @base_len: Length of base in octets
+ * @power: Exponent
+ * @power_len: Length of power in octets
+ * @result: Buffer for the result
+ * @result_len: Length of the result buffer; set to used length on success
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is otherwise equivalent to crypto_mod_exp() with the group prime as
+ * the modulus, but allows cached per-group precomputation to be used when the
+ * base is the group generator. Other bases (e.g., the peer's public value) use
+ * crypto_mod_exp() since a Montgomery context alone is not faster than it.
+ */
+int dh_mod_exp(const struct dh_group *dh, const u8 *base, size_t base_len,
+	       const u8 *power, size_t power_len,
+	       u8 *result, size_t *result_len)
+{
+#ifdef CONFIG_DH_PRECOMP
+	struct bignum_mont *ctx;
+
+	if (power_len <= dh->prime_len &&
+	    (!base || (base_len == dh->generator_len &&
+		       os_memcmp(base, dh->generator, base_len) == 0))) {
+		ctx = dh_group_precomp(dh);
+		if (ctx)
+			return dh_precomp_exptmod(ctx, power, power_len,
+						  result, result_len);
+	}
+#endif /* CONFIG_DH_PRECOMP */
+
+	if (!base) {
+		base = dh->generator;
+		base_len = dh->generator_len;
+	}
+	return crypto_mod_exp(base, base_len, power, power_len,
+			      dh->prime, dh->prime_len, result, result_len);
+}
+
+
+/**
+ * dh_groups_deinit - Free cached Diffie-Hellman group precomputation
+ */
+void dh_groups_deinit(void)
+{
+#ifdef CONFIG_DH_PRECOMP
+	size_t i;
+
+	dh_precomp_lock();
+	for (i = 0; i < NUM_DH_GROUPS; i++) {
+		bignum_mont_deinit(dh_precomp[i]);
+		dh_precomp[i] = NULL;
+	}
+	dh_precomp_unlock();
+#endif /* CONFIG_DH_PRECOMP */
+}
+
+
 /**
  * dh_init - Initialize Diffie-Hellman handshake
  * @dh: Selected Diffie-Hellman group
@@ -1223,12 +1379,10 @@ struct wpabuf * dh_init(const struct dh_group *dh, struct wpabuf **priv)
 		*priv = NULL;
 		return NULL;
 	}
-	if (crypto_mod_exp(dh->generator, dh->generator_len,
-			   wpabuf_head(*priv), wpabuf_len(*priv),
-			   dh->prime, dh->prime_len, wpabuf_mhead(pv),
-			   &pv_len) < 0) {
+	if (dh_mod_exp(dh, NULL, 0, wpabuf_head(*priv), wpabuf_len(*priv),
+		       wpabuf_mhead(pv), &pv_len) < 0) {
 		wpabuf_clear_free(pv);
-		wpa_printf(MSG_INFO, "DH: crypto_mod_exp failed");
+		wpa_printf(MSG_INFO, "DH: dh_mod_exp failed");
 		wpabuf_clear_free(*priv);
 		*priv = NULL;
 		return NULL;
@@ -1261,12 +1415,11 @@ struct wpabuf * dh_derive_shared(const struct wpabuf *peer_public,
 	shared = wpabuf_alloc(shared_len);
 	if (shared == NULL)
 		return NULL;
-	if (crypto_mod_exp(wpabuf_head(peer_public), wpabuf_len(peer_public),
-			   wpabuf_head(own_private), wpabuf_len(own_private),
-			   dh->prime, dh->prime_len,
-			   wpabuf_mhead(shared), &shared_len) < 0) {
+	if (dh_mod_exp(dh, wpabuf_head(peer_public), wpabuf_len(peer_public),
+		       wpabuf_head(own_private), wpabuf_len(own_private),
+		       wpabuf_mhead(shared), &shared_len) < 0) {
 		wpabuf_clear_free(shared);
-		wpa_printf(MSG_INFO, "DH: crypto_mod_exp failed");
+		wpa_printf(MSG_INFO, "DH: dh_mod_exp failed");
 		return NULL;
 	}
 	wpabuf_put(shared, shared_len);
@@ -21,6 +21,10 @@ struct dh_group {
 };
 
 const struct dh_group * dh_groups_get(int id);
+int dh_mod_exp(const struct dh_group *dh, const u8 *base, size_t base_len,
+	       const u8 *power, size_t power_len,
+	       u8 *result, size_t *result_len);
+void dh_groups_deinit(void);
 struct wpabuf * dh_init(const struct dh_group *dh, struct wpabuf **priv);
 struct wpabuf * dh_derive_shared(const struct wpabuf *peer_public,
 				 const struct wpabuf *own_private,
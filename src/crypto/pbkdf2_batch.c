@@ -0,0 +1,420 @@
+/*
+ * Batch derivation of WPA PSKs from passphrases (PBKDF2-SHA1)
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Deriving a PSK from a passphrase takes 4096 iterations of PBKDF2-SHA1, so
+ * configurations with a large number of passphrases take a long time to load.
+ * This file collects the passphrases first and then derives all the PSKs in
+ * one go. With CONFIG_PBKDF2_THREADS, the derivations are distributed over
+ * worker threads. Optionally, the derived PSKs are stored in a cache file
+ * indexed with a hash of the SSID and passphrase so that they do not need to
+ * be derived again when the configuration is reloaded.
+ */
+
+#include "includes.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef CONFIG_PBKDF2_THREADS
+#include <pthread.h>
+#endif /* CONFIG_PBKDF2_THREADS */
+
+#include "common.h"
+#include "sha1.h"
+#include "crypto.h"
+#include "pbkdf2_batch.h"
+
+#define PBKDF2_BATCH_KEY_LEN SHA1_MAC_LEN
+#define PBKDF2_BATCH_PSK_LEN 32
+#define PBKDF2_BATCH_MAX_THREADS 16
+/* Number of passphrases given to pbkdf2_sha1_multi() at a time */
+#define PBKDF2_BATCH_CHUNK 4
+
+struct pbkdf2_batch_entry {
+	char *passphrase;
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+	u8 key[PBKDF2_BATCH_KEY_LEN];
+	u8 psk[PBKDF2_BATCH_PSK_LEN];
+	u8 *out;
+	int done;
+};
+
+struct pbkdf2_batch {
+	struct pbkdf2_batch_entry *entries;
+	size_t num;
+	size_t size;
+#ifdef CONFIG_PBKDF2_THREADS
+	pthread_mutex_t lock;
+	size_t next;
+	int failed;
+#endif /* CONFIG_PBKDF2_THREADS */
+};
+
+
+/**
+ * pbkdf2_batch_init - Initialize a PSK derivation batch
+ * Returns: Pointer to the batch or %NULL on failure
+ */
+struct pbkdf2_batch * pbkdf2_batch_init(void)
+{
+	return os_zalloc(sizeof(struct pbkdf2_batch));
+}
+
+
+/**
+ * pbkdf2_batch_free - Free a PSK derivation batch
+ * @batch: Batch from pbkdf2_batch_init()
+ */
+void pbkdf2_batch_free(struct pbkdf2_batch *batch)
+{
+	size_t i;
+
+	if (!batch)
+		return;
+	for (i = 0; i < batch->num; i++)
+		str_clear_free(batch->entries[i].passphrase);
+	bin_clear_free(batch->entries,
+		       batch->size * sizeof(struct pbkdf2_batch_entry));
+	os_free(batch);
+}
+
+
+/**
+ * pbkdf2_batch_add - Add a passphrase to a PSK derivation batch
+ * @batch: Batch from pbkdf2_batch_init()
+ * @passphrase: ASCII passphrase
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @psk: Buffer for the derived PSK (32 octets)
+ * Returns: 0 on success, -1 on failure
+ *
+ * The PSK is written to the @psk buffer by pbkdf2_batch_run(), so the buffer
+ * needs to remain valid until then.
+ */
+int pbkdf2_batch_add(struct pbkdf2_batch *batch, const char *passphrase,
+		     const u8 *ssid, size_t ssid_len, u8 *psk)
+{
+	struct pbkdf2_batch_entry *e;
+	const u8 *addr[3];
+	size_t len[3];
+	u8 ssid_len_buf = ssid_len;
+
+	if (ssid_len > SSID_MAX_LEN)
+		return -1;
+
+	if (batch->num == batch->size) {
+		size_t size = batch->size ? batch->size * 2 : 16;
+		struct pbkdf2_batch_entry *n;
+
+		n = os_realloc_array(batch->entries, size, sizeof(*n));
+		if (!n)
+			return -1;
+		batch->entries = n;
+		batch->size = size;
+	}
+
+	e = &batch->entries[batch->num];
+	os_memset(e, 0, sizeof(*e));
+	e->passphrase = os_strdup(passphrase);
+	if (!e->passphrase)
+		return -1;
+	os_memcpy(e->ssid, ssid, ssid_len);
+	e->ssid_len = ssid_len;
+	e->out = psk;
+
+	/* Cache key: SHA1(SSID length | SSID | passphrase) */
+	addr[0] = &ssid_len_buf;
+	len[0] = 1;
+	addr[1] = ssid;
+	len[1] = ssid_len;
+	addr[2] = (const u8 *) passphrase;
+	len[2] = os_strlen(passphrase);
+	if (sha1_vector(3, addr, len, e->key) < 0) {
+		str_clear_free(e->passphrase);
+		return -1;
+	}
+
+	batch->num++;
+	return 0;
+}
+
+
+static int pbkdf2_batch_derive(struct pbkdf2_batch_entry *e[], size_t num)
+{
+	const char *passphrase[PBKDF2_BATCH_CHUNK];
+	const u8 *ssid[PBKDF2_BATCH_CHUNK];
+	size_t ssid_len[PBKDF2_BATCH_CHUNK];
+	u8 *psk[PBKDF2_BATCH_CHUNK];
+	size_t i;
+
+	os_memset(ssid_len, 0, sizeof(ssid_len));
+	for (i = 0; i < num; i++) {
+		passphrase[i] = e[i]->passphrase;
+		ssid[i] = e[i]->ssid;
+		ssid_len[i] = e[i]->ssid_len;
+		psk[i] = e[i]->psk;
+	}
+
+	if (pbkdf2_sha1_multi(num, passphrase, ssid, ssid_len, 4096, psk,
+			      PBKDF2_BATCH_PSK_LEN) < 0)
+		return -1;
+
+	for (i = 0; i < num; i++)
+		e[i]->done = 1;
+	return 0;
+}
+
+
+static int pbkdf2_batch_derive_serial(struct pbkdf2_batch *batch)
+{
+	struct pbkdf2_batch_entry *e[PBKDF2_BATCH_CHUNK];
+	size_t i, num = 0;
+
+	for (i = 0; i < batch->num; i++) {
+		if (batch->entries[i].done)
+			continue;
+		e[num++] = &batch->entries[i];
+		if (num == PBKDF2_BATCH_CHUNK) {
+			if (pbkdf2_batch_derive(e, num) < 0)
+				return -1;
+			num = 0;
+		}
+	}
+
+	if (num && pbkdf2_batch_derive(e, num) < 0)
+		return -1;
+
+	return 0;
+}
+
+
+static void pbkdf2_batch_cache_read(struct pbkdf2_batch *batch,
+				    const char *fname)
+{
+	FILE *f;
+	char buf[2 * PBKDF2_BATCH_KEY_LEN + 1 + 2 * PBKDF2_BATCH_PSK_LEN + 3];
+	u8 key[PBKDF2_BATCH_KEY_LEN], psk[PBKDF2_BATCH_PSK_LEN];
+	size_t i, found = 0;
+
+	f = fopen(fname, "r");
+	if (!f)
+		return;
+
+	while (fgets(buf, sizeof(buf), f)) {
+		if (buf[0] == '#' ||
+		    hexstr2bin(buf, key, sizeof(key)) < 0 ||
+		    buf[2 * sizeof(key)] != ' ' ||
+		    hexstr2bin(&buf[2 * sizeof(key) + 1], psk, sizeof(psk)) < 0)
+			continue;
+		for (i = 0; i < batch->num; i++) {
+			struct pbkdf2_batch_entry *e = &batch->entries[i];
+
+			if (!e->done &&
+			    os_memcmp(e->key, key, sizeof(key)) == 0) {
+				os_memcpy(e->psk, psk, PBKDF2_BATCH_PSK_LEN);
+				e->done = 1;
+				found++;
+			}
+		}
+	}
+	os_memset(buf, 0, sizeof(buf));
+	os_memset(psk, 0, sizeof(psk));
+	fclose(f);
+
+	wpa_printf(MSG_DEBUG, "PBKDF2: Found %u/%u PSKs in cache file %s",
+		   (unsigned int) found, (unsigned int) batch->num, fname);
+}
+
+
+static void pbkdf2_batch_cache_write(struct pbkdf2_batch *batch,
+				     const char *fname)
+{
+	FILE *f;
+	size_t i, tmp_len;
+	char key[2 * PBKDF2_BATCH_KEY_LEN + 1], psk[2 * PBKDF2_BATCH_PSK_LEN + 1];
+	char *tmp_name;
+	int fd, fail = 0;
+
+	/*
+	 * Write the PSKs into a new file that is readable only by the owner
+	 * and replace the old cache file with it only once the data has been
+	 * written out completely.
+	 */
+	tmp_len = os_strlen(fname) + 5;
+	tmp_name = os_malloc(tmp_len);
+	if (!tmp_name)
+		return;
+	os_snprintf(tmp_name, tmp_len, "%s.tmp", fname);
+
+	fd = open(tmp_name, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+	if (fd < 0 && errno == EEXIST) {
+		/* Left behind by an earlier interrupted write */
+		unlink(tmp_name);
+		fd = open(tmp_name, O_CREAT | O_EXCL | O_WRONLY,
+			  S_IRUSR | S_IWUSR);
+	}
+	f = fd < 0 ? NULL : fdopen(fd, "w");
+	if (!f) {
+		wpa_printf(MSG_ERROR, "PBKDF2: Could not open cache file %s "
+			   "for writing: %s", tmp_name, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_name);
+		}
+		os_free(tmp_name);
+		return;
+	}
+
+	/* Only the PSKs used by the current configuration are stored */
+	fprintf(f, "# Derived PSKs (SHA1(SSID length|SSID|passphrase) PSK)\n");
+	for (i = 0; i < batch->num; i++) {
+		struct pbkdf2_batch_entry *e = &batch->entries[i];
+
+		if (!e->done)
+			continue;
+		wpa_snprintf_hex(key, sizeof(key), e->key, sizeof(e->key));
+		wpa_snprintf_hex(psk, sizeof(psk), e->psk, sizeof(e->psk));
+		if (fprintf(f, "%s %s\n", key, psk) < 0)
+			fail = 1;
+	}
+	os_memset(psk, 0, sizeof(psk));
+	if (fflush(f) != 0 || fsync(fileno(f)) != 0)
+		fail = 1;
+	if (fclose(f) != 0)
+		fail = 1;
+
+	if (!fail && rename(tmp_name, fname) != 0)
+		fail = 1;
+	if (fail) {
+		wpa_printf(MSG_ERROR, "PBKDF2: Could not write cache file %s",
+			   fname);
+		unlink(tmp_name);
+	}
+	os_free(tmp_name);
+}
+
+
+#ifdef CONFIG_PBKDF2_THREADS
+
+/*
+ * Worker threads only call pbkdf2_sha1_multi() which does not use any shared
+ * state; in particular, no os_*alloc() calls or debug prints are done in them.
+ */
+static void * pbkdf2_batch_worker(void *ctx)
+{
+	struct pbkdf2_batch *batch = ctx;
+	struct pbkdf2_batch_entry *e[PBKDF2_BATCH_CHUNK];
+	size_t num;
+
+	for (;;) {
+		num = 0;
+		pthread_mutex_lock(&batch->lock);
+		while (num < PBKDF2_BATCH_CHUNK && batch->next < batch->num) {
+			if (!batch->entries[batch->next].done)
+				e[num++] = &batch->entries[batch->next];
+			batch->next++;
+		}
+		pthread_mutex_unlock(&batch->lock);
+		if (num == 0)
+			break;
+
+		if (pbkdf2_batch_derive(e, num) < 0) {
+			pthread_mutex_lock(&batch->lock);
+			batch->failed = 1;
+			pthread_mutex_unlock(&batch->lock);
+		}
+	}
+
+	return NULL;
+}
+
+
+static int pbkdf2_batch_derive_all(struct pbkdf2_batch *batch, size_t pending)
+{
+	pthread_t threads[PBKDF2_BATCH_MAX_THREADS];
+	long cpus;
+	size_t i, num_threads = 0, max_threads, chunks;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	max_threads = cpus > 1 ? (size_t) cpus - 1 : 0;
+	if (max_threads > PBKDF2_BATCH_MAX_THREADS)
+		max_threads = PBKDF2_BATCH_MAX_THREADS;
+	chunks = (pending + PBKDF2_BATCH_CHUNK - 1) / PBKDF2_BATCH_CHUNK;
+	if (max_threads > chunks - 1)
+		max_threads = chunks - 1;
+
+	if (max_threads == 0 || pthread_mutex_init(&batch->lock, NULL) != 0)
+		return pbkdf2_batch_derive_serial(batch);
+	batch->next = 0;
+	batch->failed = 0;
+
+	for (i = 0; i < max_threads; i++) {
+		if (pthread_create(&threads[num_threads], NULL,
+				   pbkdf2_batch_worker, batch) != 0)
+			break;
+		num_threads++;
+	}
+
+	wpa_printf(MSG_DEBUG, "PBKDF2: Deriving %u PSKs with %u thread(s)",
+		   (unsigned int) pending, (unsigned int) num_threads + 1);
+
+	/* The calling thread works through the entries as well */
+	pbkdf2_batch_worker(batch);
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&batch->lock);
+
+	return batch->failed ? -1 : 0;
+}
+
+#else /* CONFIG_PBKDF2_THREADS */
+
+static int pbkdf2_batch_derive_all(struct pbkdf2_batch *batch, size_t pending)
+{
+	return pbkdf2_batch_derive_serial(batch);
+}
+
+#endif /* CONFIG_PBKDF2_THREADS */
+
+
+/**
+ * pbkdf2_batch_run - Derive the PSKs for all passphrases in a batch
+ * @batch: Batch from pbkdf2_batch_init()
+ * @cache_file: Cache file for derived PSKs or %NULL to not use a cache
+ * Returns: 0 on success, -1 on failure
+ *
+ * The derived PSKs are written to the buffers given to pbkdf2_batch_add(). If
+ * a cache file is specified, it is rewritten to contain the PSKs of this
+ * batch. The cache file contains key material and needs to be protected in
+ * the same way as the configuration file.
+ */
+int pbkdf2_batch_run(struct pbkdf2_batch *batch, const char *cache_file)
+{
+	size_t i, pending = 0;
+
+	if (batch->num == 0)
+		return 0;
+
+	if (cache_file)
+		pbkdf2_batch_cache_read(batch, cache_file);
+
+	for (i = 0; i < batch->num; i++) {
+		if (!batch->entries[i].done)
+			pending++;
+	}
+
+	if (pending && pbkdf2_batch_derive_all(batch, pending) < 0)
+		return -1;
+
+	if (cache_file && pending)
+		pbkdf2_batch_cache_write(batch, cache_file);
+
+	for (i = 0; i < batch->num; i++)
+		os_memcpy(batch->entries[i].out, batch->entries[i].psk,
+			  PBKDF2_BATCH_PSK_LEN);
+
+	return 0;
+}
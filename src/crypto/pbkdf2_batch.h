@@ -0,0 +1,20 @@
+/*
+ * Batch derivation of WPA PSKs from passphrases (PBKDF2-SHA1)
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef PBKDF2_BATCH_H
+#define PBKDF2_BATCH_H
+
+struct pbkdf2_batch;
+
+struct pbkdf2_batch * pbkdf2_batch_init(void);
+void pbkdf2_batch_free(struct pbkdf2_batch *batch);
+int pbkdf2_batch_add(struct pbkdf2_batch *batch, const char *passphrase,
+		     const u8 *ssid, size_t ssid_len, u8 *psk);
+int pbkdf2_batch_run(struct pbkdf2_batch *batch, const char *cache_file);
+
+#endif /* PBKDF2_BATCH_H */
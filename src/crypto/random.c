@@ -26,6 +26,9 @@
 #ifdef __linux__
 #include <fcntl.h>
 #endif /* __linux__ */
+#ifdef CONFIG_RANDOM_THREADS
+#include <pthread.h>
+#endif /* CONFIG_RANDOM_THREADS */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
@@ -63,6 +66,16 @@ static unsigned int total_collected = 0;
 
 static void random_write_entropy(void);
 
+#ifdef CONFIG_RANDOM_THREADS
+/* Protects the pool when random_get_bytes() is used from worker threads */
+static pthread_mutex_t random_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#define random_lock() pthread_mutex_lock(&random_pool_lock)
+#define random_unlock() pthread_mutex_unlock(&random_pool_lock)
+#else /* CONFIG_RANDOM_THREADS */
+#define random_lock() do { } while (0)
+#define random_unlock() do { } while (0)
+#endif /* CONFIG_RANDOM_THREADS */
+
 
 static u32 __ROL32(u32 x, u32 y)
 {
@@ -128,12 +141,14 @@ void random_add_randomness(const void *buf, size_t len)
 	struct os_time t;
 	static unsigned int count = 0;
 
+	random_lock();
 	count++;
 	if (entropy > MIN_COLLECT_ENTROPY && (count & 0x3ff) != 0) {
 		/*
 		 * No need to add more entropy at this point, so save CPU and
 		 * skip the update.
 		 */
+		random_unlock();
 		return;
 	}
 	wpa_printf(MSG_EXCESSIVE, "Add randomness: count=%u entropy=%u",
@@ -148,6 +163,7 @@ void random_add_randomness(const void *buf, size_t len)
 			(const u8 *) pool, sizeof(pool));
 	entropy++;
 	total_collected++;
+	random_unlock();
 }
 
 
@@ -157,15 +173,15 @@ int random_get_bytes(void *buf, size_t len)
 	u8 *bytes = buf;
 	size_t left;
 
-	wpa_printf(MSG_MSGDUMP, "Get randomness: len=%u entropy=%u",
-		   (unsigned int) len, entropy);
-
 	/* Start with assumed strong randomness from OS */
 	ret = os_get_random(buf, len);
 	wpa_hexdump_key(MSG_EXCESSIVE, "random from os_get_random",
 			buf, len);
 
 	/* Mix in additional entropy extracted from the internal pool */
+	random_lock();
+	wpa_printf(MSG_MSGDUMP, "Get randomness: len=%u entropy=%u",
+		   (unsigned int) len, entropy);
 	left = len;
 	while (left) {
 		size_t siz, i;
@@ -178,6 +194,7 @@ int random_get_bytes(void *buf, size_t len)
 			*bytes++ ^= tmp[i];
 		left -= siz;
 	}
+	random_unlock();
 
 #ifdef CONFIG_FIPS
 	/* Mix in additional entropy from the crypto module */
@@ -202,10 +219,12 @@ int random_get_bytes(void *buf, size_t len)
 
 	wpa_hexdump_key(MSG_EXCESSIVE, "mixed random", buf, len);
 
+	random_lock();
 	if (entropy < len)
 		entropy = 0;
 	else
 		entropy -= len;
+	random_unlock();
 
 	return ret;
 }
@@ -238,6 +257,7 @@ int random_pool_ready(void)
 		return -1;
 	}
 
+	random_lock();
 	res = read(fd, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
 	if (res < 0) {
@@ -249,6 +269,7 @@ int random_pool_ready(void)
 		   "/dev/random", (unsigned) res,
 		   (unsigned) (sizeof(dummy_key) - dummy_key_avail));
 	dummy_key_avail += res;
+	random_unlock();
 	close(fd);
 
 	if (dummy_key_avail == sizeof(dummy_key)) {
@@ -309,9 +330,11 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		return;
 	}
 
+	random_lock();
 	res = read(sock, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
 	if (res < 0) {
+		random_unlock();
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
 		return;
@@ -321,6 +344,7 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		   (unsigned) res,
 		   (unsigned) (sizeof(dummy_key) - dummy_key_avail));
 	dummy_key_avail += res;
+	random_unlock();
 
 	if (dummy_key_avail == sizeof(dummy_key)) {
 		random_close_fd();
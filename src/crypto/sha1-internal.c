@@ -229,6 +229,123 @@ void SHA1Transform(u32 state[5], const unsigned char buffer[64])
 }
 
 
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#ifdef __AVX2__
+#include <immintrin.h>
+typedef __m256i sha1_vec;
+#define V_LOAD(p) _mm256_loadu_si256((const __m256i *) (p))
+#define V_STORE(p, v) _mm256_storeu_si256((__m256i *) (p), (v))
+#define V_SET1(x) _mm256_set1_epi32(x)
+#define V_ADD(x, y) _mm256_add_epi32((x), (y))
+#define V_XOR(x, y) _mm256_xor_si256((x), (y))
+#define V_AND(x, y) _mm256_and_si256((x), (y))
+#define V_OR(x, y) _mm256_or_si256((x), (y))
+#define V_ROL(v, n) V_OR(_mm256_slli_epi32((v), (n)), \
+			 _mm256_srli_epi32((v), 32 - (n)))
+#else /* __AVX2__ */
+#include <emmintrin.h>
+typedef __m128i sha1_vec;
+#define V_LOAD(p) _mm_loadu_si128((const __m128i *) (p))
+#define V_STORE(p, v) _mm_storeu_si128((__m128i *) (p), (v))
+#define V_SET1(x) _mm_set1_epi32(x)
+#define V_ADD(x, y) _mm_add_epi32((x), (y))
+#define V_XOR(x, y) _mm_xor_si128((x), (y))
+#define V_AND(x, y) _mm_and_si128((x), (y))
+#define V_OR(x, y) _mm_or_si128((x), (y))
+#define V_ROL(v, n) V_OR(_mm_slli_epi32((v), (n)), \
+			 _mm_srli_epi32((v), 32 - (n)))
+#endif /* __AVX2__ */
+
+#define V_BLK(i) \
+	(w[(i) & 15] = V_ROL(V_XOR(V_XOR(w[((i) + 13) & 15], \
+					 w[((i) + 8) & 15]), \
+				   V_XOR(w[((i) + 2) & 15], w[(i) & 15])), 1))
+#define V_ROUND(f, k, x) \
+	do { \
+		t = V_ADD(V_ADD(V_ROL(a, 5), (f)), \
+			  V_ADD(V_ADD(e, (k)), (x))); \
+		e = d; \
+		d = c; \
+		c = V_ROL(b, 30); \
+		b = a; \
+		a = t; \
+	} while (0)
+
+/**
+ * SHA1TransformLanes - Process one 512-bit block in each of SHA1_LANES lanes
+ * @state: Interleaved SHA-1 states of the lanes
+ * @block: Interleaved message blocks as host byte order 32-bit words
+ *
+ * This is used for computing a number of independent hashes in parallel with
+ * SIMD instructions (e.g., the HMAC iterations in PBKDF2).
+ */
+void SHA1TransformLanes(u32 state[5][SHA1_LANES],
+			const u32 block[16][SHA1_LANES])
+{
+	sha1_vec w[16], a, b, c, d, e, t;
+	sha1_vec k0 = V_SET1(0x5A827999), k1 = V_SET1(0x6ED9EBA1);
+	sha1_vec k2 = V_SET1(0x8F1BBCDC), k3 = V_SET1(0xCA62C1D6);
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = V_LOAD(block[i]);
+	a = V_LOAD(state[0]);
+	b = V_LOAD(state[1]);
+	c = V_LOAD(state[2]);
+	d = V_LOAD(state[3]);
+	e = V_LOAD(state[4]);
+
+	for (i = 0; i < 16; i++)
+		V_ROUND(V_XOR(V_AND(b, V_XOR(c, d)), d), k0, w[i]);
+	for (; i < 20; i++)
+		V_ROUND(V_XOR(V_AND(b, V_XOR(c, d)), d), k0, V_BLK(i));
+	for (; i < 40; i++)
+		V_ROUND(V_XOR(V_XOR(b, c), d), k1, V_BLK(i));
+	for (; i < 60; i++)
+		V_ROUND(V_OR(V_AND(V_OR(b, c), d), V_AND(b, c)), k2, V_BLK(i));
+	for (; i < 80; i++)
+		V_ROUND(V_XOR(V_XOR(b, c), d), k3, V_BLK(i));
+
+	V_STORE(state[0], V_ADD(V_LOAD(state[0]), a));
+	V_STORE(state[1], V_ADD(V_LOAD(state[1]), b));
+	V_STORE(state[2], V_ADD(V_LOAD(state[2]), c));
+	V_STORE(state[3], V_ADD(V_LOAD(state[3]), d));
+	V_STORE(state[4], V_ADD(V_LOAD(state[4]), e));
+}
+
+#else /* __AVX2__ || __SSE2__ */
+
+/**
+ * SHA1TransformLanes - Process one 512-bit block in each of SHA1_LANES lanes
+ * @state: Interleaved SHA-1 states of the lanes
+ * @block: Interleaved message blocks as host byte order 32-bit words
+ *
+ * Portable version that processes the lanes one at a time.
+ */
+void SHA1TransformLanes(u32 state[5][SHA1_LANES],
+			const u32 block[16][SHA1_LANES])
+{
+	unsigned char buf[64];
+	u32 lstate[5];
+	int i, l;
+
+	for (l = 0; l < SHA1_LANES; l++) {
+		for (i = 0; i < 16; i++)
+			WPA_PUT_BE32(&buf[4 * i], block[i][l]);
+		for (i = 0; i < 5; i++)
+			lstate[i] = state[i][l];
+		SHA1Transform(lstate, buf);
+		for (i = 0; i < 5; i++)
+			state[i][l] = lstate[i];
+	}
+	os_memset(buf, 0, sizeof(buf));
+	os_memset(lstate, 0, sizeof(lstate));
+}
+
+#endif /* __AVX2__ || __SSE2__ */
+
+
 /* SHA1Init - Initialize new context */
 
 void SHA1Init(SHA1_CTX* context)
@@ -10,6 +10,225 @@
 
 #include "common.h"
 #include "sha1.h"
+#ifdef CONFIG_INTERNAL_SHA1
+#include "sha1_i.h"
+#include "crypto.h"
+#endif /* CONFIG_INTERNAL_SHA1 */
+
+#ifdef CONFIG_INTERNAL_SHA1
+
+/*
+ * With the internal SHA-1 implementation, the HMAC ipad/opad states are
+ * computed only once per passphrase and the remaining iterations are run as
+ * two SHA-1 block operations each. Independent PBKDF2 blocks (e.g., the two
+ * output blocks of a PSK or PSKs for multiple passphrases) are processed in
+ * parallel lanes with SHA1TransformLanes().
+ */
+
+static int pbkdf2_sha1_midstate(const char *passphrase, u32 ipad[5],
+				u32 opad[5])
+{
+	struct SHA1Context ctx;
+	u8 key[64], pad[64];
+	size_t key_len = os_strlen(passphrase);
+	int i;
+
+	os_memset(key, 0, sizeof(key));
+	if (key_len > sizeof(key)) {
+		const u8 *addr = (const u8 *) passphrase;
+
+		if (sha1_vector(1, &addr, &key_len, key) < 0)
+			return -1;
+	} else {
+		os_memcpy(key, passphrase, key_len);
+	}
+
+	for (i = 0; i < 64; i++)
+		pad[i] = key[i] ^ 0x36;
+	SHA1Init(&ctx);
+	SHA1Transform(ctx.state, pad);
+	os_memcpy(ipad, ctx.state, 5 * sizeof(u32));
+
+	for (i = 0; i < 64; i++)
+		pad[i] = key[i] ^ 0x5c;
+	SHA1Init(&ctx);
+	SHA1Transform(ctx.state, pad);
+	os_memcpy(opad, ctx.state, 5 * sizeof(u32));
+
+	os_memset(key, 0, sizeof(key));
+	os_memset(pad, 0, sizeof(pad));
+	os_memset(&ctx, 0, sizeof(ctx));
+	return 0;
+}
+
+
+static int pbkdf2_sha1_lanes(const char *passphrase[], const u8 *ssid[],
+			     const size_t ssid_len[], const unsigned int count[],
+			     size_t lanes, int iterations,
+			     u8 digest[][SHA1_MAC_LEN])
+{
+	u32 ipad[5][SHA1_LANES], opad[5][SHA1_LANES], state[5][SHA1_LANES];
+	u32 block[16][SHA1_LANES], t[5][SHA1_LANES], lipad[5], lopad[5];
+	u8 u1[SHA1_MAC_LEN], count_buf[4];
+	const u8 *addr[2];
+	size_t len[2];
+	size_t l;
+	int i, j, ret = -1;
+
+	os_memset(ipad, 0, sizeof(ipad));
+	os_memset(opad, 0, sizeof(opad));
+	os_memset(block, 0, sizeof(block));
+	os_memset(t, 0, sizeof(t));
+
+	for (l = 0; l < lanes; l++) {
+		if (pbkdf2_sha1_midstate(passphrase[l], lipad, lopad) < 0)
+			goto fail;
+
+		/* U1 = PRF(P, S || i) */
+		WPA_PUT_BE32(count_buf, count[l]);
+		addr[0] = ssid[l];
+		len[0] = ssid_len[l];
+		addr[1] = count_buf;
+		len[1] = 4;
+		if (hmac_sha1_vector((const u8 *) passphrase[l],
+				     os_strlen(passphrase[l]), 2, addr, len,
+				     u1))
+			goto fail;
+
+		for (j = 0; j < 5; j++) {
+			ipad[j][l] = lipad[j];
+			opad[j][l] = lopad[j];
+			block[j][l] = t[j][l] = WPA_GET_BE32(&u1[4 * j]);
+		}
+	}
+
+	/*
+	 * Both the inner and the outer hash input is a single 20 octet block
+	 * after the pad, so the SHA-1 padding in the message block does not
+	 * change between iterations.
+	 */
+	for (l = 0; l < SHA1_LANES; l++) {
+		block[5][l] = 0x80000000;
+		block[15][l] = (64 + SHA1_MAC_LEN) * 8;
+	}
+
+	for (i = 1; i < iterations; i++) {
+		os_memcpy(state, ipad, sizeof(state));
+		SHA1TransformLanes(state, block);
+		os_memcpy(block, state, sizeof(state));
+		os_memcpy(state, opad, sizeof(state));
+		SHA1TransformLanes(state, block);
+		os_memcpy(block, state, sizeof(state));
+		for (j = 0; j < 5; j++) {
+			for (l = 0; l < SHA1_LANES; l++)
+				t[j][l] ^= state[j][l];
+		}
+	}
+
+	for (l = 0; l < lanes; l++) {
+		for (j = 0; j < 5; j++)
+			WPA_PUT_BE32(&digest[l][4 * j], t[j][l]);
+	}
+	ret = 0;
+
+fail:
+	os_memset(ipad, 0, sizeof(ipad));
+	os_memset(opad, 0, sizeof(opad));
+	os_memset(state, 0, sizeof(state));
+	os_memset(block, 0, sizeof(block));
+	os_memset(t, 0, sizeof(t));
+	os_memset(lipad, 0, sizeof(lipad));
+	os_memset(lopad, 0, sizeof(lopad));
+	os_memset(u1, 0, sizeof(u1));
+	return ret;
+}
+
+
+/**
+ * pbkdf2_sha1_multi - PBKDF2-SHA1 for multiple passphrases
+ * @num: Number of passphrases
+ * @passphrase: ASCII passphrases
+ * @ssid: SSIDs
+ * @ssid_len: SSID lengths in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Buffers for the generated keys
+ * @buflen: Length of each buffer in bytes
+ * Returns: 0 on success, -1 of failure
+ *
+ * This is equivalent to calling pbkdf2_sha1() for each passphrase, but allows
+ * the key derivations to be computed in parallel.
+ */
+int pbkdf2_sha1_multi(size_t num, const char *passphrase[], const u8 *ssid[],
+		      const size_t ssid_len[], int iterations, u8 *buf[],
+		      size_t buflen)
+{
+	const char *lpassphrase[SHA1_LANES];
+	const u8 *lssid[SHA1_LANES];
+	size_t lssid_len[SHA1_LANES];
+	unsigned int count[SHA1_LANES];
+	u8 digest[SHA1_LANES][SHA1_MAC_LEN];
+	size_t blocks, total, pos, lanes, l, p, off, plen;
+	int ret = 0;
+
+	blocks = (buflen + SHA1_MAC_LEN - 1) / SHA1_MAC_LEN;
+	total = num * blocks;
+
+	for (pos = 0; pos < total; pos += lanes) {
+		lanes = total - pos;
+		if (lanes > SHA1_LANES)
+			lanes = SHA1_LANES;
+
+		for (l = 0; l < lanes; l++) {
+			p = (pos + l) / blocks;
+			lpassphrase[l] = passphrase[p];
+			lssid[l] = ssid[p];
+			lssid_len[l] = ssid_len[p];
+			count[l] = (pos + l) % blocks + 1;
+		}
+
+		if (pbkdf2_sha1_lanes(lpassphrase, lssid, lssid_len, count,
+				      lanes, iterations, digest) < 0) {
+			ret = -1;
+			break;
+		}
+
+		for (l = 0; l < lanes; l++) {
+			p = (pos + l) / blocks;
+			off = (count[l] - 1) * SHA1_MAC_LEN;
+			plen = buflen - off;
+			if (plen > SHA1_MAC_LEN)
+				plen = SHA1_MAC_LEN;
+			os_memcpy(buf[p] + off, digest[l], plen);
+		}
+	}
+
+	os_memset(digest, 0, sizeof(digest));
+	return ret;
+}
+
+
+/**
+ * pbkdf2_sha1 - SHA1-based key derivation function (PBKDF2) for IEEE 802.11i
+ * @passphrase: ASCII passphrase
+ * @ssid: SSID
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Buffer for the generated key
+ * @buflen: Length of the buffer in bytes
+ * Returns: 0 on success, -1 of failure
+ *
+ * This function is used to derive PSK for WPA-PSK. For this protocol,
+ * iterations is set to 4096 and buflen to 32. This function is described in
+ * IEEE Std 802.11-2004, Clause H.4. The main construction is from PKCS#5 v2.0.
+ */
+int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
+		int iterations, u8 *buf, size_t buflen)
+{
+	return pbkdf2_sha1_multi(1, &passphrase, &ssid, &ssid_len, iterations,
+				 &buf, buflen);
+}
+
+#else /* CONFIG_INTERNAL_SHA1 */
 
 static int pbkdf2_sha1_f(const char *passphrase, const u8 *ssid,
 			 size_t ssid_len, int iterations, unsigned int count,
@@ -90,3 +309,32 @@ int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
 
 	return 0;
 }
+
+
+/**
+ * pbkdf2_sha1_multi - PBKDF2-SHA1 for multiple passphrases
+ * @num: Number of passphrases
+ * @passphrase: ASCII passphrases
+ * @ssid: SSIDs
+ * @ssid_len: SSID lengths in bytes
+ * @iterations: Number of iterations to run
+ * @buf: Buffers for the generated keys
+ * @buflen: Length of each buffer in bytes
+ * Returns: 0 on success, -1 of failure
+ */
+int pbkdf2_sha1_multi(size_t num, const char *passphrase[], const u8 *ssid[],
+		      const size_t ssid_len[], int iterations, u8 *buf[],
+		      size_t buflen)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (pbkdf2_sha1(passphrase[i], ssid[i], ssid_len[i],
+				iterations, buf[i], buflen) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_INTERNAL_SHA1 */
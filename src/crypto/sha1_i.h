@@ -20,4 +20,18 @@ void SHA1Update(struct SHA1Context *context, const void *data, u32 len);
 void SHA1Final(unsigned char digest[20], struct SHA1Context *context);
 void SHA1Transform(u32 state[5], const unsigned char buffer[64]);
 
+/*
+ * Number of independent SHA-1 computations (lanes) processed by
+ * SHA1TransformLanes(). The state and message words are interleaved so that
+ * word i of lane l is at [i][l].
+ */
+#ifdef __AVX2__
+#define SHA1_LANES 8
+#else /* __AVX2__ */
+#define SHA1_LANES 4
+#endif /* __AVX2__ */
+
+void SHA1TransformLanes(u32 state[5][SHA1_LANES],
+			const u32 block[16][SHA1_LANES]);
+
 #endif /* SHA1_I_H */
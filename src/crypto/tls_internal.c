@@ -15,13 +15,20 @@
 #include "tls.h"
 #include "tls/tlsv1_client.h"
 #include "tls/tlsv1_server.h"
+#include "tls/x509v3.h"
 
 
 static int tls_ref_count = 0;
 
+/* Maximum number of sessions kept for TLS server session resumption */
+#define TLS_SERVER_SESSION_CACHE_SIZE 256
+
 struct tls_global {
 	int server;
 	struct tlsv1_credentials *server_cred;
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	struct tlsv1_server_cache *session_cache;
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
 	int check_crl;
 
 	void (*event_cb)(void *ctx, enum tls_event ev,
@@ -60,6 +67,11 @@ void * tls_init(const struct tls_config *conf)
 		global->event_cb = conf->event_cb;
 		global->cb_ctx = conf->cb_ctx;
 		global->cert_in_cb = conf->cert_in_cb;
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+		global->session_cache = tlsv1_server_cache_init(
+			TLS_SERVER_SESSION_CACHE_SIZE,
+			conf->tls_session_lifetime);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
 	}
 
 	return global;
@@ -76,8 +88,10 @@ void tls_deinit(void *ssl_ctx)
 #ifdef CONFIG_TLS_INTERNAL_SERVER
 		tlsv1_server_global_deinit();
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
+		x509_certificate_cache_flush();
 	}
 #ifdef CONFIG_TLS_INTERNAL_SERVER
+	tlsv1_server_cache_deinit(global->session_cache);
 	tlsv1_cred_free(global->server_cred);
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
 	os_free(global);
@@ -118,6 +132,8 @@ struct tls_connection * tls_connection_init(void *tls_ctx)
 			os_free(conn);
 			return NULL;
 		}
+		tlsv1_server_set_session_cache(conn->server,
+					       global->session_cache);
 	}
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
 
@@ -298,6 +314,9 @@ int tls_global_set_params(void *tls_ctx,
 	/* Currently, global parameters are only set when running in server
 	 * mode. */
 	global->server = 1;
+	/* Cached sessions are bound to the previous credentials */
+	tlsv1_server_cache_flush(global->session_cache);
+	x509_certificate_cache_flush();
 	tlsv1_cred_free(global->server_cred);
 	global->server_cred = cred = tlsv1_cred_alloc();
 	if (cred == NULL)
@@ -759,6 +778,13 @@ int tls_get_library_version(char *buf, size_t buf_len)
 void tls_connection_set_success_data(struct tls_connection *conn,
 				     struct wpabuf *data)
 {
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conn->server) {
+		tlsv1_server_set_success_data(conn->server, data);
+		return;
+	}
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
+	wpabuf_free(data);
 }
 
 
@@ -770,10 +796,18 @@ void tls_connection_set_success_data_resumed(struct tls_connection *conn)
 const struct wpabuf *
 tls_connection_get_success_data(struct tls_connection *conn)
 {
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conn->server)
+		return tlsv1_server_get_success_data(conn->server);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
 	return NULL;
 }
 
 
 void tls_connection_remove_session(struct tls_connection *conn)
 {
+#ifdef CONFIG_TLS_INTERNAL_SERVER
+	if (conn->server)
+		tlsv1_server_remove_session(conn->server);
+#endif /* CONFIG_TLS_INTERNAL_SERVER */
 }
@@ -7,6 +7,9 @@
  */
 
 #include "includes.h"
+#ifdef CONFIG_CRYPTO_THREADS
+#include <pthread.h>
+#endif /* CONFIG_CRYPTO_THREADS */
 
 #ifndef CONFIG_SMARTCARD
 #ifndef OPENSSL_NO_ENGINE
@@ -193,6 +196,62 @@ struct tls_context {
 static struct tls_context *tls_global = NULL;
 
 
+#if defined(CONFIG_CRYPTO_THREADS) && OPENSSL_VERSION_NUMBER < 0x10100000L
+
+/*
+ * OpenSSL versions before 1.1.0 are thread safe only if the application
+ * provides the locking callbacks.
+ */
+static pthread_mutex_t *tls_openssl_locks = NULL;
+
+static void tls_openssl_locking_cb(int mode, int n, const char *file,
+				   int line)
+{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&tls_openssl_locks[n]);
+	else
+		pthread_mutex_unlock(&tls_openssl_locks[n]);
+}
+
+
+static void tls_openssl_thread_id_cb(CRYPTO_THREADID *id)
+{
+	CRYPTO_THREADID_set_numeric(id, (unsigned long) pthread_self());
+}
+
+
+static int tls_openssl_locks_init(void)
+{
+	int i, num = CRYPTO_num_locks();
+
+	tls_openssl_locks = os_calloc(num, sizeof(pthread_mutex_t));
+	if (!tls_openssl_locks)
+		return -1;
+	for (i = 0; i < num; i++)
+		pthread_mutex_init(&tls_openssl_locks[i], NULL);
+	CRYPTO_THREADID_set_callback(tls_openssl_thread_id_cb);
+	CRYPTO_set_locking_callback(tls_openssl_locking_cb);
+	return 0;
+}
+
+
+static void tls_openssl_locks_deinit(void)
+{
+	int i, num = CRYPTO_num_locks();
+
+	if (!tls_openssl_locks)
+		return;
+	CRYPTO_set_locking_callback(NULL);
+	CRYPTO_THREADID_set_callback(NULL);
+	for (i = 0; i < num; i++)
+		pthread_mutex_destroy(&tls_openssl_locks[i]);
+	os_free(tls_openssl_locks);
+	tls_openssl_locks = NULL;
+}
+
+#endif /* CONFIG_CRYPTO_THREADS && < 1.1.0 */
+
+
 struct tls_data {
 	SSL_CTX *ssl;
 	unsigned int tls_session_lifetime;
@@ -920,6 +979,13 @@ void * tls_init(const struct tls_config *conf)
 #endif /* OPENSSL_FIPS */
 #endif /* CONFIG_FIPS */
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
+#ifdef CONFIG_CRYPTO_THREADS
+		if (tls_openssl_locks_init() < 0) {
+			os_free(tls_global);
+			tls_global = NULL;
+			return NULL;
+		}
+#endif /* CONFIG_CRYPTO_THREADS */
 		SSL_load_error_strings();
 		SSL_library_init();
 #ifndef OPENSSL_NO_SHA256
@@ -1051,6 +1117,9 @@ void tls_deinit(void *ssl_ctx)
 		ERR_remove_thread_state(NULL);
 		ERR_free_strings();
 		EVP_cleanup();
+#ifdef CONFIG_CRYPTO_THREADS
+		tls_openssl_locks_deinit();
+#endif /* CONFIG_CRYPTO_THREADS */
 #endif /* < 1.1.0 */
 		os_free(tls_global->ocsp_stapling_response);
 		tls_global->ocsp_stapling_response = NULL;
@@ -187,8 +187,8 @@ int eap_eke_dh_init(u8 group, u8 *ret_priv, u8 *ret_pub)
 
 	/* y = g ^ x (mod p) */
 	pub_len = dh->prime_len;
-	if (crypto_mod_exp(&gen, 1, ret_priv, dh->prime_len,
-			   dh->prime, dh->prime_len, ret_pub, &pub_len) < 0)
+	if (dh_mod_exp(dh, &gen, 1, ret_priv, dh->prime_len,
+		       ret_pub, &pub_len) < 0)
 		return -1;
 	if (pub_len < dh->prime_len) {
 		size_t pad = dh->prime_len - pub_len;
@@ -421,8 +421,8 @@ int eap_eke_shared_secret(struct eap_eke_session *sess, const u8 *key,
 
 	/* SharedSecret = prf(0+, g ^ (x_s * x_p) (mod p)) */
 	len = dh->prime_len;
-	if (crypto_mod_exp(peer_pub, dh->prime_len, dhpriv, dh->prime_len,
-			   dh->prime, dh->prime_len, modexp, &len) < 0)
+	if (dh_mod_exp(dh, peer_pub, dh->prime_len, dhpriv, dh->prime_len,
+		       modexp, &len) < 0)
 		return -1;
 	if (len < dh->prime_len) {
 		size_t pad = dh->prime_len - len;
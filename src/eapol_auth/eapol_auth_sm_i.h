@@ -148,6 +148,8 @@ struct eapol_state_machine {
 	struct eap_eapol_interface *eap_if;
 
 	int radius_identifier;
+	u8 radius_authenticator[16]; /* Request Authenticator of the pending
+				      * Access-Request */
 	/* TODO: check when the last messages can be released */
 	struct radius_msg *last_recv_radius;
 	u8 last_eap_id; /* last used EAP Identifier */
@@ -9,8 +9,10 @@
 #include "includes.h"
 
 #include "common.h"
+#include "utils/list.h"
 #include "radius.h"
 #include "radius_client.h"
+#include "radius_io.h"
 #include "eloop.h"
 
 /* Defaults for RADIUS retransmit values (exponential backoff) */
@@ -49,6 +51,19 @@
  */
 #define RADIUS_CLIENT_NUM_FAILOVER 4
 
+/**
+ * RADIUS_CLIENT_MAX_SOCKS - RADIUS client maximum source sockets
+ *
+ * Maximum number of source sockets (local UDP ports) used for each server
+ * type. Each socket has its own RADIUS identifier space.
+ */
+#define RADIUS_CLIENT_MAX_SOCKS 16
+
+/**
+ * RADIUS_CLIENT_MAX_MSG_LEN - RADIUS client maximum received message length
+ */
+#define RADIUS_CLIENT_MAX_MSG_LEN 3000
+
 
 /**
  * struct radius_rx_handler - RADIUS client RX handler
@@ -137,9 +152,45 @@ struct radius_msg_list {
 	/* TODO: server config with failover to backup server(s) */
 
 	/**
-	 * next - Next message in the list
+	 * list - Entry in the pending message list (newest first)
+	 */
+	struct dl_list list;
+
+	/**
+	 * slot - Source socket on which the identifier of this message is
+	 * reserved or %NULL if none
 	 */
-	struct radius_msg_list *next;
+	struct radius_client_sock *slot;
+};
+
+
+/**
+ * struct radius_client_sock - RADIUS client source socket
+ *
+ * Each source socket uses a separate local UDP port and consequently has its
+ * own RADIUS identifier space. Pending requests are indexed by identifier so
+ * that a response can be matched without walking the pending message list.
+ */
+struct radius_client_sock {
+	/**
+	 * serv_sock - IPv4 socket
+	 */
+	int serv_sock;
+
+	/**
+	 * serv_sock6 - IPv6 socket
+	 */
+	int serv_sock6;
+
+	/**
+	 * sock - Currently used socket (serv_sock or serv_sock6)
+	 */
+	int sock;
+
+	/**
+	 * pending - Pending requests indexed by RADIUS identifier
+	 */
+	struct radius_msg_list *pending[256];
 };
 
 
@@ -163,34 +214,19 @@ struct radius_client_data {
 	struct hostapd_radius_servers *conf;
 
 	/**
-	 * auth_serv_sock - IPv4 socket for RADIUS authentication messages
-	 */
-	int auth_serv_sock;
-
-	/**
-	 * acct_serv_sock - IPv4 socket for RADIUS accounting messages
-	 */
-	int acct_serv_sock;
-
-	/**
-	 * auth_serv_sock6 - IPv6 socket for RADIUS authentication messages
-	 */
-	int auth_serv_sock6;
-
-	/**
-	 * acct_serv_sock6 - IPv6 socket for RADIUS accounting messages
+	 * auth_socks - Source sockets for RADIUS authentication messages
 	 */
-	int acct_serv_sock6;
+	struct radius_client_sock *auth_socks;
 
 	/**
-	 * auth_sock - Currently used socket for RADIUS authentication server
+	 * acct_socks - Source sockets for RADIUS accounting messages
 	 */
-	int auth_sock;
+	struct radius_client_sock *acct_socks;
 
 	/**
-	 * acct_sock - Currently used socket for RADIUS accounting server
+	 * num_socks - Number of entries in auth_socks and acct_socks
 	 */
-	int acct_sock;
+	size_t num_socks;
 
 	/**
 	 * auth_handlers - Authentication message handlers
@@ -213,9 +249,9 @@ struct radius_client_data {
 	size_t num_acct_handlers;
 
 	/**
-	 * msgs - Pending outgoing RADIUS messages
+	 * msgs - Pending outgoing RADIUS messages (struct radius_msg_list)
 	 */
-	struct radius_msg_list *msgs;
+	struct dl_list msgs;
 
 	/**
 	 * num_msgs - Number of pending messages in the msgs list
@@ -236,6 +272,21 @@ struct radius_client_data {
 	 * interim_error_cb_ctx - interim_error_cb() context data
 	 */
 	void *interim_error_cb_ctx;
+
+	/**
+	 * rx_buf - Receive buffers for RADIUS_IO_BATCH messages
+	 */
+	u8 *rx_buf;
+
+	/**
+	 * tx_batch - Retransmissions waiting for radius_client_tx_flush()
+	 */
+	struct radius_msg_list *tx_batch[RADIUS_IO_BATCH];
+
+	/**
+	 * num_tx_batch - Number of entries in tx_batch
+	 */
+	size_t num_tx_batch;
 };
 
 
@@ -243,7 +294,7 @@ static int
 radius_change_server(struct radius_client_data *radius,
 		     struct hostapd_radius_server *nserv,
 		     struct hostapd_radius_server *oserv,
-		     int sock, int sock6, int auth);
+		     int auth);
 static int radius_client_init_acct(struct radius_client_data *radius);
 static int radius_client_init_auth(struct radius_client_data *radius);
 static void radius_client_auth_failover(struct radius_client_data *radius);
@@ -257,6 +308,103 @@ static void radius_client_msg_free(struct radius_msg_list *req)
 }
 
 
+static struct radius_client_sock *
+radius_client_socks(struct radius_client_data *radius, RadiusType msg_type)
+{
+	return msg_type == RADIUS_AUTH ? radius->auth_socks :
+		radius->acct_socks;
+}
+
+
+static void radius_client_msg_unslot(struct radius_msg_list *entry)
+{
+	if (entry->slot) {
+		entry->slot->pending[radius_msg_get_hdr(entry->msg)->identifier]
+			= NULL;
+		entry->slot = NULL;
+	}
+}
+
+
+static void radius_client_tx_flush(struct radius_client_data *radius);
+
+static void radius_client_msg_remove(struct radius_client_data *radius,
+				     struct radius_msg_list *entry)
+{
+	radius_client_tx_flush(radius);
+	radius_client_msg_unslot(entry);
+	dl_list_del(&entry->list);
+	radius->num_msgs--;
+}
+
+
+static struct radius_msg_list *
+radius_client_msg_next(struct radius_client_data *radius,
+		       struct radius_msg_list *entry)
+{
+	if (entry->list.next == &radius->msgs)
+		return NULL;
+	return dl_list_entry(entry->list.next, struct radius_msg_list, list);
+}
+
+
+/*
+ * Reserve the identifier of a message on the first source socket that does
+ * not have a pending request with the same identifier. If the identifier is
+ * in use on all source sockets, the oldest of the pending requests is
+ * removed. Returns the socket to use for sending the message.
+ */
+static int radius_client_msg_slot(struct radius_client_data *radius,
+				  struct radius_msg_list *entry)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
+	struct radius_client_sock *socks, *cs = NULL;
+	struct radius_msg_list *old, *oldest = NULL;
+	struct hostapd_radius_server *serv;
+	u8 id = radius_msg_get_hdr(entry->msg)->identifier;
+	size_t i;
+
+	socks = radius_client_socks(radius, entry->msg_type);
+	if (!socks)
+		return -1;
+
+	for (i = 0; i < radius->num_socks; i++) {
+		/* Additional sockets are used only if they could be
+		 * connected to the current server */
+		if (i > 0 && socks[i].sock < 0)
+			continue;
+		old = socks[i].pending[id];
+		if (!old) {
+			cs = &socks[i];
+			break;
+		}
+		if (!oldest || old->first_try < oldest->first_try) {
+			oldest = old;
+			cs = &socks[i];
+		}
+	}
+
+	if (oldest && cs->pending[id] == oldest) {
+		/* Remove the old entry to avoid using a new reply from the
+		 * RADIUS server with an old request */
+		hostapd_logger(radius->ctx, oldest->addr,
+			       HOSTAPD_MODULE_RADIUS, HOSTAPD_LEVEL_DEBUG,
+			       "Removing pending RADIUS message, since its id (%d) is reused",
+			       id);
+		serv = entry->msg_type == RADIUS_AUTH ? conf->auth_server :
+			conf->acct_server;
+		if (serv)
+			serv->id_exhaustions++;
+		radius_client_msg_remove(radius, oldest);
+		radius_client_msg_free(oldest);
+	}
+
+	cs->pending[id] = entry;
+	entry->slot = cs;
+	return cs->sock;
+}
+
+
 /**
  * radius_client_register - Register a RADIUS client RX handler
  * @radius: RADIUS client context from radius_client_init()
@@ -357,28 +505,94 @@ static int radius_client_handle_send_error(struct radius_client_data *radius,
 }
 
 
+/*
+ * Send the retransmissions queued from radius_client_timer(). Consecutive
+ * messages for the same socket are sent with a single system call where
+ * supported. This must be called before any queued entry is freed and before
+ * the sockets are changed.
+ *
+ * The socket is read from the entry's slot when the batch is sent. A send
+ * error may make radius_client_handle_send_error() reopen the sockets or flush
+ * the message queue, so the rest of the batch is not sent on the sockets
+ * resolved before the error. The remaining entries are queued again with
+ * their current sockets unless the message queue was flushed, in which case
+ * any entry that is still pending is sent by radius_client_timer().
+ */
+static void radius_client_tx_flush(struct radius_client_data *radius)
+{
+	struct radius_tx_pkt pkts[RADIUS_IO_BATCH];
+	struct radius_msg_list *batch[RADIUS_IO_BATCH];
+	int socks[RADIUS_IO_BATCH];
+	size_t num, i, j, k;
+	struct wpabuf *buf;
+
+	while (radius->num_tx_batch > 0) {
+		/* Error handling may change the sockets, which flushes the
+		 * queue, so take a local copy first. */
+		num = radius->num_tx_batch;
+		os_memcpy(batch, radius->tx_batch, num * sizeof(batch[0]));
+		radius->num_tx_batch = 0;
+
+		for (i = 0; i < num; i++) {
+			buf = radius_msg_get_buf(batch[i]->msg);
+			socks[i] = batch[i]->slot ? batch[i]->slot->sock : -1;
+			pkts[i].data = wpabuf_head(buf);
+			pkts[i].len = wpabuf_len(buf);
+			pkts[i].to = NULL;
+			pkts[i].tolen = 0;
+		}
+
+		for (i = 0; i < num; i = j) {
+			for (j = i + 1; j < num && socks[j] == socks[i]; j++)
+				;
+			if (socks[i] < 0)
+				continue;
+			i += radius_send_batch(socks[i], &pkts[i], j - i);
+			if (i < j)
+				break;
+		}
+		if (i >= num)
+			break;
+
+		if (radius_client_handle_send_error(radius, socks[i],
+						    batch[i]->msg_type) > 0)
+			break;
+		for (k = i + 1; k < num; k++)
+			radius->tx_batch[radius->num_tx_batch++] = batch[k];
+	}
+}
+
+
+static void radius_client_tx_queue(struct radius_client_data *radius,
+				   struct radius_msg_list *entry)
+{
+	if (radius->num_tx_batch == RADIUS_IO_BATCH)
+		radius_client_tx_flush(radius);
+	radius->tx_batch[radius->num_tx_batch++] = entry;
+}
+
+
 static int radius_client_retransmit(struct radius_client_data *radius,
 				    struct radius_msg_list *entry,
 				    os_time_t now)
 {
 	struct hostapd_radius_servers *conf = radius->conf;
 	int s;
-	struct wpabuf *buf;
 	size_t prev_num_msgs;
 	u8 *acct_delay_time;
 	size_t acct_delay_time_len;
 
 	if (entry->msg_type == RADIUS_ACCT ||
 	    entry->msg_type == RADIUS_ACCT_INTERIM) {
-		if (radius->acct_sock < 0)
+		if (radius->acct_socks[0].sock < 0)
 			radius_client_init_acct(radius);
-		if (radius->acct_sock < 0 && conf->num_acct_servers > 1) {
+		if (radius->acct_socks[0].sock < 0 &&
+		    conf->num_acct_servers > 1) {
 			prev_num_msgs = radius->num_msgs;
 			radius_client_acct_failover(radius);
 			if (prev_num_msgs != radius->num_msgs)
 				return 0;
 		}
-		s = radius->acct_sock;
 		if (entry->attempts == 0)
 			conf->acct_server->requests++;
 		else {
@@ -386,15 +600,15 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 			conf->acct_server->retransmissions++;
 		}
 	} else {
-		if (radius->auth_sock < 0)
+		if (radius->auth_socks[0].sock < 0)
 			radius_client_init_auth(radius);
-		if (radius->auth_sock < 0 && conf->num_auth_servers > 1) {
+		if (radius->auth_socks[0].sock < 0 &&
+		    conf->num_auth_servers > 1) {
 			prev_num_msgs = radius->num_msgs;
 			radius_client_auth_failover(radius);
 			if (prev_num_msgs != radius->num_msgs)
 				return 0;
 		}
-		s = radius->auth_sock;
 		if (entry->attempts == 0)
 			conf->auth_server->requests++;
 		else {
@@ -414,12 +628,6 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		return 1;
 	}
 
-	if (s < 0) {
-		wpa_printf(MSG_INFO,
-			   "RADIUS: No valid socket for retransmission");
-		return 1;
-	}
-
 	if (entry->msg_type == RADIUS_ACCT &&
 	    radius_msg_get_attr_ptr(entry->msg, RADIUS_ATTR_ACCT_DELAY_TIME,
 				    &acct_delay_time, &acct_delay_time_len,
@@ -432,6 +640,7 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		 * Need to assign a new identifier since attribute contents
 		 * changes.
 		 */
+		radius_client_msg_unslot(entry);
 		hdr = radius_msg_get_hdr(entry->msg);
 		hdr->identifier = radius_client_get_id(radius);
 
@@ -448,6 +657,18 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 			radius_msg_dump(entry->msg);
 	}
 
+	/* Move the message to another source socket if the one it was sent
+	 * from is not available anymore */
+	if (!entry->slot || entry->slot->sock < 0)
+		radius_client_msg_unslot(entry);
+	s = entry->slot ? entry->slot->sock :
+		radius_client_msg_slot(radius, entry);
+	if (s < 0) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: No valid socket for retransmission");
+		return 1;
+	}
+
 	/* retransmit; remove entry if too many attempts */
 	entry->attempts++;
 	hostapd_logger(radius->ctx, entry->addr, HOSTAPD_MODULE_RADIUS,
@@ -455,12 +676,7 @@ static int radius_client_retransmit(struct radius_client_data *radius,
 		       radius_msg_get_hdr(entry->msg)->identifier);
 
 	os_get_reltime(&entry->last_attempt);
-	buf = radius_msg_get_buf(entry->msg);
-	if (send(s, wpabuf_head(buf), wpabuf_len(buf), 0) < 0) {
-		if (radius_client_handle_send_error(radius, s, entry->msg_type)
-		    > 0)
-			return 0;
-	}
+	radius_client_tx_queue(radius, entry);
 
 	entry->next_try = now + entry->next_wait;
 	entry->next_wait *= 2;
@@ -480,45 +696,40 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 	struct radius_client_data *radius = eloop_ctx;
 	struct os_reltime now;
 	os_time_t first;
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *next;
 	int auth_failover = 0, acct_failover = 0;
 	size_t prev_num_msgs;
 	int s;
 
-	entry = radius->msgs;
+	entry = dl_list_first(&radius->msgs, struct radius_msg_list, list);
 	if (!entry)
 		return;
 
 	os_get_reltime(&now);
 	first = 0;
 
-	prev = NULL;
 	while (entry) {
 		prev_num_msgs = radius->num_msgs;
 		if (now.sec >= entry->next_try &&
 		    radius_client_retransmit(radius, entry, now.sec)) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-			continue;
+			next = radius_client_msg_next(radius, entry);
+			radius_client_msg_remove(radius, entry);
+			radius_client_msg_free(entry);
+			if (prev_num_msgs == radius->num_msgs + 1) {
+				entry = next;
+				continue;
+			}
 		}
 
 		if (prev_num_msgs != radius->num_msgs) {
 			wpa_printf(MSG_DEBUG,
 				   "RADIUS: Message removed from queue - restart from beginning");
-			entry = radius->msgs;
-			prev = NULL;
+			entry = dl_list_first(&radius->msgs,
+					      struct radius_msg_list, list);
 			continue;
 		}
 
-		s = entry->msg_type == RADIUS_AUTH ? radius->auth_sock :
-			radius->acct_sock;
+		s = radius_client_socks(radius, entry->msg_type)[0].sock;
 		if (entry->attempts > RADIUS_CLIENT_NUM_FAILOVER ||
 		    (s < 0 && entry->attempts > 0)) {
 			if (entry->msg_type == RADIUS_ACCT ||
@@ -531,11 +742,12 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 		if (first == 0 || entry->next_try < first)
 			first = entry->next_try;
 
-		prev = entry;
-		entry = entry->next;
+		entry = radius_client_msg_next(radius, entry);
 	}
 
-	if (radius->msgs) {
+	radius_client_tx_flush(radius);
+
+	if (!dl_list_empty(&radius->msgs)) {
 		if (first < now.sec)
 			first = now.sec;
 		eloop_register_timeout(first - now.sec, 0,
@@ -568,7 +780,7 @@ static void radius_client_auth_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH)
 			old->timeouts++;
 	}
@@ -577,9 +789,7 @@ static void radius_client_auth_failover(struct radius_client_data *radius)
 	if (next > &(conf->auth_servers[conf->num_auth_servers - 1]))
 		next = conf->auth_servers;
 	conf->auth_server = next;
-	radius_change_server(radius, next, old,
-			     radius->auth_serv_sock,
-			     radius->auth_serv_sock6, 1);
+	radius_change_server(radius, next, old, 1);
 }
 
 
@@ -597,7 +807,7 @@ static void radius_client_acct_failover(struct radius_client_data *radius)
 		       hostapd_ip_txt(&old->addr, abuf, sizeof(abuf)),
 		       old->port);
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_ACCT ||
 		    entry->msg_type == RADIUS_ACCT_INTERIM)
 			old->timeouts++;
@@ -607,9 +817,7 @@ static void radius_client_acct_failover(struct radius_client_data *radius)
 	if (next > &conf->acct_servers[conf->num_acct_servers - 1])
 		next = conf->acct_servers;
 	conf->acct_server = next;
-	radius_change_server(radius, next, old,
-			     radius->acct_serv_sock,
-			     radius->acct_serv_sock6, 0);
+	radius_change_server(radius, next, old, 0);
 }
 
 
@@ -621,12 +829,11 @@ static void radius_client_update_timeout(struct radius_client_data *radius)
 
 	eloop_cancel_timeout(radius_client_timer, radius, NULL);
 
-	if (radius->msgs == NULL) {
+	if (dl_list_empty(&radius->msgs))
 		return;
-	}
 
 	first = 0;
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (first == 0 || entry->next_try < first)
 			first = entry->next_try;
 	}
@@ -642,26 +849,23 @@ static void radius_client_update_timeout(struct radius_client_data *radius)
 }
 
 
-static void radius_client_list_add(struct radius_client_data *radius,
-				   struct radius_msg *msg,
-				   RadiusType msg_type,
-				   const u8 *shared_secret,
-				   size_t shared_secret_len, const u8 *addr)
+static struct radius_msg_list *
+radius_client_msg_alloc(struct radius_msg *msg, RadiusType msg_type,
+			const u8 *shared_secret, size_t shared_secret_len,
+			const u8 *addr)
 {
-	struct radius_msg_list *entry, *prev;
+	struct radius_msg_list *entry;
 
 	if (eloop_terminated()) {
 		/* No point in adding entries to retransmit queue since event
 		 * loop has already been terminated. */
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	entry = os_zalloc(sizeof(*entry));
 	if (entry == NULL) {
 		wpa_printf(MSG_INFO, "RADIUS: Failed to add packet into retransmit list");
-		radius_msg_free(msg);
-		return;
+		return NULL;
 	}
 
 	if (addr)
@@ -675,23 +879,37 @@ static void radius_client_list_add(struct radius_client_data *radius,
 	entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
 	entry->attempts = 1;
 	entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
-	entry->next = radius->msgs;
-	radius->msgs = entry;
+
+	return entry;
+}
+
+
+static size_t radius_client_max_msgs(struct radius_client_data *radius)
+{
+	if (radius->conf->max_pending > 0)
+		return radius->conf->max_pending;
+	if (radius->num_socks > 1)
+		return 256 * radius->num_socks;
+	return RADIUS_CLIENT_MAX_ENTRIES;
+}
+
+
+static void radius_client_list_add(struct radius_client_data *radius,
+				   struct radius_msg_list *entry)
+{
+	struct radius_msg_list *oldest;
+
+	dl_list_add(&radius->msgs, &entry->list);
+	radius->num_msgs++;
 	radius_client_update_timeout(radius);
 
-	if (radius->num_msgs >= RADIUS_CLIENT_MAX_ENTRIES) {
+	if (radius->num_msgs > radius_client_max_msgs(radius)) {
 		wpa_printf(MSG_INFO, "RADIUS: Removing the oldest un-ACKed packet due to retransmit list limits");
-		prev = NULL;
-		while (entry->next) {
-			prev = entry;
-			entry = entry->next;
-		}
-		if (prev) {
-			prev->next = NULL;
-			radius_client_msg_free(entry);
-		}
-	} else
-		radius->num_msgs++;
+		oldest = dl_list_last(&radius->msgs, struct radius_msg_list,
+				      list);
+		radius_client_msg_remove(radius, oldest);
+		radius_client_msg_free(oldest);
+	}
 }
 
 
@@ -730,12 +948,14 @@ int radius_client_send(struct radius_client_data *radius,
 	char *name;
 	int s, res;
 	struct wpabuf *buf;
+	struct radius_msg_list *entry;
 
 	if (msg_type == RADIUS_ACCT || msg_type == RADIUS_ACCT_INTERIM) {
-		if (conf->acct_server && radius->acct_sock < 0)
+		if (conf->acct_server && radius->acct_socks[0].sock < 0)
 			radius_client_init_acct(radius);
 
-		if (conf->acct_server == NULL || radius->acct_sock < 0 ||
+		if (conf->acct_server == NULL ||
+		    radius->acct_socks[0].sock < 0 ||
 		    conf->acct_server->shared_secret == NULL) {
 			hostapd_logger(radius->ctx, NULL,
 				       HOSTAPD_MODULE_RADIUS,
@@ -747,13 +967,13 @@ int radius_client_send(struct radius_client_data *radius,
 		shared_secret_len = conf->acct_server->shared_secret_len;
 		radius_msg_finish_acct(msg, shared_secret, shared_secret_len);
 		name = "accounting";
-		s = radius->acct_sock;
 		conf->acct_server->requests++;
 	} else {
-		if (conf->auth_server && radius->auth_sock < 0)
+		if (conf->auth_server && radius->auth_socks[0].sock < 0)
 			radius_client_init_auth(radius);
 
-		if (conf->auth_server == NULL || radius->auth_sock < 0 ||
+		if (conf->auth_server == NULL ||
+		    radius->auth_socks[0].sock < 0 ||
 		    conf->auth_server->shared_secret == NULL) {
 			hostapd_logger(radius->ctx, NULL,
 				       HOSTAPD_MODULE_RADIUS,
@@ -765,7 +985,6 @@ int radius_client_send(struct radius_client_data *radius,
 		shared_secret_len = conf->auth_server->shared_secret_len;
 		radius_msg_finish(msg, shared_secret, shared_secret_len);
 		name = "authentication";
-		s = radius->auth_sock;
 		conf->auth_server->requests++;
 	}
 
@@ -775,30 +994,39 @@ int radius_client_send(struct radius_client_data *radius,
 	if (conf->msg_dumps)
 		radius_msg_dump(msg);
 
+	entry = radius_client_msg_alloc(msg, msg_type, shared_secret,
+					shared_secret_len, addr);
+	if (entry)
+		s = radius_client_msg_slot(radius, entry);
+	else
+		s = radius_client_socks(radius, msg_type)[0].sock;
+
 	buf = radius_msg_get_buf(msg);
 	res = send(s, wpabuf_head(buf), wpabuf_len(buf), 0);
 	if (res < 0)
 		radius_client_handle_send_error(radius, s, msg_type);
 
-	radius_client_list_add(radius, msg, msg_type, shared_secret,
-			       shared_secret_len, addr);
+	if (entry)
+		radius_client_list_add(radius, entry);
+	else
+		radius_msg_free(msg);
 
 	return 0;
 }
 
 
-static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
+static void radius_client_receive_msg(struct radius_client_data *radius,
+				      int sock, RadiusType msg_type,
+				      const u8 *buf, size_t len)
 {
-	struct radius_client_data *radius = eloop_ctx;
 	struct hostapd_radius_servers *conf = radius->conf;
-	RadiusType msg_type = (RadiusType) sock_ctx;
-	int len, roundtrip;
-	unsigned char buf[3000];
+	int roundtrip;
 	struct radius_msg *msg;
 	struct radius_hdr *hdr;
 	struct radius_rx_handler *handlers;
 	size_t num_handlers, i;
-	struct radius_msg_list *req, *prev_req;
+	struct radius_client_sock *socks;
+	struct radius_msg_list *req;
 	struct os_reltime now;
 	struct hostapd_radius_server *rconf;
 	int invalid_authenticator = 0;
@@ -813,15 +1041,10 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		rconf = conf->auth_server;
 	}
 
-	len = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recv[RADIUS]: %s", strerror(errno));
-		return;
-	}
 	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
 		       HOSTAPD_LEVEL_DEBUG, "Received %d bytes from RADIUS "
-		       "server", len);
-	if (len == sizeof(buf)) {
+		       "server", (int) len);
+	if (len == RADIUS_CLIENT_MAX_MSG_LEN) {
 		wpa_printf(MSG_INFO, "RADIUS: Possibly too long UDP frame for our buffer - dropping it");
 		return;
 	}
@@ -854,20 +1077,15 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		break;
 	}
 
-	prev_req = NULL;
-	req = radius->msgs;
-	while (req) {
-		/* TODO: also match by src addr:port of the packet when using
-		 * alternative RADIUS servers (?) */
-		if ((req->msg_type == msg_type ||
-		     (req->msg_type == RADIUS_ACCT_INTERIM &&
-		      msg_type == RADIUS_ACCT)) &&
-		    radius_msg_get_hdr(req->msg)->identifier ==
-		    hdr->identifier)
+	/* TODO: also match by src addr:port of the packet when using
+	 * alternative RADIUS servers (?) */
+	req = NULL;
+	socks = radius_client_socks(radius, msg_type);
+	for (i = 0; socks && i < radius->num_socks; i++) {
+		if (socks[i].serv_sock == sock || socks[i].serv_sock6 == sock) {
+			req = socks[i].pending[hdr->identifier];
 			break;
-
-		prev_req = req;
-		req = req->next;
+		}
 	}
 
 	if (req == NULL) {
@@ -890,11 +1108,7 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 	rconf->round_trip_time = roundtrip;
 
 	/* Remove ACKed RADIUS packet from retransmit list */
-	if (prev_req)
-		prev_req->next = req->next;
-	else
-		radius->msgs = req->next;
-	radius->num_msgs--;
+	radius_client_msg_remove(radius, req);
 
 	for (i = 0; i < num_handlers; i++) {
 		RadiusRxResult res;
@@ -934,46 +1148,44 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 }
 
 
+static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct radius_client_data *radius = eloop_ctx;
+	RadiusType msg_type = (RadiusType) sock_ctx;
+	struct radius_rx_pkt pkts[RADIUS_IO_BATCH];
+	int i, num;
+
+	for (i = 0; i < RADIUS_IO_BATCH; i++)
+		pkts[i].buf = radius->rx_buf + i * RADIUS_CLIENT_MAX_MSG_LEN;
+
+	/* Handle all queued responses from a burst with a single wakeup */
+	num = radius_recv_batch(sock, pkts, RADIUS_IO_BATCH,
+				RADIUS_CLIENT_MAX_MSG_LEN);
+	if (num < 0) {
+		wpa_printf(MSG_INFO, "recv[RADIUS]: %s", strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < num; i++)
+		radius_client_receive_msg(radius, sock, msg_type, pkts[i].buf,
+					  pkts[i].len);
+}
+
+
 /**
  * radius_client_get_id - Get an identifier for a new RADIUS message
  * @radius: RADIUS client context from radius_client_init()
  * Returns: Allocated identifier
  *
- * This function is used to fetch a unique (among pending requests) identifier
- * for a new RADIUS message.
+ * This function is used to fetch an identifier for a new RADIUS message. The
+ * identifier is reserved on one of the client source sockets only when the
+ * message is sent with radius_client_send(). A pending request with the same
+ * identifier is removed at that point only if the identifier is in use on all
+ * source sockets.
  */
 u8 radius_client_get_id(struct radius_client_data *radius)
 {
-	struct radius_msg_list *entry, *prev, *_remove;
-	u8 id = radius->next_radius_identifier++;
-
-	/* remove entries with matching id from retransmit list to avoid
-	 * using new reply from the RADIUS server with an old request */
-	entry = radius->msgs;
-	prev = NULL;
-	while (entry) {
-		if (radius_msg_get_hdr(entry->msg)->identifier == id) {
-			hostapd_logger(radius->ctx, entry->addr,
-				       HOSTAPD_MODULE_RADIUS,
-				       HOSTAPD_LEVEL_DEBUG,
-				       "Removing pending RADIUS message, "
-				       "since its id (%d) is reused", id);
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-			_remove = entry;
-		} else {
-			_remove = NULL;
-			prev = entry;
-		}
-		entry = entry->next;
-
-		if (_remove)
-			radius_client_msg_free(_remove);
-	}
-
-	return id;
+	return radius->next_radius_identifier++;
 }
 
 
@@ -984,32 +1196,20 @@ u8 radius_client_get_id(struct radius_client_data *radius)
  */
 void radius_client_flush(struct radius_client_data *radius, int only_auth)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 
 	if (!radius)
 		return;
 
-	prev = NULL;
-	entry = radius->msgs;
-
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
 		if (!only_auth || entry->msg_type == RADIUS_AUTH) {
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-		} else {
-			prev = entry;
-			entry = entry->next;
+			radius_client_msg_remove(radius, entry);
+			radius_client_msg_free(entry);
 		}
 	}
 
-	if (radius->msgs == NULL)
+	if (dl_list_empty(&radius->msgs))
 		eloop_cancel_timeout(radius_client_timer, radius, NULL);
 }
 
@@ -1023,7 +1223,7 @@ static void radius_client_update_acct_msgs(struct radius_client_data *radius,
 	if (!radius)
 		return;
 
-	for (entry = radius->msgs; entry; entry = entry->next) {
+	dl_list_for_each(entry, &radius->msgs, struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_ACCT) {
 			entry->shared_secret = shared_secret;
 			entry->shared_secret_len = shared_secret_len;
@@ -1034,76 +1234,23 @@ static void radius_client_update_acct_msgs(struct radius_client_data *radius,
 }
 
 
-static int
-radius_change_server(struct radius_client_data *radius,
-		     struct hostapd_radius_server *nserv,
-		     struct hostapd_radius_server *oserv,
-		     int sock, int sock6, int auth)
+static int radius_change_server_sock(struct radius_client_data *radius,
+				     struct hostapd_radius_server *nserv,
+				     struct radius_client_sock *cs)
 {
 	struct sockaddr_in serv, claddr;
 #ifdef CONFIG_IPV6
 	struct sockaddr_in6 serv6, claddr6;
+	char abuf[50];
 #endif /* CONFIG_IPV6 */
 	struct sockaddr *addr, *cl_addr;
 	socklen_t addrlen, claddrlen;
-	char abuf[50];
 	int sel_sock;
-	struct radius_msg_list *entry;
 	struct hostapd_radius_servers *conf = radius->conf;
 	struct sockaddr_in disconnect_addr = {
 		.sin_family = AF_UNSPEC,
 	};
 
-	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
-		       HOSTAPD_LEVEL_INFO,
-		       "%s server %s:%d",
-		       auth ? "Authentication" : "Accounting",
-		       hostapd_ip_txt(&nserv->addr, abuf, sizeof(abuf)),
-		       nserv->port);
-
-	if (oserv && oserv == nserv) {
-		/* Reconnect to same server, flush */
-		if (auth)
-			radius_client_flush(radius, 1);
-	}
-
-	if (oserv && oserv != nserv &&
-	    (nserv->shared_secret_len != oserv->shared_secret_len ||
-	     os_memcmp(nserv->shared_secret, oserv->shared_secret,
-		       nserv->shared_secret_len) != 0)) {
-		/* Pending RADIUS packets used different shared secret, so
-		 * they need to be modified. Update accounting message
-		 * authenticators here. Authentication messages are removed
-		 * since they would require more changes and the new RADIUS
-		 * server may not be prepared to receive them anyway due to
-		 * missing state information. Client will likely retry
-		 * authentication, so this should not be an issue. */
-		if (auth)
-			radius_client_flush(radius, 1);
-		else {
-			radius_client_update_acct_msgs(
-				radius, nserv->shared_secret,
-				nserv->shared_secret_len);
-		}
-	}
-
-	/* Reset retry counters for the new server */
-	for (entry = radius->msgs; oserv && oserv != nserv && entry;
-	     entry = entry->next) {
-		if ((auth && entry->msg_type != RADIUS_AUTH) ||
-		    (!auth && entry->msg_type != RADIUS_ACCT))
-			continue;
-		entry->next_try = entry->first_try + RADIUS_CLIENT_FIRST_WAIT;
-		entry->attempts = 0;
-		entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
-	}
-
-	if (radius->msgs) {
-		eloop_cancel_timeout(radius_client_timer, radius, NULL);
-		eloop_register_timeout(RADIUS_CLIENT_FIRST_WAIT, 0,
-				       radius_client_timer, radius, NULL);
-	}
-
 	switch (nserv->addr.af) {
 	case AF_INET:
 		os_memset(&serv, 0, sizeof(serv));
@@ -1112,7 +1259,7 @@ radius_change_server(struct radius_client_data *radius,
 		serv.sin_port = htons(nserv->port);
 		addr = (struct sockaddr *) &serv;
 		addrlen = sizeof(serv);
-		sel_sock = sock;
+		sel_sock = cs->serv_sock;
 		break;
 #ifdef CONFIG_IPV6
 	case AF_INET6:
@@ -1123,7 +1270,7 @@ radius_change_server(struct radius_client_data *radius,
 		serv6.sin6_port = htons(nserv->port);
 		addr = (struct sockaddr *) &serv6;
 		addrlen = sizeof(serv6);
-		sel_sock = sock6;
+		sel_sock = cs->serv_sock6;
 		break;
 #endif /* CONFIG_IPV6 */
 	default:
@@ -1132,8 +1279,8 @@ radius_change_server(struct radius_client_data *radius,
 
 	if (sel_sock < 0) {
 		wpa_printf(MSG_INFO,
-			   "RADIUS: No server socket available (af=%d sock=%d sock6=%d auth=%d",
-			   nserv->addr.af, sock, sock6, auth);
+			   "RADIUS: No server socket available (af=%d sock=%d sock6=%d)",
+			   nserv->addr.af, cs->serv_sock, cs->serv_sock6);
 		return -1;
 	}
 
@@ -1206,10 +1353,88 @@ radius_change_server(struct radius_client_data *radius,
 	}
 #endif /* CONFIG_NATIVE_WINDOWS */
 
-	if (auth)
-		radius->auth_sock = sel_sock;
-	else
-		radius->acct_sock = sel_sock;
+	cs->sock = sel_sock;
+
+	return 0;
+}
+
+
+static int
+radius_change_server(struct radius_client_data *radius,
+		     struct hostapd_radius_server *nserv,
+		     struct hostapd_radius_server *oserv,
+		     int auth)
+{
+	char abuf[50];
+	struct radius_msg_list *entry;
+	struct radius_client_sock *socks;
+	size_t i;
+
+	radius_client_tx_flush(radius);
+
+	hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
+		       HOSTAPD_LEVEL_INFO,
+		       "%s server %s:%d",
+		       auth ? "Authentication" : "Accounting",
+		       hostapd_ip_txt(&nserv->addr, abuf, sizeof(abuf)),
+		       nserv->port);
+
+	if (oserv && oserv == nserv) {
+		/* Reconnect to same server, flush */
+		if (auth)
+			radius_client_flush(radius, 1);
+	}
+
+	if (oserv && oserv != nserv &&
+	    (nserv->shared_secret_len != oserv->shared_secret_len ||
+	     os_memcmp(nserv->shared_secret, oserv->shared_secret,
+		       nserv->shared_secret_len) != 0)) {
+		/* Pending RADIUS packets used different shared secret, so
+		 * they need to be modified. Update accounting message
+		 * authenticators here. Authentication messages are removed
+		 * since they would require more changes and the new RADIUS
+		 * server may not be prepared to receive them anyway due to
+		 * missing state information. Client will likely retry
+		 * authentication, so this should not be an issue. */
+		if (auth)
+			radius_client_flush(radius, 1);
+		else {
+			radius_client_update_acct_msgs(
+				radius, nserv->shared_secret,
+				nserv->shared_secret_len);
+		}
+	}
+
+	/* Reset retry counters for the new server */
+	if (oserv && oserv != nserv) {
+		dl_list_for_each(entry, &radius->msgs, struct radius_msg_list,
+				 list) {
+			if ((auth && entry->msg_type != RADIUS_AUTH) ||
+			    (!auth && entry->msg_type != RADIUS_ACCT))
+				continue;
+			entry->next_try = entry->first_try +
+				RADIUS_CLIENT_FIRST_WAIT;
+			entry->attempts = 0;
+			entry->next_wait = RADIUS_CLIENT_FIRST_WAIT * 2;
+		}
+	}
+
+	if (!dl_list_empty(&radius->msgs)) {
+		eloop_cancel_timeout(radius_client_timer, radius, NULL);
+		eloop_register_timeout(RADIUS_CLIENT_FIRST_WAIT, 0,
+				       radius_client_timer, radius, NULL);
+	}
+
+	socks = auth ? radius->auth_socks : radius->acct_socks;
+	if (radius_change_server_sock(radius, nserv, &socks[0]) < 0)
+		return -1;
+
+	/* Additional source sockets are optional; messages are sent only
+	 * through the ones that could be connected to the new server. */
+	for (i = 1; i < radius->num_socks; i++) {
+		if (radius_change_server_sock(radius, nserv, &socks[i]) < 0)
+			socks[i].sock = -1;
+	}
 
 	return 0;
 }
@@ -1221,31 +1446,27 @@ static void radius_retry_primary_timer(void *eloop_ctx, void *timeout_ctx)
 	struct hostapd_radius_servers *conf = radius->conf;
 	struct hostapd_radius_server *oserv;
 
-	if (radius->auth_sock >= 0 && conf->auth_servers &&
+	if (radius->auth_socks[0].sock >= 0 && conf->auth_servers &&
 	    conf->auth_server != conf->auth_servers) {
 		oserv = conf->auth_server;
 		conf->auth_server = conf->auth_servers;
 		if (radius_change_server(radius, conf->auth_server, oserv,
-					 radius->auth_serv_sock,
-					 radius->auth_serv_sock6, 1) < 0) {
+					 1) < 0) {
 			conf->auth_server = oserv;
 			radius_change_server(radius, oserv, conf->auth_server,
-					     radius->auth_serv_sock,
-					     radius->auth_serv_sock6, 1);
+					     1);
 		}
 	}
 
-	if (radius->acct_sock >= 0 && conf->acct_servers &&
+	if (radius->acct_socks[0].sock >= 0 && conf->acct_servers &&
 	    conf->acct_server != conf->acct_servers) {
 		oserv = conf->acct_server;
 		conf->acct_server = conf->acct_servers;
 		if (radius_change_server(radius, conf->acct_server, oserv,
-					 radius->acct_serv_sock,
-					 radius->acct_serv_sock6, 0) < 0) {
+					 0) < 0) {
 			conf->acct_server = oserv;
 			radius_change_server(radius, oserv, conf->acct_server,
-					     radius->acct_serv_sock,
-					     radius->acct_serv_sock6, 0);
+					     0);
 		}
 	}
 
@@ -1272,153 +1493,134 @@ static int radius_client_disable_pmtu_discovery(int s)
 }
 
 
-static void radius_close_auth_sockets(struct radius_client_data *radius)
+static void radius_close_sockets(struct radius_client_sock *socks,
+				 size_t num_socks)
 {
-	radius->auth_sock = -1;
+	size_t i;
 
-	if (radius->auth_serv_sock >= 0) {
-		eloop_unregister_read_sock(radius->auth_serv_sock);
-		close(radius->auth_serv_sock);
-		radius->auth_serv_sock = -1;
-	}
+	for (i = 0; socks && i < num_socks; i++) {
+		socks[i].sock = -1;
+
+		if (socks[i].serv_sock >= 0) {
+			eloop_unregister_read_sock(socks[i].serv_sock);
+			close(socks[i].serv_sock);
+			socks[i].serv_sock = -1;
+		}
 #ifdef CONFIG_IPV6
-	if (radius->auth_serv_sock6 >= 0) {
-		eloop_unregister_read_sock(radius->auth_serv_sock6);
-		close(radius->auth_serv_sock6);
-		radius->auth_serv_sock6 = -1;
-	}
+		if (socks[i].serv_sock6 >= 0) {
+			eloop_unregister_read_sock(socks[i].serv_sock6);
+			close(socks[i].serv_sock6);
+			socks[i].serv_sock6 = -1;
+		}
 #endif /* CONFIG_IPV6 */
+	}
 }
 
 
-static void radius_close_acct_sockets(struct radius_client_data *radius)
+static void radius_close_auth_sockets(struct radius_client_data *radius)
 {
-	radius->acct_sock = -1;
+	radius_client_tx_flush(radius);
+	radius_close_sockets(radius->auth_socks, radius->num_socks);
+}
 
-	if (radius->acct_serv_sock >= 0) {
-		eloop_unregister_read_sock(radius->acct_serv_sock);
-		close(radius->acct_serv_sock);
-		radius->acct_serv_sock = -1;
-	}
-#ifdef CONFIG_IPV6
-	if (radius->acct_serv_sock6 >= 0) {
-		eloop_unregister_read_sock(radius->acct_serv_sock6);
-		close(radius->acct_serv_sock6);
-		radius->acct_serv_sock6 = -1;
-	}
-#endif /* CONFIG_IPV6 */
+
+static void radius_close_acct_sockets(struct radius_client_data *radius)
+{
+	radius_client_tx_flush(radius);
+	radius_close_sockets(radius->acct_socks, radius->num_socks);
 }
 
 
-static int radius_client_init_auth(struct radius_client_data *radius)
+static int radius_client_open_sock(struct radius_client_sock *cs)
 {
-	struct hostapd_radius_servers *conf = radius->conf;
 	int ok = 0;
 
-	radius_close_auth_sockets(radius);
-
-	radius->auth_serv_sock = socket(PF_INET, SOCK_DGRAM, 0);
-	if (radius->auth_serv_sock < 0)
+	cs->serv_sock = socket(PF_INET, SOCK_DGRAM, 0);
+	if (cs->serv_sock < 0)
 		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET,SOCK_DGRAM]: %s",
 			   strerror(errno));
 	else {
-		radius_client_disable_pmtu_discovery(radius->auth_serv_sock);
+		radius_client_disable_pmtu_discovery(cs->serv_sock);
 		ok++;
 	}
 
 #ifdef CONFIG_IPV6
-	radius->auth_serv_sock6 = socket(PF_INET6, SOCK_DGRAM, 0);
-	if (radius->auth_serv_sock6 < 0)
+	cs->serv_sock6 = socket(PF_INET6, SOCK_DGRAM, 0);
+	if (cs->serv_sock6 < 0)
 		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET6,SOCK_DGRAM]: %s",
 			   strerror(errno));
 	else
 		ok++;
 #endif /* CONFIG_IPV6 */
 
-	if (ok == 0)
-		return -1;
+	return ok ? 0 : -1;
+}
 
-	radius_change_server(radius, conf->auth_server, NULL,
-			     radius->auth_serv_sock, radius->auth_serv_sock6,
-			     1);
 
-	if (radius->auth_serv_sock >= 0 &&
-	    eloop_register_read_sock(radius->auth_serv_sock,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_AUTH)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for authentication server");
-		radius_close_auth_sockets(radius);
+static int radius_client_register_sock(struct radius_client_data *radius,
+				       struct radius_client_sock *cs,
+				       RadiusType msg_type)
+{
+	if (cs->serv_sock >= 0 &&
+	    eloop_register_read_sock(cs->serv_sock, radius_client_receive,
+				     radius, (void *) msg_type))
 		return -1;
-	}
 
 #ifdef CONFIG_IPV6
-	if (radius->auth_serv_sock6 >= 0 &&
-	    eloop_register_read_sock(radius->auth_serv_sock6,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_AUTH)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for authentication server");
-		radius_close_auth_sockets(radius);
+	if (cs->serv_sock6 >= 0 &&
+	    eloop_register_read_sock(cs->serv_sock6, radius_client_receive,
+				     radius, (void *) msg_type))
 		return -1;
-	}
 #endif /* CONFIG_IPV6 */
 
 	return 0;
 }
 
 
-static int radius_client_init_acct(struct radius_client_data *radius)
+static int radius_client_init_socks(struct radius_client_data *radius,
+				    int auth)
 {
 	struct hostapd_radius_servers *conf = radius->conf;
-	int ok = 0;
+	struct radius_client_sock *socks;
+	size_t i;
 
-	radius_close_acct_sockets(radius);
+	socks = auth ? radius->auth_socks : radius->acct_socks;
+	radius_client_tx_flush(radius);
+	radius_close_sockets(socks, radius->num_socks);
 
-	radius->acct_serv_sock = socket(PF_INET, SOCK_DGRAM, 0);
-	if (radius->acct_serv_sock < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else {
-		radius_client_disable_pmtu_discovery(radius->acct_serv_sock);
-		ok++;
+	for (i = 0; i < radius->num_socks; i++) {
+		if (radius_client_open_sock(&socks[i]) < 0 && i == 0)
+			return -1;
 	}
 
-#ifdef CONFIG_IPV6
-	radius->acct_serv_sock6 = socket(PF_INET6, SOCK_DGRAM, 0);
-	if (radius->acct_serv_sock6 < 0)
-		wpa_printf(MSG_INFO, "RADIUS: socket[PF_INET6,SOCK_DGRAM]: %s",
-			   strerror(errno));
-	else
-		ok++;
-#endif /* CONFIG_IPV6 */
+	radius_change_server(radius, auth ? conf->auth_server :
+			     conf->acct_server, NULL, auth);
+
+	for (i = 0; i < radius->num_socks; i++) {
+		if (radius_client_register_sock(radius, &socks[i],
+						auth ? RADIUS_AUTH :
+						RADIUS_ACCT)) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: Could not register read socket for %s server",
+				   auth ? "authentication" : "accounting");
+			radius_close_sockets(socks, radius->num_socks);
+			return -1;
+		}
+	}
 
-	if (ok == 0)
-		return -1;
+	return 0;
+}
 
-	radius_change_server(radius, conf->acct_server, NULL,
-			     radius->acct_serv_sock, radius->acct_serv_sock6,
-			     0);
 
-	if (radius->acct_serv_sock >= 0 &&
-	    eloop_register_read_sock(radius->acct_serv_sock,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_ACCT)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for accounting server");
-		radius_close_acct_sockets(radius);
-		return -1;
-	}
+static int radius_client_init_auth(struct radius_client_data *radius)
+{
+	return radius_client_init_socks(radius, 1);
+}
 
-#ifdef CONFIG_IPV6
-	if (radius->acct_serv_sock6 >= 0 &&
-	    eloop_register_read_sock(radius->acct_serv_sock6,
-				     radius_client_receive, radius,
-				     (void *) RADIUS_ACCT)) {
-		wpa_printf(MSG_INFO, "RADIUS: Could not register read socket for accounting server");
-		radius_close_acct_sockets(radius);
-		return -1;
-	}
-#endif /* CONFIG_IPV6 */
 
-	return 0;
+static int radius_client_init_acct(struct radius_client_data *radius)
+{
+	return radius_client_init_socks(radius, 0);
 }
 
 
@@ -1436,6 +1638,7 @@ struct radius_client_data *
 radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 {
 	struct radius_client_data *radius;
+	size_t i;
 
 	radius = os_zalloc(sizeof(struct radius_client_data));
 	if (radius == NULL)
@@ -1443,9 +1646,28 @@ radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 
 	radius->ctx = ctx;
 	radius->conf = conf;
-	radius->auth_serv_sock = radius->acct_serv_sock =
-		radius->auth_serv_sock6 = radius->acct_serv_sock6 =
-		radius->auth_sock = radius->acct_sock = -1;
+	dl_list_init(&radius->msgs);
+
+	radius->num_socks = conf->client_socks > 0 ? conf->client_socks : 1;
+	if (radius->num_socks > RADIUS_CLIENT_MAX_SOCKS)
+		radius->num_socks = RADIUS_CLIENT_MAX_SOCKS;
+	radius->auth_socks = os_calloc(radius->num_socks,
+				       sizeof(struct radius_client_sock));
+	radius->acct_socks = os_calloc(radius->num_socks,
+				       sizeof(struct radius_client_sock));
+	radius->rx_buf = os_malloc(RADIUS_IO_BATCH * RADIUS_CLIENT_MAX_MSG_LEN);
+	if (!radius->auth_socks || !radius->acct_socks || !radius->rx_buf) {
+		radius_client_deinit(radius);
+		return NULL;
+	}
+	for (i = 0; i < radius->num_socks; i++) {
+		radius->auth_socks[i].serv_sock =
+			radius->auth_socks[i].serv_sock6 =
+			radius->auth_socks[i].sock = -1;
+		radius->acct_socks[i].serv_sock =
+			radius->acct_socks[i].serv_sock6 =
+			radius->acct_socks[i].sock = -1;
+	}
 
 	if (conf->auth_server && radius_client_init_auth(radius)) {
 		radius_client_deinit(radius);
@@ -1481,6 +1703,9 @@ void radius_client_deinit(struct radius_client_data *radius)
 	eloop_cancel_timeout(radius_retry_primary_timer, radius, NULL);
 
 	radius_client_flush(radius, 0);
+	os_free(radius->auth_socks);
+	os_free(radius->acct_socks);
+	os_free(radius->rx_buf);
 	os_free(radius->auth_handlers);
 	os_free(radius->acct_handlers);
 	os_free(radius);
@@ -1500,11 +1725,10 @@ void radius_client_deinit(struct radius_client_data *radius)
 void radius_client_flush_auth(struct radius_client_data *radius,
 			      const u8 *addr)
 {
-	struct radius_msg_list *entry, *prev, *tmp;
+	struct radius_msg_list *entry, *tmp;
 
-	prev = NULL;
-	entry = radius->msgs;
-	while (entry) {
+	dl_list_for_each_safe(entry, tmp, &radius->msgs,
+			      struct radius_msg_list, list) {
 		if (entry->msg_type == RADIUS_AUTH &&
 		    os_memcmp(entry->addr, addr, ETH_ALEN) == 0) {
 			hostapd_logger(radius->ctx, addr,
@@ -1513,20 +1737,9 @@ void radius_client_flush_auth(struct radius_client_data *radius,
 				       "Removing pending RADIUS authentication"
 				       " message for removed client");
 
-			if (prev)
-				prev->next = entry->next;
-			else
-				radius->msgs = entry->next;
-
-			tmp = entry;
-			entry = entry->next;
-			radius_client_msg_free(tmp);
-			radius->num_msgs--;
-			continue;
+			radius_client_msg_remove(radius, entry);
+			radius_client_msg_free(entry);
 		}
-
-		prev = entry;
-		entry = entry->next;
 	}
 }
 
@@ -1540,7 +1753,8 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 	char abuf[50];
 
 	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
+		dl_list_for_each(msg, &cli->msgs, struct radius_msg_list,
+				 list) {
 			if (msg->msg_type == RADIUS_AUTH)
 				pending++;
 		}
@@ -1561,7 +1775,8 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 			   "radiusAuthClientPendingRequests=%u\n"
 			   "radiusAuthClientTimeouts=%u\n"
 			   "radiusAuthClientUnknownTypes=%u\n"
-			   "radiusAuthClientPacketsDropped=%u\n",
+			   "radiusAuthClientPacketsDropped=%u\n"
+			   "radiusAuthClientIdentifierExhaustions=%u\n",
 			   serv->index,
 			   hostapd_ip_txt(&serv->addr, abuf, sizeof(abuf)),
 			   serv->port,
@@ -1576,7 +1791,8 @@ static int radius_client_dump_auth_server(char *buf, size_t buflen,
 			   pending,
 			   serv->timeouts,
 			   serv->unknown_types,
-			   serv->packets_dropped);
+			   serv->packets_dropped,
+			   serv->id_exhaustions);
 }
 
 
@@ -1589,7 +1805,8 @@ static int radius_client_dump_acct_server(char *buf, size_t buflen,
 	char abuf[50];
 
 	if (cli) {
-		for (msg = cli->msgs; msg; msg = msg->next) {
+		dl_list_for_each(msg, &cli->msgs, struct radius_msg_list,
+				 list) {
 			if (msg->msg_type == RADIUS_ACCT ||
 			    msg->msg_type == RADIUS_ACCT_INTERIM)
 				pending++;
@@ -1609,7 +1826,8 @@ static int radius_client_dump_acct_server(char *buf, size_t buflen,
 			   "radiusAccClientPendingRequests=%u\n"
 			   "radiusAccClientTimeouts=%u\n"
 			   "radiusAccClientUnknownTypes=%u\n"
-			   "radiusAccClientPacketsDropped=%u\n",
+			   "radiusAccClientPacketsDropped=%u\n"
+			   "radiusAccClientIdentifierExhaustions=%u\n",
 			   serv->index,
 			   hostapd_ip_txt(&serv->addr, abuf, sizeof(abuf)),
 			   serv->port,
@@ -1622,7 +1840,8 @@ static int radius_client_dump_acct_server(char *buf, size_t buflen,
 			   pending,
 			   serv->timeouts,
 			   serv->unknown_types,
-			   serv->packets_dropped);
+			   serv->packets_dropped,
+			   serv->id_exhaustions);
 }
 
 
@@ -112,6 +112,15 @@ struct hostapd_radius_server {
 	 * packets_dropped - radiusAuthClientPacketsDropped or radiusAccClientPacketsDropped
 	 */
 	u32 packets_dropped;
+
+	/**
+	 * id_exhaustions - radiusAuthClientIdentifierExhaustions or radiusAccClientIdentifierExhaustions
+	 *
+	 * Number of times a pending request had to be dropped because its
+	 * RADIUS identifier was needed for a new request on every source
+	 * socket.
+	 */
+	u32 id_exhaustions;
 };
 
 /**
@@ -174,6 +183,25 @@ struct hostapd_radius_servers {
 	 * force_client_addr - Whether to force client (local) address
 	 */
 	int force_client_addr;
+
+	/**
+	 * client_socks - Number of client source sockets per server type
+	 *
+	 * Each source socket (local UDP port) has its own 8-bit RADIUS
+	 * identifier space, so up to 256 * client_socks requests can be
+	 * pending at the same time. 0 is handled as 1.
+	 */
+	int client_socks;
+
+	/**
+	 * max_pending - Maximum number of pending RADIUS requests
+	 *
+	 * The oldest pending request is removed if this limit is exceeded. 0
+	 * uses the default of RADIUS_CLIENT_MAX_ENTRIES with a single source
+	 * socket or the full identifier space (256 * client_socks) with
+	 * multiple source sockets.
+	 */
+	int max_pending;
 };
 
 
@@ -0,0 +1,146 @@
+/*
+ * RADIUS batched socket I/O
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifdef __linux__
+/* recvmmsg() and sendmmsg() are GNU extensions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif /* _GNU_SOURCE */
+#endif /* __linux__ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "radius_io.h"
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define RADIUS_IO_MMSG
+#endif /* __linux__ && MSG_WAITFORONE */
+
+
+#ifdef RADIUS_IO_MMSG
+/* Cleared if the kernel does not support recvmmsg()/sendmmsg() */
+static int radius_io_mmsg = 1;
+#endif /* RADIUS_IO_MMSG */
+
+
+/**
+ * radius_recv_batch - Receive pending datagrams from a socket
+ * @sock: Socket that has been indicated to be readable
+ * @pkts: Array of num receive buffers; buf must be set by the caller
+ * @num: Maximum number of datagrams to receive
+ * @buflen: Length of each pkts[i].buf in octets
+ * Returns: Number of received datagrams or -1 if nothing could be received
+ *
+ * This receives up to num datagrams without blocking, so that a burst of
+ * RADIUS messages can be handled with a single socket event. A datagram that
+ * did not fit in the buffer is reported with len equal to buflen.
+ */
+int radius_recv_batch(int sock, struct radius_rx_pkt *pkts, size_t num,
+		      size_t buflen)
+{
+	size_t i;
+	ssize_t len;
+
+#ifdef RADIUS_IO_MMSG
+	if (radius_io_mmsg) {
+		struct mmsghdr msgs[RADIUS_IO_BATCH];
+		struct iovec iov[RADIUS_IO_BATCH];
+		int res;
+
+		if (num > RADIUS_IO_BATCH)
+			num = RADIUS_IO_BATCH;
+		os_memset(msgs, 0, num * sizeof(msgs[0]));
+		for (i = 0; i < num; i++) {
+			iov[i].iov_base = pkts[i].buf;
+			iov[i].iov_len = buflen;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &pkts[i].from;
+			msgs[i].msg_hdr.msg_namelen = sizeof(pkts[i].from);
+		}
+
+		res = recvmmsg(sock, msgs, num, MSG_DONTWAIT, NULL);
+		if (res >= 0 || errno != ENOSYS) {
+			for (i = 0; res > 0 && i < (size_t) res; i++) {
+				pkts[i].len = msgs[i].msg_len;
+				pkts[i].fromlen = msgs[i].msg_hdr.msg_namelen;
+			}
+			return res;
+		}
+		radius_io_mmsg = 0;
+	}
+#endif /* RADIUS_IO_MMSG */
+
+	for (i = 0; i < num; i++) {
+		pkts[i].fromlen = sizeof(pkts[i].from);
+		len = recvfrom(sock, pkts[i].buf, buflen, MSG_DONTWAIT,
+			       (struct sockaddr *) &pkts[i].from,
+			       &pkts[i].fromlen);
+		if (len < 0)
+			return i > 0 ? (int) i : -1;
+		pkts[i].len = len;
+	}
+
+	return num;
+}
+
+
+/**
+ * radius_send_batch - Send a number of datagrams
+ * @sock: Socket to use
+ * @pkts: Datagrams to send
+ * @num: Number of entries in pkts
+ * Returns: Number of datagrams sent before the first failure
+ *
+ * If the returned value is less than num, sending pkts[ret] failed and errno
+ * indicates the reason. The caller can continue from pkts[ret + 1].
+ */
+size_t radius_send_batch(int sock, const struct radius_tx_pkt *pkts,
+			 size_t num)
+{
+	size_t i, sent = 0;
+
+#ifdef RADIUS_IO_MMSG
+	while (radius_io_mmsg && sent < num) {
+		struct mmsghdr msgs[RADIUS_IO_BATCH];
+		struct iovec iov[RADIUS_IO_BATCH];
+		size_t n = num - sent;
+		int res;
+
+		if (n > RADIUS_IO_BATCH)
+			n = RADIUS_IO_BATCH;
+		os_memset(msgs, 0, n * sizeof(msgs[0]));
+		for (i = 0; i < n; i++) {
+			iov[i].iov_base = (void *) pkts[sent + i].data;
+			iov[i].iov_len = pkts[sent + i].len;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = (void *) pkts[sent + i].to;
+			msgs[i].msg_hdr.msg_namelen = pkts[sent + i].tolen;
+		}
+
+		res = sendmmsg(sock, msgs, n, 0);
+		if (res < 0) {
+			if (errno != ENOSYS)
+				return sent;
+			radius_io_mmsg = 0;
+			break;
+		}
+		sent += res;
+	}
+#endif /* RADIUS_IO_MMSG */
+
+	for (i = sent; i < num; i++) {
+		if (sendto(sock, pkts[i].data, pkts[i].len, 0, pkts[i].to,
+			   pkts[i].to ? pkts[i].tolen : 0) < 0)
+			return i;
+	}
+
+	return num;
+}
@@ -0,0 +1,67 @@
+/*
+ * RADIUS batched socket I/O
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef RADIUS_IO_H
+#define RADIUS_IO_H
+
+/**
+ * RADIUS_IO_BATCH - Maximum number of datagrams handled per socket event
+ */
+#define RADIUS_IO_BATCH 16
+
+/**
+ * struct radius_rx_pkt - Received RADIUS datagram
+ */
+struct radius_rx_pkt {
+	/**
+	 * buf - Receive buffer (provided by the caller)
+	 */
+	u8 *buf;
+
+	/**
+	 * len - Length of the received datagram in octets
+	 */
+	size_t len;
+
+	/**
+	 * from - Source address of the datagram
+	 */
+	union {
+		struct sockaddr_storage ss;
+		struct sockaddr_in sin;
+#ifdef CONFIG_IPV6
+		struct sockaddr_in6 sin6;
+#endif /* CONFIG_IPV6 */
+	} from;
+
+	/**
+	 * fromlen - Length of from in octets
+	 */
+	socklen_t fromlen;
+};
+
+/**
+ * struct radius_tx_pkt - RADIUS datagram to be sent
+ */
+struct radius_tx_pkt {
+	const u8 *data;
+	size_t len;
+
+	/**
+	 * to - Destination address or %NULL for a connected socket
+	 */
+	const struct sockaddr *to;
+	socklen_t tolen;
+};
+
+int radius_recv_batch(int sock, struct radius_rx_pkt *pkts, size_t num,
+		      size_t buflen);
+size_t radius_send_batch(int sock, const struct radius_tx_pkt *pkts,
+			 size_t num);
+
+#endif /* RADIUS_IO_H */
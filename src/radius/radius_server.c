@@ -11,6 +11,9 @@
 #ifdef CONFIG_SQLITE
 #include <sqlite3.h>
 #endif /* CONFIG_SQLITE */
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+#include <pthread.h>
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
 
 #include "common.h"
 #include "radius.h"
@@ -19,6 +22,7 @@
 #include "ap/ap_config.h"
 #include "crypto/tls.h"
 #include "radius_server.h"
+#include "radius_io.h"
 
 /**
  * RADIUS_SESSION_TIMEOUT - Session timeout in seconds
@@ -26,15 +30,26 @@
 #define RADIUS_SESSION_TIMEOUT 60
 
 /**
- * RADIUS_MAX_SESSION - Maximum number of active sessions
+ * RADIUS_MAX_SESSION - Default maximum number of active sessions
  */
-#define RADIUS_MAX_SESSION 100
+#define RADIUS_MAX_SESSION 1000
+
+/**
+ * RADIUS_SESSION_HASH_SIZE - Number of buckets in the session hash table
+ */
+#define RADIUS_SESSION_HASH_SIZE 256
+#define RADIUS_SESSION_HASH(id) ((id) & (RADIUS_SESSION_HASH_SIZE - 1))
 
 /**
  * RADIUS_MAX_MSG_LEN - Maximum message length for incoming RADIUS messages
  */
 #define RADIUS_MAX_MSG_LEN 3000
 
+/**
+ * RADIUS_MAX_WORKERS - Maximum number of EAP worker threads
+ */
+#define RADIUS_MAX_WORKERS 64
+
 static const struct eapol_callbacks radius_server_eapol_cb;
 
 struct radius_client;
@@ -68,6 +83,7 @@ struct radius_server_counters {
  */
 struct radius_session {
 	struct radius_session *next;
+	struct radius_session *hnext; /* next entry in hash table list */
 	struct radius_client *client;
 	struct radius_server_data *server;
 	unsigned int sess_id;
@@ -89,6 +105,10 @@ struct radius_session {
 	unsigned int macacl:1;
 
 	struct hostapd_radius_attr *accept_attr;
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	int busy; /* EAP processing queued to a worker thread */
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
 };
 
 /**
@@ -102,12 +122,57 @@ struct radius_client {
 	struct in6_addr addr6;
 	struct in6_addr mask6;
 #endif /* CONFIG_IPV6 */
+	int prefix_len;
 	char *shared_secret;
 	int shared_secret_len;
 	struct radius_session *sessions;
 	struct radius_server_counters counters;
 };
 
+/**
+ * struct radius_client_node - Binary trie node for client address lookup
+ *
+ * The node at depth n covers the clients whose address prefix is the path of
+ * n bits from the root to the node.
+ */
+struct radius_client_node {
+	struct radius_client_node *child[2];
+	struct radius_client *client;
+};
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+
+/**
+ * struct radius_server_job - EAP-Message to be processed in a worker thread
+ */
+struct radius_server_job {
+	struct dl_list list;
+	struct radius_session *sess;
+	struct radius_msg *msg;
+	struct wpabuf *eap;
+	struct sockaddr_storage from;
+	socklen_t fromlen;
+	char from_addr[50];
+	int from_port;
+
+	/* Result from radius_server_eap_step() */
+	int res;
+	struct radius_msg *reply;
+	int is_complete;
+};
+
+/**
+ * struct radius_server_worker - EAP worker thread
+ */
+struct radius_server_worker {
+	struct radius_server_data *server;
+	pthread_t thread;
+	pthread_cond_t cond;
+	struct dl_list jobs; /* struct radius_server_job */
+};
+
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
 /**
  * struct radius_server_data - Internal RADIUS server data
  */
@@ -127,6 +192,18 @@ struct radius_server_data {
 	 */
 	struct radius_client *clients;
 
+	/**
+	 * client_trie - Longest prefix match index of clients by address
+	 */
+	struct radius_client_node *client_trie;
+
+	/**
+	 * sess_hash - Hash table of active sessions by session identifier
+	 *
+	 * The session identifier is also the value of the State attribute.
+	 */
+	struct radius_session *sess_hash[RADIUS_SESSION_HASH_SIZE];
+
 	/**
 	 * next_sess_id - Next session identifier
 	 */
@@ -144,6 +221,11 @@ struct radius_server_data {
 	 */
 	int num_sess;
 
+	/**
+	 * max_sessions - Maximum number of active sessions
+	 */
+	int max_sessions;
+
 	/**
 	 * eap_sim_db_priv - EAP-SIM/AKA database context
 	 *
@@ -342,6 +424,48 @@ struct radius_server_data {
 #ifdef CONFIG_SQLITE
 	sqlite3 *db;
 #endif /* CONFIG_SQLITE */
+
+	/**
+	 * rx_buf - Receive buffers for RADIUS_IO_BATCH messages
+	 */
+	u8 *rx_buf;
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	/**
+	 * workers - EAP worker threads or %NULL if EAP is processed inline
+	 */
+	struct radius_server_worker *workers;
+
+	/**
+	 * num_workers - Number of running worker threads
+	 */
+	int num_workers;
+
+	/**
+	 * job_lock - Lock for the job queues, done and workers_stop
+	 */
+	pthread_mutex_t job_lock;
+
+	/**
+	 * cb_lock - Lock for state shared with EAP callbacks
+	 *
+	 * This serializes the user database, the SQLite log, and the ERP key
+	 * list between the eloop thread and the worker threads.
+	 */
+	pthread_mutex_t cb_lock;
+
+	/**
+	 * done - Processed jobs waiting for transmission of the reply
+	 */
+	struct dl_list done; /* struct radius_server_job */
+
+	int workers_stop;
+
+	/**
+	 * done_pipe - Pipe for waking up the eloop thread for done jobs
+	 */
+	int done_pipe[2];
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
 };
 
 
@@ -362,6 +486,24 @@ static void radius_server_session_remove_timeout(void *eloop_ctx,
 void srv_log(struct radius_session *sess, const char *fmt, ...)
 PRINTF_FORMAT(2, 3);
 
+
+static void radius_server_cb_lock(struct radius_server_data *data)
+{
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (data->workers)
+		pthread_mutex_lock(&data->cb_lock);
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+}
+
+
+static void radius_server_cb_unlock(struct radius_server_data *data)
+{
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (data->workers)
+		pthread_mutex_unlock(&data->cb_lock);
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+}
+
 void srv_log(struct radius_session *sess, const char *fmt, ...)
 {
 	va_list ap;
@@ -382,6 +524,7 @@ void srv_log(struct radius_session *sess, const char *fmt, ...)
 	RADIUS_DEBUG("[0x%x %s] %s", sess->sess_id, sess->nas_ip, buf);
 
 #ifdef CONFIG_SQLITE
+	radius_server_cb_lock(sess->server);
 	if (sess->server->db) {
 		char *sql;
 		sql = sqlite3_mprintf("INSERT INTO authlog"
@@ -400,45 +543,89 @@ void srv_log(struct radius_session *sess, const char *fmt, ...)
 			sqlite3_free(sql);
 		}
 	}
+	radius_server_cb_unlock(sess->server);
 #endif /* CONFIG_SQLITE */
 
 	os_free(buf);
 }
 
 
+static int radius_server_addr_bit(const u8 *addr, int bit)
+{
+	return (addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+
+static const u8 * radius_client_addr(struct radius_client *client, int ipv6)
+{
+#ifdef CONFIG_IPV6
+	if (ipv6)
+		return client->addr6.s6_addr;
+#endif /* CONFIG_IPV6 */
+	return (const u8 *) &client->addr.s_addr;
+}
+
+
+static int radius_server_index_client(struct radius_server_data *data,
+				      struct radius_client *client)
+{
+	struct radius_client_node **node = &data->client_trie;
+	const u8 *addr = radius_client_addr(client, data->ipv6);
+	int i;
+
+	for (i = 0; ; i++) {
+		if (*node == NULL) {
+			*node = os_zalloc(sizeof(**node));
+			if (*node == NULL)
+				return -1;
+		}
+		if (i == client->prefix_len)
+			break;
+		node = &(*node)->child[radius_server_addr_bit(addr, i)];
+	}
+
+	/* The first entry in the client file is used for duplicate
+	 * prefixes */
+	if ((*node)->client == NULL)
+		(*node)->client = client;
+
+	return 0;
+}
+
+
+static void radius_server_free_client_trie(struct radius_client_node *node)
+{
+	if (node == NULL)
+		return;
+	radius_server_free_client_trie(node->child[0]);
+	radius_server_free_client_trie(node->child[1]);
+	os_free(node);
+}
+
+
+/* Find the client entry with the longest prefix matching the address */
 static struct radius_client *
 radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
 			 int ipv6)
 {
-	struct radius_client *client = data->clients;
+	struct radius_client_node *node = data->client_trie;
+	struct radius_client *client = NULL;
+	const u8 *a = (const u8 *) &addr->s_addr;
+	int i, bits = 32;
 
-	while (client) {
 #ifdef CONFIG_IPV6
-		if (ipv6) {
-			struct in6_addr *addr6;
-			int i;
-
-			addr6 = (struct in6_addr *) addr;
-			for (i = 0; i < 16; i++) {
-				if ((addr6->s6_addr[i] &
-				     client->mask6.s6_addr[i]) !=
-				    (client->addr6.s6_addr[i] &
-				     client->mask6.s6_addr[i])) {
-					i = 17;
-					break;
-				}
-			}
-			if (i == 16) {
-				break;
-			}
-		}
+	if (ipv6) {
+		a = ((struct in6_addr *) addr)->s6_addr;
+		bits = 128;
+	}
 #endif /* CONFIG_IPV6 */
-		if (!ipv6 && (client->addr.s_addr & client->mask.s_addr) ==
-		    (addr->s_addr & client->mask.s_addr)) {
-			break;
-		}
 
-		client = client->next;
+	for (i = 0; node; i++) {
+		if (node->client)
+			client = node->client;
+		if (i == bits)
+			break;
+		node = node->child[radius_server_addr_bit(a, i)];
 	}
 
 	return client;
@@ -446,26 +633,44 @@ radius_server_get_client(struct radius_server_data *data, struct in_addr *addr,
 
 
 static struct radius_session *
-radius_server_get_session(struct radius_client *client, unsigned int sess_id)
+radius_server_get_session(struct radius_server_data *data,
+			  struct radius_client *client, unsigned int sess_id)
 {
-	struct radius_session *sess = client->sessions;
+	struct radius_session *sess;
 
+	sess = data->sess_hash[RADIUS_SESSION_HASH(sess_id)];
 	while (sess) {
-		if (sess->sess_id == sess_id) {
+		if (sess->sess_id == sess_id && sess->client == client)
 			break;
-		}
-		sess = sess->next;
+		sess = sess->hnext;
 	}
 
 	return sess;
 }
 
 
+static void radius_server_sess_hash_del(struct radius_server_data *data,
+					struct radius_session *sess)
+{
+	struct radius_session **pos;
+
+	pos = &data->sess_hash[RADIUS_SESSION_HASH(sess->sess_id)];
+	while (*pos) {
+		if (*pos == sess) {
+			*pos = sess->hnext;
+			return;
+		}
+		pos = &(*pos)->hnext;
+	}
+}
+
+
 static void radius_server_session_free(struct radius_server_data *data,
 				       struct radius_session *sess)
 {
 	eloop_cancel_timeout(radius_server_session_timeout, data, sess);
 	eloop_cancel_timeout(radius_server_session_remove_timeout, data, sess);
+	radius_server_sess_hash_del(data, sess);
 	eap_server_sm_deinit(sess->eap);
 	radius_msg_free(sess->last_msg);
 	os_free(sess->last_from_addr);
@@ -508,6 +713,17 @@ static void radius_server_session_remove_timeout(void *eloop_ctx,
 {
 	struct radius_server_data *data = eloop_ctx;
 	struct radius_session *sess = timeout_ctx;
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (sess->busy) {
+		/* Let the worker thread finish with the session first */
+		eloop_register_timeout(1, 0,
+				       radius_server_session_remove_timeout,
+				       data, sess);
+		return;
+	}
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
 	RADIUS_DEBUG("Removing completed session 0x%x", sess->sess_id);
 	radius_server_session_remove(data, sess);
 }
@@ -518,6 +734,14 @@ static void radius_server_session_timeout(void *eloop_ctx, void *timeout_ctx)
 	struct radius_server_data *data = eloop_ctx;
 	struct radius_session *sess = timeout_ctx;
 
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (sess->busy) {
+		eloop_register_timeout(1, 0, radius_server_session_timeout,
+				       data, sess);
+		return;
+	}
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
 	RADIUS_DEBUG("Timing out authentication session 0x%x", sess->sess_id);
 	radius_server_session_remove(data, sess);
 }
@@ -529,7 +753,7 @@ radius_server_new_session(struct radius_server_data *data,
 {
 	struct radius_session *sess;
 
-	if (data->num_sess >= RADIUS_MAX_SESSION) {
+	if (data->num_sess >= data->max_sessions) {
 		RADIUS_DEBUG("Maximum number of existing session - no room "
 			     "for a new session");
 		return NULL;
@@ -544,6 +768,8 @@ radius_server_new_session(struct radius_server_data *data,
 	sess->sess_id = data->next_sess_id++;
 	sess->next = client->sessions;
 	client->sessions = sess;
+	sess->hnext = data->sess_hash[RADIUS_SESSION_HASH(sess->sess_id)];
+	data->sess_hash[RADIUS_SESSION_HASH(sess->sess_id)] = sess;
 	eloop_register_timeout(RADIUS_SESSION_TIMEOUT, 0,
 			       radius_server_session_timeout, data, sess);
 	data->num_sess++;
@@ -638,7 +864,9 @@ radius_server_get_new_session(struct radius_server_data *data,
 	RADIUS_DUMP_ASCII("User-Name", user, user_len);
 
 	os_memset(&tmp, 0, sizeof(tmp));
+	radius_server_cb_lock(data);
 	res = data->get_eap_user(data->conf_ctx, user, user_len, 0, &tmp);
+	radius_server_cb_unlock(data);
 	bin_clear_free(tmp.password, tmp.password_len);
 
 	if (res != 0) {
@@ -657,14 +885,14 @@ radius_server_get_new_session(struct radius_server_data *data,
 
 	sess->username = os_malloc(user_len * 4 + 1);
 	if (sess->username == NULL) {
-		radius_server_session_free(data, sess);
+		radius_server_session_remove(data, sess);
 		return NULL;
 	}
 	printf_encode(sess->username, user_len * 4 + 1, user, user_len);
 
 	sess->nas_ip = os_strdup(from_addr);
 	if (sess->nas_ip == NULL) {
-		radius_server_session_free(data, sess);
+		radius_server_session_remove(data, sess);
 		return NULL;
 	}
 
@@ -673,6 +901,12 @@ radius_server_get_new_session(struct radius_server_data *data,
 	os_memset(&eap_conf, 0, sizeof(eap_conf));
 	eap_conf.ssl_ctx = data->ssl_ctx;
 	eap_conf.msg_ctx = data->msg_ctx;
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	/* wpa_msg() callbacks are not thread safe, so EAP events from worker
+	 * threads go only to the debug log */
+	if (data->workers)
+		eap_conf.msg_ctx = NULL;
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
 	eap_conf.eap_sim_db_priv = data->eap_sim_db_priv;
 	eap_conf.backend_auth = TRUE;
 	eap_conf.eap_server = 1;
@@ -697,7 +931,7 @@ radius_server_get_new_session(struct radius_server_data *data,
 	if (sess->eap == NULL) {
 		RADIUS_DEBUG("Failed to initialize EAP state machine for the "
 			     "new session");
-		radius_server_session_free(data, sess);
+		radius_server_session_remove(data, sess);
 		return NULL;
 	}
 	sess->eap_if = eap_get_interface(sess->eap);
@@ -985,94 +1219,18 @@ static int radius_server_reject(struct radius_server_data *data,
 }
 
 
-static int radius_server_request(struct radius_server_data *data,
-				 struct radius_msg *msg,
-				 struct sockaddr *from, socklen_t fromlen,
-				 struct radius_client *client,
-				 const char *from_addr, int from_port,
-				 struct radius_session *force_sess)
+/*
+ * Process an EAP-Message with the session's EAP state machine and build the
+ * reply. Returns 0 if a reply was built (*reply may still be %NULL if that
+ * failed), -1 if there is nothing to send, or -2 if the EAP method is waiting
+ * for external data. This does not touch the counters or the sockets, so it
+ * can be run in a worker thread.
+ */
+static int radius_server_eap_step(struct radius_server_data *data,
+				  struct radius_session *sess,
+				  struct radius_msg *msg, struct wpabuf *eap,
+				  struct radius_msg **reply, int *is_complete)
 {
-	struct wpabuf *eap = NULL;
-	int res, state_included = 0;
-	u8 statebuf[4];
-	unsigned int state;
-	struct radius_session *sess;
-	struct radius_msg *reply;
-	int is_complete = 0;
-
-	if (force_sess)
-		sess = force_sess;
-	else {
-		res = radius_msg_get_attr(msg, RADIUS_ATTR_STATE, statebuf,
-					  sizeof(statebuf));
-		state_included = res >= 0;
-		if (res == sizeof(statebuf)) {
-			state = WPA_GET_BE32(statebuf);
-			sess = radius_server_get_session(client, state);
-		} else {
-			sess = NULL;
-		}
-	}
-
-	if (sess) {
-		RADIUS_DEBUG("Request for session 0x%x", sess->sess_id);
-	} else if (state_included) {
-		RADIUS_DEBUG("State attribute included but no session found");
-		radius_server_reject(data, client, msg, from, fromlen,
-				     from_addr, from_port);
-		return -1;
-	} else {
-		sess = radius_server_get_new_session(data, client, msg,
-						     from_addr);
-		if (sess == NULL) {
-			RADIUS_DEBUG("Could not create a new session");
-			radius_server_reject(data, client, msg, from, fromlen,
-					     from_addr, from_port);
-			return -1;
-		}
-	}
-
-	if (sess->last_from_port == from_port &&
-	    sess->last_identifier == radius_msg_get_hdr(msg)->identifier &&
-	    os_memcmp(sess->last_authenticator,
-		      radius_msg_get_hdr(msg)->authenticator, 16) == 0) {
-		RADIUS_DEBUG("Duplicate message from %s", from_addr);
-		data->counters.dup_access_requests++;
-		client->counters.dup_access_requests++;
-
-		if (sess->last_reply) {
-			struct wpabuf *buf;
-			buf = radius_msg_get_buf(sess->last_reply);
-			res = sendto(data->auth_sock, wpabuf_head(buf),
-				     wpabuf_len(buf), 0,
-				     (struct sockaddr *) from, fromlen);
-			if (res < 0) {
-				wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
-					   strerror(errno));
-			}
-			return 0;
-		}
-
-		RADIUS_DEBUG("No previous reply available for duplicate "
-			     "message");
-		return -1;
-	}
-		      
-	eap = radius_msg_get_eap(msg);
-	if (eap == NULL && sess->macacl) {
-		reply = radius_server_macacl(data, client, sess, msg);
-		if (reply == NULL)
-			return -1;
-		goto send_reply;
-	}
-	if (eap == NULL) {
-		RADIUS_DEBUG("No EAP-Message in RADIUS packet from %s",
-			     from_addr);
-		data->counters.packets_dropped++;
-		client->counters.packets_dropped++;
-		return -1;
-	}
-
 	RADIUS_DUMP("Received EAP data", wpabuf_head(eap), wpabuf_len(eap));
 
 	/* FIX: if Code is Request, Success, or Failure, send Access-Reject;
@@ -1087,6 +1245,9 @@ static int radius_server_request(struct radius_server_data *data,
 	sess->eap_if->eapResp = TRUE;
 	eap_server_sm_step(sess->eap);
 
+	*reply = NULL;
+	*is_complete = 0;
+
 	if ((sess->eap_if->eapReq || sess->eap_if->eapSuccess ||
 	     sess->eap_if->eapFail) && sess->eap_if->eapReqData) {
 		RADIUS_DUMP("EAP data from the state machine",
@@ -1096,33 +1257,34 @@ static int radius_server_request(struct radius_server_data *data,
 		RADIUS_DEBUG("No EAP data from the state machine, but eapFail "
 			     "set");
 	} else if (eap_sm_method_pending(sess->eap)) {
-		radius_msg_free(sess->last_msg);
-		sess->last_msg = msg;
-		sess->last_from_port = from_port;
-		os_free(sess->last_from_addr);
-		sess->last_from_addr = os_strdup(from_addr);
-		sess->last_fromlen = fromlen;
-		os_memcpy(&sess->last_from, from, fromlen);
 		return -2;
 	} else {
 		RADIUS_DEBUG("No EAP data from the state machine - ignore this"
 			     " Access-Request silently (assuming it was a "
 			     "duplicate)");
-		data->counters.packets_dropped++;
-		client->counters.packets_dropped++;
 		return -1;
 	}
 
 	if (sess->eap_if->eapSuccess || sess->eap_if->eapFail)
-		is_complete = 1;
+		*is_complete = 1;
 	if (sess->eap_if->eapFail)
 		srv_log(sess, "EAP authentication failed");
 	else if (sess->eap_if->eapSuccess)
 		srv_log(sess, "EAP authentication succeeded");
 
-	reply = radius_server_encapsulate_eap(data, client, sess, msg);
+	*reply = radius_server_encapsulate_eap(data, sess->client, sess, msg);
+	return 0;
+}
+
 
-send_reply:
+static void radius_server_send_reply(struct radius_server_data *data,
+				     struct radius_client *client,
+				     struct radius_session *sess,
+				     struct radius_msg *msg,
+				     struct radius_msg *reply, int is_complete,
+				     struct sockaddr *from, socklen_t fromlen,
+				     const char *from_addr, int from_port)
+{
 	if (reply) {
 		struct wpabuf *buf;
 		struct radius_hdr *hdr;
@@ -1149,10 +1311,8 @@ send_reply:
 			break;
 		}
 		buf = radius_msg_get_buf(reply);
-		res = sendto(data->auth_sock, wpabuf_head(buf),
-			     wpabuf_len(buf), 0,
-			     (struct sockaddr *) from, fromlen);
-		if (res < 0) {
+		if (sendto(data->auth_sock, wpabuf_head(buf), wpabuf_len(buf),
+			   0, from, fromlen) < 0) {
 			wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
 				   strerror(errno));
 		}
@@ -1176,66 +1336,414 @@ send_reply:
 				       radius_server_session_remove_timeout,
 				       data, sess);
 	}
+}
+
 
+/*
+ * Complete a request based on the radius_server_eap_step() result. Returns -2
+ * if msg was stored with the session for a pending EAP method.
+ */
+static int radius_server_eap_result(struct radius_server_data *data,
+				    struct radius_session *sess,
+				    struct radius_msg *msg, int res,
+				    struct radius_msg *reply, int is_complete,
+				    struct sockaddr *from, socklen_t fromlen,
+				    const char *from_addr, int from_port)
+{
+	struct radius_client *client = sess->client;
+
+	if (res == -2) {
+		radius_msg_free(sess->last_msg);
+		sess->last_msg = msg;
+		sess->last_from_port = from_port;
+		os_free(sess->last_from_addr);
+		sess->last_from_addr = os_strdup(from_addr);
+		sess->last_fromlen = fromlen;
+		os_memcpy(&sess->last_from, from, fromlen);
+		return -2;
+	}
+
+	if (res < 0) {
+		data->counters.packets_dropped++;
+		client->counters.packets_dropped++;
+		return -1;
+	}
+
+	radius_server_send_reply(data, client, sess, msg, reply, is_complete,
+				 from, fromlen, from_addr, from_port);
 	return 0;
 }
 
 
-static void radius_server_receive_auth(int sock, void *eloop_ctx,
-				       void *sock_ctx)
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+
+static void radius_server_job_free(struct radius_server_job *job)
+{
+	radius_msg_free(job->msg);
+	wpabuf_free(job->eap);
+	radius_msg_free(job->reply);
+	os_free(job);
+}
+
+
+static void * radius_server_worker_thread(void *arg)
+{
+	struct radius_server_worker *worker = arg;
+	struct radius_server_data *data = worker->server;
+	struct radius_server_job *job;
+	int notify;
+
+	pthread_mutex_lock(&data->job_lock);
+	while (!data->workers_stop) {
+		job = dl_list_first(&worker->jobs, struct radius_server_job,
+				    list);
+		if (job == NULL) {
+			pthread_cond_wait(&worker->cond, &data->job_lock);
+			continue;
+		}
+		dl_list_del(&job->list);
+		pthread_mutex_unlock(&data->job_lock);
+
+		job->res = radius_server_eap_step(data, job->sess, job->msg,
+						  job->eap, &job->reply,
+						  &job->is_complete);
+		job->eap = NULL; /* owned by the EAP state machine now */
+
+		pthread_mutex_lock(&data->job_lock);
+		/* Wake up the eloop thread only if it may be waiting */
+		notify = dl_list_empty(&data->done);
+		dl_list_add_tail(&data->done, &job->list);
+		if (notify && write(data->done_pipe[1], "", 1) < 0) {
+			wpa_printf(MSG_INFO, "write[RADIUS SRV]: %s",
+				   strerror(errno));
+		}
+	}
+	pthread_mutex_unlock(&data->job_lock);
+
+	return NULL;
+}
+
+
+static int radius_server_queue_job(struct radius_server_data *data,
+				   struct radius_session *sess,
+				   struct radius_msg *msg, struct wpabuf *eap,
+				   struct sockaddr *from, socklen_t fromlen,
+				   const char *from_addr, int from_port)
+{
+	struct radius_server_worker *worker;
+	struct radius_server_job *job;
+
+	job = os_zalloc(sizeof(*job));
+	if (job == NULL) {
+		wpabuf_free(eap);
+		return -1;
+	}
+	job->sess = sess;
+	job->msg = msg;
+	job->eap = eap;
+	os_memcpy(&job->from, from, fromlen);
+	job->fromlen = fromlen;
+	os_strlcpy(job->from_addr, from_addr, sizeof(job->from_addr));
+	job->from_port = from_port;
+
+	/* Keep each session on one thread to reuse its cache warm state */
+	worker = &data->workers[sess->sess_id % data->num_workers];
+	sess->busy = 1;
+
+	pthread_mutex_lock(&data->job_lock);
+	dl_list_add_tail(&worker->jobs, &job->list);
+	pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&data->job_lock);
+
+	return -2;
+}
+
+
+static void radius_server_jobs_done(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct radius_server_data *data = eloop_ctx;
-	u8 *buf = NULL;
-	union {
-		struct sockaddr_storage ss;
-		struct sockaddr_in sin;
-#ifdef CONFIG_IPV6
-		struct sockaddr_in6 sin6;
-#endif /* CONFIG_IPV6 */
-	} from;
-	socklen_t fromlen;
-	int len;
-	struct radius_client *client = NULL;
-	struct radius_msg *msg = NULL;
-	char abuf[50];
-	int from_port = 0;
+	struct radius_server_job *job;
+	struct radius_session *sess;
+	char buf[16];
 
-	buf = os_malloc(RADIUS_MAX_MSG_LEN);
-	if (buf == NULL) {
-		goto fail;
+	if (read(sock, buf, sizeof(buf)) < 0) {
+		wpa_printf(MSG_INFO, "read[RADIUS SRV]: %s", strerror(errno));
+		return;
 	}
 
-	fromlen = sizeof(from);
-	len = recvfrom(sock, buf, RADIUS_MAX_MSG_LEN, 0,
-		       (struct sockaddr *) &from.ss, &fromlen);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recvfrom[radius_server]: %s",
-			   strerror(errno));
-		goto fail;
+	for (;;) {
+		pthread_mutex_lock(&data->job_lock);
+		job = dl_list_first(&data->done, struct radius_server_job,
+				    list);
+		if (job)
+			dl_list_del(&job->list);
+		pthread_mutex_unlock(&data->job_lock);
+		if (job == NULL)
+			break;
+
+		sess = job->sess;
+		sess->busy = 0;
+		if (radius_server_eap_result(data, sess, job->msg, job->res,
+					     job->reply, job->is_complete,
+					     (struct sockaddr *) &job->from,
+					     job->fromlen, job->from_addr,
+					     job->from_port) == -2)
+			job->msg = NULL; /* stored with the session */
+		if (job->res == 0)
+			job->reply = NULL; /* stored with the session */
+		radius_server_job_free(job);
+	}
+}
+
+static void radius_server_stop_workers(struct radius_server_data *data)
+{
+	struct radius_server_job *job, *tmp;
+	int i;
+
+	if (data->workers == NULL)
+		return;
+
+	pthread_mutex_lock(&data->job_lock);
+	data->workers_stop = 1;
+	for (i = 0; i < data->num_workers; i++)
+		pthread_cond_signal(&data->workers[i].cond);
+	pthread_mutex_unlock(&data->job_lock);
+
+	for (i = 0; i < data->num_workers; i++) {
+		pthread_join(data->workers[i].thread, NULL);
+		dl_list_for_each_safe(job, tmp, &data->workers[i].jobs,
+				      struct radius_server_job, list) {
+			dl_list_del(&job->list);
+			radius_server_job_free(job);
+		}
+		pthread_cond_destroy(&data->workers[i].cond);
+	}
+	dl_list_for_each_safe(job, tmp, &data->done, struct radius_server_job,
+			      list) {
+		dl_list_del(&job->list);
+		radius_server_job_free(job);
+	}
+
+	eloop_unregister_read_sock(data->done_pipe[0]);
+	close(data->done_pipe[0]);
+	close(data->done_pipe[1]);
+	pthread_mutex_destroy(&data->job_lock);
+	pthread_mutex_destroy(&data->cb_lock);
+	os_free(data->workers);
+	data->workers = NULL;
+	data->num_workers = 0;
+}
+
+
+static int radius_server_start_workers(struct radius_server_data *data,
+				       int num)
+{
+	struct radius_server_worker *worker;
+
+	if (data->wps || data->eap_sim_db_priv || data->tnc) {
+		/* WPS and EAP-SIM/AKA database use eloop from within the EAP
+		 * methods and TNC keeps an unlocked global connection list */
+		wpa_printf(MSG_INFO,
+			   "RADIUS SRV: EAP worker threads not supported with WPS, EAP-SIM/AKA database, or TNC - process EAP inline");
+		return 0;
+	}
+
+	if (num > RADIUS_MAX_WORKERS)
+		num = RADIUS_MAX_WORKERS;
+	data->workers = os_calloc(num, sizeof(*data->workers));
+	if (data->workers == NULL)
+		return -1;
+	if (pipe(data->done_pipe) < 0) {
+		wpa_printf(MSG_ERROR, "RADIUS SRV: pipe: %s", strerror(errno));
+		os_free(data->workers);
+		data->workers = NULL;
+		return -1;
+	}
+	pthread_mutex_init(&data->job_lock, NULL);
+	pthread_mutex_init(&data->cb_lock, NULL);
+	dl_list_init(&data->done);
+
+	if (eloop_register_read_sock(data->done_pipe[0],
+				     radius_server_jobs_done, data, NULL)) {
+		radius_server_stop_workers(data);
+		return -1;
+	}
+
+	while (data->num_workers < num) {
+		worker = &data->workers[data->num_workers];
+		worker->server = data;
+		dl_list_init(&worker->jobs);
+		pthread_cond_init(&worker->cond, NULL);
+		if (pthread_create(&worker->thread, NULL,
+				   radius_server_worker_thread, worker) != 0) {
+			pthread_cond_destroy(&worker->cond);
+			break;
+		}
+		data->num_workers++;
+	}
+
+	if (data->num_workers == 0) {
+		radius_server_stop_workers(data);
+		return -1;
+	}
+
+	RADIUS_DEBUG("Started %d EAP worker threads", data->num_workers);
+	return 0;
+}
+
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
+
+static int radius_server_request(struct radius_server_data *data,
+				 struct radius_msg *msg,
+				 struct sockaddr *from, socklen_t fromlen,
+				 struct radius_client *client,
+				 const char *from_addr, int from_port,
+				 struct radius_session *force_sess)
+{
+	struct wpabuf *eap = NULL;
+	int res, state_included = 0;
+	u8 statebuf[4];
+	unsigned int state;
+	struct radius_session *sess;
+	struct radius_msg *reply;
+	int is_complete = 0;
+
+	if (force_sess)
+		sess = force_sess;
+	else {
+		res = radius_msg_get_attr(msg, RADIUS_ATTR_STATE, statebuf,
+					  sizeof(statebuf));
+		state_included = res >= 0;
+		if (res == sizeof(statebuf)) {
+			state = WPA_GET_BE32(statebuf);
+			sess = radius_server_get_session(data, client, state);
+		} else {
+			sess = NULL;
+		}
+	}
+
+	if (sess) {
+		RADIUS_DEBUG("Request for session 0x%x", sess->sess_id);
+	} else if (state_included) {
+		RADIUS_DEBUG("State attribute included but no session found");
+		radius_server_reject(data, client, msg, from, fromlen,
+				     from_addr, from_port);
+		return -1;
+	} else {
+		sess = radius_server_get_new_session(data, client, msg,
+						     from_addr);
+		if (sess == NULL) {
+			RADIUS_DEBUG("Could not create a new session");
+			radius_server_reject(data, client, msg, from, fromlen,
+					     from_addr, from_port);
+			return -1;
+		}
+	}
+
+	if (sess->last_from_port == from_port &&
+	    sess->last_identifier == radius_msg_get_hdr(msg)->identifier &&
+	    os_memcmp(sess->last_authenticator,
+		      radius_msg_get_hdr(msg)->authenticator, 16) == 0) {
+		RADIUS_DEBUG("Duplicate message from %s", from_addr);
+		data->counters.dup_access_requests++;
+		client->counters.dup_access_requests++;
+
+		if (sess->last_reply) {
+			struct wpabuf *buf;
+			buf = radius_msg_get_buf(sess->last_reply);
+			res = sendto(data->auth_sock, wpabuf_head(buf),
+				     wpabuf_len(buf), 0,
+				     (struct sockaddr *) from, fromlen);
+			if (res < 0) {
+				wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
+					   strerror(errno));
+			}
+			return 0;
+		}
+
+		RADIUS_DEBUG("No previous reply available for duplicate "
+			     "message");
+		return -1;
+	}
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (sess->busy) {
+		/* Most likely a retransmission of the request in progress */
+		RADIUS_DEBUG("Session 0x%x is being processed - drop request "
+			     "from %s", sess->sess_id, from_addr);
+		data->counters.packets_dropped++;
+		client->counters.packets_dropped++;
+		return -1;
 	}
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
+	eap = radius_msg_get_eap(msg);
+	if (eap == NULL && sess->macacl) {
+		reply = radius_server_macacl(data, client, sess, msg);
+		if (reply == NULL)
+			return -1;
+		radius_server_send_reply(data, client, sess, msg, reply, 0,
+					 from, fromlen, from_addr, from_port);
+		return 0;
+	}
+	if (eap == NULL) {
+		RADIUS_DEBUG("No EAP-Message in RADIUS packet from %s",
+			     from_addr);
+		data->counters.packets_dropped++;
+		client->counters.packets_dropped++;
+		return -1;
+	}
+
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	if (data->num_workers)
+		return radius_server_queue_job(data, sess, msg, eap, from,
+					       fromlen, from_addr, from_port);
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
+	res = radius_server_eap_step(data, sess, msg, eap, &reply,
+				     &is_complete);
+	return radius_server_eap_result(data, sess, msg, res, reply,
+					is_complete, from, fromlen, from_addr,
+					from_port);
+}
+
+
+static void radius_server_handle_auth(struct radius_server_data *data,
+				      struct radius_rx_pkt *pkt)
+{
+	const u8 *buf = pkt->buf;
+	int len = pkt->len;
+	struct radius_client *client = NULL;
+	struct radius_msg *msg = NULL;
+	char abuf[50];
+	int from_port = 0;
 
 #ifdef CONFIG_IPV6
 	if (data->ipv6) {
-		if (inet_ntop(AF_INET6, &from.sin6.sin6_addr, abuf,
+		if (inet_ntop(AF_INET6, &pkt->from.sin6.sin6_addr, abuf,
 			      sizeof(abuf)) == NULL)
 			abuf[0] = '\0';
-		from_port = ntohs(from.sin6.sin6_port);
+		from_port = ntohs(pkt->from.sin6.sin6_port);
 		RADIUS_DEBUG("Received %d bytes from %s:%d",
 			     len, abuf, from_port);
 
 		client = radius_server_get_client(data,
 						  (struct in_addr *)
-						  &from.sin6.sin6_addr, 1);
+						  &pkt->from.sin6.sin6_addr,
+						  1);
 	}
 #endif /* CONFIG_IPV6 */
 
 	if (!data->ipv6) {
-		os_strlcpy(abuf, inet_ntoa(from.sin.sin_addr), sizeof(abuf));
-		from_port = ntohs(from.sin.sin_port);
+		os_strlcpy(abuf, inet_ntoa(pkt->from.sin.sin_addr),
+			   sizeof(abuf));
+		from_port = ntohs(pkt->from.sin.sin_port);
 		RADIUS_DEBUG("Received %d bytes from %s:%d",
 			     len, abuf, from_port);
 
-		client = radius_server_get_client(data, &from.sin.sin_addr, 0);
+		client = radius_server_get_client(data,
+						  &pkt->from.sin.sin_addr, 0);
 	}
 
 	RADIUS_DUMP("Received data", buf, len);
@@ -1254,9 +1762,6 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
-	os_free(buf);
-	buf = NULL;
-
 	if (wpa_debug_level <= MSG_MSGDUMP) {
 		radius_msg_dump(msg);
 	}
@@ -1280,74 +1785,85 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
-	if (radius_server_request(data, msg, (struct sockaddr *) &from,
-				  fromlen, client, abuf, from_port, NULL) ==
-	    -2)
-		return; /* msg was stored with the session */
+	if (radius_server_request(data, msg, (struct sockaddr *) &pkt->from,
+				  pkt->fromlen, client, abuf, from_port,
+				  NULL) == -2)
+		return; /* msg was stored with the session or queued */
 
 fail:
 	radius_msg_free(msg);
-	os_free(buf);
 }
 
 
-static void radius_server_receive_acct(int sock, void *eloop_ctx,
+static int radius_server_recv_batch(struct radius_server_data *data, int sock,
+				    struct radius_rx_pkt *pkts)
+{
+	int i, num;
+
+	for (i = 0; i < RADIUS_IO_BATCH; i++)
+		pkts[i].buf = data->rx_buf + i * RADIUS_MAX_MSG_LEN;
+
+	/* Drain a burst of requests with a single wakeup */
+	num = radius_recv_batch(sock, pkts, RADIUS_IO_BATCH,
+				RADIUS_MAX_MSG_LEN);
+	if (num < 0)
+		wpa_printf(MSG_INFO, "recvfrom[radius_server]: %s",
+			   strerror(errno));
+	return num;
+}
+
+
+static void radius_server_receive_auth(int sock, void *eloop_ctx,
 				       void *sock_ctx)
 {
 	struct radius_server_data *data = eloop_ctx;
-	u8 *buf = NULL;
-	union {
-		struct sockaddr_storage ss;
-		struct sockaddr_in sin;
-#ifdef CONFIG_IPV6
-		struct sockaddr_in6 sin6;
-#endif /* CONFIG_IPV6 */
-	} from;
-	socklen_t fromlen;
-	int len, res;
+	struct radius_rx_pkt pkts[RADIUS_IO_BATCH];
+	int i, num;
+
+	num = radius_server_recv_batch(data, sock, pkts);
+	for (i = 0; i < num; i++)
+		radius_server_handle_auth(data, &pkts[i]);
+}
+
+
+/* Returns the Accounting-Response to be sent to pkt->from or %NULL */
+static struct radius_msg *
+radius_server_handle_acct(struct radius_server_data *data,
+			  struct radius_rx_pkt *pkt)
+{
+	const u8 *buf = pkt->buf;
+	int len = pkt->len;
 	struct radius_client *client = NULL;
 	struct radius_msg *msg = NULL, *resp = NULL;
 	char abuf[50];
 	int from_port = 0;
 	struct radius_hdr *hdr;
-	struct wpabuf *rbuf;
-
-	buf = os_malloc(RADIUS_MAX_MSG_LEN);
-	if (buf == NULL) {
-		goto fail;
-	}
-
-	fromlen = sizeof(from);
-	len = recvfrom(sock, buf, RADIUS_MAX_MSG_LEN, 0,
-		       (struct sockaddr *) &from.ss, &fromlen);
-	if (len < 0) {
-		wpa_printf(MSG_INFO, "recvfrom[radius_server]: %s",
-			   strerror(errno));
-		goto fail;
-	}
 
 #ifdef CONFIG_IPV6
 	if (data->ipv6) {
-		if (inet_ntop(AF_INET6, &from.sin6.sin6_addr, abuf,
+		if (inet_ntop(AF_INET6, &pkt->from.sin6.sin6_addr, abuf,
 			      sizeof(abuf)) == NULL)
 			abuf[0] = '\0';
-		from_port = ntohs(from.sin6.sin6_port);
+		from_port = ntohs(pkt->from.sin6.sin6_port);
 		RADIUS_DEBUG("Received %d bytes from %s:%d",
 			     len, abuf, from_port);
 
 		client = radius_server_get_client(data,
 						  (struct in_addr *)
-						  &from.sin6.sin6_addr, 1);
+						  &pkt->from.sin6.sin6_addr,
+						  1);
 	}
 #endif /* CONFIG_IPV6 */
 
 	if (!data->ipv6) {
-		os_strlcpy(abuf, inet_ntoa(from.sin.sin_addr), sizeof(abuf));
-		from_port = ntohs(from.sin.sin_port);
+		os_strlcpy(abuf, inet_ntoa(pkt->from.sin.sin_addr),
+			   sizeof(abuf));
+		from_port = ntohs(pkt->from.sin.sin_port);
 		RADIUS_DEBUG("Received %d bytes from %s:%d",
 			     len, abuf, from_port);
 
-		client = radius_server_get_client(data, &from.sin.sin_addr, 0);
+		client = radius_server_get_client(data,
+						  &pkt->from.sin.sin_addr, 0);
 	}
 
 	RADIUS_DUMP("Received data", buf, len);
@@ -1366,9 +1882,6 @@ static void radius_server_receive_acct(int sock, void *eloop_ctx,
 		goto fail;
 	}
 
-	os_free(buf);
-	buf = NULL;
-
 	if (wpa_debug_level <= MSG_MSGDUMP) {
 		radius_msg_dump(msg);
 	}
@@ -1408,20 +1921,53 @@ static void radius_server_receive_acct(int sock, void *eloop_ctx,
 	if (wpa_debug_level <= MSG_MSGDUMP) {
 		radius_msg_dump(resp);
 	}
-	rbuf = radius_msg_get_buf(resp);
 	data->counters.acct_responses++;
 	client->counters.acct_responses++;
-	res = sendto(data->acct_sock, wpabuf_head(rbuf), wpabuf_len(rbuf), 0,
-		     (struct sockaddr *) &from.ss, fromlen);
-	if (res < 0) {
-		wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
-			   strerror(errno));
-	}
 
 fail:
-	radius_msg_free(resp);
 	radius_msg_free(msg);
-	os_free(buf);
+	return resp;
+}
+
+
+static void radius_server_receive_acct(int sock, void *eloop_ctx,
+				       void *sock_ctx)
+{
+	struct radius_server_data *data = eloop_ctx;
+	struct radius_rx_pkt pkts[RADIUS_IO_BATCH];
+	struct radius_tx_pkt tx[RADIUS_IO_BATCH];
+	struct radius_msg *resp[RADIUS_IO_BATCH];
+	struct wpabuf *rbuf;
+	int i, num;
+	size_t num_tx = 0, sent;
+
+	num = radius_server_recv_batch(data, sock, pkts);
+	for (i = 0; i < num; i++) {
+		resp[num_tx] = radius_server_handle_acct(data, &pkts[i]);
+		if (!resp[num_tx])
+			continue;
+		rbuf = radius_msg_get_buf(resp[num_tx]);
+		tx[num_tx].data = wpabuf_head(rbuf);
+		tx[num_tx].len = wpabuf_len(rbuf);
+		tx[num_tx].to = (struct sockaddr *) &pkts[i].from;
+		tx[num_tx].tolen = pkts[i].fromlen;
+		num_tx++;
+	}
+
+	/* Send all Accounting-Response messages for the burst together */
+	sent = 0;
+	while (sent < num_tx) {
+		sent += radius_send_batch(data->acct_sock, &tx[sent],
+					  num_tx - sent);
+		if (sent < num_tx) {
+			wpa_printf(MSG_INFO, "sendto[RADIUS SRV]: %s",
+				   strerror(errno));
+			sent++; /* skip the failed message */
+		}
+	}
+
+	for (sent = 0; sent < num_tx; sent++)
+		radius_msg_free(resp[sent]);
 }
 
 
@@ -1638,6 +2184,7 @@ radius_server_read_clients(const char *client_file, int ipv6)
 			break;
 		}
 		entry->shared_secret_len = os_strlen(entry->shared_secret);
+		entry->prefix_len = mask;
 		if (!ipv6) {
 			entry->addr.s_addr = addr.s_addr;
 			val = 0;
@@ -1693,6 +2240,7 @@ struct radius_server_data *
 radius_server_init(struct radius_server_conf *conf)
 {
 	struct radius_server_data *data;
+	struct radius_client *client;
 
 #ifndef CONFIG_IPV6
 	if (conf->ipv6) {
@@ -1705,6 +2253,12 @@ radius_server_init(struct radius_server_conf *conf)
 	if (data == NULL)
 		return NULL;
 
+	data->rx_buf = os_malloc(RADIUS_IO_BATCH * RADIUS_MAX_MSG_LEN);
+	if (data->rx_buf == NULL) {
+		os_free(data);
+		return NULL;
+	}
+
 	dl_list_init(&data->erp_keys);
 	os_get_reltime(&data->start_time);
 	data->conf_ctx = conf->conf_ctx;
@@ -1749,6 +2303,8 @@ radius_server_init(struct radius_server_conf *conf)
 	data->erp = conf->erp;
 	data->erp_domain = conf->erp_domain;
 	data->tls_session_lifetime = conf->tls_session_lifetime;
+	data->max_sessions = conf->max_sessions > 0 ? conf->max_sessions :
+		RADIUS_MAX_SESSION;
 
 	if (conf->subscr_remediation_url) {
 		data->subscr_remediation_url =
@@ -1780,6 +2336,13 @@ radius_server_init(struct radius_server_conf *conf)
 		return NULL;
 	}
 
+	for (client = data->clients; client; client = client->next) {
+		if (radius_server_index_client(data, client) < 0) {
+			radius_server_deinit(data);
+			return NULL;
+		}
+	}
+
 #ifdef CONFIG_IPV6
 	if (conf->ipv6)
 		data->auth_sock = radius_server_open_socket6(conf->auth_port);
@@ -1821,6 +2384,18 @@ radius_server_init(struct radius_server_conf *conf)
 		data->acct_sock = -1;
 	}
 
+	if (conf->eap_threads > 0) {
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+		if (radius_server_start_workers(data, conf->eap_threads) < 0) {
+			wpa_printf(MSG_ERROR, "Failed to start RADIUS server EAP worker threads");
+			radius_server_deinit(data);
+			return NULL;
+		}
+#else /* CONFIG_RADIUS_SERVER_THREADS */
+		wpa_printf(MSG_INFO, "RADIUS server compiled without EAP worker thread support - process EAP inline");
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+	}
+
 	return data;
 }
 
@@ -1835,11 +2410,13 @@ void radius_server_erp_flush(struct radius_server_data *data)
 
 	if (data == NULL)
 		return;
+	radius_server_cb_lock(data);
 	while ((erp = dl_list_first(&data->erp_keys, struct eap_server_erp_key,
 				    list)) != NULL) {
 		dl_list_del(&erp->list);
 		bin_clear_free(erp, sizeof(*erp));
 	}
+	radius_server_cb_unlock(data);
 }
 
 
@@ -1852,6 +2429,10 @@ void radius_server_deinit(struct radius_server_data *data)
 	if (data == NULL)
 		return;
 
+#ifdef CONFIG_RADIUS_SERVER_THREADS
+	radius_server_stop_workers(data);
+#endif /* CONFIG_RADIUS_SERVER_THREADS */
+
 	if (data->auth_sock >= 0) {
 		eloop_unregister_read_sock(data->auth_sock);
 		close(data->auth_sock);
@@ -1863,7 +2444,9 @@ void radius_server_deinit(struct radius_server_data *data)
 	}
 
 	radius_server_free_clients(data, data->clients);
+	radius_server_free_client_trie(data->client_trie);
 
+	os_free(data->rx_buf);
 	os_free(data->pac_opaque_encr_key);
 	os_free(data->eap_fast_a_id);
 	os_free(data->eap_fast_a_id_info);
@@ -2034,8 +2617,10 @@ static int radius_server_get_eap_user(void *ctx, const u8 *identity,
 	struct radius_server_data *data = sess->server;
 	int ret;
 
+	radius_server_cb_lock(data);
 	ret = data->get_eap_user(data->conf_ctx, identity, identity_len,
 				 phase2, user);
+	radius_server_cb_unlock(data);
 	if (ret == 0 && user) {
 		sess->accept_attr = user->accept_attr;
 		sess->remediation = user->remediation;
@@ -2083,15 +2668,19 @@ radius_server_erp_get_key(void *ctx, const char *keyname)
 {
 	struct radius_session *sess = ctx;
 	struct radius_server_data *data = sess->server;
-	struct eap_server_erp_key *erp;
+	struct eap_server_erp_key *erp, *found = NULL;
 
+	radius_server_cb_lock(data);
 	dl_list_for_each(erp, &data->erp_keys, struct eap_server_erp_key,
 			 list) {
-		if (os_strcmp(erp->keyname_nai, keyname) == 0)
-			return erp;
+		if (os_strcmp(erp->keyname_nai, keyname) == 0) {
+			found = erp;
+			break;
+		}
 	}
+	radius_server_cb_unlock(data);
 
-	return NULL;
+	return found;
 }
 
 
@@ -2100,7 +2689,9 @@ static int radius_server_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 	struct radius_session *sess = ctx;
 	struct radius_server_data *data = sess->server;
 
+	radius_server_cb_lock(data);
 	dl_list_add(&data->erp_keys, &erp->list);
+	radius_server_cb_unlock(data);
 	return 0;
 }
 
@@ -186,6 +186,29 @@ struct radius_server_conf {
 	 */
 	int ipv6;
 
+	/**
+	 * max_sessions - Maximum number of active sessions
+	 *
+	 * New sessions are rejected when this many authentication sessions
+	 * are in progress or waiting for removal after completion. 0 = use
+	 * the default (1000).
+	 */
+	int max_sessions;
+
+	/**
+	 * eap_threads - Number of worker threads for EAP processing
+	 *
+	 * If set, EAP state machine steps are run in a pool of worker threads
+	 * instead of the eloop thread so that TLS handshakes of different
+	 * sessions can use multiple CPU cores. All messages of a session are
+	 * processed by the same thread. This requires the server to be built
+	 * with CONFIG_RADIUS_SERVER_THREADS (which also enables the locking
+	 * in the random pool and the crypto/TLS caches). The worker threads
+	 * are not used with WPS, EAP-SIM/AKA database, or TNC. 0 = process
+	 * EAP in the eloop thread.
+	 */
+	int eap_threads;
+
 	/**
 	 * get_eap_user - Callback for fetching EAP user information
 	 * @ctx: Context data from conf_ctx
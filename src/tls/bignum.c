@@ -222,3 +222,282 @@ int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 	}
 	return 0;
 }
+
+
+/*
+ * Montgomery context for repeated exponentiation with a fixed odd modulus.
+ * The reduction parameters are computed once and an optional comb table
+ * allows fixed-base exponentiation (e.g., with a DH group generator) with
+ * about a quarter of the modular multiplications needed by the sliding
+ * window method.
+ */
+struct bignum_mont {
+	mp_int n; /* modulus */
+	mp_digit rho; /* -1/n mod b */
+	mp_int rr; /* R^2 mod n */
+	mp_int one; /* R mod n, i.e., 1 in Montgomery form */
+
+	/* Fixed-base comb table: comb[i - 1] = prod g^(2^(j * comb_d)) over
+	 * bits j set in i, all in Montgomery form */
+	mp_int base;
+	mp_int *comb;
+	int comb_teeth;
+	int comb_d;
+};
+
+
+static int bignum_mont_mul(struct bignum_mont *ctx, mp_int *a, mp_int *b,
+			   mp_int *c)
+{
+	if (mp_mul(a, b, c) != MP_OKAY ||
+	    mp_montgomery_reduce(c, &ctx->n, ctx->rho) != MP_OKAY)
+		return -1;
+	return 0;
+}
+
+
+static int bignum_mont_sqr(struct bignum_mont *ctx, mp_int *a, mp_int *c)
+{
+	if (mp_sqr(a, c) != MP_OKAY ||
+	    mp_montgomery_reduce(c, &ctx->n, ctx->rho) != MP_OKAY)
+		return -1;
+	return 0;
+}
+
+
+/* c = a * R mod n */
+static int bignum_mont_to(struct bignum_mont *ctx, mp_int *a, mp_int *c)
+{
+	if (mp_cmp_mag(a, &ctx->n) != MP_LT) {
+		if (mp_mod(a, &ctx->n, c) != MP_OKAY)
+			return -1;
+		return bignum_mont_mul(ctx, c, &ctx->rr, c);
+	}
+	return bignum_mont_mul(ctx, a, &ctx->rr, c);
+}
+
+
+/* c = a * R^-1 mod n */
+static int bignum_mont_from(struct bignum_mont *ctx, mp_int *a, mp_int *c)
+{
+	if (mp_copy(a, c) != MP_OKAY ||
+	    mp_montgomery_reduce(c, &ctx->n, ctx->rho) != MP_OKAY)
+		return -1;
+	return 0;
+}
+
+
+static int bignum_bit(mp_int *x, int i)
+{
+	if (i / DIGIT_BIT >= x->used)
+		return 0;
+	return (x->dp[i / DIGIT_BIT] >> (i % DIGIT_BIT)) & 1;
+}
+
+
+/**
+ * bignum_mont_init - Initialize Montgomery context for an odd modulus
+ * @n: Bignum from bignum_init(); odd modulus
+ * Returns: Pointer to Montgomery context or %NULL on failure
+ */
+struct bignum_mont * bignum_mont_init(const struct bignum *n)
+{
+	struct bignum_mont *ctx;
+
+	if (!mp_isodd((mp_int *) n) || mp_cmp_d((mp_int *) n, 1) != MP_GT)
+		return NULL;
+
+	ctx = os_zalloc(sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+	if (mp_init(&ctx->n) != MP_OKAY) {
+		os_free(ctx);
+		return NULL;
+	}
+	if (mp_init(&ctx->rr) != MP_OKAY) {
+		mp_clear(&ctx->n);
+		os_free(ctx);
+		return NULL;
+	}
+	if (mp_init(&ctx->one) != MP_OKAY) {
+		mp_clear(&ctx->rr);
+		mp_clear(&ctx->n);
+		os_free(ctx);
+		return NULL;
+	}
+	if (mp_init(&ctx->base) != MP_OKAY) {
+		mp_clear(&ctx->one);
+		mp_clear(&ctx->rr);
+		mp_clear(&ctx->n);
+		os_free(ctx);
+		return NULL;
+	}
+
+	if (mp_copy((mp_int *) n, &ctx->n) != MP_OKAY ||
+	    mp_montgomery_setup(&ctx->n, &ctx->rho) != MP_OKAY ||
+	    mp_montgomery_calc_normalization(&ctx->one, &ctx->n) != MP_OKAY ||
+	    mp_mulmod(&ctx->one, &ctx->one, &ctx->n, &ctx->rr) != MP_OKAY) {
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+		bignum_mont_deinit(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+
+static void bignum_mont_free_comb(struct bignum_mont *ctx)
+{
+	int i;
+
+	if (!ctx->comb)
+		return;
+	for (i = 0; i < (1 << ctx->comb_teeth) - 1; i++)
+		mp_clear(&ctx->comb[i]);
+	os_free(ctx->comb);
+	ctx->comb = NULL;
+	ctx->comb_teeth = 0;
+	ctx->comb_d = 0;
+}
+
+
+/**
+ * bignum_mont_deinit - Free Montgomery context
+ * @ctx: Montgomery context from bignum_mont_init()
+ */
+void bignum_mont_deinit(struct bignum_mont *ctx)
+{
+	if (!ctx)
+		return;
+	bignum_mont_free_comb(ctx);
+	mp_clear(&ctx->base);
+	mp_clear(&ctx->one);
+	mp_clear(&ctx->rr);
+	mp_clear(&ctx->n);
+	os_free(ctx);
+}
+
+
+/**
+ * bignum_mont_set_base - Precompute comb table for fixed-base exponentiation
+ * @ctx: Montgomery context from bignum_mont_init()
+ * @g: Bignum from bignum_init(); fixed base
+ * @max_bits: Maximum exponent length in bits for bignum_mont_exptmod_base()
+ * @teeth: Number of comb teeth; the table has 2^teeth - 1 entries
+ * Returns: 0 on success, -1 on failure
+ */
+int bignum_mont_set_base(struct bignum_mont *ctx, const struct bignum *g,
+			 size_t max_bits, unsigned int teeth)
+{
+	mp_int *comb;
+	int i, j, k, entries;
+
+	if (teeth < 1 || teeth > 8 || max_bits == 0)
+		return -1;
+
+	bignum_mont_free_comb(ctx);
+	entries = (1 << teeth) - 1;
+	comb = os_calloc(entries, sizeof(mp_int));
+	if (!comb)
+		return -1;
+	for (i = 0; i < entries; i++) {
+		if (mp_init(&comb[i]) != MP_OKAY) {
+			while (--i >= 0)
+				mp_clear(&comb[i]);
+			os_free(comb);
+			return -1;
+		}
+	}
+	ctx->comb = comb;
+	ctx->comb_teeth = teeth;
+	ctx->comb_d = (max_bits + teeth - 1) / teeth;
+
+	if (mp_copy((mp_int *) g, &ctx->base) != MP_OKAY ||
+	    bignum_mont_to(ctx, &ctx->base, &comb[0]) < 0)
+		goto fail;
+
+	/* comb[2^j - 1] = g^(2^(j * d)) */
+	for (j = 1; j < (int) teeth; j++) {
+		mp_int *prev = &comb[(1 << (j - 1)) - 1];
+		mp_int *cur = &comb[(1 << j) - 1];
+
+		if (mp_copy(prev, cur) != MP_OKAY)
+			goto fail;
+		for (k = 0; k < ctx->comb_d; k++) {
+			if (bignum_mont_sqr(ctx, cur, cur) < 0)
+				goto fail;
+		}
+	}
+
+	/* Remaining entries are products of the power-of-two entries */
+	for (i = 3; i <= entries; i++) {
+		int low = i & (i - 1);
+
+		if (low == 0)
+			continue;
+		if (bignum_mont_mul(ctx, &comb[low - 1],
+				    &comb[(i & -i) - 1], &comb[i - 1]) < 0)
+			goto fail;
+	}
+
+	return 0;
+fail:
+	wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+	bignum_mont_free_comb(ctx);
+	return -1;
+}
+
+
+/**
+ * bignum_mont_exptmod_base - Fixed-base modular exponentiation
+ * @ctx: Montgomery context with a base from bignum_mont_set_base()
+ * @b: Bignum from bignum_init(); exponent
+ * @d: Bignum from bignum_init(); used to store the result of g^b (mod n)
+ * Returns: 0 on success, -1 on failure
+ *
+ * Exponents longer than the max_bits value used with bignum_mont_set_base()
+ * are not supported and result in failure.
+ */
+int bignum_mont_exptmod_base(struct bignum_mont *ctx, const struct bignum *b,
+			     struct bignum *d)
+{
+	mp_int *x = (mp_int *) b;
+	mp_int res;
+	int i, j, idx, first = 1, ret = -1;
+
+	if (!ctx->comb || x->sign == MP_NEG ||
+	    mp_count_bits(x) > ctx->comb_teeth * ctx->comb_d)
+		return -1;
+
+	if (mp_init(&res) != MP_OKAY)
+		return -1;
+	if (mp_copy(&ctx->one, &res) != MP_OKAY)
+		goto fail;
+
+	for (i = ctx->comb_d - 1; i >= 0; i--) {
+		if (!first && bignum_mont_sqr(ctx, &res, &res) < 0)
+			goto fail;
+		idx = 0;
+		for (j = ctx->comb_teeth - 1; j >= 0; j--)
+			idx = (idx << 1) | bignum_bit(x, j * ctx->comb_d + i);
+		if (!idx)
+			continue;
+		if (first) {
+			if (mp_copy(&ctx->comb[idx - 1], &res) != MP_OKAY)
+				goto fail;
+			first = 0;
+		} else if (bignum_mont_mul(ctx, &res, &ctx->comb[idx - 1],
+					   &res) < 0) {
+			goto fail;
+		}
+	}
+
+	if (bignum_mont_from(ctx, &res, (mp_int *) d) < 0)
+		goto fail;
+	ret = 0;
+fail:
+	if (ret)
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+	mp_clear(&res);
+	return ret;
+}
@@ -10,6 +10,7 @@
 #define BIGNUM_H
 
 struct bignum;
+struct bignum_mont;
 
 struct bignum * bignum_init(void);
 void bignum_deinit(struct bignum *n);
@@ -29,4 +30,11 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d);
 
+struct bignum_mont * bignum_mont_init(const struct bignum *n);
+void bignum_mont_deinit(struct bignum_mont *ctx);
+int bignum_mont_set_base(struct bignum_mont *ctx, const struct bignum *g,
+			 size_t max_bits, unsigned int teeth);
+int bignum_mont_exptmod_base(struct bignum_mont *ctx, const struct bignum *b,
+			     struct bignum *d);
+
 #endif /* BIGNUM_H */
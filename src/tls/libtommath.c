@@ -27,17 +27,22 @@
 #define BN_S_MP_MUL_HIGH_DIGS_C /* Note: #undef in tommath_superclass.h; this
 				 * would require other than mp_reduce */
 
+/* Montgomery exptmod for odd moduli (all DH and RSA moduli) at the cost of
+ * about 2.5 kB in code. The baseline reduction does not need the large comba
+ * array on stack; LTM_FAST replaces it with the comba version. */
+#define BN_MP_EXPTMOD_FAST_C
+#define BN_MP_MONTGOMERY_SETUP_C
+#define BN_MP_MONTGOMERY_REDUCE_C
+#define BN_MP_MONTGOMERY_CALC_NORMALIZATION_C
+#define BN_MP_MUL_2_C
+
 #ifdef LTM_FAST
 
 /* Use faster div at the cost of about 1 kB */
 #define BN_MP_MUL_D_C
 
-/* Include faster exptmod (Montgomery) at the cost of about 2.5 kB in code */
-#define BN_MP_EXPTMOD_FAST_C
-#define BN_MP_MONTGOMERY_SETUP_C
+/* Comba Montgomery reduction; about 0.5 kB of code, but large stack use */
 #define BN_FAST_MP_MONTGOMERY_REDUCE_C
-#define BN_MP_MONTGOMERY_CALC_NORMALIZATION_C
-#define BN_MP_MUL_2_C
 
 /* Include faster sqr at the cost of about 0.5 kB in code */
 #define BN_FAST_S_MP_SQR_C
@@ -186,6 +191,15 @@ static int mp_init_size(mp_int * a, int size);
 #ifdef BN_MP_EXPTMOD_FAST_C
 static int mp_exptmod_fast (mp_int * G, mp_int * X, mp_int * P, mp_int * Y, int redmode);
 #endif /* BN_MP_EXPTMOD_FAST_C */
+#ifdef BN_MP_MONTGOMERY_SETUP_C
+static int mp_montgomery_setup (mp_int * n, mp_digit * rho);
+#endif /* BN_MP_MONTGOMERY_SETUP_C */
+#ifdef BN_MP_MONTGOMERY_REDUCE_C
+static int mp_montgomery_reduce (mp_int * x, mp_int * n, mp_digit rho);
+#endif /* BN_MP_MONTGOMERY_REDUCE_C */
+#ifdef BN_MP_MONTGOMERY_CALC_NORMALIZATION_C
+static int mp_montgomery_calc_normalization (mp_int * a, mp_int * b);
+#endif /* BN_MP_MONTGOMERY_CALC_NORMALIZATION_C */
 #ifdef BN_FAST_S_MP_SQR_C
 static int fast_s_mp_sqr (mp_int * a, mp_int * b);
 #endif /* BN_FAST_S_MP_SQR_C */
@@ -2842,6 +2856,107 @@ static int fast_mp_montgomery_reduce (mp_int * x, mp_int * n, mp_digit rho)
 #endif
 
 
+#ifdef BN_MP_MONTGOMERY_REDUCE_C
+/* computes xR**-1 == x (mod N) via Montgomery Reduction
+ *
+ * Baseline version of fast_mp_montgomery_reduce() that does not need the
+ * MP_WARRAY sized column array. Based on Algorithm 14.32 on pp.601 of HAC.
+ */
+static int mp_montgomery_reduce (mp_int * x, mp_int * n, mp_digit rho)
+{
+  int     ix, res, digs;
+  mp_digit mu;
+
+#ifdef BN_FAST_MP_MONTGOMERY_REDUCE_C
+  /* can the fast reduction [comba] method be used? */
+  digs = n->used * 2 + 1;
+  if ((digs < MP_WARRAY) &&
+      n->used <
+      (1 << ((CHAR_BIT * sizeof (mp_word)) - (2 * DIGIT_BIT)))) {
+    return fast_mp_montgomery_reduce (x, n, rho);
+  }
+#else
+  digs = n->used * 2 + 1;
+#endif
+
+  /* grow the input as required */
+  if (x->alloc < digs) {
+    if ((res = mp_grow (x, digs)) != MP_OKAY) {
+      return res;
+    }
+  }
+  x->used = digs;
+
+  for (ix = 0; ix < n->used; ix++) {
+    /* mu = ai * rho mod b
+     *
+     * The value of rho must be precalculated via
+     * montgomery_setup() such that
+     * it equals -1/n0 mod b this allows the
+     * following inner loop to reduce the
+     * input one digit at a time
+     */
+    mu = (mp_digit) (((mp_word)x->dp[ix]) * ((mp_word)rho) & MP_MASK);
+
+    /* a = a + mu * m * b**i */
+    {
+      register int iy;
+      register mp_digit *tmpn, *tmpx, u;
+      register mp_word r;
+
+      /* alias for digits of the modulus */
+      tmpn = n->dp;
+
+      /* alias for the digits of x [the input] */
+      tmpx = x->dp + ix;
+
+      /* set the carry to zero */
+      u = 0;
+
+      /* Multiply and add in place */
+      for (iy = 0; iy < n->used; iy++) {
+        /* compute product and sum */
+        r       = ((mp_word)mu) * ((mp_word)*tmpn++) +
+                  ((mp_word) u) + ((mp_word) * tmpx);
+
+        /* get carry */
+        u       = (mp_digit)(r >> ((mp_word) DIGIT_BIT));
+
+        /* fix digit */
+        *tmpx++ = (mp_digit)(r & ((mp_word) MP_MASK));
+      }
+      /* At this point the ix'th digit of x should be zero */
+
+      /* propagate carries upwards as required*/
+      while (u) {
+        *tmpx   += u;
+        u        = *tmpx >> DIGIT_BIT;
+        *tmpx++ &= MP_MASK;
+      }
+    }
+  }
+
+  /* at this point the n.used'th least
+   * significant digits of x are all zero
+   * which means we can shift x to the
+   * right by n.used digits and the
+   * residue is unchanged.
+   */
+
+  /* x = x/b**n.used */
+  mp_clamp(x);
+  mp_rshd (x, n->used);
+
+  /* if x >= n then x = x - n */
+  if (mp_cmp_mag (x, n) != MP_LT) {
+    return s_mp_sub (x, n, x);
+  }
+
+  return MP_OKAY;
+}
+#endif
+
+
 #ifdef BN_MP_MUL_2_C
 /* b = a*2 */
 static int mp_mul_2(mp_int * a, mp_int * b)
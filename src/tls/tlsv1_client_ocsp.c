@@ -658,9 +658,10 @@ tls_process_basic_ocsp_response(struct tlsv1_client *conn,
 
 	res = tls_process_ocsp_responses(conn, srv_cert, issuer,
 					 responses, responses_len);
-	if (res == TLS_OCSP_REVOKED)
+	if (res == TLS_OCSP_REVOKED) {
 		srv_cert->ocsp_revoked = 1;
-	else if (res == TLS_OCSP_GOOD)
+		x509_certificate_cache_remove(srv_cert);
+	} else if (res == TLS_OCSP_GOOD)
 		srv_cert->ocsp_good = 1;
 	return res;
 
@@ -7,8 +7,12 @@
  */
 
 #include "includes.h"
+#ifdef CONFIG_CRYPTO_THREADS
+#include <pthread.h>
+#endif /* CONFIG_CRYPTO_THREADS */
 
 #include "common.h"
+#include "utils/list.h"
 #include "crypto/sha1.h"
 #include "crypto/tls.h"
 #include "tlsv1_common.h"
@@ -426,10 +430,14 @@ static void tlsv1_server_clear_data(struct tlsv1_server *conn)
 	conn->session_ticket = NULL;
 	conn->session_ticket_len = 0;
 	conn->use_session_ticket = 0;
+	conn->resumed = 0;
 
 	os_free(conn->dh_secret);
 	conn->dh_secret = NULL;
 	conn->dh_secret_len = 0;
+
+	wpabuf_free(conn->success_data);
+	conn->success_data = NULL;
 }
 
 
@@ -605,7 +613,7 @@ int tlsv1_server_shutdown(struct tlsv1_server *conn)
  */
 int tlsv1_server_resumed(struct tlsv1_server *conn)
 {
-	return 0;
+	return conn->resumed;
 }
 
 
@@ -708,6 +716,348 @@ void tlsv1_server_set_log_cb(struct tlsv1_server *conn,
 }
 
 
+struct tlsv1_server_cache_entry {
+	struct dl_list list;
+	u8 session_id[TLS_SESSION_ID_MAX_LEN];
+	size_t session_id_len;
+	u8 master_secret[TLS_MASTER_SECRET_LEN];
+	u16 cipher_suite;
+	u16 tls_version;
+	int verify_peer;
+	struct os_reltime expiration;
+	struct wpabuf *success_data;
+};
+
+struct tlsv1_server_cache {
+	struct dl_list entries; /* LRU order, most recently used first */
+	unsigned int num_entries;
+	unsigned int max_entries;
+	unsigned int lifetime;
+#ifdef CONFIG_CRYPTO_THREADS
+	/* The cache is shared by connections processed in worker threads */
+	pthread_mutex_t lock;
+#endif /* CONFIG_CRYPTO_THREADS */
+};
+
+#ifdef CONFIG_CRYPTO_THREADS
+#define tlsv1_server_cache_lock(c) pthread_mutex_lock(&(c)->lock)
+#define tlsv1_server_cache_unlock(c) pthread_mutex_unlock(&(c)->lock)
+#else /* CONFIG_CRYPTO_THREADS */
+#define tlsv1_server_cache_lock(c) do { } while (0)
+#define tlsv1_server_cache_unlock(c) do { } while (0)
+#endif /* CONFIG_CRYPTO_THREADS */
+
+
+static void tlsv1_server_cache_entry_free(struct tlsv1_server_cache *cache,
+					  struct tlsv1_server_cache_entry *e)
+{
+	dl_list_del(&e->list);
+	cache->num_entries--;
+	wpabuf_free(e->success_data);
+	bin_clear_free(e, sizeof(*e));
+}
+
+
+static void tlsv1_server_cache_expire(struct tlsv1_server_cache *cache)
+{
+	struct tlsv1_server_cache_entry *e, *prev;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	dl_list_for_each_safe(e, prev, &cache->entries,
+			      struct tlsv1_server_cache_entry, list) {
+		if (os_reltime_before(&now, &e->expiration))
+			continue;
+		wpa_hexdump(MSG_DEBUG, "TLSv1: Session cache entry expired",
+			    e->session_id, e->session_id_len);
+		tlsv1_server_cache_entry_free(cache, e);
+	}
+}
+
+
+static struct tlsv1_server_cache_entry *
+tlsv1_server_cache_find(struct tlsv1_server_cache *cache,
+			const u8 *session_id, size_t session_id_len)
+{
+	struct tlsv1_server_cache_entry *e;
+
+	if (!cache || session_id_len == 0)
+		return NULL;
+
+	dl_list_for_each(e, &cache->entries, struct tlsv1_server_cache_entry,
+			 list) {
+		if (e->session_id_len == session_id_len &&
+		    os_memcmp(e->session_id, session_id, session_id_len) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * tlsv1_server_cache_init - Initialize TLS session cache for resumption
+ * @max_entries: Maximum number of cached sessions
+ * @lifetime: Session lifetime in seconds
+ * Returns: Pointer to the session cache or %NULL on failure
+ *
+ * The cache can be shared by all TLSv1 server connections that use the same
+ * credentials (see tlsv1_server_set_session_cache()). Sessions are evicted in
+ * least recently used order once max_entries is reached.
+ */
+struct tlsv1_server_cache * tlsv1_server_cache_init(unsigned int max_entries,
+						     unsigned int lifetime)
+{
+	struct tlsv1_server_cache *cache;
+
+	if (max_entries == 0 || lifetime == 0)
+		return NULL;
+
+	cache = os_zalloc(sizeof(*cache));
+	if (!cache)
+		return NULL;
+	dl_list_init(&cache->entries);
+	cache->max_entries = max_entries;
+	cache->lifetime = lifetime;
+#ifdef CONFIG_CRYPTO_THREADS
+	if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+		os_free(cache);
+		return NULL;
+	}
+#endif /* CONFIG_CRYPTO_THREADS */
+
+	return cache;
+}
+
+
+/**
+ * tlsv1_server_cache_flush - Remove all sessions from TLS session cache
+ * @cache: Session cache from tlsv1_server_cache_init()
+ */
+void tlsv1_server_cache_flush(struct tlsv1_server_cache *cache)
+{
+	struct tlsv1_server_cache_entry *e, *prev;
+
+	if (!cache)
+		return;
+
+	tlsv1_server_cache_lock(cache);
+	dl_list_for_each_safe(e, prev, &cache->entries,
+			      struct tlsv1_server_cache_entry, list)
+		tlsv1_server_cache_entry_free(cache, e);
+	tlsv1_server_cache_unlock(cache);
+}
+
+
+/**
+ * tlsv1_server_cache_deinit - Deinitialize TLS session cache
+ * @cache: Session cache from tlsv1_server_cache_init()
+ */
+void tlsv1_server_cache_deinit(struct tlsv1_server_cache *cache)
+{
+	if (!cache)
+		return;
+	tlsv1_server_cache_flush(cache);
+#ifdef CONFIG_CRYPTO_THREADS
+	pthread_mutex_destroy(&cache->lock);
+#endif /* CONFIG_CRYPTO_THREADS */
+	os_free(cache);
+}
+
+
+/**
+ * tlsv1_server_set_session_cache - Enable session resumption for a connection
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * @cache: Session cache from tlsv1_server_cache_init() or %NULL to disable
+ */
+void tlsv1_server_set_session_cache(struct tlsv1_server *conn,
+				    struct tlsv1_server_cache *cache)
+{
+	conn->cache = cache;
+}
+
+
+static int tlsv1_server_cache_match(struct tlsv1_server *conn,
+				    struct tlsv1_server_cache_entry *e,
+				    const u8 *suites, size_t num_suites)
+{
+	size_t i;
+	int found = 0;
+
+	if (e->tls_version != conn->rl.tls_version ||
+	    e->verify_peer < conn->verify_peer)
+		return 0;
+
+	/* The cached CipherSuite must be both allowed and offered */
+	for (i = 0; i < conn->num_cipher_suites; i++) {
+		if (conn->cipher_suites[i] == e->cipher_suite) {
+			found = 1;
+			break;
+		}
+	}
+	if (!found)
+		return 0;
+	for (i = 0; i < num_suites; i++) {
+		if (WPA_GET_BE16(suites + 2 * i) == e->cipher_suite)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+int tlsv1_server_cache_get(struct tlsv1_server *conn,
+			   const u8 *suites, size_t num_suites)
+{
+	struct tlsv1_server_cache *cache = conn->cache;
+	struct tlsv1_server_cache_entry *e;
+	int res = 0;
+
+	if (!cache || conn->session_id_len == 0)
+		return 0;
+
+	tlsv1_server_cache_lock(cache);
+	tlsv1_server_cache_expire(cache);
+	e = tlsv1_server_cache_find(cache, conn->session_id,
+				    conn->session_id_len);
+	if (e && tlsv1_server_cache_match(conn, e, suites, num_suites)) {
+		os_memcpy(conn->master_secret, e->master_secret,
+			  TLS_MASTER_SECRET_LEN);
+		conn->cipher_suite = e->cipher_suite;
+		/* The entry may be evicted by another connection, so keep a
+		 * copy of the application data for this connection. */
+		wpabuf_free(conn->success_data);
+		conn->success_data = e->success_data ?
+			wpabuf_dup(e->success_data) : NULL;
+
+		/* Move to the head of the LRU list */
+		dl_list_del(&e->list);
+		dl_list_add(&cache->entries, &e->list);
+		res = 1;
+	}
+	tlsv1_server_cache_unlock(cache);
+
+	if (res)
+		tlsv1_server_log(conn, "Resuming cached session");
+	else if (e)
+		tlsv1_server_log(conn,
+				 "Cached session parameters do not match");
+	else
+		tlsv1_server_log(conn, "Session not found in cache");
+	return res;
+}
+
+
+void tlsv1_server_cache_add(struct tlsv1_server *conn)
+{
+	struct tlsv1_server_cache *cache = conn->cache;
+	struct tlsv1_server_cache_entry *e, *old;
+	unsigned int num_entries;
+
+	if (!cache || conn->resumed || conn->use_session_ticket ||
+	    conn->session_id_len == 0)
+		return;
+
+	e = os_zalloc(sizeof(*e));
+	if (!e)
+		return;
+	os_memcpy(e->session_id, conn->session_id, conn->session_id_len);
+	e->session_id_len = conn->session_id_len;
+	os_memcpy(e->master_secret, conn->master_secret,
+		  TLS_MASTER_SECRET_LEN);
+	e->cipher_suite = conn->cipher_suite;
+	e->tls_version = conn->rl.tls_version;
+	e->verify_peer = conn->verify_peer;
+	os_get_reltime(&e->expiration);
+	e->expiration.sec += cache->lifetime;
+
+	tlsv1_server_cache_lock(cache);
+	tlsv1_server_cache_expire(cache);
+	if (cache->num_entries >= cache->max_entries) {
+		old = dl_list_last(&cache->entries,
+				   struct tlsv1_server_cache_entry, list);
+		if (old) {
+			wpa_hexdump(MSG_DEBUG,
+				    "TLSv1: Session cache full - evict",
+				    old->session_id, old->session_id_len);
+			tlsv1_server_cache_entry_free(cache, old);
+		}
+	}
+	dl_list_add(&cache->entries, &e->list);
+	cache->num_entries++;
+	num_entries = cache->num_entries;
+	tlsv1_server_cache_unlock(cache);
+
+	tlsv1_server_log(conn, "Added session to cache (%u entries)",
+			 num_entries);
+}
+
+
+/**
+ * tlsv1_server_set_success_data - Store application data for cached session
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * @data: Application data; ownership is transferred to the session cache
+ */
+void tlsv1_server_set_success_data(struct tlsv1_server *conn,
+				   struct wpabuf *data)
+{
+	struct tlsv1_server_cache_entry *e;
+
+	if (!conn->cache) {
+		wpabuf_free(data);
+		return;
+	}
+
+	tlsv1_server_cache_lock(conn->cache);
+	e = tlsv1_server_cache_find(conn->cache, conn->session_id,
+				    conn->session_id_len);
+	if (e) {
+		wpabuf_free(e->success_data);
+		e->success_data = data;
+		data = NULL;
+	}
+	tlsv1_server_cache_unlock(conn->cache);
+	wpabuf_free(data);
+}
+
+
+/**
+ * tlsv1_server_get_success_data - Get application data for cached session
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ * Returns: Data from tlsv1_server_set_success_data() or %NULL if not available
+ *
+ * The data is copied from the session cache when a session is resumed.
+ */
+const struct wpabuf *
+tlsv1_server_get_success_data(struct tlsv1_server *conn)
+{
+	return conn->success_data;
+}
+
+
+/**
+ * tlsv1_server_remove_session - Remove connection's session from cache
+ * @conn: TLSv1 server connection data from tlsv1_server_init()
+ */
+void tlsv1_server_remove_session(struct tlsv1_server *conn)
+{
+	struct tlsv1_server_cache_entry *e;
+
+	if (!conn->cache)
+		return;
+
+	tlsv1_server_cache_lock(conn->cache);
+	e = tlsv1_server_cache_find(conn->cache, conn->session_id,
+				    conn->session_id_len);
+	if (e)
+		tlsv1_server_cache_entry_free(conn->cache, e);
+	tlsv1_server_cache_unlock(conn->cache);
+
+	if (e)
+		tlsv1_server_log(conn, "Removed session from cache");
+}
+
+
 #ifdef CONFIG_TESTING_OPTIONS
 void tlsv1_server_set_test_flags(struct tlsv1_server *conn, u32 flags)
 {
@@ -12,6 +12,7 @@
 #include "tlsv1_cred.h"
 
 struct tlsv1_server;
+struct tlsv1_server_cache;
 
 int tlsv1_server_global_init(void);
 void tlsv1_server_global_deinit(void);
@@ -48,6 +49,18 @@ void tlsv1_server_set_session_ticket_cb(struct tlsv1_server *conn,
 void tlsv1_server_set_log_cb(struct tlsv1_server *conn,
 			     void (*cb)(void *ctx, const char *msg), void *ctx);
 
+struct tlsv1_server_cache * tlsv1_server_cache_init(unsigned int max_entries,
+						     unsigned int lifetime);
+void tlsv1_server_cache_deinit(struct tlsv1_server_cache *cache);
+void tlsv1_server_cache_flush(struct tlsv1_server_cache *cache);
+void tlsv1_server_set_session_cache(struct tlsv1_server *conn,
+				    struct tlsv1_server_cache *cache);
+void tlsv1_server_set_success_data(struct tlsv1_server *conn,
+				   struct wpabuf *data);
+const struct wpabuf *
+tlsv1_server_get_success_data(struct tlsv1_server *conn);
+void tlsv1_server_remove_session(struct tlsv1_server *conn);
+
 void tlsv1_server_set_test_flags(struct tlsv1_server *conn, u32 flags);
 
 #endif /* TLSV1_SERVER_H */
@@ -55,6 +55,9 @@ struct tlsv1_server {
 	void *log_cb_ctx;
 
 	int use_session_ticket;
+	struct tlsv1_server_cache *cache;
+	struct wpabuf *success_data; /* copy from a resumed cache entry */
+	int resumed;
 	unsigned int status_request:1;
 	unsigned int status_request_v2:1;
 	unsigned int status_request_multi:1;
@@ -81,6 +84,9 @@ u8 * tlsv1_server_send_alert(struct tlsv1_server *conn, u8 level,
 			     u8 description, size_t *out_len);
 int tlsv1_server_process_handshake(struct tlsv1_server *conn, u8 ct,
 				   const u8 *buf, size_t *len);
+int tlsv1_server_cache_get(struct tlsv1_server *conn,
+			   const u8 *suites, size_t num_suites);
+void tlsv1_server_cache_add(struct tlsv1_server *conn);
 void tlsv1_server_get_dh_p(struct tlsv1_server *conn, const u8 **dh_p,
 			   size_t *dh_p_len);
 
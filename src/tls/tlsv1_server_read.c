@@ -210,8 +210,9 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 	if (end - pos < 1 + *pos || *pos > TLS_SESSION_ID_MAX_LEN)
 		goto decode_error;
 	wpa_hexdump(MSG_MSGDUMP, "TLSv1: client session_id", pos + 1, *pos);
+	conn->session_id_len = *pos;
+	os_memcpy(conn->session_id, pos + 1, conn->session_id_len);
 	pos += 1 + *pos;
-	/* TODO: add support for session resumption */
 
 	/* CipherSuite cipher_suites<2..2^16-1> */
 	if (end - pos < 2)
@@ -240,6 +241,12 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 			}
 		}
 	}
+	if (cipher_suite && tlsv1_server_cache_get(conn, pos, num_suites)) {
+		conn->resumed = 1;
+		cipher_suite = conn->cipher_suite;
+	} else {
+		conn->session_id_len = 0;
+	}
 	pos += num_suites * 2;
 	if (!cipher_suite) {
 		tlsv1_server_log(conn, "No supported cipher suite available");
@@ -350,6 +357,12 @@ static int tls_process_client_hello(struct tlsv1_server *conn, u8 ct,
 		}
 	}
 
+	if (conn->resumed && conn->session_ticket && conn->session_ticket_cb) {
+		/* SessionTicket processing takes precedence over the cache */
+		conn->resumed = 0;
+		conn->session_id_len = 0;
+	}
+
 	*in_len = end - in_data;
 
 	tlsv1_server_log(conn, "ClientHello OK - proceed to ServerHello");
@@ -1224,8 +1237,9 @@ static int tls_process_client_finished(struct tlsv1_server *conn, u8 ct,
 
 	*in_len = end - in_data;
 
-	if (conn->use_session_ticket) {
-		/* Abbreviated handshake using session ticket; RFC 4507 */
+	if (conn->use_session_ticket || conn->resumed) {
+		/* Abbreviated handshake using session ticket (RFC 4507) or
+		 * cached session_id */
 		tlsv1_server_log(conn, "Abbreviated handshake completed successfully");
 		conn->state = ESTABLISHED;
 	} else {
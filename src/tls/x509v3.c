@@ -7,13 +7,49 @@
  */
 
 #include "includes.h"
+#ifdef CONFIG_CRYPTO_THREADS
+#include <pthread.h>
+#endif /* CONFIG_CRYPTO_THREADS */
 
 #include "common.h"
+#include "utils/list.h"
 #include "crypto/crypto.h"
+#include "crypto/sha256.h"
 #include "asn1.h"
 #include "x509v3.h"
 
 
+/*
+ * Cache of issuer -> subject signatures that have already been verified. The
+ * entries are keyed on the SHA-256 hash of the DER encoding of both
+ * certificates, so a hit implies that exactly the same signature was verified
+ * with exactly the same public key and the RSA operation can be skipped.
+ * The cache is shared by all TLS connections, so it (and the lazily computed
+ * certificate hashes, since trusted CA certificates are shared through the
+ * credentials) is protected with a mutex when threads are in use.
+ */
+#define X509_SIG_CACHE_SIZE 64
+
+struct x509_sig_cache_entry {
+	struct dl_list list;
+	u8 issuer_hash[SHA256_MAC_LEN];
+	u8 cert_hash[SHA256_MAC_LEN];
+	os_time_t expire;
+};
+
+static struct dl_list x509_sig_cache = DL_LIST_HEAD_INIT(x509_sig_cache);
+static unsigned int x509_sig_cache_count = 0;
+
+#ifdef CONFIG_CRYPTO_THREADS
+static pthread_mutex_t x509_sig_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define x509_sig_cache_lock() pthread_mutex_lock(&x509_sig_cache_mutex)
+#define x509_sig_cache_unlock() pthread_mutex_unlock(&x509_sig_cache_mutex)
+#else /* CONFIG_CRYPTO_THREADS */
+#define x509_sig_cache_lock() do { } while (0)
+#define x509_sig_cache_unlock() do { } while (0)
+#endif /* CONFIG_CRYPTO_THREADS */
+
+
 void x509_free_name(struct x509_name *name)
 {
 	size_t i;
@@ -1716,6 +1752,92 @@ struct x509_certificate * x509_certificate_parse(const u8 *buf, size_t len)
 }
 
 
+/* Must be called with the cache lock held */
+static int x509_certificate_hash(struct x509_certificate *cert)
+{
+	if (cert->hash_set)
+		return 0;
+	if (sha256_vector(1, &cert->cert_start, &cert->cert_len,
+			  cert->hash) < 0)
+		return -1;
+	cert->hash_set = 1;
+	return 0;
+}
+
+
+/* Must be called with the cache lock held */
+static struct x509_sig_cache_entry *
+x509_sig_cache_get(struct x509_certificate *issuer,
+		   struct x509_certificate *cert, struct os_time *now)
+{
+	struct x509_sig_cache_entry *entry;
+
+	dl_list_for_each(entry, &x509_sig_cache, struct x509_sig_cache_entry,
+			 list) {
+		if (os_memcmp(entry->cert_hash, cert->hash,
+			      SHA256_MAC_LEN) != 0 ||
+		    os_memcmp(entry->issuer_hash, issuer->hash,
+			      SHA256_MAC_LEN) != 0)
+			continue;
+		if ((unsigned long) now->sec > (unsigned long) entry->expire) {
+			dl_list_del(&entry->list);
+			os_free(entry);
+			x509_sig_cache_count--;
+			return NULL;
+		}
+		/* Move to the head to keep the list in LRU order */
+		dl_list_del(&entry->list);
+		dl_list_add(&x509_sig_cache, &entry->list);
+		return entry;
+	}
+
+	return NULL;
+}
+
+
+static void x509_sig_cache_add(struct x509_certificate *issuer,
+			       struct x509_certificate *cert,
+			       struct os_time *now)
+{
+	struct x509_sig_cache_entry *entry, *last;
+
+	/*
+	 * Do not keep the result beyond the validity period of either
+	 * certificate. Expired certificates are not cached at all.
+	 */
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return;
+	entry->expire = cert->not_after;
+	if ((unsigned long) issuer->not_after < (unsigned long) entry->expire)
+		entry->expire = issuer->not_after;
+	if ((unsigned long) now->sec > (unsigned long) entry->expire) {
+		os_free(entry);
+		return;
+	}
+	os_memcpy(entry->issuer_hash, issuer->hash, SHA256_MAC_LEN);
+	os_memcpy(entry->cert_hash, cert->hash, SHA256_MAC_LEN);
+
+	x509_sig_cache_lock();
+	if (x509_sig_cache_get(issuer, cert, now)) {
+		/* Another thread added the same result meanwhile */
+		x509_sig_cache_unlock();
+		os_free(entry);
+		return;
+	}
+	if (x509_sig_cache_count >= X509_SIG_CACHE_SIZE) {
+		last = dl_list_last(&x509_sig_cache,
+				    struct x509_sig_cache_entry, list);
+		dl_list_del(&last->list);
+		os_free(last);
+		x509_sig_cache_count--;
+	}
+	dl_list_add(&x509_sig_cache, &entry->list);
+	x509_sig_cache_count++;
+	x509_sig_cache_unlock();
+}
+
+
 /**
  * x509_certificate_check_signature - Verify certificate signature
  * @issuer: Issuer certificate
@@ -1726,9 +1848,83 @@ struct x509_certificate * x509_certificate_parse(const u8 *buf, size_t len)
 int x509_certificate_check_signature(struct x509_certificate *issuer,
 				     struct x509_certificate *cert)
 {
-	return x509_check_signature(issuer, &cert->signature,
-				    cert->sign_value, cert->sign_value_len,
-				    cert->tbs_cert_start, cert->tbs_cert_len);
+	struct x509_sig_cache_entry *entry;
+	struct os_time now;
+	int cacheable;
+
+	os_get_time(&now);
+	x509_sig_cache_lock();
+	cacheable = x509_certificate_hash(issuer) == 0 &&
+		x509_certificate_hash(cert) == 0;
+	if (cacheable)
+		entry = x509_sig_cache_get(issuer, cert, &now);
+	else
+		entry = NULL;
+	x509_sig_cache_unlock();
+	if (entry) {
+		wpa_printf(MSG_DEBUG,
+			   "X509: Certificate signature already verified (cached)");
+		return 0;
+	}
+
+	if (x509_check_signature(issuer, &cert->signature,
+				 cert->sign_value, cert->sign_value_len,
+				 cert->tbs_cert_start, cert->tbs_cert_len) < 0)
+		return -1;
+
+	if (cacheable)
+		x509_sig_cache_add(issuer, cert, &now);
+
+	return 0;
+}
+
+
+/**
+ * x509_certificate_cache_remove - Drop cached signature results for a cert
+ * @cert: Certificate that is no longer to be trusted (e.g., revoked)
+ *
+ * All cached signature verification results where the certificate appears
+ * either as the issuer or the subject are removed.
+ */
+void x509_certificate_cache_remove(struct x509_certificate *cert)
+{
+	struct x509_sig_cache_entry *entry, *prev;
+
+	x509_sig_cache_lock();
+	if (x509_certificate_hash(cert) < 0) {
+		x509_sig_cache_unlock();
+		return;
+	}
+	dl_list_for_each_safe(entry, prev, &x509_sig_cache,
+			      struct x509_sig_cache_entry, list) {
+		if (os_memcmp(entry->cert_hash, cert->hash,
+			      SHA256_MAC_LEN) == 0 ||
+		    os_memcmp(entry->issuer_hash, cert->hash,
+			      SHA256_MAC_LEN) == 0) {
+			dl_list_del(&entry->list);
+			os_free(entry);
+			x509_sig_cache_count--;
+		}
+	}
+	x509_sig_cache_unlock();
+}
+
+
+/**
+ * x509_certificate_cache_flush - Flush the signature verification cache
+ */
+void x509_certificate_cache_flush(void)
+{
+	struct x509_sig_cache_entry *entry, *prev;
+
+	x509_sig_cache_lock();
+	dl_list_for_each_safe(entry, prev, &x509_sig_cache,
+			      struct x509_sig_cache_entry, list) {
+		dl_list_del(&entry->list);
+		os_free(entry);
+	}
+	x509_sig_cache_count = 0;
+	x509_sig_cache_unlock();
 }
 
 
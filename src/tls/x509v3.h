@@ -106,6 +106,10 @@ struct x509_certificate {
 	size_t cert_len;
 	const u8 *tbs_cert_start;
 	size_t tbs_cert_len;
+	/* SHA-256 hash of the DER encoding; computed on first use (not a
+	 * bitfield since it is updated under the signature cache lock) */
+	u8 hash[32];
+	int hash_set;
 
 	/* Meta data used for certificate validation */
 	unsigned int ocsp_good:1;
@@ -141,6 +145,8 @@ int x509_check_signature(struct x509_certificate *issuer,
 			 const u8 *signed_data, size_t signed_data_len);
 int x509_certificate_check_signature(struct x509_certificate *issuer,
 				     struct x509_certificate *cert);
+void x509_certificate_cache_remove(struct x509_certificate *cert);
+void x509_certificate_cache_flush(void);
 int x509_certificate_chain_validate(struct x509_certificate *trusted,
 				    struct x509_certificate *chain,
 				    int *reason, int disable_time_checks);
@@ -39,6 +39,10 @@
 #include <sys/event.h>
 #endif /* CONFIG_ELOOP_KQUEUE */
 
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+#define ELOOP_TIMEOUT_HASH_SIZE 256
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
 struct eloop_sock {
 	int sock;
 	void *eloop_data;
@@ -50,7 +54,15 @@ struct eloop_sock {
 };
 
 struct eloop_timeout {
+	/*
+	 * Sorted timeout list entry or, with CONFIG_ELOOP_TIMEOUT_HEAP,
+	 * handler/context hash bucket entry
+	 */
 	struct dl_list list;
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	size_t heap_idx; /* position in eloop.timeout_heap */
+	unsigned int seq; /* registration order for equal expiration times */
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	struct os_reltime time;
 	void *eloop_data;
 	void *user_data;
@@ -102,7 +114,17 @@ struct eloop_data {
 	struct eloop_sock_table writers;
 	struct eloop_sock_table exceptions;
 
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	/* binary min-heap of timeouts ordered by (time, seq) */
+	struct eloop_timeout **timeout_heap;
+	size_t timeout_count;
+	size_t timeout_heap_size;
+	unsigned int timeout_seq;
+	/* index on (handler, eloop_data, user_data) for cancel lookups */
+	struct dl_list timeout_hash[ELOOP_TIMEOUT_HASH_SIZE];
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	struct dl_list timeout;
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 
 	int signal_count;
 	struct eloop_signal *signals;
@@ -160,8 +182,17 @@ static void eloop_trace_sock_remove_ref(struct eloop_sock_table *table)
 
 int eloop_init(void)
 {
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	int i;
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
 	os_memset(&eloop, 0, sizeof(eloop));
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	for (i = 0; i < ELOOP_TIMEOUT_HASH_SIZE; i++)
+		dl_list_init(&eloop.timeout_hash[i]);
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	dl_list_init(&eloop.timeout);
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 #ifdef CONFIG_ELOOP_EPOLL
 	eloop.epollfd = epoll_create1(0);
 	if (eloop.epollfd < 0) {
@@ -759,11 +790,202 @@ void eloop_unregister_sock(int sock, eloop_event_type type)
 }
 
 
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+
+static unsigned int eloop_timeout_hash(eloop_timeout_handler handler,
+				       void *eloop_data, void *user_data)
+{
+	unsigned long h;
+
+	h = (unsigned long) handler ^ ((unsigned long) eloop_data * 31) ^
+		((unsigned long) user_data * 131);
+	h ^= (h >> 4) ^ (h >> 12) ^ (h >> 20);
+
+	return h % ELOOP_TIMEOUT_HASH_SIZE;
+}
+
+
+static int eloop_timeout_before(struct eloop_timeout *a,
+				struct eloop_timeout *b)
+{
+	if (os_reltime_before(&a->time, &b->time))
+		return 1;
+	if (os_reltime_before(&b->time, &a->time))
+		return 0;
+	/* Equal expiration time - maintain registration order */
+	return (int) (a->seq - b->seq) < 0;
+}
+
+
+static void eloop_timeout_heap_set(size_t idx, struct eloop_timeout *timeout)
+{
+	eloop.timeout_heap[idx] = timeout;
+	timeout->heap_idx = idx;
+}
+
+
+static void eloop_timeout_heap_up(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!eloop_timeout_before(timeout, eloop.timeout_heap[parent]))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[parent]);
+		idx = parent;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static void eloop_timeout_heap_down(size_t idx)
+{
+	struct eloop_timeout *timeout = eloop.timeout_heap[idx];
+
+	for (;;) {
+		size_t child = 2 * idx + 1;
+
+		if (child >= eloop.timeout_count)
+			break;
+		if (child + 1 < eloop.timeout_count &&
+		    eloop_timeout_before(eloop.timeout_heap[child + 1],
+					 eloop.timeout_heap[child]))
+			child++;
+		if (!eloop_timeout_before(eloop.timeout_heap[child], timeout))
+			break;
+		eloop_timeout_heap_set(idx, eloop.timeout_heap[child]);
+		idx = child;
+	}
+	eloop_timeout_heap_set(idx, timeout);
+}
+
+
+static struct eloop_timeout * eloop_timeout_first(void)
+{
+	return eloop.timeout_count ? eloop.timeout_heap[0] : NULL;
+}
+
+
+static int eloop_timeout_insert(struct eloop_timeout *timeout)
+{
+	unsigned int hash;
+
+	if (eloop.timeout_count == eloop.timeout_heap_size) {
+		struct eloop_timeout **n;
+		size_t size = eloop.timeout_heap_size ?
+			2 * eloop.timeout_heap_size : 16;
+
+		n = os_realloc_array(eloop.timeout_heap, size, sizeof(*n));
+		if (n == NULL)
+			return -1;
+		eloop.timeout_heap = n;
+		eloop.timeout_heap_size = size;
+	}
+
+	timeout->seq = eloop.timeout_seq++;
+	eloop_timeout_heap_set(eloop.timeout_count++, timeout);
+	eloop_timeout_heap_up(timeout->heap_idx);
+
+	hash = eloop_timeout_hash(timeout->handler, timeout->eloop_data,
+				  timeout->user_data);
+	dl_list_add(&eloop.timeout_hash[hash], &timeout->list);
+
+	return 0;
+}
+
+
+static void eloop_timeout_unlink(struct eloop_timeout *timeout)
+{
+	size_t idx = timeout->heap_idx;
+	struct eloop_timeout *last;
+
+	dl_list_del(&timeout->list);
+	last = eloop.timeout_heap[--eloop.timeout_count];
+	if (last != timeout) {
+		eloop_timeout_heap_set(idx, last);
+		eloop_timeout_heap_up(idx);
+		eloop_timeout_heap_down(last->heap_idx);
+	}
+}
+
+
+static struct eloop_timeout *
+eloop_timeout_find(eloop_timeout_handler handler, void *eloop_data,
+		   void *user_data)
+{
+	struct eloop_timeout *tmp, *found = NULL;
+	unsigned int hash;
+
+	hash = eloop_timeout_hash(handler, eloop_data, user_data);
+	dl_list_for_each(tmp, &eloop.timeout_hash[hash], struct eloop_timeout,
+			 list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data &&
+		    (!found || eloop_timeout_before(tmp, found)))
+			found = tmp;
+	}
+
+	return found;
+}
+
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
+static struct eloop_timeout * eloop_timeout_first(void)
+{
+	return dl_list_first(&eloop.timeout, struct eloop_timeout, list);
+}
+
+
+static int eloop_timeout_insert(struct eloop_timeout *timeout)
+{
+	struct eloop_timeout *tmp;
+
+	/* Maintain timeouts in order of increasing time */
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (os_reltime_before(&timeout->time, &tmp->time)) {
+			dl_list_add(tmp->list.prev, &timeout->list);
+			return 0;
+		}
+	}
+	dl_list_add_tail(&eloop.timeout, &timeout->list);
+
+	return 0;
+}
+
+
+static void eloop_timeout_unlink(struct eloop_timeout *timeout)
+{
+	dl_list_del(&timeout->list);
+}
+
+
+static struct eloop_timeout *
+eloop_timeout_find(eloop_timeout_handler handler, void *eloop_data,
+		   void *user_data)
+{
+	struct eloop_timeout *tmp;
+
+	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
+		if (tmp->handler == handler &&
+		    tmp->eloop_data == eloop_data &&
+		    tmp->user_data == user_data)
+			return tmp;
+	}
+
+	return NULL;
+}
+
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
+
+
 int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 			   eloop_timeout_handler handler,
 			   void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *timeout, *tmp;
+	struct eloop_timeout *timeout;
 	os_time_t now_sec;
 
 	timeout = os_zalloc(sizeof(*timeout));
@@ -793,26 +1015,23 @@ int eloop_register_timeout(unsigned int secs, unsigned int usecs,
 	timeout->eloop_data = eloop_data;
 	timeout->user_data = user_data;
 	timeout->handler = handler;
+
+	if (eloop_timeout_insert(timeout) < 0) {
+		os_free(timeout);
+		return -1;
+	}
+
 	wpa_trace_add_ref(timeout, eloop, eloop_data);
 	wpa_trace_add_ref(timeout, user, user_data);
 	wpa_trace_record(timeout);
 
-	/* Maintain timeouts in order of increasing time */
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (os_reltime_before(&timeout->time, &tmp->time)) {
-			dl_list_add(tmp->list.prev, &timeout->list);
-			return 0;
-		}
-	}
-	dl_list_add_tail(&eloop.timeout, &timeout->list);
-
 	return 0;
 }
 
 
 static void eloop_remove_timeout(struct eloop_timeout *timeout)
 {
-	dl_list_del(&timeout->list);
+	eloop_timeout_unlink(timeout);
 	wpa_trace_remove_ref(timeout, eloop, timeout->eloop_data);
 	wpa_trace_remove_ref(timeout, user, timeout->user_data);
 	os_free(timeout);
@@ -824,7 +1043,52 @@ int eloop_cancel_timeout(eloop_timeout_handler handler,
 {
 	struct eloop_timeout *timeout, *prev;
 	int removed = 0;
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	size_t i, count;
+
+	if (eloop_data != ELOOP_ALL_CTX && user_data != ELOOP_ALL_CTX) {
+		unsigned int hash;
+
+		hash = eloop_timeout_hash(handler, eloop_data, user_data);
+		dl_list_for_each_safe(timeout, prev, &eloop.timeout_hash[hash],
+				      struct eloop_timeout, list) {
+			if (timeout->handler == handler &&
+			    timeout->eloop_data == eloop_data &&
+			    timeout->user_data == user_data) {
+				eloop_remove_timeout(timeout);
+				removed++;
+			}
+		}
+		return removed;
+	}
 
+	/*
+	 * Wildcard context cannot use the hash index. Compact the heap array
+	 * in a single pass and restore the heap property afterwards instead of
+	 * removing entries one by one.
+	 */
+	count = 0;
+	for (i = 0; i < eloop.timeout_count; i++) {
+		timeout = eloop.timeout_heap[i];
+		if (timeout->handler == handler &&
+		    (timeout->eloop_data == eloop_data ||
+		     eloop_data == ELOOP_ALL_CTX) &&
+		    (timeout->user_data == user_data ||
+		     user_data == ELOOP_ALL_CTX)) {
+			dl_list_del(&timeout->list);
+			wpa_trace_remove_ref(timeout, eloop,
+					     timeout->eloop_data);
+			wpa_trace_remove_ref(timeout, user, timeout->user_data);
+			os_free(timeout);
+			removed++;
+		} else {
+			eloop_timeout_heap_set(count++, timeout);
+		}
+	}
+	eloop.timeout_count = count;
+	for (i = count / 2; i > 0; i--)
+		eloop_timeout_heap_down(i - 1);
+#else /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
 			      struct eloop_timeout, list) {
 		if (timeout->handler == handler &&
@@ -836,6 +1100,7 @@ int eloop_cancel_timeout(eloop_timeout_handler handler,
 			removed++;
 		}
 	}
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 
 	return removed;
 }
@@ -845,42 +1110,28 @@ int eloop_cancel_timeout_one(eloop_timeout_handler handler,
 			     void *eloop_data, void *user_data,
 			     struct os_reltime *remaining)
 {
-	struct eloop_timeout *timeout, *prev;
-	int removed = 0;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
 	remaining->sec = remaining->usec = 0;
 
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
-		if (timeout->handler == handler &&
-		    (timeout->eloop_data == eloop_data) &&
-		    (timeout->user_data == user_data)) {
-			removed = 1;
-			if (os_reltime_before(&now, &timeout->time))
-				os_reltime_sub(&timeout->time, &now, remaining);
-			eloop_remove_timeout(timeout);
-			break;
-		}
-	}
-	return removed;
+	timeout = eloop_timeout_find(handler, eloop_data, user_data);
+	if (timeout == NULL)
+		return 0;
+
+	if (os_reltime_before(&now, &timeout->time))
+		os_reltime_sub(&timeout->time, &now, remaining);
+	eloop_remove_timeout(timeout);
+
+	return 1;
 }
 
 
 int eloop_is_timeout_registered(eloop_timeout_handler handler,
 				void *eloop_data, void *user_data)
 {
-	struct eloop_timeout *tmp;
-
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data)
-			return 1;
-	}
-
-	return 0;
+	return eloop_timeout_find(handler, eloop_data, user_data) != NULL;
 }
 
 
@@ -891,28 +1142,22 @@ int eloop_deplete_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&requested, &remaining)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
+	tmp = eloop_timeout_find(handler, eloop_data, user_data);
+	if (tmp == NULL)
+		return -1;
+
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&requested, &remaining)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
 	}
 
-	return -1;
+	return 0;
 }
 
 
@@ -923,28 +1168,22 @@ int eloop_replenish_timeout(unsigned int req_secs, unsigned int req_usecs,
 	struct os_reltime now, requested, remaining;
 	struct eloop_timeout *tmp;
 
-	dl_list_for_each(tmp, &eloop.timeout, struct eloop_timeout, list) {
-		if (tmp->handler == handler &&
-		    tmp->eloop_data == eloop_data &&
-		    tmp->user_data == user_data) {
-			requested.sec = req_secs;
-			requested.usec = req_usecs;
-			os_get_reltime(&now);
-			os_reltime_sub(&tmp->time, &now, &remaining);
-			if (os_reltime_before(&remaining, &requested)) {
-				eloop_cancel_timeout(handler, eloop_data,
-						     user_data);
-				eloop_register_timeout(requested.sec,
-						       requested.usec,
-						       handler, eloop_data,
-						       user_data);
-				return 1;
-			}
-			return 0;
-		}
+	tmp = eloop_timeout_find(handler, eloop_data, user_data);
+	if (tmp == NULL)
+		return -1;
+
+	requested.sec = req_secs;
+	requested.usec = req_usecs;
+	os_get_reltime(&now);
+	os_reltime_sub(&tmp->time, &now, &remaining);
+	if (os_reltime_before(&remaining, &requested)) {
+		eloop_cancel_timeout(handler, eloop_data, user_data);
+		eloop_register_timeout(requested.sec, requested.usec,
+				       handler, eloop_data, user_data);
+		return 1;
 	}
 
-	return -1;
+	return 0;
 }
 
 
@@ -1081,7 +1320,7 @@ void eloop_run(void)
 #endif /* CONFIG_ELOOP_SELECT */
 
 	while (!eloop.terminate &&
-	       (!dl_list_empty(&eloop.timeout) || eloop.readers.count > 0 ||
+	       (eloop_timeout_first() || eloop.readers.count > 0 ||
 		eloop.writers.count > 0 || eloop.exceptions.count > 0)) {
 		struct eloop_timeout *timeout;
 
@@ -1098,8 +1337,7 @@ void eloop_run(void)
 				break;
 		}
 
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_timeout_first();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (os_reltime_before(&now, &timeout->time))
@@ -1178,8 +1416,7 @@ void eloop_run(void)
 
 
 		/* check if some registered timeouts have occurred */
-		timeout = dl_list_first(&eloop.timeout, struct eloop_timeout,
-					list);
+		timeout = eloop_timeout_first();
 		if (timeout) {
 			os_get_reltime(&now);
 			if (!os_reltime_before(&now, &timeout->time)) {
@@ -1246,12 +1483,11 @@ void eloop_terminate(void)
 
 void eloop_destroy(void)
 {
-	struct eloop_timeout *timeout, *prev;
+	struct eloop_timeout *timeout;
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	dl_list_for_each_safe(timeout, prev, &eloop.timeout,
-			      struct eloop_timeout, list) {
+	while ((timeout = eloop_timeout_first())) {
 		int sec, usec;
 		sec = timeout->time.sec - now.sec;
 		usec = timeout->time.usec - now.usec;
@@ -1268,6 +1504,9 @@ void eloop_destroy(void)
 		wpa_trace_dump("eloop timeout", timeout);
 		eloop_remove_timeout(timeout);
 	}
+#ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+	os_free(eloop.timeout_heap);
+#endif /* CONFIG_ELOOP_TIMEOUT_HEAP */
 	eloop_sock_table_destroy(&eloop.readers);
 	eloop_sock_table_destroy(&eloop.writers);
 	eloop_sock_table_destroy(&eloop.exceptions);
@@ -125,7 +125,7 @@ int os_get_reltime(struct os_reltime *t)
 int os_mktime(int year, int month, int day, int hour, int min, int sec,
 	      os_time_t *t)
 {
-	struct tm tm, *tm1;
+	struct tm tm, tm_buf, *tm1;
 	time_t t_local, t1, t2;
 	os_time_t tz_offset;
 
@@ -145,10 +145,10 @@ int os_mktime(int year, int month, int day, int hour, int min, int sec,
 	t_local = mktime(&tm);
 
 	/* figure out offset to UTC */
-	tm1 = localtime(&t_local);
+	tm1 = localtime_r(&t_local, &tm_buf);
 	if (tm1) {
 		t1 = mktime(tm1);
-		tm1 = gmtime(&t_local);
+		tm1 = gmtime_r(&t_local, &tm_buf);
 		if (tm1) {
 			t2 = mktime(tm1);
 			tz_offset = t2 - t1;
@@ -164,10 +164,10 @@ int os_mktime(int year, int month, int day, int hour, int min, int sec,
 
 int os_gmtime(os_time_t t, struct os_tm *tm)
 {
-	struct tm *tm2;
+	struct tm tm_buf, *tm2;
 	time_t t2 = t;
 
-	tm2 = gmtime(&t2);
+	tm2 = gmtime_r(&t2, &tm_buf);
 	if (tm2 == NULL)
 		return -1;
 	tm->sec = tm2->tm_sec;
@@ -824,8 +824,84 @@ static void eloop_tests_run(void *eloop_data, void *user_ctx)
 }
 
 
+static void eloop_test_never(void *eloop_data, void *user_ctx)
+{
+	wpa_printf(MSG_ERROR, "%s: FAIL - should not have called this function",
+		   __func__);
+}
+
+
+static int eloop_timeout_tests(void)
+{
+	int errors = 0;
+	int i;
+	u8 ctx[100];
+	struct os_reltime remaining;
+
+	wpa_printf(MSG_INFO, "eloop timeout tests");
+
+	for (i = 0; i < (int) sizeof(ctx); i++) {
+		if (eloop_register_timeout(1000 + i % 10, 0, eloop_test_never,
+					   ctx, &ctx[i]) < 0)
+			errors++;
+	}
+	if (eloop_register_timeout(2000, 0, eloop_test_never, ctx, &ctx[0]) < 0)
+		errors++;
+
+	for (i = 0; i < (int) sizeof(ctx); i++) {
+		if (!eloop_is_timeout_registered(eloop_test_never, ctx,
+						 &ctx[i]))
+			errors++;
+	}
+	if (eloop_is_timeout_registered(eloop_test_never, NULL, &ctx[0]) ||
+	    eloop_is_timeout_registered(eloop_test_never, ctx, NULL))
+		errors++;
+
+	/* Both entries for ctx[0] are removed */
+	if (eloop_cancel_timeout(eloop_test_never, ctx, &ctx[0]) != 2 ||
+	    eloop_is_timeout_registered(eloop_test_never, ctx, &ctx[0]))
+		errors++;
+
+	if (eloop_cancel_timeout_one(eloop_test_never, ctx, &ctx[1],
+				     &remaining) != 1 ||
+	    remaining.sec < 1000 || remaining.sec > 1001 ||
+	    eloop_cancel_timeout_one(eloop_test_never, ctx, &ctx[1],
+				     &remaining) != 0)
+		errors++;
+
+	if (eloop_deplete_timeout(10, 0, eloop_test_never, ctx, &ctx[2]) != 1 ||
+	    eloop_deplete_timeout(20, 0, eloop_test_never, ctx, &ctx[2]) != 0 ||
+	    eloop_replenish_timeout(5, 0, eloop_test_never, ctx,
+				    &ctx[2]) != 0 ||
+	    eloop_replenish_timeout(3000, 0, eloop_test_never, ctx,
+				    &ctx[2]) != 1 ||
+	    eloop_deplete_timeout(10, 0, eloop_test_never, ctx, &ctx[0]) != -1)
+		errors++;
+
+	if (eloop_cancel_timeout(eloop_test_never, ctx, ELOOP_ALL_CTX) !=
+	    (int) sizeof(ctx) - 2)
+		errors++;
+	for (i = 0; i < (int) sizeof(ctx); i++) {
+		if (eloop_is_timeout_registered(eloop_test_never, ctx,
+						&ctx[i]))
+			errors++;
+	}
+
+	if (errors) {
+		wpa_printf(MSG_ERROR, "%d eloop timeout test(s) failed",
+			   errors);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 static int eloop_tests(void)
 {
+	if (eloop_timeout_tests() < 0)
+		return -1;
+
 	wpa_printf(MSG_INFO, "schedule eloop tests to be run");
 
 	/*
@@ -6,7 +6,18 @@
  * See README for more details.
  */
 
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+/* fopencookie() is a GNU extension */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif /* _GNU_SOURCE */
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+
 #include "includes.h"
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+#include <fcntl.h>
+#include <pthread.h>
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
 
 #include "common.h"
 
@@ -61,6 +72,284 @@ static int wpa_to_android_level(int level)
 static FILE *out_file = NULL;
 #endif /* CONFIG_DEBUG_FILE */
 
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+/*
+ * With CONFIG_DEBUG_FILE_ASYNC, out_file is a line buffered stdio stream that
+ * appends each line to a ring buffer and a background thread writes the ring
+ * buffer to the log file. This keeps file system latency out of the calling
+ * thread. If the writer falls behind, lines that do not fit in the ring buffer
+ * are dropped and the number of dropped lines is noted in the log. Only whole
+ * lines are dropped; the rest of a line that was already partially added
+ * waits for space in the ring buffer.
+ *
+ * The writer thread does not exist in a child process after fork(), so the
+ * child writes its output synchronously until the writer is restarted with
+ * wpa_debug_start_file_writer() (after daemonizing).
+ */
+
+#ifndef WPA_DEBUG_RING_SIZE
+#define WPA_DEBUG_RING_SIZE (256 * 1024) /* must be a power of two */
+#endif /* WPA_DEBUG_RING_SIZE */
+
+static struct wpa_debug_ring {
+	pthread_mutex_t lock;
+	pthread_cond_t cond; /* data added or stop requested */
+	pthread_cond_t drained; /* data written */
+	pthread_t thread;
+	char *buf;
+	size_t head; /* total number of octets added */
+	size_t tail; /* total number of octets written */
+	unsigned int dropped;
+	int fd;
+	int running;
+	int stop;
+	int partial; /* last added output did not end a line */
+	int discard; /* dropping the rest of a line */
+} debug_ring;
+
+
+static void wpa_debug_write_fd(int fd, const char *buf, size_t len)
+{
+	ssize_t res;
+
+	while (len) {
+		res = write(fd, buf, len);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			break; /* nothing useful can be done with the error */
+		buf += res;
+		len -= res;
+	}
+}
+
+
+static void * wpa_debug_ring_thread(void *arg)
+{
+	struct wpa_debug_ring *ring = arg;
+	size_t pos, len;
+	unsigned int dropped;
+	char note[80];
+
+	pthread_mutex_lock(&ring->lock);
+	for (;;) {
+		while (ring->head == ring->tail && !ring->dropped &&
+		       !ring->stop)
+			pthread_cond_wait(&ring->cond, &ring->lock);
+		if (ring->head == ring->tail && !ring->dropped)
+			break;
+
+		while (ring->head != ring->tail) {
+			pos = ring->tail & (WPA_DEBUG_RING_SIZE - 1);
+			len = WPA_DEBUG_RING_SIZE - pos;
+			if (len > ring->head - ring->tail)
+				len = ring->head - ring->tail;
+			/* Only this thread moves tail, so the data stays */
+			pthread_mutex_unlock(&ring->lock);
+			wpa_debug_write_fd(ring->fd, ring->buf + pos, len);
+			pthread_mutex_lock(&ring->lock);
+			ring->tail += len;
+		}
+
+		dropped = ring->dropped;
+		if (dropped) {
+			pthread_mutex_unlock(&ring->lock);
+			len = os_snprintf(note, sizeof(note),
+					  "wpa_debug: %u log lines dropped\n",
+					  dropped);
+			wpa_debug_write_fd(ring->fd, note, len);
+			pthread_mutex_lock(&ring->lock);
+			ring->dropped -= dropped;
+		}
+		pthread_cond_broadcast(&ring->drained);
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	return NULL;
+}
+
+
+static ssize_t wpa_debug_ring_write(void *cookie, const char *buf, size_t len)
+{
+	struct wpa_debug_ring *ring = cookie;
+	int eol = len > 0 && buf[len - 1] == '\n';
+	size_t pos, part, space, left = len;
+
+	pthread_mutex_lock(&ring->lock);
+	if (!ring->running) {
+		/* No writer thread in a child process after fork() */
+		pthread_mutex_unlock(&ring->lock);
+		wpa_debug_write_fd(ring->fd, buf, len);
+		return len;
+	}
+
+	/* The writer thread sleeps only when there is nothing to do */
+	if (ring->head == ring->tail && !ring->dropped)
+		pthread_cond_signal(&ring->cond);
+
+	if (ring->discard) {
+		ring->discard = !eol;
+	} else if (!ring->partial &&
+		   len > WPA_DEBUG_RING_SIZE - (ring->head - ring->tail)) {
+		/* Drop the whole line, including the rest of it if stdio
+		 * passes it in multiple parts */
+		ring->dropped++;
+		ring->discard = !eol;
+	} else {
+		while (left) {
+			space = WPA_DEBUG_RING_SIZE - (ring->head - ring->tail);
+			if (space == 0) {
+				/* Do not break a line that was already
+				 * started; wait for the writer instead */
+				pthread_cond_wait(&ring->drained, &ring->lock);
+				continue;
+			}
+			if (space > left)
+				space = left;
+			pos = ring->head & (WPA_DEBUG_RING_SIZE - 1);
+			part = WPA_DEBUG_RING_SIZE - pos;
+			if (part > space)
+				part = space;
+			os_memcpy(ring->buf + pos, buf, part);
+			os_memcpy(ring->buf, buf + part, space - part);
+			ring->head += space;
+			buf += space;
+			left -= space;
+		}
+		ring->partial = !eol;
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	/* Dropped lines are reported as written to keep the stream usable */
+	return len;
+}
+
+
+static int wpa_debug_ring_start(struct wpa_debug_ring *ring)
+{
+	ring->stop = 0;
+	if (pthread_create(&ring->thread, NULL, wpa_debug_ring_thread,
+			   ring) != 0)
+		return -1;
+	ring->running = 1;
+	return 0;
+}
+
+
+static void wpa_debug_ring_prefork(void)
+{
+	if (debug_ring.buf)
+		pthread_mutex_lock(&debug_ring.lock);
+}
+
+
+static void wpa_debug_ring_postfork_parent(void)
+{
+	if (debug_ring.buf)
+		pthread_mutex_unlock(&debug_ring.lock);
+}
+
+
+static void wpa_debug_ring_postfork_child(void)
+{
+	static const pthread_mutex_t lock_init = PTHREAD_MUTEX_INITIALIZER;
+	static const pthread_cond_t cond_init = PTHREAD_COND_INITIALIZER;
+
+	/*
+	 * Only async-signal-safe operations are allowed here, so the
+	 * synchronization objects (the lock is held since
+	 * wpa_debug_ring_prefork()) are reset with plain stores. The lines
+	 * still in the ring buffer are written by the parent process, so
+	 * discard them here to avoid duplicates in the log.
+	 */
+	if (debug_ring.buf) {
+		debug_ring.lock = lock_init;
+		debug_ring.cond = cond_init;
+		debug_ring.drained = cond_init;
+		debug_ring.tail = debug_ring.head;
+		debug_ring.dropped = 0;
+		debug_ring.partial = 0;
+		debug_ring.discard = 0;
+		debug_ring.running = 0;
+	}
+}
+
+
+static FILE * wpa_debug_ring_open(int fd)
+{
+	static int atfork_registered = 0;
+	struct wpa_debug_ring *ring = &debug_ring;
+	cookie_io_functions_t funcs;
+	FILE *f;
+
+	os_memset(&funcs, 0, sizeof(funcs));
+	funcs.write = wpa_debug_ring_write;
+
+	if (!atfork_registered) {
+		if (pthread_atfork(wpa_debug_ring_prefork,
+				   wpa_debug_ring_postfork_parent,
+				   wpa_debug_ring_postfork_child) != 0)
+			return NULL;
+		atfork_registered = 1;
+	}
+
+	ring->buf = os_malloc(WPA_DEBUG_RING_SIZE);
+	if (ring->buf == NULL)
+		return NULL;
+	ring->head = ring->tail = 0;
+	ring->dropped = 0;
+	ring->partial = ring->discard = 0;
+	ring->fd = fd;
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+	pthread_cond_init(&ring->drained, NULL);
+
+	f = fopencookie(ring, "w", funcs);
+	if (f == NULL || wpa_debug_ring_start(ring) < 0) {
+		if (f)
+			fclose(f);
+		pthread_cond_destroy(&ring->drained);
+		pthread_cond_destroy(&ring->cond);
+		pthread_mutex_destroy(&ring->lock);
+		os_free(ring->buf);
+		ring->buf = NULL;
+		return NULL;
+	}
+
+	return f;
+}
+
+
+static void wpa_debug_ring_wait(struct wpa_debug_ring *ring)
+{
+	pthread_mutex_lock(&ring->lock);
+	while (ring->head != ring->tail || ring->dropped)
+		pthread_cond_wait(&ring->drained, &ring->lock);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+
+static void wpa_debug_ring_close(struct wpa_debug_ring *ring)
+{
+	if (ring->running) {
+		pthread_mutex_lock(&ring->lock);
+		ring->stop = 1;
+		pthread_cond_signal(&ring->cond);
+		pthread_mutex_unlock(&ring->lock);
+		pthread_join(ring->thread, NULL);
+		ring->running = 0;
+	}
+
+	pthread_cond_destroy(&ring->drained);
+	pthread_cond_destroy(&ring->cond);
+	pthread_mutex_destroy(&ring->lock);
+	os_free(ring->buf);
+	ring->buf = NULL;
+	close(ring->fd);
+}
+
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+
 
 void wpa_debug_print_timestamp(void)
 {
@@ -539,6 +828,10 @@ int wpa_debug_reopen_file(void)
 int wpa_debug_open_file(const char *path)
 {
 #ifdef CONFIG_DEBUG_FILE
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	int fd;
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+
 	if (!path)
 		return 0;
 
@@ -548,7 +841,18 @@ int wpa_debug_open_file(const char *path)
 		last_path = os_strdup(path);
 	}
 
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0666);
+	if (fd >= 0) {
+		out_file = wpa_debug_ring_open(fd);
+		if (out_file == NULL)
+			out_file = fdopen(fd, "a");
+		if (out_file == NULL)
+			close(fd);
+	}
+#else /* CONFIG_DEBUG_FILE_ASYNC */
 	out_file = fopen(path, "a");
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
 	if (out_file == NULL) {
 		wpa_printf(MSG_ERROR, "wpa_debug_open_file: Failed to open "
 			   "output file, using standard output");
@@ -564,6 +868,31 @@ int wpa_debug_open_file(const char *path)
 }
 
 
+void wpa_debug_flush_file(void)
+{
+#ifdef CONFIG_DEBUG_FILE
+	if (!out_file)
+		return;
+	fflush(out_file);
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	if (debug_ring.running)
+		wpa_debug_ring_wait(&debug_ring);
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+#endif /* CONFIG_DEBUG_FILE */
+}
+
+
+void wpa_debug_start_file_writer(void)
+{
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	if (out_file && debug_ring.buf && !debug_ring.running &&
+	    wpa_debug_ring_start(&debug_ring) < 0)
+		wpa_printf(MSG_INFO,
+			   "wpa_debug: Failed to start debug file writer - write synchronously");
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+}
+
+
 void wpa_debug_close_file(void)
 {
 #ifdef CONFIG_DEBUG_FILE
@@ -571,6 +900,11 @@ void wpa_debug_close_file(void)
 		return;
 	fclose(out_file);
 	out_file = NULL;
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	/* Write out everything that is still in the ring buffer */
+	if (debug_ring.buf)
+		wpa_debug_ring_close(&debug_ring);
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
 	os_free(last_path);
 	last_path = NULL;
 #endif /* CONFIG_DEBUG_FILE */
@@ -596,6 +930,14 @@ void wpa_msg_register_cb(wpa_msg_cb_func func)
 }
 
 
+static wpa_msg_wanted_func wpa_msg_wanted_cb = NULL;
+
+void wpa_msg_register_wanted_cb(wpa_msg_wanted_func func)
+{
+	wpa_msg_wanted_cb = func;
+}
+
+
 static wpa_msg_get_ifname_func wpa_msg_ifname_cb = NULL;
 
 void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func)
@@ -604,178 +946,183 @@ void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func)
 }
 
 
+/*
+ * Most events fit in this and can be formatted without a heap allocation; the
+ * buffer is on the caller's stack, so this is safe to use from any thread.
+ */
+#define WPA_MSG_BUF_LEN 512
+
+static int wpa_msg_to_cb(void *ctx, int level, enum wpa_msg_type type)
+{
+	if (!wpa_msg_cb)
+		return 0;
+	/* Without a query function, assume the callback always wants it */
+	return !wpa_msg_wanted_cb || wpa_msg_wanted_cb(ctx, level, type);
+}
+
+
+static int wpa_msg_to_debug(int level)
+{
+#ifdef CONFIG_NO_STDOUT_DEBUG
+	return 0;
+#else /* CONFIG_NO_STDOUT_DEBUG */
+#ifdef CONFIG_DEBUG_LINUX_TRACING
+	if (wpa_debug_tracing_file)
+		return 1;
+#endif /* CONFIG_DEBUG_LINUX_TRACING */
+	return level >= wpa_debug_level;
+#endif /* CONFIG_NO_STDOUT_DEBUG */
+}
+
+
+/*
+ * Format an event into buf (WPA_MSG_BUF_LEN octets) or into an allocated
+ * buffer if it is longer. Returns the message to be freed with
+ * wpa_msg_free() or %NULL on failure.
+ */
+static char * wpa_msg_format(char *buf, int *len, const char *fmt, va_list ap)
+{
+	va_list ap2;
+	char *msg;
+	int res;
+
+	va_copy(ap2, ap);
+	res = vsnprintf(buf, WPA_MSG_BUF_LEN, fmt, ap2);
+	va_end(ap2);
+	if (res < 0)
+		return NULL;
+	*len = res;
+	if (res < WPA_MSG_BUF_LEN)
+		return buf;
+
+	msg = os_malloc(res + 1);
+	if (msg == NULL)
+		return NULL;
+	vsnprintf(msg, res + 1, fmt, ap);
+	return msg;
+}
+
+
+static void wpa_msg_free(char *msg, char *buf, int len)
+{
+	if (msg == buf)
+		os_memset(buf, 0, len);
+	else
+		bin_clear_free(msg, len + 1);
+}
+
+
+static void wpa_msg_type(void *ctx, int level, enum wpa_msg_type type,
+			 int to_debug, const char *fmt, va_list ap)
+{
+	char buf[WPA_MSG_BUF_LEN], *msg;
+	int len, to_cb;
+
+	to_cb = wpa_msg_to_cb(ctx, level, type);
+	to_debug = to_debug && wpa_msg_to_debug(level);
+	if (!to_cb && !to_debug)
+		return;
+
+	msg = wpa_msg_format(buf, &len, fmt, ap);
+	if (msg == NULL) {
+		wpa_printf(MSG_ERROR, "wpa_msg: Failed to allocate message "
+			   "buffer");
+		return;
+	}
+	if (to_debug)
+		wpa_printf(level, "%s", msg);
+	if (to_cb)
+		wpa_msg_cb(ctx, level, type, msg, len);
+	wpa_msg_free(msg, buf, len);
+}
+
+
 void wpa_msg(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
+	char buf[WPA_MSG_BUF_LEN], *msg;
+	int len, to_cb, to_debug;
 	char prefix[130];
 
+	to_cb = wpa_msg_to_cb(ctx, level, WPA_MSG_PER_INTERFACE);
+	to_debug = wpa_msg_to_debug(level);
+	if (!to_cb && !to_debug)
+		return;
+
 	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
+	msg = wpa_msg_format(buf, &len, fmt, ap);
 	va_end(ap);
-
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
+	if (msg == NULL) {
 		wpa_printf(MSG_ERROR, "wpa_msg: Failed to allocate message "
 			   "buffer");
 		return;
 	}
-	va_start(ap, fmt);
-	prefix[0] = '\0';
-	if (wpa_msg_ifname_cb) {
-		const char *ifname = wpa_msg_ifname_cb(ctx);
-		if (ifname) {
-			int res = os_snprintf(prefix, sizeof(prefix), "%s: ",
-					      ifname);
-			if (os_snprintf_error(sizeof(prefix), res))
-				prefix[0] = '\0';
+	if (to_debug) {
+		prefix[0] = '\0';
+		if (wpa_msg_ifname_cb) {
+			const char *ifname = wpa_msg_ifname_cb(ctx);
+			if (ifname) {
+				int res = os_snprintf(prefix, sizeof(prefix),
+						      "%s: ", ifname);
+				if (os_snprintf_error(sizeof(prefix), res))
+					prefix[0] = '\0';
+			}
 		}
+		wpa_printf(level, "%s%s", prefix, msg);
 	}
-	len = vsnprintf(buf, buflen, fmt, ap);
-	va_end(ap);
-	wpa_printf(level, "%s%s", prefix, buf);
-	if (wpa_msg_cb)
-		wpa_msg_cb(ctx, level, WPA_MSG_PER_INTERFACE, buf, len);
-	bin_clear_free(buf, buflen);
+	if (to_cb)
+		wpa_msg_cb(ctx, level, WPA_MSG_PER_INTERFACE, msg, len);
+	wpa_msg_free(msg, buf, len);
 }
 
 
 void wpa_msg_ctrl(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
-
-	if (!wpa_msg_cb)
-		return;
 
 	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
+	wpa_msg_type(ctx, level, WPA_MSG_PER_INTERFACE, 0, fmt, ap);
 	va_end(ap);
-
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
-		wpa_printf(MSG_ERROR, "wpa_msg_ctrl: Failed to allocate "
-			   "message buffer");
-		return;
-	}
-	va_start(ap, fmt);
-	len = vsnprintf(buf, buflen, fmt, ap);
-	va_end(ap);
-	wpa_msg_cb(ctx, level, WPA_MSG_PER_INTERFACE, buf, len);
-	bin_clear_free(buf, buflen);
 }
 
 
 void wpa_msg_global(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
 
 	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
-	va_end(ap);
-
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
-		wpa_printf(MSG_ERROR, "wpa_msg_global: Failed to allocate "
-			   "message buffer");
-		return;
-	}
-	va_start(ap, fmt);
-	len = vsnprintf(buf, buflen, fmt, ap);
+	wpa_msg_type(ctx, level, WPA_MSG_GLOBAL, 1, fmt, ap);
 	va_end(ap);
-	wpa_printf(level, "%s", buf);
-	if (wpa_msg_cb)
-		wpa_msg_cb(ctx, level, WPA_MSG_GLOBAL, buf, len);
-	bin_clear_free(buf, buflen);
 }
 
 
 void wpa_msg_global_ctrl(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
-
-	if (!wpa_msg_cb)
-		return;
 
 	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
-	va_end(ap);
-
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
-		wpa_printf(MSG_ERROR,
-			   "wpa_msg_global_ctrl: Failed to allocate message buffer");
-		return;
-	}
-	va_start(ap, fmt);
-	len = vsnprintf(buf, buflen, fmt, ap);
+	wpa_msg_type(ctx, level, WPA_MSG_GLOBAL, 0, fmt, ap);
 	va_end(ap);
-	wpa_msg_cb(ctx, level, WPA_MSG_GLOBAL, buf, len);
-	bin_clear_free(buf, buflen);
 }
 
 
 void wpa_msg_no_global(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
-
-	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
-	va_end(ap);
 
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
-		wpa_printf(MSG_ERROR, "wpa_msg_no_global: Failed to allocate "
-			   "message buffer");
-		return;
-	}
 	va_start(ap, fmt);
-	len = vsnprintf(buf, buflen, fmt, ap);
+	wpa_msg_type(ctx, level, WPA_MSG_NO_GLOBAL, 1, fmt, ap);
 	va_end(ap);
-	wpa_printf(level, "%s", buf);
-	if (wpa_msg_cb)
-		wpa_msg_cb(ctx, level, WPA_MSG_NO_GLOBAL, buf, len);
-	bin_clear_free(buf, buflen);
 }
 
 
 void wpa_msg_global_only(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
-	char *buf;
-	int buflen;
-	int len;
 
 	va_start(ap, fmt);
-	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
-	va_end(ap);
-
-	buf = os_malloc(buflen);
-	if (buf == NULL) {
-		wpa_printf(MSG_ERROR, "%s: Failed to allocate message buffer",
-			   __func__);
-		return;
-	}
-	va_start(ap, fmt);
-	len = vsnprintf(buf, buflen, fmt, ap);
+	wpa_msg_type(ctx, level, WPA_MSG_ONLY_GLOBAL, 1, fmt, ap);
 	va_end(ap);
-	wpa_printf(level, "%s", buf);
-	if (wpa_msg_cb)
-		wpa_msg_cb(ctx, level, WPA_MSG_ONLY_GLOBAL, buf, len);
-	os_free(buf);
 }
 
 #endif /* CONFIG_NO_WPA_MSG */
@@ -34,6 +34,8 @@ enum {
 #define wpa_hexdump_ascii_key(l,t,b,le) do { } while (0)
 #define wpa_debug_open_file(p) do { } while (0)
 #define wpa_debug_close_file() do { } while (0)
+#define wpa_debug_flush_file() do { } while (0)
+#define wpa_debug_start_file_writer() do { } while (0)
 #define wpa_debug_setup_stdout() do { } while (0)
 #define wpa_dbg(args...) do { } while (0)
 
@@ -49,6 +51,25 @@ int wpa_debug_reopen_file(void);
 void wpa_debug_close_file(void);
 void wpa_debug_setup_stdout(void);
 
+/**
+ * wpa_debug_flush_file - Write out buffered debug file output
+ *
+ * This returns once all debug file output so far has been written to the
+ * file, including output buffered for the asynchronous writer
+ * (CONFIG_DEBUG_FILE_ASYNC).
+ */
+void wpa_debug_flush_file(void);
+
+/**
+ * wpa_debug_start_file_writer - Restart asynchronous debug file writer
+ *
+ * The writer thread used with CONFIG_DEBUG_FILE_ASYNC does not exist in a
+ * child process after fork() and the child writes debug file output
+ * synchronously. This restarts the writer thread; it is used in the process
+ * that continues running after daemonizing.
+ */
+void wpa_debug_start_file_writer(void);
+
 /**
  * wpa_debug_printf_timestamp - Print timestamp for debug output
  *
@@ -166,6 +187,7 @@ void wpa_hexdump_ascii_key(int level, const char *title, const void *buf,
 #define wpa_msg_no_global(args...) do { } while (0)
 #define wpa_msg_global_only(args...) do { } while (0)
 #define wpa_msg_register_cb(f) do { } while (0)
+#define wpa_msg_register_wanted_cb(f) do { } while (0)
 #define wpa_msg_register_ifname_cb(f) do { } while (0)
 #else /* CONFIG_NO_WPA_MSG */
 /**
@@ -274,6 +296,21 @@ typedef void (*wpa_msg_cb_func)(void *ctx, int level, enum wpa_msg_type type,
  */
 void wpa_msg_register_cb(wpa_msg_cb_func func);
 
+typedef int (*wpa_msg_wanted_func)(void *ctx, int level,
+				   enum wpa_msg_type type);
+
+/**
+ * wpa_msg_register_wanted_cb - Register listener check for wpa_msg() messages
+ * @func: Callback function (%NULL to unregister)
+ *
+ * The callback returns whether a message with the specified level and type
+ * would be delivered anywhere by the wpa_msg_register_cb() callback. This
+ * allows messages that are not logged either to be dropped without
+ * formatting them. If no callback is registered, all messages are assumed to
+ * be wanted.
+ */
+void wpa_msg_register_wanted_cb(wpa_msg_wanted_func func);
+
 typedef const char * (*wpa_msg_get_ifname_func)(void *ctx);
 void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func);
 
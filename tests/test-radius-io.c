@@ -0,0 +1,197 @@
+/*
+ * Loopback benchmark for RADIUS batched socket I/O
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "radius/radius_io.h"
+
+#define NUM_CLIENTS 8
+#define PKTS_PER_ROUND 128
+#define NUM_ROUNDS 200
+#define PKT_LEN 100
+
+
+static unsigned int usec_since(struct os_reltime *start)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &now);
+	return now.sec * 1000000 + now.usec;
+}
+
+
+static int open_sock(struct sockaddr_in *addr)
+{
+	socklen_t addrlen = sizeof(*addr);
+	int s;
+
+	s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (s < 0) {
+		perror("socket");
+		return -1;
+	}
+
+	os_memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(s, (struct sockaddr *) addr, sizeof(*addr)) < 0 ||
+	    getsockname(s, (struct sockaddr *) addr, &addrlen) < 0) {
+		perror("bind");
+		close(s);
+		return -1;
+	}
+
+	return s;
+}
+
+
+/*
+ * Send one round of datagrams from the client sockets with
+ * radius_send_batch(). The first octet of each datagram carries a sequence
+ * number that the receiver verifies.
+ */
+static int send_round(int *clients, struct sockaddr_in *srv, size_t batch,
+		      u8 *seq, unsigned int *tx_usec)
+{
+	struct radius_tx_pkt pkts[RADIUS_IO_BATCH];
+	u8 bufs[RADIUS_IO_BATCH][PKT_LEN];
+	struct os_reltime start;
+	size_t i, j, n, sent;
+	int c;
+
+	for (i = 0; i < PKTS_PER_ROUND; i += n) {
+		c = clients[(i / batch) % NUM_CLIENTS];
+		n = PKTS_PER_ROUND - i;
+		if (n > batch)
+			n = batch;
+		for (j = 0; j < n; j++) {
+			os_memset(bufs[j], 0x55, PKT_LEN);
+			bufs[j][0] = (*seq)++;
+			pkts[j].data = bufs[j];
+			pkts[j].len = PKT_LEN;
+			pkts[j].to = (struct sockaddr *) srv;
+			pkts[j].tolen = sizeof(*srv);
+		}
+		os_get_reltime(&start);
+		sent = radius_send_batch(c, pkts, n);
+		*tx_usec += usec_since(&start);
+		if (sent != n) {
+			perror("radius_send_batch");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/* Drain one round of datagrams with radius_recv_batch() */
+static int recv_round(int s, size_t batch, u8 *seq, unsigned int *rx_usec,
+		      unsigned int *wakeups)
+{
+	struct radius_rx_pkt pkts[RADIUS_IO_BATCH];
+	static u8 bufs[RADIUS_IO_BATCH][3000];
+	struct os_reltime start;
+	size_t received = 0;
+	int i, res;
+
+	for (i = 0; i < RADIUS_IO_BATCH; i++)
+		pkts[i].buf = bufs[i];
+
+	os_get_reltime(&start);
+	while (received < PKTS_PER_ROUND) {
+		res = radius_recv_batch(s, pkts, batch, sizeof(bufs[0]));
+		if (res <= 0)
+			break;
+		(*wakeups)++;
+		for (i = 0; i < res; i++) {
+			if (pkts[i].len != PKT_LEN ||
+			    pkts[i].buf[0] != (*seq)++) {
+				printf("Unexpected datagram (len=%u)\n",
+				       (unsigned int) pkts[i].len);
+				return -1;
+			}
+		}
+		received += res;
+	}
+	*rx_usec += usec_since(&start);
+
+	if (received != PKTS_PER_ROUND) {
+		printf("Received only %u/%u datagrams\n",
+		       (unsigned int) received, PKTS_PER_ROUND);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int run(int srv, int *clients, struct sockaddr_in *srv_addr,
+	       size_t batch)
+{
+	unsigned int tx_usec = 0, rx_usec = 0, wakeups = 0, round;
+	u8 tx_seq = 0, rx_seq = 0;
+	unsigned int total = NUM_ROUNDS * PKTS_PER_ROUND;
+
+	for (round = 0; round < NUM_ROUNDS; round++) {
+		/* Sending of a round completes before it is drained, so the
+		 * receive side sees a queued burst like after a busy eloop
+		 * iteration. */
+		if (send_round(clients, srv_addr, batch, &tx_seq,
+			       &tx_usec) < 0 ||
+		    recv_round(srv, batch, &rx_seq, &rx_usec, &wakeups) < 0)
+			return -1;
+	}
+
+	if (tx_usec == 0)
+		tx_usec = 1;
+	if (rx_usec == 0)
+		rx_usec = 1;
+	printf("batch=%2u: %u datagrams, send %u usec (%u pkt/s), receive %u usec in %u calls (%u pkt/s)\n",
+	       (unsigned int) batch, total,
+	       tx_usec, (unsigned int) ((u64) total * 1000000 / tx_usec),
+	       rx_usec, wakeups,
+	       (unsigned int) ((u64) total * 1000000 / rx_usec));
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_in srv_addr, addr;
+	int clients[NUM_CLIENTS];
+	int srv, i, ret = -1;
+
+	for (i = 0; i < NUM_CLIENTS; i++)
+		clients[i] = -1;
+
+	srv = open_sock(&srv_addr);
+	if (srv < 0)
+		return -1;
+	for (i = 0; i < NUM_CLIENTS; i++) {
+		clients[i] = open_sock(&addr);
+		if (clients[i] < 0)
+			goto fail;
+	}
+
+	if (run(srv, clients, &srv_addr, 1) < 0 ||
+	    run(srv, clients, &srv_addr, RADIUS_IO_BATCH) < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	for (i = 0; i < NUM_CLIENTS; i++) {
+		if (clients[i] >= 0)
+			close(clients[i]);
+	}
+	close(srv);
+	return ret;
+}
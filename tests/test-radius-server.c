@@ -0,0 +1,563 @@
+/*
+ * EAP-TLS benchmark for the integrated RADIUS server
+ * Copyright (c) 2026, Jouni Malinen <j@w1.fi>
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A number of EAP-TLS peers authenticate concurrently against an in-process
+ * RADIUS server over loopback. The Access-Request messages are captured and
+ * the final request of each conversation is then replayed at a high rate.
+ * The server answers these from the stored reply after client, session, and
+ * duplicate lookup, i.e., the replay measures the per-packet lookup path
+ * without the TLS handshake. Complete conversations cannot be replayed as
+ * such since the server uses fresh random values in each TLS handshake.
+ *
+ * The server is configured with a number of additional client subnets to
+ * populate the client lookup structure. Completed sessions are removed ten
+ * seconds after the Access-Accept, so all handshakes need to complete within
+ * that time for the replay phase.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "crypto/tls.h"
+#include "eap_common/eap_defs.h"
+#include "eap_server/eap.h"
+#include "eap_server/eap_methods.h"
+#include "radius/radius.h"
+#include "radius/radius_server.h"
+
+#define EAP_TLS_FLAGS_LENGTH_INCLUDED 0x80
+#define EAP_TLS_FLAGS_MORE_FRAGMENTS 0x40
+#define EAP_TLS_FLAGS_START 0x20
+
+#define PEERS_PER_SOCK 256
+#define REPLAY_WINDOW 32
+#define PEER_SOCK_RCVBUF (1024 * 1024)
+
+static const char *secret = "radius";
+
+struct peer {
+	struct bench *bench;
+	char identity[32];
+	struct tls_connection *conn;
+	struct wpabuf *tls_in;
+	u8 state[16];
+	size_t state_len;
+	int sock;
+	u8 radius_id;
+	struct radius_msg *last_req;
+	int done;
+};
+
+struct bench {
+	void *server_tls;
+	void *peer_tls;
+	struct tls_connection_params peer_params;
+	struct radius_server_data *server;
+	struct peer *peers;
+	int num_peers;
+	int *socks;
+	int num_socks;
+	int num_done;
+	int failed;
+	struct os_reltime start;
+
+	/* Replay phase */
+	int replay;
+	unsigned int replay_total;
+	unsigned int replay_sent;
+	unsigned int replay_recv;
+};
+
+
+static unsigned int usec_since(struct os_reltime *start)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &now);
+	return now.sec * 1000000 + now.usec;
+}
+
+
+static int get_eap_user(void *ctx, const u8 *identity, size_t identity_len,
+			int phase2, struct eap_user *user)
+{
+	os_memset(user, 0, sizeof(*user));
+	user->methods[0].vendor = EAP_VENDOR_IETF;
+	user->methods[0].method = EAP_TYPE_TLS;
+	return 0;
+}
+
+
+static int peer_send(struct peer *p, u8 eap_id, u8 flags, const u8 *data,
+		     size_t data_len)
+{
+	struct wpabuf *eap;
+	struct radius_msg *msg;
+	struct wpabuf *buf;
+	int res = -1;
+
+	eap = wpabuf_alloc(6 + data_len);
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST, p->radius_id);
+	if (!eap || !msg)
+		goto fail;
+
+	wpabuf_put_u8(eap, EAP_CODE_RESPONSE);
+	wpabuf_put_u8(eap, eap_id);
+	wpabuf_put_be16(eap, 0); /* updated below */
+	if (p->conn) {
+		wpabuf_put_u8(eap, EAP_TYPE_TLS);
+		wpabuf_put_u8(eap, flags);
+	} else {
+		wpabuf_put_u8(eap, EAP_TYPE_IDENTITY);
+	}
+	if (data)
+		wpabuf_put_data(eap, data, data_len);
+	WPA_PUT_BE16(wpabuf_mhead_u8(eap) + 2, wpabuf_len(eap));
+
+	if (radius_msg_make_authenticator(msg) < 0 ||
+	    !radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
+				 (u8 *) p->identity,
+				 os_strlen(p->identity)) ||
+	    !radius_msg_add_eap(msg, wpabuf_head(eap), wpabuf_len(eap)) ||
+	    (p->state_len &&
+	     !radius_msg_add_attr(msg, RADIUS_ATTR_STATE, p->state,
+				  p->state_len)) ||
+	    radius_msg_finish(msg, (const u8 *) secret,
+			      os_strlen(secret)) < 0)
+		goto fail;
+
+	buf = radius_msg_get_buf(msg);
+	if (send(p->bench->socks[p->sock], wpabuf_head(buf), wpabuf_len(buf),
+		 0) < 0) {
+		perror("send");
+		goto fail;
+	}
+
+	radius_msg_free(p->last_req);
+	p->last_req = msg;
+	msg = NULL;
+	res = 0;
+fail:
+	radius_msg_free(msg);
+	wpabuf_free(eap);
+	return res;
+}
+
+
+static void peer_done(struct peer *p, int result)
+{
+	struct bench *b = p->bench;
+
+	p->done = result;
+	b->num_done++;
+	if (result < 0) {
+		printf("%s: authentication failed\n", p->identity);
+		b->failed++;
+	}
+}
+
+
+static int peer_process_tls(struct peer *p, u8 eap_id, const u8 *pos,
+			    size_t len)
+{
+	struct wpabuf *out;
+	u8 flags;
+
+	if (len < 1)
+		return -1;
+	flags = *pos++;
+	len--;
+	if (flags & EAP_TLS_FLAGS_LENGTH_INCLUDED) {
+		if (len < 4)
+			return -1;
+		pos += 4;
+		len -= 4;
+	}
+
+	if (flags & EAP_TLS_FLAGS_START) {
+		p->conn = tls_connection_init(p->bench->peer_tls);
+		if (!p->conn ||
+		    tls_connection_set_params(p->bench->peer_tls, p->conn,
+					      &p->bench->peer_params))
+			return -1;
+		out = tls_connection_handshake(p->bench->peer_tls, p->conn,
+					       NULL, NULL);
+	} else {
+		if (!p->conn ||
+		    wpabuf_resize(&p->tls_in, len) < 0)
+			return -1;
+		wpabuf_put_data(p->tls_in, pos, len);
+		if (flags & EAP_TLS_FLAGS_MORE_FRAGMENTS)
+			return peer_send(p, eap_id, 0, NULL, 0);
+		out = tls_connection_handshake(p->bench->peer_tls, p->conn,
+					       p->tls_in, NULL);
+		wpabuf_free(p->tls_in);
+		p->tls_in = NULL;
+	}
+
+	if (!out)
+		return -1;
+	if (wpabuf_len(out) == 0) {
+		/* Acknowledge the server Finished message */
+		wpabuf_free(out);
+		return peer_send(p, eap_id, 0, NULL, 0);
+	}
+
+	if (peer_send(p, eap_id, 0, wpabuf_head(out), wpabuf_len(out)) < 0) {
+		wpabuf_free(out);
+		return -1;
+	}
+	wpabuf_free(out);
+	return 0;
+}
+
+
+static int peer_rx(struct peer *p, struct radius_msg *msg)
+{
+	struct radius_hdr *hdr = radius_msg_get_hdr(msg);
+	struct wpabuf *eap;
+	const u8 *pos;
+	size_t len;
+	int res;
+
+	if (!p->last_req || p->done ||
+	    radius_msg_verify(msg, (const u8 *) secret, os_strlen(secret),
+			      p->last_req, 1)) {
+		printf("%s: unexpected RADIUS message\n", p->identity);
+		return -1;
+	}
+
+	if (hdr->code == RADIUS_CODE_ACCESS_ACCEPT) {
+		peer_done(p, 1);
+		return 0;
+	}
+	if (hdr->code != RADIUS_CODE_ACCESS_CHALLENGE)
+		return -1;
+
+	res = radius_msg_get_attr(msg, RADIUS_ATTR_STATE, p->state,
+				  sizeof(p->state));
+	if (res < 0 || (size_t) res > sizeof(p->state))
+		return -1;
+	p->state_len = res;
+
+	eap = radius_msg_get_eap(msg);
+	if (!eap || wpabuf_len(eap) < 5 ||
+	    wpabuf_head_u8(eap)[0] != EAP_CODE_REQUEST ||
+	    wpabuf_head_u8(eap)[4] != EAP_TYPE_TLS) {
+		wpabuf_free(eap);
+		return -1;
+	}
+	pos = wpabuf_head_u8(eap) + 5;
+	len = wpabuf_len(eap) - 5;
+	res = peer_process_tls(p, wpabuf_head_u8(eap)[1], pos, len);
+	wpabuf_free(eap);
+	return res;
+}
+
+
+static void replay_send(struct bench *b, int sock)
+{
+	struct peer *p;
+	struct wpabuf *buf;
+	int i;
+
+	/* Captured final requests of the peers sharing this socket in
+	 * round-robin order */
+	i = sock * PEERS_PER_SOCK + b->replay_sent % PEERS_PER_SOCK;
+	if (i >= b->num_peers)
+		i = sock * PEERS_PER_SOCK;
+	p = &b->peers[i];
+	b->replay_sent++;
+	buf = radius_msg_get_buf(p->last_req);
+	if (send(b->socks[sock], wpabuf_head(buf), wpabuf_len(buf), 0) < 0)
+		perror("send");
+}
+
+
+static void replay_start(struct bench *b)
+{
+	int i, j;
+
+	b->replay = 1;
+	os_get_reltime(&b->start);
+	for (i = 0; i < b->num_socks; i++) {
+		for (j = 0; j < REPLAY_WINDOW; j++)
+			replay_send(b, i);
+	}
+}
+
+
+static void bench_rx(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct bench *b = eloop_ctx;
+	int idx = (intptr_t) sock_ctx;
+	u8 buf[4096];
+	struct radius_msg *msg;
+	struct peer *p;
+	int len, i;
+	unsigned int usec;
+
+	len = recv(sock, buf, sizeof(buf), 0);
+	if (len < 0) {
+		perror("recv");
+		return;
+	}
+
+	if (b->replay) {
+		if (len < 1 || buf[0] != RADIUS_CODE_ACCESS_ACCEPT) {
+			printf("Unexpected reply to a replayed request\n");
+			b->failed++;
+			eloop_terminate();
+			return;
+		}
+		b->replay_recv++;
+		if (b->replay_recv == b->replay_total) {
+			usec = usec_since(&b->start);
+			if (usec == 0)
+				usec = 1;
+			printf("Replayed %u requests in %u usec (%u req/s)\n",
+			       b->replay_total, usec,
+			       (unsigned int) ((u64) b->replay_total *
+					       1000000 / usec));
+			eloop_terminate();
+		} else if (b->replay_sent < b->replay_total) {
+			replay_send(b, idx);
+		}
+		return;
+	}
+
+	msg = radius_msg_parse(buf, len);
+	if (!msg)
+		return;
+	i = idx * PEERS_PER_SOCK + radius_msg_get_hdr(msg)->identifier;
+	if (i >= b->num_peers) {
+		radius_msg_free(msg);
+		return;
+	}
+	p = &b->peers[i];
+	if (peer_rx(p, msg) < 0 && !p->done)
+		peer_done(p, -1);
+	radius_msg_free(msg);
+
+	if (b->num_done < b->num_peers)
+		return;
+
+	usec = usec_since(&b->start);
+	if (usec == 0)
+		usec = 1;
+	printf("%d EAP-TLS authentications in %u usec (%u auth/s)\n",
+	       b->num_peers, usec,
+	       (unsigned int) ((u64) b->num_peers * 1000000 / usec));
+	if (b->failed || b->replay_total == 0)
+		eloop_terminate();
+	else
+		replay_start(b);
+}
+
+
+static int write_client_file(const char *fname, int num_clients)
+{
+	FILE *f;
+	int i;
+
+	f = fopen(fname, "w");
+	if (!f)
+		return -1;
+	/* Other NAS subnets that populate the client lookup structure */
+	for (i = 0; i < num_clients; i++)
+		fprintf(f, "10.%d.%d.0/24 other%d\n",
+			(i >> 8) & 0xff, i & 0xff, i);
+	fprintf(f, "127.0.0.0/8 %s\n", secret);
+	fclose(f);
+	return 0;
+}
+
+
+static int open_socks(struct bench *b, int port)
+{
+	struct sockaddr_in addr;
+	int i, rcvbuf = PEER_SOCK_RCVBUF;
+
+	b->num_socks = (b->num_peers + PEERS_PER_SOCK - 1) / PEERS_PER_SOCK;
+	b->socks = os_calloc(b->num_socks, sizeof(int));
+	if (!b->socks)
+		return -1;
+	for (i = 0; i < b->num_socks; i++)
+		b->socks[i] = -1;
+
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	for (i = 0; i < b->num_socks; i++) {
+		b->socks[i] = socket(PF_INET, SOCK_DGRAM, 0);
+		/* There are no retransmissions, so make sure a burst of
+		 * replies to all peers on the socket is not dropped */
+		if (b->socks[i] < 0 ||
+		    setsockopt(b->socks[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+			       sizeof(rcvbuf)) < 0 ||
+		    connect(b->socks[i], (struct sockaddr *) &addr,
+			    sizeof(addr)) < 0 ||
+		    eloop_register_read_sock(b->socks[i], bench_rx, b,
+					     (void *) (intptr_t) i) < 0) {
+			perror("socket");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static void usage(void)
+{
+	printf("usage: test-radius-server [-d] [-c<clients>] [-n<peers>] "
+	       "[-p<port>] [-r<replays>] [-t<threads>]\n"
+	       "  -c = number of additional client subnets (default 4096)\n"
+	       "  -n = number of concurrent EAP-TLS peers (default 50)\n"
+	       "  -p = RADIUS server port (default 18120)\n"
+	       "  -r = number of replayed requests (default 200000)\n"
+	       "  -t = number of EAP worker threads (default 0)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct bench b;
+	struct tls_config tconf;
+	struct tls_connection_params params;
+	struct radius_server_conf conf;
+	const char *client_file = "/tmp/test-radius-server.clients";
+	int num_clients = 4096, port = 18120, threads = 0;
+	int c, i, ret = -1;
+
+	os_memset(&b, 0, sizeof(b));
+	b.num_peers = 50;
+	b.replay_total = 200000;
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "c:dhn:p:r:t:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'c':
+			num_clients = atoi(optarg);
+			break;
+		case 'd':
+			wpa_debug_level = MSG_DEBUG;
+			break;
+		case 'n':
+			b.num_peers = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'r':
+			b.replay_total = atoi(optarg);
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			usage();
+			return -1;
+		}
+	}
+	if (b.num_peers <= 0 || num_clients < 0) {
+		usage();
+		return -1;
+	}
+
+	if (eloop_init() < 0 || eap_server_identity_register() < 0 ||
+	    eap_server_tls_register() < 0 ||
+	    write_client_file(client_file, num_clients) < 0)
+		return -1;
+
+	os_memset(&tconf, 0, sizeof(tconf));
+	b.server_tls = tls_init(&tconf);
+	b.peer_tls = tls_init(NULL);
+	if (!b.server_tls || !b.peer_tls)
+		goto fail;
+	os_memset(&params, 0, sizeof(params));
+	params.ca_cert = "auth_serv/ca.pem";
+	params.client_cert = "auth_serv/server.pem";
+	params.private_key = "auth_serv/server.key";
+	params.dh_file = "auth_serv/dh.conf";
+	if (tls_global_set_params(b.server_tls, &params)) {
+		printf("Failed to load server credentials\n");
+		goto fail;
+	}
+
+	os_memset(&conf, 0, sizeof(conf));
+	conf.auth_port = port;
+	conf.client_file = (char *) client_file;
+	conf.conf_ctx = &b;
+	conf.ssl_ctx = b.server_tls;
+	conf.server_id = "test-radius-server";
+	conf.max_sessions = b.num_peers;
+	conf.eap_threads = threads;
+	conf.get_eap_user = get_eap_user;
+	b.server = radius_server_init(&conf);
+	if (!b.server) {
+		printf("Failed to initialize RADIUS server\n");
+		goto fail;
+	}
+
+	b.peers = os_calloc(b.num_peers, sizeof(struct peer));
+	if (!b.peers || open_socks(&b, port) < 0)
+		goto fail;
+
+	b.peer_params.ca_cert = "auth_serv/ca.pem";
+	b.peer_params.client_cert = "auth_serv/user.pem";
+	b.peer_params.private_key = "auth_serv/user.key";
+
+	os_get_reltime(&b.start);
+	for (i = 0; i < b.num_peers; i++) {
+		struct peer *p = &b.peers[i];
+
+		p->bench = &b;
+		os_snprintf(p->identity, sizeof(p->identity), "peer%d", i);
+		p->sock = i / PEERS_PER_SOCK;
+		p->radius_id = i % PEERS_PER_SOCK;
+		if (peer_send(p, 0, 0, (u8 *) p->identity,
+			      os_strlen(p->identity)) < 0)
+			goto fail;
+	}
+	eloop_run();
+	if (!b.failed && b.num_done == b.num_peers &&
+	    (b.replay_total == 0 || b.replay_recv == b.replay_total))
+		ret = 0;
+
+fail:
+	if (ret)
+		printf("FAIL\n");
+	for (i = 0; b.peers && i < b.num_peers; i++) {
+		radius_msg_free(b.peers[i].last_req);
+		wpabuf_free(b.peers[i].tls_in);
+		tls_connection_deinit(b.peer_tls, b.peers[i].conn);
+	}
+	os_free(b.peers);
+	for (i = 0; b.socks && i < b.num_socks; i++) {
+		if (b.socks[i] >= 0) {
+			eloop_unregister_read_sock(b.socks[i]);
+			close(b.socks[i]);
+		}
+	}
+	os_free(b.socks);
+	radius_server_deinit(b.server);
+	if (b.peer_tls)
+		tls_deinit(b.peer_tls);
+	if (b.server_tls)
+		tls_deinit(b.server_tls);
+	eap_server_unregister_methods();
+	eloop_destroy();
+	unlink(client_file);
+	return ret;
+}
@@ -149,6 +149,10 @@ ifdef CONFIG_ELOOP_EPOLL
 L_CFLAGS += -DCONFIG_ELOOP_EPOLL
 endif
 
+ifdef CONFIG_ELOOP_TIMEOUT_HEAP
+L_CFLAGS += -DCONFIG_ELOOP_TIMEOUT_HEAP
+endif
+
 ifdef CONFIG_EAPOL_TEST
 L_CFLAGS += -Werror -DEAPOL_TEST
 endif
@@ -236,6 +240,10 @@ L_CFLAGS += -DCONFIG_SAE
 OBJS += src/common/sae.c
 NEED_ECC=y
 NEED_DH_GROUPS=y
+ifdef CONFIG_SAE_THREADS
+L_CFLAGS += -DCONFIG_SAE_THREADS -DCONFIG_RANDOM_THREADS
+L_CFLAGS += -DCONFIG_CRYPTO_THREADS
+endif
 endif
 
 ifdef CONFIG_WNM
@@ -845,6 +853,9 @@ OBJS += src/ap/ap_list.c
 OBJS += src/ap/ieee802_11.c
 OBJS += src/ap/hw_features.c
 OBJS += src/ap/dfs.c
+ifdef CONFIG_SAE
+OBJS += src/ap/sae_pool.c
+endif
 L_CFLAGS += -DNEED_AP_MLME
 endif
 ifdef CONFIG_WPS
@@ -1108,8 +1119,12 @@ endif
 
 AESOBJS = # none so far (see below)
 ifdef CONFIG_INTERNAL_AES
+L_CFLAGS += -DCONFIG_INTERNAL_AES
 AESOBJS += src/crypto/aes-internal.c src/crypto/aes-internal-dec.c
 endif
+ifdef CONFIG_NO_AES_NI
+L_CFLAGS += -DCONFIG_NO_AES_NI
+endif
 
 ifneq ($(CONFIG_TLS), openssl)
 NEED_INTERNAL_AES_WRAP=y
@@ -1177,6 +1192,7 @@ SHA1OBJS += src/crypto/sha1.c
 endif
 SHA1OBJS += src/crypto/sha1-prf.c
 ifdef CONFIG_INTERNAL_SHA1
+L_CFLAGS += -DCONFIG_INTERNAL_SHA1
 SHA1OBJS += src/crypto/sha1-internal.c
 ifdef NEED_FIPS186_2_PRF
 SHA1OBJS += src/crypto/fips_prf_internal.c
@@ -1188,6 +1204,10 @@ else
 ifneq ($(CONFIG_TLS), openssl)
 SHA1OBJS += src/crypto/sha1-pbkdf2.c
 endif
+SHA1OBJS += src/crypto/pbkdf2_batch.c
+ifdef CONFIG_PBKDF2_THREADS
+L_CFLAGS += -DCONFIG_PBKDF2_THREADS
+endif
 endif
 ifdef NEED_T_PRF
 SHA1OBJS += src/crypto/sha1-tprf.c
@@ -1270,6 +1290,12 @@ endif
 
 ifdef NEED_DH_GROUPS
 OBJS += src/crypto/dh_groups.c
+ifeq ($(CONFIG_CRYPTO), internal)
+ifdef NEED_MODEXP
+# Cache Montgomery context and generator comb table per DH group
+L_CFLAGS += -DCONFIG_DH_PRECOMP
+endif
+endif
 endif
 ifdef NEED_DH_GROUPS_ALL
 L_CFLAGS += -DALL_DH_GROUPS
@@ -1430,6 +1456,9 @@ endif
 
 ifdef CONFIG_DEBUG_FILE
 L_CFLAGS += -DCONFIG_DEBUG_FILE
+ifdef CONFIG_DEBUG_FILE_ASYNC
+L_CFLAGS += -DCONFIG_DEBUG_FILE_ASYNC
+endif
 endif
 
 ifdef CONFIG_DELAYED_MIC_ERROR_REPORT
@@ -1508,6 +1537,7 @@ OBJS += wpa_supplicant.c events.c blacklist.c wpas_glue.c scan.c
 OBJS_t := $(OBJS) $(OBJS_l2) eapol_test.c
 OBJS_t += src/radius/radius_client.c
 OBJS_t += src/radius/radius.c
+OBJS_t += src/radius/radius_io.c
 ifndef CONFIG_AP
 OBJS_t += src/utils/ip_addr.c
 endif
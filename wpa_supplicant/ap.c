@@ -21,6 +21,7 @@
 #include "ap/ap_drv_ops.h"
 #ifdef NEED_AP_MLME
 #include "ap/ieee802_11.h"
+#include "ap/sae_pool.h"
 #endif /* NEED_AP_MLME */
 #include "ap/beacon.h"
 #include "ap/ieee802_1x.h"
@@ -340,6 +341,9 @@ static int wpa_supplicant_conf_ap(struct wpa_supplicant *wpa_s,
 	else if (wpa_s->conf->beacon_int)
 		conf->beacon_int = wpa_s->conf->beacon_int;
 
+	bss->sae_threads = wpa_s->conf->ap_sae_threads;
+	bss->probe_req_coalesce_ms = wpa_s->conf->ap_probe_req_coalesce;
+
 #ifdef CONFIG_P2P
 	if (ssid->mode == WPAS_MODE_P2P_GO ||
 	    ssid->mode == WPAS_MODE_P2P_GROUP_FORMATION) {
@@ -1136,6 +1140,29 @@ int ap_ctrl_iface_sta_first(struct wpa_supplicant *wpa_s,
 }
 
 
+int ap_ctrl_iface_sae_stats(struct wpa_supplicant *wpa_s,
+			    char *buf, size_t buflen)
+{
+#if defined(CONFIG_SAE) && defined(NEED_AP_MLME)
+	if (!wpa_s->ap_iface)
+		return -1;
+	return sae_pool_stats(wpa_s->ap_iface->bss[0]->sae_pool, buf, buflen);
+#else /* CONFIG_SAE && NEED_AP_MLME */
+	return -1;
+#endif /* CONFIG_SAE && NEED_AP_MLME */
+}
+
+
+int ap_ctrl_iface_probe_req_stats(struct wpa_supplicant *wpa_s,
+				  char *buf, size_t buflen)
+{
+	if (!wpa_s->ap_iface)
+		return -1;
+	return hostapd_ctrl_iface_probe_req_stats(wpa_s->ap_iface->bss[0],
+						  buf, buflen);
+}
+
+
 int ap_ctrl_iface_sta(struct wpa_supplicant *wpa_s, const char *txtaddr,
 		      char *buf, size_t buflen)
 {
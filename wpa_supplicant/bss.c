@@ -29,6 +29,7 @@
 #define WPA_BSS_WPS_CHANGED_FLAG	BIT(6)
 #define WPA_BSS_RATES_CHANGED_FLAG	BIT(7)
 #define WPA_BSS_IES_CHANGED_FLAG	BIT(8)
+#define WPA_BSS_SEEN_FLAG		BIT(9)
 
 
 static void wpa_bss_set_hessid(struct wpa_bss *bss)
@@ -47,6 +48,145 @@ static void wpa_bss_set_hessid(struct wpa_bss *bss)
 }
 
 
+static void wpa_bss_set_p2p_dev_addr(struct wpa_bss *bss)
+{
+#ifdef CONFIG_P2P
+	if (p2p_parse_dev_addr((const u8 *) (bss + 1), bss->ie_len,
+			       bss->p2p_dev_addr) < 0)
+		os_memset(bss->p2p_dev_addr, 0, ETH_ALEN);
+#endif /* CONFIG_P2P */
+}
+
+
+/* Vendor specific element types that have their own element index entry */
+static const u32 wpa_bss_ie_index_vendor[] = {
+	WPA_IE_VENDOR_TYPE, WMM_IE_VENDOR_TYPE, WPS_IE_VENDOR_TYPE,
+	P2P_IE_VENDOR_TYPE, WFD_IE_VENDOR_TYPE, HS20_IE_VENDOR_TYPE,
+	OSEN_IE_VENDOR_TYPE, MBO_IE_VENDOR_TYPE
+};
+
+/*
+ * Element index for the Probe Response IEs of a BSS entry: offset plus one to
+ * the first element of each Element ID and each known vendor specific element
+ * type or 0 if no such element is present.
+ */
+struct wpa_bss_ie_index {
+	u16 eid[256];
+	u16 vendor[ARRAY_SIZE(wpa_bss_ie_index_vendor)];
+};
+
+
+static void wpa_bss_ie_index_free(struct wpa_bss *bss)
+{
+	os_free(bss->ie_index);
+	bss->ie_index = NULL;
+}
+
+
+static int wpa_bss_ie_index_vendor_idx(u32 vendor_type)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(wpa_bss_ie_index_vendor); i++) {
+		if (wpa_bss_ie_index_vendor[i] == vendor_type)
+			return i;
+	}
+
+	return -1;
+}
+
+
+/*
+ * The element index is built on the first lookup and dropped whenever the IEs
+ * of the entry are replaced. It is only a cache of the IE buffer, so it is
+ * updated through the const pointers used by the IE lookup functions.
+ */
+static const struct wpa_bss_ie_index *
+wpa_bss_get_ie_index(const struct wpa_bss *bss)
+{
+	struct wpa_bss_ie_index *idx;
+	const u8 *start, *pos, *end;
+	int i;
+
+	if (bss->ie_index)
+		return bss->ie_index;
+	if (bss->ie_len >= 0xffff)
+		return NULL;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+
+	start = pos = (const u8 *) (bss + 1);
+	end = pos + bss->ie_len;
+	while (end - pos > 1) {
+		if (2 + pos[1] > end - pos)
+			break;
+		if (!idx->eid[pos[0]])
+			idx->eid[pos[0]] = pos - start + 1;
+		if (pos[0] == WLAN_EID_VENDOR_SPECIFIC && pos[1] >= 4) {
+			i = wpa_bss_ie_index_vendor_idx(WPA_GET_BE32(&pos[2]));
+			if (i >= 0 && !idx->vendor[i])
+				idx->vendor[i] = pos - start + 1;
+		}
+		pos += 2 + pos[1];
+	}
+
+	((struct wpa_bss *) bss)->ie_index = idx;
+	return idx;
+}
+
+
+/* Returns the first possible location of a vendor element or %NULL if none */
+static const u8 * wpa_bss_vendor_ie_start(const struct wpa_bss *bss,
+					  u32 vendor_type)
+{
+	const struct wpa_bss_ie_index *idx = wpa_bss_get_ie_index(bss);
+	const u8 *ies = (const u8 *) (bss + 1);
+	u16 offset;
+	int i;
+
+	if (!idx)
+		return ies;
+
+	i = wpa_bss_ie_index_vendor_idx(vendor_type);
+	if (i >= 0)
+		offset = idx->vendor[i];
+	else
+		offset = idx->eid[WLAN_EID_VENDOR_SPECIFIC];
+
+	return offset ? ies + offset - 1 : NULL;
+}
+
+
+static void wpa_bss_hash_add(struct wpa_supplicant *wpa_s,
+			     struct wpa_bss *bss)
+{
+	dl_list_add(&wpa_s->bss_hash[WPA_BSS_HASH(bss->bssid)],
+		    &bss->list_hash);
+	dl_list_add(&wpa_s->bss_id_hash[bss->id % WPA_BSS_HASH_SIZE],
+		    &bss->list_id_hash);
+#ifdef CONFIG_P2P
+	if (!is_zero_ether_addr(bss->p2p_dev_addr)) {
+		unsigned int hash = WPA_BSS_HASH(bss->p2p_dev_addr);
+
+		dl_list_add(&wpa_s->bss_p2p_hash[hash], &bss->list_p2p_hash);
+	}
+#endif /* CONFIG_P2P */
+}
+
+
+static void wpa_bss_hash_del(struct wpa_bss *bss)
+{
+	dl_list_del(&bss->list_hash);
+	dl_list_del(&bss->list_id_hash);
+#ifdef CONFIG_P2P
+	if (!is_zero_ether_addr(bss->p2p_dev_addr))
+		dl_list_del(&bss->list_p2p_hash);
+#endif /* CONFIG_P2P */
+}
+
+
 /**
  * wpa_bss_anqp_alloc - Allocate ANQP data structure for a BSS entry
  * Returns: Allocated ANQP data structure or %NULL on failure
@@ -233,12 +373,14 @@ void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_update_pending_connect(wpa_s, bss, NULL);
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	wpa_bss_hash_del(bss);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
 		wpa_ssid_txt(bss->ssid, bss->ssid_len), reason);
 	wpas_notify_bss_removed(wpa_s, bss->bssid, bss->id);
 	wpa_bss_anqp_free(bss->anqp);
+	os_free(bss->ie_index);
 	os_free(bss);
 }
 
@@ -257,7 +399,8 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_hash[WPA_BSS_HASH(bssid)],
+			 struct wpa_bss, list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
 		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
@@ -285,6 +428,19 @@ static void calculate_update_time(const struct os_reltime *fetch_time,
 }
 
 
+static int wpa_bss_ies_unchanged(const struct wpa_bss *bss,
+				 const struct wpa_scan_res *res)
+{
+	/*
+	 * Only the Probe Response IEs are compared. The Beacon IEs include
+	 * TIM that changes in practically every Beacon frame and they are not
+	 * used for the change notifications or the element index.
+	 */
+	return bss->ie_len == res->ie_len &&
+		os_memcmp(bss + 1, res + 1, res->ie_len) == 0;
+}
+
+
 static void wpa_bss_copy_res(struct wpa_bss *dst, struct wpa_scan_res *src,
 			     struct os_reltime *fetch_time)
 {
@@ -438,6 +594,7 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 	bss->beacon_ie_len = res->beacon_ie_len;
 	os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
 	wpa_bss_set_hessid(bss);
+	wpa_bss_set_p2p_dev_addr(bss);
 
 	if (wpa_s->num_bss + 1 > wpa_s->conf->bss_max_count &&
 	    wpa_bss_remove_oldest(wpa_s) != 0) {
@@ -449,6 +606,7 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	wpa_bss_hash_add(wpa_s, bss);
 	wpa_s->num_bss++;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Add new id %u BSSID " MACSTR
 		" SSID '%s' freq %d",
@@ -516,7 +674,8 @@ static int are_ies_equal(const struct wpa_bss *old,
 
 
 static u32 wpa_bss_compare_res(const struct wpa_bss *old,
-			       const struct wpa_scan_res *new_res)
+			       const struct wpa_scan_res *new_res,
+			       int ies_unchanged)
 {
 	u32 changes = 0;
 	int caps_diff = old->caps ^ new_res->caps;
@@ -533,8 +692,9 @@ static u32 wpa_bss_compare_res(const struct wpa_bss *old,
 	if (caps_diff & IEEE80211_CAP_IBSS)
 		changes |= WPA_BSS_MODE_CHANGED_FLAG;
 
-	if (old->ie_len == new_res->ie_len &&
-	    os_memcmp(old + 1, new_res + 1, old->ie_len) == 0)
+	if (ies_unchanged ||
+	    (old->ie_len == new_res->ie_len &&
+	     os_memcmp(old + 1, new_res + 1, old->ie_len) == 0))
 		return changes;
 	changes |= WPA_BSS_IES_CHANGED_FLAG;
 
@@ -585,7 +745,8 @@ static void notify_bss_changes(struct wpa_supplicant *wpa_s, u32 changes,
 	if (changes & WPA_BSS_RATES_CHANGED_FLAG)
 		wpas_notify_bss_rates_changed(wpa_s, bss->id);
 
-	wpas_notify_bss_seen(wpa_s, bss->id);
+	if (changes & WPA_BSS_SEEN_FLAG)
+		wpas_notify_bss_seen(wpa_s, bss->id);
 }
 
 
@@ -594,16 +755,29 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	       struct wpa_scan_res *res, struct os_reltime *fetch_time)
 {
 	u32 changes;
+	int ies_unchanged;
 
-	changes = wpa_bss_compare_res(bss, res);
+	/*
+	 * Most BSSes advertise the same IEs in consecutive scans, so skip IE
+	 * comparison, copying, and parsing in that common case.
+	 */
+	ies_unchanged = wpa_bss_ies_unchanged(bss, res);
+	changes = wpa_bss_compare_res(bss, res, ies_unchanged);
 	if (changes & WPA_BSS_FREQ_CHANGED_FLAG)
 		wpa_printf(MSG_DEBUG, "BSS: " MACSTR " changed freq %d --> %d",
 			   MAC2STR(bss->bssid), bss->freq, res->freq);
 	bss->scan_miss_count = 0;
 	bss->last_update_idx = wpa_s->bss_update_idx;
 	wpa_bss_copy_res(bss, res, fetch_time);
-	/* Move the entry to the end of the list */
+	/* Move the entry to the end of the list and the head of hash lists */
 	dl_list_del(&bss->list);
+	wpa_bss_hash_del(bss);
+	if (ies_unchanged && bss->beacon_ie_len == res->beacon_ie_len) {
+		/* Only the Beacon IEs need to be refreshed; keep the index */
+		os_memcpy((u8 *) (bss + 1) + bss->ie_len,
+			  (const u8 *) (res + 1) + res->ie_len,
+			  res->beacon_ie_len);
+	} else
 #ifdef CONFIG_P2P
 	if (wpa_bss_get_vendor_ie(bss, P2P_IE_VENDOR_TYPE) &&
 	    !wpa_scan_get_vendor_ie(res, P2P_IE_VENDOR_TYPE)) {
@@ -625,6 +799,7 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 		os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
 		bss->ie_len = res->ie_len;
 		bss->beacon_ie_len = res->beacon_ie_len;
+		wpa_bss_ie_index_free(bss);
 	} else {
 		struct wpa_bss *nbss;
 		struct dl_list *prev = bss->list_id.prev;
@@ -647,14 +822,26 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 				  res->ie_len + res->beacon_ie_len);
 			bss->ie_len = res->ie_len;
 			bss->beacon_ie_len = res->beacon_ie_len;
+			wpa_bss_ie_index_free(bss);
 		}
 		dl_list_add(prev, &bss->list_id);
 	}
-	if (changes & WPA_BSS_IES_CHANGED_FLAG)
+	if (changes & WPA_BSS_IES_CHANGED_FLAG) {
 		wpa_bss_set_hessid(bss);
+		wpa_bss_set_p2p_dev_addr(bss);
+	}
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
+	wpa_bss_hash_add(wpa_s, bss);
 
-	notify_bss_changes(wpa_s, changes, bss);
+	/*
+	 * Report the changes once per BSS at the end of the scan result
+	 * update round instead of for each update.
+	 */
+	bss->pending_changes |= changes | WPA_BSS_SEEN_FLAG;
+	if (!wpa_s->bss_update_in_progress) {
+		notify_bss_changes(wpa_s, bss->pending_changes, bss);
+		bss->pending_changes = 0;
+	}
 
 	return bss;
 }
@@ -675,6 +862,7 @@ void wpa_bss_update_start(struct wpa_supplicant *wpa_s)
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Start scan result update %u",
 		wpa_s->bss_update_idx);
 	wpa_s->last_scan_res_used = 0;
+	wpa_s->bss_update_in_progress = 1;
 }
 
 
@@ -834,13 +1022,22 @@ static int wpa_bss_included_in_scan(const struct wpa_bss *bss,
  *
  * This function is called at the end of each BSS table update round for new
  * scan results. The start of the update was indicated with a call to
- * wpa_bss_update_start().
+ * wpa_bss_update_start(). Change notifications for the BSS entries that were
+ * updated during the round are delivered from here.
  */
 void wpa_bss_update_end(struct wpa_supplicant *wpa_s, struct scan_info *info,
 			int new_scan)
 {
 	struct wpa_bss *bss, *n;
 
+	wpa_s->bss_update_in_progress = 0;
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (bss->pending_changes) {
+			notify_bss_changes(wpa_s, bss->pending_changes, bss);
+			bss->pending_changes = 0;
+		}
+	}
+
 	os_get_reltime(&wpa_s->last_scan);
 	if ((info && info->aborted) || !new_scan)
 		return; /* do not expire entries without new scan */
@@ -903,8 +1100,17 @@ void wpa_bss_flush_by_age(struct wpa_supplicant *wpa_s, int age)
  */
 int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
+	unsigned int i;
+
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
+	for (i = 0; i < WPA_BSS_HASH_SIZE; i++) {
+		dl_list_init(&wpa_s->bss_hash[i]);
+		dl_list_init(&wpa_s->bss_id_hash[i]);
+#ifdef CONFIG_P2P
+		dl_list_init(&wpa_s->bss_p2p_hash[i]);
+#endif /* CONFIG_P2P */
+	}
 	return 0;
 }
 
@@ -952,7 +1158,8 @@ struct wpa_bss * wpa_bss_get_bssid(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_hash[WPA_BSS_HASH(bssid)],
+			 struct wpa_bss, list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0)
 			return bss;
 	}
@@ -977,7 +1184,8 @@ struct wpa_bss * wpa_bss_get_bssid_latest(struct wpa_supplicant *wpa_s,
 	struct wpa_bss *bss, *found = NULL;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_hash[WPA_BSS_HASH(bssid)],
+			 struct wpa_bss, list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) != 0)
 			continue;
 		if (found == NULL ||
@@ -999,11 +1207,9 @@ struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 					  const u8 *dev_addr)
 {
 	struct wpa_bss *bss;
-	dl_list_for_each_reverse(bss, &wpa_s->bss, struct wpa_bss, list) {
-		u8 addr[ETH_ALEN];
-		if (p2p_parse_dev_addr((const u8 *) (bss + 1), bss->ie_len,
-				       addr) == 0 &&
-		    os_memcmp(addr, dev_addr, ETH_ALEN) == 0)
+	dl_list_for_each(bss, &wpa_s->bss_p2p_hash[WPA_BSS_HASH(dev_addr)],
+			 struct wpa_bss, list_p2p_hash) {
+		if (os_memcmp(bss->p2p_dev_addr, dev_addr, ETH_ALEN) == 0)
 			return bss;
 	}
 	return NULL;
@@ -1020,7 +1226,8 @@ struct wpa_bss * wpa_bss_get_p2p_dev_addr(struct wpa_supplicant *wpa_s,
 struct wpa_bss * wpa_bss_get_id(struct wpa_supplicant *wpa_s, unsigned int id)
 {
 	struct wpa_bss *bss;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_id_hash[id % WPA_BSS_HASH_SIZE],
+			 struct wpa_bss, list_id_hash) {
 		if (bss->id == id)
 			return bss;
 	}
@@ -1062,7 +1269,13 @@ struct wpa_bss * wpa_bss_get_id_range(struct wpa_supplicant *wpa_s,
  */
 const u8 * wpa_bss_get_ie(const struct wpa_bss *bss, u8 ie)
 {
-	return get_ie((const u8 *) (bss + 1), bss->ie_len, ie);
+	const struct wpa_bss_ie_index *idx = wpa_bss_get_ie_index(bss);
+
+	if (!idx)
+		return get_ie((const u8 *) (bss + 1), bss->ie_len, ie);
+	if (!idx->eid[ie])
+		return NULL;
+	return (const u8 *) (bss + 1) + idx->eid[ie] - 1;
 }
 
 
@@ -1079,8 +1292,10 @@ const u8 * wpa_bss_get_vendor_ie(const struct wpa_bss *bss, u32 vendor_type)
 {
 	const u8 *end, *pos;
 
-	pos = (const u8 *) (bss + 1);
-	end = pos + bss->ie_len;
+	pos = wpa_bss_vendor_ie_start(bss, vendor_type);
+	if (!pos)
+		return NULL;
+	end = (const u8 *) (bss + 1) + bss->ie_len;
 
 	while (end - pos > 1) {
 		if (2 + pos[1] > end - pos)
@@ -1148,13 +1363,15 @@ struct wpabuf * wpa_bss_get_vendor_ie_multi(const struct wpa_bss *bss,
 	struct wpabuf *buf;
 	const u8 *end, *pos;
 
+	pos = wpa_bss_vendor_ie_start(bss, vendor_type);
+	if (!pos)
+		return NULL;
+	end = (const u8 *) (bss + 1) + bss->ie_len;
+
 	buf = wpabuf_alloc(bss->ie_len);
 	if (buf == NULL)
 		return NULL;
 
-	pos = (const u8 *) (bss + 1);
-	end = pos + bss->ie_len;
-
 	while (end - pos > 1) {
 		if (2 + pos[1] > end - pos)
 			break;
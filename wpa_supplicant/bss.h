@@ -52,6 +52,8 @@ struct wpa_bss_anqp {
 #endif /* CONFIG_HS20 */
 };
 
+struct wpa_bss_ie_index;
+
 /**
  * struct wpa_bss - BSS table
  *
@@ -63,6 +65,16 @@ struct wpa_bss {
 	struct dl_list list;
 	/** List entry for struct wpa_supplicant::bss_id */
 	struct dl_list list_id;
+	/** Hash list entry for struct wpa_supplicant::bss_hash (BSSID) */
+	struct dl_list list_hash;
+	/** Hash list entry for struct wpa_supplicant::bss_id_hash */
+	struct dl_list list_id_hash;
+#ifdef CONFIG_P2P
+	/** Hash list entry for struct wpa_supplicant::bss_p2p_hash */
+	struct dl_list list_p2p_hash;
+	/** P2P Device Address of the GO or all zeros if not a P2P GO */
+	u8 p2p_dev_addr[ETH_ALEN];
+#endif /* CONFIG_P2P */
 	/** Unique identifier for this BSS entry */
 	unsigned int id;
 	/** Number of counts without seeing this BSS */
@@ -101,6 +113,10 @@ struct wpa_bss {
 	int snr;
 	/** ANQP data */
 	struct wpa_bss_anqp *anqp;
+	/** Pending change notifications (reported at the end of scan update) */
+	u32 pending_changes;
+	/** Lazily built element index for the Probe Response IEs or %NULL */
+	struct wpa_bss_ie_index *ie_index;
 	/** Length of the following IE field in octets (from Probe Response) */
 	size_t ie_len;
 	/** Length of the following Beacon IE field in octets */
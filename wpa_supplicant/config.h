@@ -947,6 +947,16 @@ struct wpa_config {
 	 */
 	char *ext_password_backend;
 
+	/**
+	 * psk_cache_file - Cache file for PSKs derived from passphrases
+	 *
+	 * If set, PSKs derived from network block passphrases when reading
+	 * the configuration file are stored in this file and reused on the
+	 * following reads instead of running PBKDF2 again. The file contains
+	 * key material and needs to be protected like the configuration file.
+	 */
+	char *psk_cache_file;
+
 	/*
 	 * p2p_go_max_inactivity - Timeout in seconds to detect STA inactivity
 	 *
@@ -1070,6 +1080,29 @@ struct wpa_config {
 	 */
 	int beacon_int;
 
+	/**
+	 * ap_sae_threads - Number of worker threads for SAE in AP mode
+	 *
+	 * When built with CONFIG_SAE_THREADS, the PWE and shared secret for
+	 * SAE Commit messages from new stations are computed in this many
+	 * worker threads instead of the main event loop. 0 (default) means
+	 * the computation is done inline. The worker pool is shared by all
+	 * AP mode interfaces in the process.
+	 */
+	int ap_sae_threads;
+
+	/**
+	 * ap_probe_req_coalesce - Probe Request coalescing window in AP mode
+	 *
+	 * Probe Request frames from the same STA with the same elements that
+	 * are received within this many milliseconds from the previous one are
+	 * answered (or ignored) based on the result for the first frame
+	 * without processing them again. Other frames from a STA are fully
+	 * processed at most eight times in a burst and then once per window.
+	 * 0 (default) disables this.
+	 */
+	int ap_probe_req_coalesce;
+
 	/**
 	 * ap_vendor_elements: Vendor specific elements for Beacon/ProbeResp
 	 *
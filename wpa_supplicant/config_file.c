@@ -22,6 +22,7 @@
 #include "p2p/p2p.h"
 #include "eap_peer/eap_methods.h"
 #include "eap_peer/eap.h"
+#include "crypto/pbkdf2_batch.h"
 
 
 static int newline_terminated(const char *buf, size_t buflen)
@@ -127,13 +128,11 @@ static int wpa_config_validate_network(struct wpa_ssid *ssid, int line)
 {
 	int errors = 0;
 
-	if (ssid->passphrase) {
-		if (ssid->psk_set) {
-			wpa_printf(MSG_ERROR, "Line %d: both PSK and "
-				   "passphrase configured.", line);
-			errors++;
-		}
-		wpa_config_update_psk(ssid);
+	/* PSK is derived from passphrase in wpa_config_derive_psks() */
+	if (ssid->passphrase && ssid->psk_set) {
+		wpa_printf(MSG_ERROR, "Line %d: both PSK and passphrase "
+			   "configured.", line);
+		errors++;
 	}
 
 	if ((ssid->group_cipher & WPA_CIPHER_CCMP) &&
@@ -359,12 +358,52 @@ static int wpa_config_process_blob(struct wpa_config *config, FILE *f,
 #endif /* CONFIG_NO_CONFIG_BLOBS */
 
 
+static int wpa_config_derive_psks(struct wpa_config *config,
+				  struct wpa_ssid *first)
+{
+#ifndef CONFIG_NO_PBKDF2
+	struct pbkdf2_batch *batch;
+	struct wpa_ssid *ssid;
+	int ret = 0;
+
+	batch = pbkdf2_batch_init();
+	if (!batch)
+		return -1;
+	for (ssid = first; ssid; ssid = ssid->next) {
+		if (ssid->passphrase &&
+		    pbkdf2_batch_add(batch, ssid->passphrase, ssid->ssid,
+				     ssid->ssid_len, ssid->psk) < 0) {
+			ret = -1;
+			break;
+		}
+	}
+	if (ret == 0)
+		ret = pbkdf2_batch_run(batch, config->psk_cache_file);
+	pbkdf2_batch_free(batch);
+	if (ret < 0) {
+		wpa_printf(MSG_ERROR, "Failed to derive PSKs from passphrases");
+		return -1;
+	}
+
+	for (ssid = first; ssid; ssid = ssid->next) {
+		if (!ssid->passphrase)
+			continue;
+		wpa_hexdump_key(MSG_MSGDUMP, "PSK (from passphrase)",
+				ssid->psk, sizeof(ssid->psk));
+		ssid->psk_set = 1;
+	}
+#endif /* CONFIG_NO_PBKDF2 */
+
+	return 0;
+}
+
+
 struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 {
 	FILE *f;
 	char buf[512], *pos;
 	int errors = 0, line = 0;
-	struct wpa_ssid *ssid, *tail, *head;
+	struct wpa_ssid *ssid, *tail, *head, *prev_tail;
 	struct wpa_cred *cred, *cred_tail, *cred_head;
 	struct wpa_config *config;
 	int id = 0;
@@ -384,6 +423,7 @@ struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 	tail = head = config->ssid;
 	while (tail && tail->next)
 		tail = tail->next;
+	prev_tail = tail;
 	cred_tail = cred_head = config->cred;
 	while (cred_tail && cred_tail->next)
 		cred_tail = cred_tail->next;
@@ -453,6 +493,11 @@ struct wpa_config * wpa_config_read(const char *name, struct wpa_config *cfgp)
 
 	fclose(f);
 
+	/* Derive PSKs for all network blocks from this file in one batch */
+	if (wpa_config_derive_psks(config, prev_tail ? prev_tail->next : head) <
+	    0)
+		errors++;
+
 	config->ssid = head;
 	wpa_config_debug_dump_networks(config);
 	config->cred = cred_head;
@@ -1208,6 +1253,8 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 	if (config->ext_password_backend)
 		fprintf(f, "ext_password_backend=%s\n",
 			config->ext_password_backend);
+	if (config->psk_cache_file)
+		fprintf(f, "psk_cache_file=%s\n", config->psk_cache_file);
 	if (config->p2p_go_max_inactivity != DEFAULT_P2P_GO_MAX_INACTIVITY)
 		fprintf(f, "p2p_go_max_inactivity=%d\n",
 			config->p2p_go_max_inactivity);
@@ -1222,6 +1269,11 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 		fprintf(f, "dtim_period=%d\n", config->dtim_period);
 	if (config->beacon_int)
 		fprintf(f, "beacon_int=%d\n", config->beacon_int);
+	if (config->ap_sae_threads)
+		fprintf(f, "ap_sae_threads=%d\n", config->ap_sae_threads);
+	if (config->ap_probe_req_coalesce)
+		fprintf(f, "ap_probe_req_coalesce=%d\n",
+			config->ap_probe_req_coalesce);
 
 	if (config->sae_groups) {
 		int i;
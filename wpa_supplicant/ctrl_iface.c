@@ -9180,6 +9180,11 @@ char * wpa_supplicant_ctrl_iface_process(struct wpa_supplicant *wpa_s,
 #ifdef CONFIG_AP
 	} else if (os_strcmp(buf, "STA-FIRST") == 0) {
 		reply_len = ap_ctrl_iface_sta_first(wpa_s, reply, reply_size);
+	} else if (os_strcmp(buf, "SAE_STATS") == 0) {
+		reply_len = ap_ctrl_iface_sae_stats(wpa_s, reply, reply_size);
+	} else if (os_strcmp(buf, "PROBE_REQ_STATS") == 0) {
+		reply_len = ap_ctrl_iface_probe_req_stats(wpa_s, reply,
+							  reply_size);
 	} else if (os_strncmp(buf, "STA ", 4) == 0) {
 		reply_len = ap_ctrl_iface_sta(wpa_s, buf + 4, reply,
 					      reply_size);
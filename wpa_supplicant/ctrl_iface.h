@@ -115,6 +115,30 @@ void wpa_supplicant_global_ctrl_iface_deinit(
 
 void wpas_ctrl_radio_work_flush(struct wpa_supplicant *wpa_s);
 
+/**
+ * wpa_supplicant_ctrl_iface_bin_wanted - Check for binary event monitors
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @event: Binary event type (enum wpa_ctrl_bin_event)
+ * Returns: 1 if any attached monitor subscribed to the event, 0 if not
+ *
+ * This is used to skip building binary event messages that would not be
+ * delivered to any monitor.
+ */
+int wpa_supplicant_ctrl_iface_bin_wanted(struct wpa_supplicant *wpa_s,
+					 int event);
+
+/**
+ * wpa_supplicant_ctrl_iface_send_bin - Send a binary event message
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @event: Binary event type (enum wpa_ctrl_bin_event)
+ * @buf: Complete binary event message including the header
+ *
+ * The message is sent to the monitors on the per-interface and global control
+ * interfaces that subscribed to the event with ATTACH_BIN.
+ */
+void wpa_supplicant_ctrl_iface_send_bin(struct wpa_supplicant *wpa_s,
+					int event, const struct wpabuf *buf);
+
 #else /* CONFIG_CTRL_IFACE */
 
 static inline struct ctrl_iface_priv *
@@ -154,6 +178,18 @@ static inline void wpas_ctrl_radio_work_flush(struct wpa_supplicant *wpa_s)
 {
 }
 
+static inline int
+wpa_supplicant_ctrl_iface_bin_wanted(struct wpa_supplicant *wpa_s, int event)
+{
+	return 0;
+}
+
+static inline void
+wpa_supplicant_ctrl_iface_send_bin(struct wpa_supplicant *wpa_s, int event,
+				   const struct wpabuf *buf)
+{
+}
+
 #endif /* CONFIG_CTRL_IFACE */
 
 #endif /* CTRL_IFACE_H */
@@ -573,6 +573,20 @@ void wpa_supplicant_ctrl_iface_wait(struct ctrl_iface_priv *priv)
 }
 
 
+int wpa_supplicant_ctrl_iface_bin_wanted(struct wpa_supplicant *wpa_s,
+					 int event)
+{
+	/* Binary event monitors are supported only with UNIX domain sockets */
+	return 0;
+}
+
+
+void wpa_supplicant_ctrl_iface_send_bin(struct wpa_supplicant *wpa_s,
+					int event, const struct wpabuf *buf)
+{
+}
+
+
 /* Global ctrl_iface */
 
 static char *
@@ -23,6 +23,7 @@
 #include "utils/common.h"
 #include "utils/eloop.h"
 #include "utils/list.h"
+#include "common/wpa_ctrl.h"
 #include "common/ctrl_iface_common.h"
 #include "eapol_supp/eapol_supp_sm.h"
 #include "config.h"
@@ -67,6 +68,12 @@ static void wpa_supplicant_ctrl_iface_send(struct wpa_supplicant *wpa_s,
 					   size_t len,
 					   struct ctrl_iface_priv *priv,
 					   struct ctrl_iface_global_priv *gp);
+static void wpas_ctrl_iface_sendmsg(struct wpa_supplicant *wpa_s, int sock,
+				    struct dl_list *ctrl_dst,
+				    struct msghdr *msg, int level,
+				    int bin_event,
+				    struct ctrl_iface_priv *priv,
+				    struct ctrl_iface_global_priv *gp);
 static int wpas_ctrl_iface_reinit(struct wpa_supplicant *wpa_s,
 				  struct ctrl_iface_priv *priv);
 static int wpas_ctrl_iface_global_reinit(struct wpa_global *global,
@@ -156,6 +163,14 @@ static void wpa_supplicant_ctrl_iface_receive(int sock, void *eloop_ctx,
 			new_attached = 1;
 			reply_len = 2;
 		}
+	} else if (os_strncmp(buf, "ATTACH_BIN ", 11) == 0) {
+		if (ctrl_iface_attach_bin(&priv->ctrl_dst, &from, fromlen,
+					  buf + 11))
+			reply_len = 1;
+		else {
+			new_attached = 1;
+			reply_len = 2;
+		}
 	} else if (os_strcmp(buf, "DETACH") == 0) {
 		if (wpa_supplicant_ctrl_iface_detach(&priv->ctrl_dst, &from,
 						     fromlen))
@@ -485,6 +500,97 @@ static void wpa_supplicant_ctrl_iface_msg_cb(void *ctx, int level,
 }
 
 
+static int wpas_ctrl_iface_dst_wanted(struct dl_list *ctrl_dst, int level)
+{
+	struct wpa_ctrl_dst *dst;
+
+	dl_list_for_each(dst, ctrl_dst, struct wpa_ctrl_dst, list) {
+		if (!dst->bin_events && level >= dst->debug_level)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+static int wpa_supplicant_ctrl_iface_msg_wanted(void *ctx, int level,
+						enum wpa_msg_type type)
+{
+	struct wpa_supplicant *wpa_s = ctx;
+	struct ctrl_iface_priv *priv;
+	struct ctrl_iface_global_priv *gpriv;
+
+	if (wpa_s == NULL)
+		return 0;
+
+	gpriv = wpa_s->global->ctrl_iface;
+	if (type != WPA_MSG_NO_GLOBAL && gpriv &&
+	    wpas_ctrl_iface_dst_wanted(&gpriv->ctrl_dst, level))
+		return 1;
+
+	priv = wpa_s->ctrl_iface;
+	if (type != WPA_MSG_ONLY_GLOBAL && priv &&
+	    wpas_ctrl_iface_dst_wanted(&priv->ctrl_dst, level))
+		return 1;
+
+	return 0;
+}
+
+
+static int wpas_ctrl_iface_dst_bin_wanted(struct dl_list *ctrl_dst, int event)
+{
+	struct wpa_ctrl_dst *dst;
+
+	dl_list_for_each(dst, ctrl_dst, struct wpa_ctrl_dst, list) {
+		if (dst->bin_events & BIT(event))
+			return 1;
+	}
+
+	return 0;
+}
+
+
+int wpa_supplicant_ctrl_iface_bin_wanted(struct wpa_supplicant *wpa_s,
+					 int event)
+{
+	struct ctrl_iface_priv *priv = wpa_s->ctrl_iface;
+	struct ctrl_iface_global_priv *gpriv = wpa_s->global->ctrl_iface;
+
+	if (event < 0 || event >= WPA_CTRL_BIN_EV_MAX)
+		return 0;
+	return (gpriv && wpas_ctrl_iface_dst_bin_wanted(&gpriv->ctrl_dst,
+							 event)) ||
+		(priv && wpas_ctrl_iface_dst_bin_wanted(&priv->ctrl_dst,
+							 event));
+}
+
+
+void wpa_supplicant_ctrl_iface_send_bin(struct wpa_supplicant *wpa_s,
+					int event, const struct wpabuf *buf)
+{
+	struct ctrl_iface_priv *priv = wpa_s->ctrl_iface;
+	struct ctrl_iface_global_priv *gpriv = wpa_s->global->ctrl_iface;
+	struct msghdr msg;
+	struct iovec io;
+
+	if (event < 0 || event >= WPA_CTRL_BIN_EV_MAX)
+		return;
+
+	io.iov_base = (void *) wpabuf_head(buf);
+	io.iov_len = wpabuf_len(buf);
+	os_memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &io;
+	msg.msg_iovlen = 1;
+
+	if (gpriv && gpriv->sock >= 0)
+		wpas_ctrl_iface_sendmsg(wpa_s, gpriv->sock, &gpriv->ctrl_dst,
+					&msg, 0, event, NULL, gpriv);
+	if (priv && priv->sock >= 0)
+		wpas_ctrl_iface_sendmsg(wpa_s, priv->sock, &priv->ctrl_dst,
+					&msg, 0, event, priv, NULL);
+}
+
+
 static int wpas_ctrl_iface_open_sock(struct wpa_supplicant *wpa_s,
 				     struct ctrl_iface_priv *priv)
 {
@@ -672,6 +778,7 @@ havesock:
 	eloop_register_read_sock(priv->sock, wpa_supplicant_ctrl_iface_receive,
 				 wpa_s, priv);
 	wpa_msg_register_cb(wpa_supplicant_ctrl_iface_msg_cb);
+	wpa_msg_register_wanted_cb(wpa_supplicant_ctrl_iface_msg_wanted);
 
 	os_free(buf);
 	return 0;
@@ -891,7 +998,6 @@ static void wpa_supplicant_ctrl_iface_send(struct wpa_supplicant *wpa_s,
 					   struct ctrl_iface_priv *priv,
 					   struct ctrl_iface_global_priv *gp)
 {
-	struct wpa_ctrl_dst *dst, *next;
 	char levelstr[10];
 	int idx, res;
 	struct msghdr msg;
@@ -925,17 +1031,48 @@ static void wpa_supplicant_ctrl_iface_send(struct wpa_supplicant *wpa_s,
 	msg.msg_iov = io;
 	msg.msg_iovlen = idx;
 
+	wpas_ctrl_iface_sendmsg(wpa_s, sock, ctrl_dst, &msg, level, -1,
+				priv, gp);
+}
+
+
+/**
+ * wpas_ctrl_iface_sendmsg - Send a prepared message to matching monitors
+ * @sock: Local socket fd
+ * @ctrl_dst: List of attached listeners
+ * @msg: Message with the iovec filled in
+ * @level: Priority level of a text message
+ * @bin_event: Binary event type (enum wpa_ctrl_bin_event) or -1 for text
+ *
+ * Text messages are sent to text monitors with a suitable debug level and
+ * binary messages to the binary monitors that subscribed to the event.
+ */
+static void wpas_ctrl_iface_sendmsg(struct wpa_supplicant *wpa_s, int sock,
+				    struct dl_list *ctrl_dst,
+				    struct msghdr *msg, int level,
+				    int bin_event,
+				    struct ctrl_iface_priv *priv,
+				    struct ctrl_iface_global_priv *gp)
+{
+	struct wpa_ctrl_dst *dst, *next;
+	struct iovec *last = &msg->msg_iov[msg->msg_iovlen - 1];
+
 	dl_list_for_each_safe(dst, next, ctrl_dst, struct wpa_ctrl_dst, list) {
 		int _errno;
 		char txt[200];
 
-		if (level < dst->debug_level)
+		if (bin_event < 0) {
+			if (dst->bin_events || level < dst->debug_level)
+				continue;
+		} else if (!(dst->bin_events & BIT(bin_event))) {
 			continue;
+		}
 
-		msg.msg_name = (void *) &dst->addr;
-		msg.msg_namelen = dst->addrlen;
-		wpas_ctrl_sock_debug("ctrl_sock-sendmsg", sock, buf, len);
-		if (sendmsg(sock, &msg, MSG_DONTWAIT) >= 0) {
+		msg->msg_name = (void *) &dst->addr;
+		msg->msg_namelen = dst->addrlen;
+		wpas_ctrl_sock_debug("ctrl_sock-sendmsg", sock, last->iov_base,
+				     last->iov_len);
+		if (sendmsg(sock, msg, MSG_DONTWAIT) >= 0) {
 			sockaddr_print(MSG_MSGDUMP,
 				       "CTRL_IFACE monitor sent successfully to",
 				       &dst->addr, dst->addrlen);
@@ -1068,6 +1205,12 @@ static void wpa_supplicant_global_ctrl_iface_receive(int sock, void *eloop_ctx,
 			reply_len = 1;
 		else
 			reply_len = 2;
+	} else if (os_strncmp(buf, "ATTACH_BIN ", 11) == 0) {
+		if (ctrl_iface_attach_bin(&priv->ctrl_dst, &from, fromlen,
+					  buf + 11))
+			reply_len = 1;
+		else
+			reply_len = 2;
 	} else if (os_strcmp(buf, "DETACH") == 0) {
 		if (wpa_supplicant_ctrl_iface_detach(&priv->ctrl_dst, &from,
 						     fromlen))
@@ -1311,6 +1454,7 @@ wpa_supplicant_global_ctrl_iface_init(struct wpa_global *global)
 	}
 
 	wpa_msg_register_cb(wpa_supplicant_ctrl_iface_msg_cb);
+	wpa_msg_register_wanted_cb(wpa_supplicant_ctrl_iface_msg_wanted);
 
 	return priv;
 }
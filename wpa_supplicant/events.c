@@ -501,9 +501,50 @@ static int wpa_supplicant_match_privacy(struct wpa_bss *bss,
 }
 
 
+/*
+ * BSS information used by network selection that does not depend on the
+ * network block being matched. This is collected once per BSS so that the
+ * IEs do not need to be searched and parsed again for each configured network.
+ */
+struct wpas_sel_bss {
+	const u8 *wpa_ie;
+	const u8 *rsn_ie;
+	struct wpa_ie_data wpa;
+	struct wpa_ie_data rsn;
+	int wpa_res; /* wpa_parse_wpa_ie() result for wpa_ie */
+	int rsn_res; /* wpa_parse_wpa_ie() result for rsn_ie */
+	int osen;
+	int rate_ok; /* rate_match() result or -1 if not yet determined */
+};
+
+
+static void wpas_sel_bss_init(struct wpas_sel_bss *info, struct wpa_bss *bss)
+{
+	os_memset(info, 0, sizeof(*info));
+	info->rsn_res = -1;
+	info->wpa_res = -1;
+	info->rate_ok = -1;
+
+	info->rsn_ie = wpa_bss_get_ie(bss, WLAN_EID_RSN);
+	if (info->rsn_ie)
+		info->rsn_res = wpa_parse_wpa_ie(info->rsn_ie,
+						 2 + info->rsn_ie[1],
+						 &info->rsn);
+
+	info->wpa_ie = wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE);
+	if (info->wpa_ie)
+		info->wpa_res = wpa_parse_wpa_ie(info->wpa_ie,
+						 2 + info->wpa_ie[1],
+						 &info->wpa);
+
+	info->osen = wpa_bss_get_vendor_ie(bss, OSEN_IE_VENDOR_TYPE) != NULL;
+}
+
+
 static int wpa_supplicant_ssid_bss_match(struct wpa_supplicant *wpa_s,
 					 struct wpa_ssid *ssid,
-					 struct wpa_bss *bss)
+					 struct wpa_bss *bss,
+					 const struct wpas_sel_bss *info)
 {
 	struct wpa_ie_data ie;
 	int proto_match = 0;
@@ -521,15 +562,16 @@ static int wpa_supplicant_ssid_bss_match(struct wpa_supplicant *wpa_s,
 		  ssid->wep_key_len[ssid->wep_tx_keyidx] > 0) ||
 		 (ssid->key_mgmt & WPA_KEY_MGMT_IEEE8021X_NO_WPA));
 
-	rsn_ie = wpa_bss_get_ie(bss, WLAN_EID_RSN);
+	rsn_ie = info->rsn_ie;
 	while ((ssid->proto & WPA_PROTO_RSN) && rsn_ie) {
 		proto_match++;
 
-		if (wpa_parse_wpa_ie(rsn_ie, 2 + rsn_ie[1], &ie)) {
+		if (info->rsn_res) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "   skip RSN IE - parse "
 				"failed");
 			break;
 		}
+		ie = info->rsn;
 
 		if (wep_ok &&
 		    (ie.group_cipher & (WPA_CIPHER_WEP40 | WPA_CIPHER_WEP104)))
@@ -602,15 +644,16 @@ static int wpa_supplicant_ssid_bss_match(struct wpa_supplicant *wpa_s,
 	}
 #endif /* CONFIG_IEEE80211W */
 
-	wpa_ie = wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE);
+	wpa_ie = info->wpa_ie;
 	while ((ssid->proto & WPA_PROTO_WPA) && wpa_ie) {
 		proto_match++;
 
-		if (wpa_parse_wpa_ie(wpa_ie, 2 + wpa_ie[1], &ie)) {
+		if (info->wpa_res) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "   skip WPA IE - parse "
 				"failed");
 			break;
 		}
+		ie = info->wpa;
 
 		if (wep_ok &&
 		    (ie.group_cipher & (WPA_CIPHER_WEP40 | WPA_CIPHER_WEP104)))
@@ -660,8 +703,7 @@ static int wpa_supplicant_ssid_bss_match(struct wpa_supplicant *wpa_s,
 		return 0;
 	}
 
-	if ((ssid->key_mgmt & WPA_KEY_MGMT_OSEN) &&
-	    wpa_bss_get_vendor_ie(bss, OSEN_IE_VENDOR_TYPE)) {
+	if ((ssid->key_mgmt & WPA_KEY_MGMT_OSEN) && info->osen) {
 		wpa_dbg(wpa_s, MSG_DEBUG, "   allow in OSEN");
 		return 1;
 	}
@@ -839,29 +881,219 @@ static int addr_in_list(const u8 *addr, const u8 *list, size_t num)
 }
 
 
-struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
-				     int i, struct wpa_bss *bss,
-				     struct wpa_ssid *group,
-				     int only_first_ssid)
+/*
+ * Network selection index
+ *
+ * A network block with an SSID can only match a BSS that advertises exactly
+ * the same SSID, so such networks are hashed by (priority group, SSID). The
+ * network blocks without an SSID (wildcard, WPS, BSSID-only) are maintained in
+ * a separate list for each priority group and need to be checked for every
+ * BSS. Entries are stored in the order the networks appear in the priority
+ * group lists and both lists are merged in that order when iterating over the
+ * candidates to maintain the same selection result as a full list walk.
+ */
+
+struct wpas_sel_entry {
+	struct wpa_ssid *ssid;
+	int prio; /* index to wpa_s->conf->pssid[] */
+	int next; /* next entry in the same list or -1 */
+};
+
+struct wpas_sel_index {
+	struct wpas_sel_entry *entries;
+	int *hash;
+	unsigned int hash_mask;
+	int *wildcard; /* first wildcard entry for each priority group */
+	struct wpas_sel_bss *bss; /* for each entry in wpa_s->last_scan_res */
+};
+
+struct wpas_sel_iter {
+	/* Network list iteration without an index */
+	struct wpa_ssid *next;
+	int only_first;
+
+	/* Indexed iteration */
+	const struct wpas_sel_index *idx;
+	int prio;
+	const u8 *ssid;
+	size_t ssid_len;
+	int match; /* next entry in the SSID hash bucket */
+	int wildcard; /* next entry in the wildcard list */
+};
+
+
+static unsigned int wpas_sel_hash(const u8 *ssid, size_t ssid_len, int prio)
+{
+	u32 hash = 2166136261U ^ (u32) prio;
+	size_t i;
+
+	for (i = 0; i < ssid_len; i++) {
+		hash ^= ssid[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+
+static void wpas_sel_index_free(struct wpas_sel_index *idx)
+{
+	if (!idx)
+		return;
+	os_free(idx->entries);
+	os_free(idx->hash);
+	os_free(idx->wildcard);
+	os_free(idx->bss);
+	os_free(idx);
+}
+
+
+static struct wpas_sel_index *
+wpas_sel_index_build(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_config *conf = wpa_s->conf;
+	struct wpas_sel_index *idx;
+	struct wpa_ssid *ssid;
+	unsigned int i, num = 0, size;
+	int prio, n;
+
+	if (conf->num_prio <= 0 || wpa_s->last_scan_res_used == 0)
+		return NULL;
+
+	for (prio = 0; prio < conf->num_prio; prio++) {
+		for (ssid = conf->pssid[prio]; ssid; ssid = ssid->pnext)
+			num++;
+	}
+	for (size = 16; size < 2 * num; size <<= 1)
+		;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+	idx->entries = os_calloc(num, sizeof(struct wpas_sel_entry));
+	idx->hash = os_calloc(size, sizeof(int));
+	idx->wildcard = os_calloc(conf->num_prio, sizeof(int));
+	idx->bss = os_calloc(wpa_s->last_scan_res_used,
+			     sizeof(struct wpas_sel_bss));
+	if (!idx->entries || !idx->hash || !idx->wildcard || !idx->bss) {
+		wpas_sel_index_free(idx);
+		return NULL;
+	}
+
+	idx->hash_mask = size - 1;
+	for (i = 0; i < size; i++)
+		idx->hash[i] = -1;
+
+	n = 0;
+	for (prio = 0; prio < conf->num_prio; prio++) {
+		idx->wildcard[prio] = -1;
+		for (ssid = conf->pssid[prio]; ssid; ssid = ssid->pnext) {
+			idx->entries[n].ssid = ssid;
+			idx->entries[n].prio = prio;
+			n++;
+		}
+	}
+
+	/* Add entries backwards so that each list ends up in selection order */
+	while (n-- > 0) {
+		struct wpas_sel_entry *e = &idx->entries[n];
+		int *head;
+
+		if (e->ssid->ssid_len == 0)
+			head = &idx->wildcard[e->prio];
+		else
+			head = &idx->hash[wpas_sel_hash(e->ssid->ssid,
+							e->ssid->ssid_len,
+							e->prio) &
+					  idx->hash_mask];
+		e->next = *head;
+		*head = n;
+	}
+
+	for (i = 0; i < wpa_s->last_scan_res_used; i++)
+		wpas_sel_bss_init(&idx->bss[i], wpa_s->last_scan_res[i]);
+
+	return idx;
+}
+
+
+static void wpas_sel_iter_list(struct wpas_sel_iter *iter,
+			       struct wpa_ssid *group, int only_first_ssid)
+{
+	os_memset(iter, 0, sizeof(*iter));
+	iter->next = group;
+	iter->only_first = only_first_ssid;
+}
+
+
+static void wpas_sel_iter_index(struct wpas_sel_iter *iter,
+				const struct wpas_sel_index *idx, int prio,
+				struct wpa_bss *bss)
+{
+	os_memset(iter, 0, sizeof(*iter));
+	iter->idx = idx;
+	iter->prio = prio;
+	iter->ssid = bss->ssid;
+	iter->ssid_len = bss->ssid_len;
+	iter->match = idx->hash[wpas_sel_hash(bss->ssid, bss->ssid_len, prio) &
+				idx->hash_mask];
+	iter->wildcard = idx->wildcard[prio];
+}
+
+
+static struct wpa_ssid * wpas_sel_next(struct wpas_sel_iter *iter)
+{
+	const struct wpas_sel_entry *e;
+
+	if (!iter->idx) {
+		struct wpa_ssid *ssid = iter->next;
+
+		iter->next = ssid && !iter->only_first ? ssid->pnext : NULL;
+		return ssid;
+	}
+
+	/* Skip hash collisions */
+	while (iter->match >= 0) {
+		e = &iter->idx->entries[iter->match];
+		if (e->prio == iter->prio &&
+		    e->ssid->ssid_len == iter->ssid_len &&
+		    os_memcmp(e->ssid->ssid, iter->ssid, iter->ssid_len) == 0)
+			break;
+		iter->match = e->next;
+	}
+
+	if (iter->match >= 0 &&
+	    (iter->wildcard < 0 || iter->match < iter->wildcard)) {
+		e = &iter->idx->entries[iter->match];
+		iter->match = e->next;
+	} else if (iter->wildcard >= 0) {
+		e = &iter->idx->entries[iter->wildcard];
+		iter->wildcard = e->next;
+	} else {
+		return NULL;
+	}
+
+	return e->ssid;
+}
+
+
+static struct wpa_ssid * wpas_scan_res_match(struct wpa_supplicant *wpa_s,
+					     int i, struct wpa_bss *bss,
+					     struct wpas_sel_bss *info,
+					     struct wpas_sel_iter *iter)
 {
 	u8 wpa_ie_len, rsn_ie_len;
 	int wpa;
 	struct wpa_blacklist *e;
-	const u8 *ie;
 	struct wpa_ssid *ssid;
 	int osen;
 #ifdef CONFIG_MBO
 	const u8 *assoc_disallow;
 #endif /* CONFIG_MBO */
 
-	ie = wpa_bss_get_vendor_ie(bss, WPA_IE_VENDOR_TYPE);
-	wpa_ie_len = ie ? ie[1] : 0;
-
-	ie = wpa_bss_get_ie(bss, WLAN_EID_RSN);
-	rsn_ie_len = ie ? ie[1] : 0;
-
-	ie = wpa_bss_get_vendor_ie(bss, OSEN_IE_VENDOR_TYPE);
-	osen = ie != NULL;
+	wpa_ie_len = info->wpa_ie ? info->wpa_ie[1] : 0;
+	rsn_ie_len = info->rsn_ie ? info->rsn_ie[1] : 0;
+	osen = info->osen;
 
 	wpa_dbg(wpa_s, MSG_DEBUG, "%d: " MACSTR " ssid='%s' "
 		"wpa_ie_len=%u rsn_ie_len=%u caps=0x%x level=%d freq=%d %s%s%s",
@@ -911,7 +1143,7 @@ struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 
 	wpa = wpa_ie_len > 0 || rsn_ie_len > 0;
 
-	for (ssid = group; ssid; ssid = only_first_ssid ? NULL : ssid->pnext) {
+	while ((ssid = wpas_sel_next(iter))) {
 		int check_ssid = wpa ? 1 : (ssid->ssid_len != 0);
 		int res;
 
@@ -984,7 +1216,7 @@ struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 			continue;
 		}
 
-		if (!wpa_supplicant_ssid_bss_match(wpa_s, ssid, bss))
+		if (!wpa_supplicant_ssid_bss_match(wpa_s, ssid, bss, info))
 			continue;
 
 		if (!osen && !wpa &&
@@ -1041,7 +1273,9 @@ struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 		}
 #endif /* CONFIG_MESH */
 
-		if (!rate_match(wpa_s, bss)) {
+		if (info->rate_ok < 0)
+			info->rate_ok = rate_match(wpa_s, bss);
+		if (!info->rate_ok) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "   skip - rate sets do "
 				"not match");
 			continue;
@@ -1056,6 +1290,7 @@ struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 		}
 
 		if (!is_zero_ether_addr(ssid->go_p2p_dev_addr)) {
+			const u8 *ie;
 			struct wpabuf *p2p_ie;
 			u8 dev_addr[ETH_ALEN];
 
@@ -1133,8 +1368,23 @@ struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
 }
 
 
+struct wpa_ssid * wpa_scan_res_match(struct wpa_supplicant *wpa_s,
+				     int i, struct wpa_bss *bss,
+				     struct wpa_ssid *group,
+				     int only_first_ssid)
+{
+	struct wpas_sel_bss info;
+	struct wpas_sel_iter iter;
+
+	wpas_sel_bss_init(&info, bss);
+	wpas_sel_iter_list(&iter, group, only_first_ssid);
+	return wpas_scan_res_match(wpa_s, i, bss, &info, &iter);
+}
+
+
 static struct wpa_bss *
 wpa_supplicant_select_bss(struct wpa_supplicant *wpa_s,
+			  struct wpas_sel_index *idx, int prio,
 			  struct wpa_ssid *group,
 			  struct wpa_ssid **selected_ssid,
 			  int only_first_ssid)
@@ -1150,8 +1400,21 @@ wpa_supplicant_select_bss(struct wpa_supplicant *wpa_s,
 
 	for (i = 0; i < wpa_s->last_scan_res_used; i++) {
 		struct wpa_bss *bss = wpa_s->last_scan_res[i];
-		*selected_ssid = wpa_scan_res_match(wpa_s, i, bss, group,
-						    only_first_ssid);
+		struct wpas_sel_bss local, *info;
+		struct wpas_sel_iter iter;
+
+		if (idx) {
+			info = &idx->bss[i];
+		} else {
+			wpas_sel_bss_init(&local, bss);
+			info = &local;
+		}
+		if (idx && !only_first_ssid)
+			wpas_sel_iter_index(&iter, idx, prio, bss);
+		else
+			wpas_sel_iter_list(&iter, group, only_first_ssid);
+		*selected_ssid = wpas_scan_res_match(wpa_s, i, bss, info,
+						     &iter);
 		if (!*selected_ssid)
 			continue;
 		wpa_dbg(wpa_s, MSG_DEBUG, "   selected BSS " MACSTR
@@ -1172,6 +1435,7 @@ struct wpa_bss * wpa_supplicant_pick_network(struct wpa_supplicant *wpa_s,
 	int prio;
 	struct wpa_ssid *next_ssid = NULL;
 	struct wpa_ssid *ssid;
+	struct wpas_sel_index *idx;
 
 	if (wpa_s->last_scan_res == NULL ||
 	    wpa_s->last_scan_res_used == 0)
@@ -1187,17 +1451,24 @@ struct wpa_bss * wpa_supplicant_pick_network(struct wpa_supplicant *wpa_s,
 		wpa_s->next_ssid = NULL;
 	}
 
+	/*
+	 * Without the index (e.g., on allocation failure), all networks in
+	 * each priority group are compared against every BSS.
+	 */
+	idx = wpas_sel_index_build(wpa_s);
+
 	while (selected == NULL) {
 		for (prio = 0; prio < wpa_s->conf->num_prio; prio++) {
 			if (next_ssid && next_ssid->priority ==
 			    wpa_s->conf->pssid[prio]->priority) {
 				selected = wpa_supplicant_select_bss(
-					wpa_s, next_ssid, selected_ssid, 1);
+					wpa_s, idx, prio, next_ssid,
+					selected_ssid, 1);
 				if (selected)
 					break;
 			}
 			selected = wpa_supplicant_select_bss(
-				wpa_s, wpa_s->conf->pssid[prio],
+				wpa_s, idx, prio, wpa_s->conf->pssid[prio],
 				selected_ssid, 0);
 			if (selected)
 				break;
@@ -1213,6 +1484,8 @@ struct wpa_bss * wpa_supplicant_pick_network(struct wpa_supplicant *wpa_s,
 			break;
 	}
 
+	wpas_sel_index_free(idx);
+
 	ssid = *selected_ssid;
 	if (selected && ssid && ssid->mem_only_psk && !ssid->psk_set &&
 	    !ssid->passphrase && !ssid->ext_psk) {
@@ -179,6 +179,8 @@ static int wpa_supplicant_mesh_init(struct wpa_supplicant *wpa_s,
 	if (!bss)
 		goto out_free;
 	dl_list_init(&bss->nr_db);
+	dl_list_init(&bss->acl_cache);
+	dl_list_init(&bss->acl_cache_age);
 
 	os_memcpy(bss->own_addr, wpa_s->own_addr, ETH_ALEN);
 	bss->driver = wpa_s->driver;
@@ -23,8 +23,57 @@
 #include "scan.h"
 #include "p2p_supplicant.h"
 #include "sme.h"
+#include "bss.h"
+#include "ctrl_iface.h"
 #include "notify.h"
 
+
+static struct wpabuf * wpas_notify_bin_init(struct wpa_supplicant *wpa_s,
+					    int event)
+{
+	struct wpabuf *buf;
+	size_t len = os_strlen(wpa_s->ifname);
+
+	if (!wpa_supplicant_ctrl_iface_bin_wanted(wpa_s, event))
+		return NULL;
+
+	buf = wpabuf_alloc(100 + len);
+	if (!buf)
+		return NULL;
+	wpabuf_put_data(buf, WPA_CTRL_BIN_PREFIX, WPA_CTRL_BIN_PREFIX_LEN);
+	wpabuf_put_be16(buf, event);
+	wpabuf_put_be16(buf, WPA_CTRL_BIN_ATTR_IFNAME);
+	wpabuf_put_be16(buf, len);
+	wpabuf_put_data(buf, wpa_s->ifname, len);
+	return buf;
+}
+
+
+static void wpas_notify_bin_put(struct wpabuf *buf, int attr,
+				const void *data, size_t len)
+{
+	wpabuf_put_be16(buf, attr);
+	wpabuf_put_be16(buf, len);
+	wpabuf_put_data(buf, data, len);
+}
+
+
+static void wpas_notify_bin_put_u32(struct wpabuf *buf, int attr, u32 val)
+{
+	wpabuf_put_be16(buf, attr);
+	wpabuf_put_be16(buf, 4);
+	wpabuf_put_be32(buf, val);
+}
+
+
+static void wpas_notify_bin_send(struct wpa_supplicant *wpa_s, int event,
+				 struct wpabuf *buf)
+{
+	wpa_supplicant_ctrl_iface_send_bin(wpa_s, event, buf);
+	wpabuf_free(buf);
+}
+
+
 int wpas_notify_supplicant_initialized(struct wpa_global *global)
 {
 #ifdef CONFIG_DBUS
@@ -91,6 +140,8 @@ void wpas_notify_state_changed(struct wpa_supplicant *wpa_s,
 			       enum wpa_states new_state,
 			       enum wpa_states old_state)
 {
+	struct wpabuf *buf;
+
 	if (wpa_s->p2p_mgmt)
 		return;
 
@@ -118,6 +169,24 @@ void wpas_notify_state_changed(struct wpa_supplicant *wpa_s,
 
 	sme_state_changed(wpa_s);
 
+	buf = wpas_notify_bin_init(wpa_s, WPA_CTRL_BIN_EV_STATE_CHANGE);
+	if (buf) {
+		struct wpa_ssid *ssid = wpa_s->current_ssid;
+
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_STATE,
+					new_state);
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_OLD_STATE,
+					old_state);
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_NETWORK_ID,
+					ssid ? ssid->id : -1);
+		wpas_notify_bin_put(buf, WPA_CTRL_BIN_ATTR_BSSID,
+				    wpa_s->bssid, ETH_ALEN);
+		if (ssid && ssid->ssid && ssid->ssid_len <= SSID_MAX_LEN)
+			wpas_notify_bin_put(buf, WPA_CTRL_BIN_ATTR_SSID,
+					    ssid->ssid, ssid->ssid_len);
+		wpas_notify_bin_send(wpa_s, WPA_CTRL_BIN_EV_STATE_CHANGE, buf);
+	}
+
 #ifdef ANDROID
 	wpa_msg_ctrl(wpa_s, MSG_INFO, WPA_EVENT_STATE_CHANGE
 		     "id=%d state=%d BSSID=" MACSTR " SSID=%s",
@@ -133,10 +202,24 @@ void wpas_notify_state_changed(struct wpa_supplicant *wpa_s,
 
 void wpas_notify_disconnect_reason(struct wpa_supplicant *wpa_s)
 {
+	struct wpabuf *buf;
+
 	if (wpa_s->p2p_mgmt)
 		return;
 
 	wpas_dbus_signal_prop_changed(wpa_s, WPAS_DBUS_PROP_DISCONNECT_REASON);
+
+	buf = wpas_notify_bin_init(wpa_s, WPA_CTRL_BIN_EV_DISCONNECTED);
+	if (buf) {
+		/* disconnect_reason is negative for locally generated ones */
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_REASON,
+					abs(wpa_s->disconnect_reason));
+		if (wpa_s->disconnect_reason < 0)
+			wpas_notify_bin_put(buf,
+					    WPA_CTRL_BIN_ATTR_LOCALLY_GENERATED,
+					    NULL, 0);
+		wpas_notify_bin_send(wpa_s, WPA_CTRL_BIN_EV_DISCONNECTED, buf);
+	}
 }
 
 
@@ -241,12 +324,18 @@ void wpas_notify_scan_done(struct wpa_supplicant *wpa_s, int success)
 
 void wpas_notify_scan_results(struct wpa_supplicant *wpa_s)
 {
+	struct wpabuf *buf;
+
 	if (wpa_s->p2p_mgmt)
 		return;
 
 	/* notify the old DBus API */
 	wpa_supplicant_dbus_notify_scan_results(wpa_s);
 
+	buf = wpas_notify_bin_init(wpa_s, WPA_CTRL_BIN_EV_SCAN_RESULTS);
+	if (buf)
+		wpas_notify_bin_send(wpa_s, WPA_CTRL_BIN_EV_SCAN_RESULTS, buf);
+
 	wpas_wps_notify_scan_results(wpa_s);
 }
 
@@ -366,24 +455,54 @@ void wpas_notify_network_removed(struct wpa_supplicant *wpa_s,
 void wpas_notify_bss_added(struct wpa_supplicant *wpa_s,
 			   u8 bssid[], unsigned int id)
 {
+	struct wpabuf *buf;
+
 	if (wpa_s->p2p_mgmt)
 		return;
 
 	wpas_dbus_register_bss(wpa_s, bssid, id);
 	wpa_msg_ctrl(wpa_s, MSG_INFO, WPA_EVENT_BSS_ADDED "%u " MACSTR,
 		     id, MAC2STR(bssid));
+
+	buf = wpas_notify_bin_init(wpa_s, WPA_CTRL_BIN_EV_BSS_ADDED);
+	if (buf) {
+		struct wpa_bss *bss = wpa_bss_get_id(wpa_s, id);
+
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_ID, id);
+		wpas_notify_bin_put(buf, WPA_CTRL_BIN_ATTR_BSSID, bssid,
+				    ETH_ALEN);
+		if (bss) {
+			wpas_notify_bin_put(buf, WPA_CTRL_BIN_ATTR_SSID,
+					    bss->ssid, bss->ssid_len);
+			wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_FREQ,
+						bss->freq);
+			wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_SIGNAL,
+						bss->level);
+		}
+		wpas_notify_bin_send(wpa_s, WPA_CTRL_BIN_EV_BSS_ADDED, buf);
+	}
 }
 
 
 void wpas_notify_bss_removed(struct wpa_supplicant *wpa_s,
 			     u8 bssid[], unsigned int id)
 {
+	struct wpabuf *buf;
+
 	if (wpa_s->p2p_mgmt)
 		return;
 
 	wpas_dbus_unregister_bss(wpa_s, bssid, id);
 	wpa_msg_ctrl(wpa_s, MSG_INFO, WPA_EVENT_BSS_REMOVED "%u " MACSTR,
 		     id, MAC2STR(bssid));
+
+	buf = wpas_notify_bin_init(wpa_s, WPA_CTRL_BIN_EV_BSS_REMOVED);
+	if (buf) {
+		wpas_notify_bin_put_u32(buf, WPA_CTRL_BIN_ATTR_ID, id);
+		wpas_notify_bin_put(buf, WPA_CTRL_BIN_ATTR_BSSID, bssid,
+				    ETH_ALEN);
+		wpas_notify_bin_send(wpa_s, WPA_CTRL_BIN_EV_BSS_REMOVED, buf);
+	}
 }
 
 
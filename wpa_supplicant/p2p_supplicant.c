@@ -1696,6 +1696,7 @@ static void wpas_p2p_add_psk_list(struct wpa_supplicant *wpa_s,
 		hpsk->next = hapd->conf->ssid.wpa_psk;
 		hapd->conf->ssid.wpa_psk = hpsk;
 	}
+	hostapd_config_wpa_psk_changed(&hapd->conf->ssid);
 }
 
 
@@ -8044,6 +8045,7 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 			psk = psk->next;
 		}
 	}
+	hostapd_config_wpa_psk_changed(&hapd->conf->ssid);
 
 	/* Disconnect from group */
 	if (iface_addr)
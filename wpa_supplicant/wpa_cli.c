@@ -1805,6 +1805,20 @@ static int wpa_cli_cmd_disassociate(struct wpa_ctrl *ctrl, int argc,
 	return wpa_cli_cmd(ctrl, "DISASSOCIATE", 1, argc, argv);
 }
 
+
+static int wpa_cli_cmd_sae_stats(struct wpa_ctrl *ctrl, int argc,
+				 char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "SAE_STATS");
+}
+
+
+static int wpa_cli_cmd_probe_req_stats(struct wpa_ctrl *ctrl, int argc,
+				       char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "PROBE_REQ_STATS");
+}
+
 static int wpa_cli_cmd_chanswitch(struct wpa_ctrl *ctrl, int argc,
 				    char *argv[])
 {
@@ -3041,6 +3055,12 @@ static const struct wpa_cli_cmd wpa_cli_commands[] = {
 	{ "disassociate", wpa_cli_cmd_disassociate, NULL,
 	  cli_cmd_flag_none,
 	  "<addr> = disassociate a station" },
+	{ "sae_stats", wpa_cli_cmd_sae_stats, NULL,
+	  cli_cmd_flag_none,
+	  "= show SAE commit processing statistics (AP)" },
+	{ "probe_req_stats", wpa_cli_cmd_probe_req_stats, NULL,
+	  cli_cmd_flag_none,
+	  "= show Probe Request processing statistics (AP)" },
 	{ "chan_switch", wpa_cli_cmd_chanswitch, NULL,
 	  cli_cmd_flag_none,
 	  "<cs_count> <freq> [sec_channel_offset=] [center_freq1=]"
@@ -18,6 +18,7 @@
 
 #include "common.h"
 #include "crypto/random.h"
+#include "crypto/dh_groups.h"
 #include "crypto/sha1.h"
 #include "eapol_supp/eapol_supp_sm.h"
 #include "eap_peer/eap.h"
@@ -886,6 +887,14 @@ static void wpa_supplicant_terminate(int sig, void *signal_ctx)
 }
 
 
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+static void wpa_supplicant_flush_log(int sig, void *signal_ctx)
+{
+	wpa_debug_flush_file();
+}
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
+
+
 void wpa_supplicant_clear_status(struct wpa_supplicant *wpa_s)
 {
 	enum wpa_states old_state = wpa_s->wpa_state;
@@ -3652,8 +3661,14 @@ int wpa_supplicant_driver_init(struct wpa_supplicant *wpa_s)
 
 static int wpa_supplicant_daemon(const char *pid_file)
 {
+	int ret;
+
 	wpa_printf(MSG_DEBUG, "Daemonize..");
-	return os_daemonize(pid_file);
+	/* The parent process exits without writing buffered debug output */
+	wpa_debug_flush_file();
+	ret = os_daemonize(pid_file);
+	wpa_debug_start_file_writer();
+	return ret;
 }
 
 
@@ -5550,6 +5565,9 @@ int wpa_supplicant_run(struct wpa_global *global)
 
 	eloop_register_signal_terminate(wpa_supplicant_terminate, global);
 	eloop_register_signal_reconfig(wpa_supplicant_reconfig, global);
+#ifdef CONFIG_DEBUG_FILE_ASYNC
+	eloop_register_signal(SIGUSR1, wpa_supplicant_flush_log, NULL);
+#endif /* CONFIG_DEBUG_FILE_ASYNC */
 
 	eloop_run();
 
@@ -5598,6 +5616,9 @@ void wpa_supplicant_deinit(struct wpa_global *global)
 	os_free(global->drv_priv);
 
 	random_deinit();
+#ifdef CONFIG_DH_PRECOMP
+	dh_groups_deinit();
+#endif /* CONFIG_DH_PRECOMP */
 
 	eloop_destroy();
 
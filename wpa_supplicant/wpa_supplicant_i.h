@@ -446,6 +446,10 @@ struct wpa_bss_tmp_disallowed {
 	struct os_reltime disallowed_until;
 };
 
+#define WPA_BSS_HASH_SIZE 128
+#define WPA_BSS_HASH(addr) (((addr)[3] ^ (addr)[4] ^ (addr)[5]) & \
+			    (WPA_BSS_HASH_SIZE - 1))
+
 /**
  * struct wpa_supplicant - Internal data for wpa_supplicant interface
  *
@@ -549,9 +553,20 @@ struct wpa_supplicant {
 				 struct wpa_scan_results *scan_res);
 	struct dl_list bss; /* struct wpa_bss::list */
 	struct dl_list bss_id; /* struct wpa_bss::list_id */
+	/*
+	 * Hash indexes for the BSS table. Entries are moved to the head of
+	 * their hash lists whenever updated, so each hash list is in reverse
+	 * order of struct wpa_supplicant::bss.
+	 */
+	struct dl_list bss_hash[WPA_BSS_HASH_SIZE]; /* by BSSID */
+	struct dl_list bss_id_hash[WPA_BSS_HASH_SIZE]; /* by id */
+#ifdef CONFIG_P2P
+	struct dl_list bss_p2p_hash[WPA_BSS_HASH_SIZE]; /* by P2P Device Addr */
+#endif /* CONFIG_P2P */
 	size_t num_bss;
 	unsigned int bss_update_idx;
 	unsigned int bss_next_id;
+	unsigned int bss_update_in_progress:1;
 
 	 /*
 	  * Pointers to BSS entries in the order they were in the last scan
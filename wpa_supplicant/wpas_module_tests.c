@@ -10,7 +10,12 @@
 
 #include "utils/common.h"
 #include "utils/module_tests.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver.h"
+#include "ap/ap_config.h"
 #include "wpa_supplicant_i.h"
+#include "config.h"
+#include "bss.h"
 #include "blacklist.h"
 
 
@@ -70,6 +75,545 @@ fail:
 }
 
 
+static struct wpa_scan_res * wpas_bss_test_res(const u8 *bssid,
+					       const char *ssid,
+					       const u8 *p2p_dev_addr,
+					       size_t pad, int rsn)
+{
+	/* WPA2-Personal with CCMP */
+	static const u8 rsn_ie[] = {
+		WLAN_EID_RSN, 20, 0x01, 0x00,
+		0x00, 0x0f, 0xac, 0x04,
+		0x01, 0x00, 0x00, 0x0f, 0xac, 0x04,
+		0x01, 0x00, 0x00, 0x0f, 0xac, 0x02,
+		0x00, 0x00
+	};
+	struct wpa_scan_res *res;
+	size_t ssid_len = os_strlen(ssid);
+	u8 *pos;
+
+	res = os_zalloc(sizeof(*res) + 2 + ssid_len + 15 + pad +
+			sizeof(rsn_ie));
+	if (!res)
+		return NULL;
+	os_memcpy(res->bssid, bssid, ETH_ALEN);
+	res->freq = 2412;
+	res->level = -50;
+	pos = (u8 *) (res + 1);
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = ssid_len;
+	os_memcpy(pos, ssid, ssid_len);
+	pos += ssid_len;
+	if (p2p_dev_addr) {
+		/* P2P IE with a P2P Device ID attribute */
+		*pos++ = WLAN_EID_VENDOR_SPECIFIC;
+		*pos++ = 4 + 3 + ETH_ALEN;
+		WPA_PUT_BE32(pos, P2P_IE_VENDOR_TYPE);
+		pos += 4;
+		*pos++ = P2P_ATTR_DEVICE_ID;
+		WPA_PUT_LE16(pos, ETH_ALEN);
+		pos += 2;
+		os_memcpy(pos, p2p_dev_addr, ETH_ALEN);
+		pos += ETH_ALEN;
+	}
+	if (rsn) {
+		res->caps = IEEE80211_CAP_ESS | IEEE80211_CAP_PRIVACY;
+		os_memcpy(pos, rsn_ie, sizeof(rsn_ie));
+		pos += sizeof(rsn_ie);
+	}
+	if (pad) {
+		/* Padding with an unknown vendor specific element */
+		*pos++ = WLAN_EID_VENDOR_SPECIFIC;
+		*pos++ = pad - 2;
+		os_memset(pos, 0xff, pad - 2);
+		pos += pad - 2;
+	}
+	res->ie_len = pos - (u8 *) (res + 1);
+
+	return res;
+}
+
+
+static int wpas_bss_module_tests(void)
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_global global;
+	struct wpa_config conf;
+	struct wpa_radio radio;
+	struct wpa_scan_res *res;
+	struct wpa_bss *bss, *bss2;
+	struct wpa_bss_ie_index *ie_index;
+	struct wpabuf *buf;
+	struct os_reltime fetch_time;
+	u8 bssid[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 dev_addr[ETH_ALEN] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+	char ssid[20];
+	unsigned int i, num = 300;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "BSS table module tests");
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	if (!wpa_s)
+		return -1;
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&conf, 0, sizeof(conf));
+	conf.bss_max_count = num + 10;
+	os_memset(&radio, 0, sizeof(radio));
+	dl_list_init(&radio.work);
+	wpa_s->global = &global;
+	wpa_s->conf = &conf;
+	wpa_s->radio = &radio;
+	wpa_bss_init(wpa_s);
+	os_get_reltime(&fetch_time);
+
+	wpa_bss_update_start(wpa_s);
+	for (i = 0; i < num; i++) {
+		bssid[4] = i >> 8;
+		bssid[5] = i & 0xff;
+		os_snprintf(ssid, sizeof(ssid), "test-%u", i % 10);
+		res = wpas_bss_test_res(bssid, ssid, NULL, 0, 0);
+		if (!res)
+			goto fail;
+		wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+		os_free(res);
+	}
+	res = wpas_bss_test_res(bssid, "DIRECT-xy", dev_addr, 0, 0);
+	if (!res)
+		goto fail;
+	wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+	os_free(res);
+	if (wpa_s->num_bss != num + 1)
+		goto fail;
+
+	for (i = 0; i < num; i++) {
+		bssid[4] = i >> 8;
+		bssid[5] = i & 0xff;
+		os_snprintf(ssid, sizeof(ssid), "test-%u", i % 10);
+		bss = wpa_bss_get(wpa_s, bssid, (u8 *) ssid, os_strlen(ssid));
+		if (!bss || wpa_bss_get_id(wpa_s, bss->id) != bss ||
+		    wpa_bss_get(wpa_s, bssid, (u8 *) "test", 4))
+			goto fail;
+		if (i != num - 1 && wpa_bss_get_bssid(wpa_s, bssid) != bss)
+			goto fail;
+	}
+
+	/* Last BSSID has two entries; the most recently updated one wins */
+	bss = wpa_bss_get(wpa_s, bssid, (u8 *) "DIRECT-xy", 9);
+	if (!bss || wpa_bss_get_bssid(wpa_s, bssid) != bss ||
+	    wpa_bss_get_bssid_latest(wpa_s, bssid) != bss)
+		goto fail;
+#ifdef CONFIG_P2P
+	if (wpa_bss_get_p2p_dev_addr(wpa_s, dev_addr) != bss ||
+	    wpa_bss_get_p2p_dev_addr(wpa_s, bssid))
+		goto fail;
+#endif /* CONFIG_P2P */
+
+	/* Element lookups through the element index */
+	buf = wpa_bss_get_vendor_ie_multi(bss, P2P_IE_VENDOR_TYPE);
+	if (wpa_bss_get_vendor_ie(bss, P2P_IE_VENDOR_TYPE) !=
+	    (const u8 *) (bss + 1) + 2 + 9 || !bss->ie_index ||
+	    !buf || wpabuf_len(buf) != 3 + ETH_ALEN ||
+	    wpa_bss_get_vendor_ie_multi(bss, WPS_IE_VENDOR_TYPE) ||
+	    wpa_bss_get_ie(bss, WLAN_EID_RSN)) {
+		wpabuf_free(buf);
+		goto fail;
+	}
+	wpabuf_free(buf);
+	bss2 = wpa_bss_get(wpa_s, bssid, (u8 *) ssid, os_strlen(ssid));
+	if (!bss2 || wpa_bss_get_ie(bss2, WLAN_EID_SSID) != (u8 *) (bss2 + 1) ||
+	    wpa_bss_get_ie(bss2, WLAN_EID_VENDOR_SPECIFIC) ||
+	    wpa_bss_get_vendor_ie(bss2, 0xffffffff))
+		goto fail;
+
+	/* Update with longer IEs to force the entry to be reallocated */
+	wpa_bss_update_start(wpa_s);
+	res = wpas_bss_test_res(bssid, ssid, NULL, 200, 0);
+	if (!res)
+		goto fail;
+	wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+	os_free(res);
+	bss2 = wpa_bss_get(wpa_s, bssid, (u8 *) ssid, os_strlen(ssid));
+	if (!bss2 || bss2->ie_len <= 200 ||
+	    wpa_bss_get_bssid(wpa_s, bssid) != bss2 ||
+	    wpa_bss_get_id(wpa_s, bss2->id) != bss2 ||
+	    !bss2->pending_changes ||
+	    wpa_bss_get_vendor_ie(bss2, 0xffffffff) !=
+	    (const u8 *) (bss2 + 1) + 2 + os_strlen(ssid))
+		goto fail;
+	wpa_bss_update_end(wpa_s, NULL, 0);
+	if (bss2->pending_changes)
+		goto fail;
+
+	/* Unchanged IEs are not copied again */
+	wpa_bss_update_start(wpa_s);
+	res = wpas_bss_test_res(bssid, ssid, NULL, 200, 0);
+	if (!res)
+		goto fail;
+	ie_index = bss2->ie_index;
+	wpa_bss_update_scan_res(wpa_s, res, &fetch_time);
+	os_free(res);
+	wpa_bss_update_end(wpa_s, NULL, 0);
+	if (wpa_bss_get(wpa_s, bssid, (u8 *) ssid, os_strlen(ssid)) != bss2 ||
+	    !ie_index || bss2->ie_index != ie_index)
+		goto fail;
+#ifdef CONFIG_P2P
+	if (wpa_bss_get_p2p_dev_addr(wpa_s, dev_addr) != bss)
+		goto fail;
+#endif /* CONFIG_P2P */
+
+	wpa_bss_remove(wpa_s, bss2, "test");
+	if (wpa_bss_get(wpa_s, bssid, (u8 *) ssid, os_strlen(ssid)) ||
+	    wpa_bss_get_bssid(wpa_s, bssid) != bss)
+		goto fail;
+	wpa_bss_remove(wpa_s, bss, "test");
+	if (wpa_bss_get_bssid(wpa_s, bssid) ||
+	    wpa_bss_get_bssid_latest(wpa_s, bssid))
+		goto fail;
+#ifdef CONFIG_P2P
+	if (wpa_bss_get_p2p_dev_addr(wpa_s, dev_addr))
+		goto fail;
+#endif /* CONFIG_P2P */
+
+	ret = 0;
+fail:
+	wpa_bss_flush(wpa_s);
+	if (wpa_s->num_bss != 0)
+		ret = -1;
+	os_free(wpa_s->last_scan_res);
+	os_free(wpa_s);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "BSS table module test failure");
+
+	return ret;
+}
+
+
+/* Network selection without the selection index for comparison */
+static struct wpa_bss * wpas_sel_test_full_walk(struct wpa_supplicant *wpa_s,
+						struct wpa_ssid **selected_ssid)
+{
+	unsigned int i;
+	int prio;
+
+	for (prio = 0; prio < wpa_s->conf->num_prio; prio++) {
+		for (i = 0; i < wpa_s->last_scan_res_used; i++) {
+			struct wpa_bss *bss = wpa_s->last_scan_res[i];
+
+			*selected_ssid = wpa_scan_res_match(
+				wpa_s, i, bss, wpa_s->conf->pssid[prio], 0);
+			if (*selected_ssid)
+				return bss;
+		}
+	}
+
+	return NULL;
+}
+
+
+static int wpas_network_selection_module_tests(void)
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_global global;
+	struct wpa_config *conf;
+	struct wpa_radio radio;
+	struct wpa_scan_res *res;
+	struct wpa_ssid *ssid, *wildcard = NULL, *target = NULL, *sel, *sel2;
+	struct wpa_bss *bss, *bss2;
+	struct os_reltime start, end, t_index, t_full;
+	u8 bssid[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	char buf[20];
+	unsigned int i, num_net = 500, num_bss = 500, iter = 10;
+	int ret = -1, debug_level;
+
+	wpa_printf(MSG_INFO, "Network selection module tests");
+
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	conf = wpa_config_alloc_empty(NULL, NULL);
+	if (!wpa_s || !conf) {
+		os_free(wpa_s);
+		wpa_config_free(conf);
+		return -1;
+	}
+	conf->bss_max_count = num_bss + 10;
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&radio, 0, sizeof(radio));
+	dl_list_init(&radio.work);
+	dl_list_init(&wpa_s->bss_tmp_disallowed);
+	wpa_s->global = &global;
+	wpa_s->conf = conf;
+	wpa_s->radio = &radio;
+	wpa_bss_init(wpa_s);
+
+	/* Networks "net-<n>" spread over four priority groups */
+	for (i = 0; i < num_net; i++) {
+		ssid = wpa_config_add_network(conf);
+		if (!ssid)
+			goto fail;
+		wpa_config_set_network_defaults(ssid);
+		os_snprintf(buf, sizeof(buf), "net-%u", i);
+		ssid->ssid = (u8 *) os_strdup(buf);
+		if (!ssid->ssid)
+			goto fail;
+		ssid->ssid_len = os_strlen(buf);
+		ssid->psk_set = 1;
+		ssid->priority = i % 4;
+		if (i == num_net - 4)
+			target = ssid;
+	}
+
+	/* BSSID-only network in the same priority group as the target */
+	wildcard = wpa_config_add_network(conf);
+	if (!wildcard)
+		goto fail;
+	wpa_config_set_network_defaults(wildcard);
+	wildcard->psk_set = 1;
+	wildcard->priority = target->priority;
+	wildcard->bssid_set = 1;
+	bssid[5] = 5;
+	os_memcpy(wildcard->bssid, bssid, ETH_ALEN);
+	wpa_config_update_prio_list(conf);
+
+	/* Unrelated BSSes and the last one matching the target network */
+	os_get_reltime(&start);
+	wpa_bss_update_start(wpa_s);
+	for (i = 0; i < num_bss; i++) {
+		bssid[4] = i >> 8;
+		bssid[5] = i & 0xff;
+		if (i == num_bss - 1)
+			os_snprintf(buf, sizeof(buf), "net-%u", num_net - 4);
+		else
+			os_snprintf(buf, sizeof(buf), "ap-%u", i);
+		res = wpas_bss_test_res(bssid, buf, NULL, 0, 1);
+		if (!res)
+			goto fail;
+		wpa_bss_update_scan_res(wpa_s, res, &start);
+		os_free(res);
+	}
+	wpa_bss_update_end(wpa_s, NULL, 0);
+	if (wpa_s->last_scan_res_used != num_bss)
+		goto fail;
+
+	/* The BSSID-only network matches an earlier BSS */
+	bss = wpa_supplicant_pick_network(wpa_s, &sel);
+	bss2 = wpas_sel_test_full_walk(wpa_s, &sel2);
+	if (!bss || bss != bss2 || sel != wildcard || sel2 != wildcard ||
+	    bss->bssid[5] != 5) {
+		wpa_printf(MSG_INFO, "Unexpected wildcard selection result");
+		goto fail;
+	}
+
+	wildcard->disabled = 1;
+	bss = wpa_supplicant_pick_network(wpa_s, &sel);
+	bss2 = wpas_sel_test_full_walk(wpa_s, &sel2);
+	if (!bss || bss != bss2 || sel != target || sel2 != target ||
+	    bss != wpa_s->last_scan_res[num_bss - 1]) {
+		wpa_printf(MSG_INFO, "Unexpected SSID selection result");
+		goto fail;
+	}
+
+	/* Benchmark without debug output dominating the measurement */
+	debug_level = wpa_debug_level;
+	wpa_debug_level = MSG_INFO;
+	os_get_reltime(&start);
+	for (i = 0; i < iter; i++)
+		wpa_supplicant_pick_network(wpa_s, &sel);
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &t_index);
+	os_get_reltime(&start);
+	for (i = 0; i < iter; i++)
+		wpas_sel_test_full_walk(wpa_s, &sel2);
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &t_full);
+	wpa_debug_level = debug_level;
+
+	wpa_printf(MSG_INFO,
+		   "Network selection with %u networks and %u BSSes: indexed %ld.%06ld sec, full walk %ld.%06ld sec (%u rounds)",
+		   num_net + 1, num_bss, t_index.sec, t_index.usec,
+		   t_full.sec, t_full.usec, iter);
+	if (sel != target || sel2 != target)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpa_bss_deinit(wpa_s);
+	os_free(wpa_s->last_scan_res);
+	wpa_config_free(conf);
+	os_free(wpa_s);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "network selection module test failure");
+
+	return ret;
+}
+
+
+#ifdef CONFIG_AP
+/* Expected next PSK from hostapd_get_psk() based on a full list walk */
+static const u8 * wpas_psk_test_next(struct hostapd_wpa_psk *list,
+				     const u8 *addr, const u8 *prev_psk,
+				     const u8 *skip)
+{
+	struct hostapd_wpa_psk *psk;
+	int next_ok = prev_psk == NULL;
+
+	for (psk = list; psk; psk = psk->next) {
+		if (next_ok && psk->psk != skip &&
+		    (psk->group || os_memcmp(psk->addr, addr, ETH_ALEN) == 0))
+			return psk->psk;
+		if (psk->psk == prev_psk)
+			next_ok = 1;
+	}
+
+	return NULL;
+}
+
+
+static int wpas_psk_test_order(struct hostapd_bss_config *conf,
+			       const u8 *addr, const u8 *first)
+{
+	const u8 *psk = NULL, *expected = NULL;
+	int count = 0;
+
+	for (;;) {
+		psk = hostapd_get_psk(conf, addr, NULL, psk);
+		if (count == 0 && first)
+			expected = first;
+		else
+			expected = wpas_psk_test_next(
+				conf->ssid.wpa_psk, addr,
+				expected == first ? NULL : expected, first);
+		if (psk != expected)
+			return -1;
+		if (!psk)
+			break;
+		count++;
+	}
+
+	return count;
+}
+
+
+static int wpas_psk_module_tests(void)
+{
+	struct hostapd_bss_config *conf;
+	struct hostapd_wpa_psk *psk, *group = NULL, *other = NULL;
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	u8 p2p_dev_addr[ETH_ALEN] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+	unsigned int i, num = 1000;
+	const char *fname = "/tmp/wpas-psk-file-test";
+	FILE *f;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "WPA PSK lookup module tests");
+
+	conf = os_zalloc(sizeof(*conf));
+	if (!conf)
+		return -1;
+
+	/* Every third entry is a group PSK; others for 16 station addresses */
+	for (i = 0; i < num; i++) {
+		psk = os_zalloc(sizeof(*psk));
+		if (!psk)
+			goto fail;
+		psk->psk[0] = i >> 8;
+		psk->psk[1] = i & 0xff;
+		if (i % 3 == 0) {
+			psk->group = 1;
+			if (i == 300)
+				group = psk;
+		} else {
+			os_memcpy(psk->addr, addr, ETH_ALEN);
+			psk->addr[5] = i % 16;
+			if (i == 301)
+				other = psk;
+		}
+		psk->next = conf->ssid.wpa_psk;
+		conf->ssid.wpa_psk = psk;
+	}
+	psk = os_zalloc(sizeof(*psk));
+	if (!psk)
+		goto fail;
+	os_memcpy(psk->p2p_dev_addr, p2p_dev_addr, ETH_ALEN);
+	psk->next = conf->ssid.wpa_psk;
+	conf->ssid.wpa_psk = psk;
+
+	addr[5] = 5;
+	if (wpas_psk_test_order(conf, addr, NULL) < 0 ||
+	    !conf->ssid.wpa_psk_index) {
+		wpa_printf(MSG_INFO, "Unexpected PSK order");
+		goto fail;
+	}
+
+	/* P2P Device Address is used for matching when known */
+	if (hostapd_get_psk(conf, addr, p2p_dev_addr, NULL) != psk->psk ||
+	    hostapd_get_psk(conf, addr, p2p_dev_addr, psk->psk) !=
+	    psk->next->psk) {
+		wpa_printf(MSG_INFO, "Unexpected P2P PSK");
+		goto fail;
+	}
+
+	/* The PSK that matched last time is tried first */
+	hostapd_wpa_psk_matched(conf, addr, NULL, group->psk);
+	if (wpas_psk_test_order(conf, addr, group->psk) < 0) {
+		wpa_printf(MSG_INFO, "Unexpected PSK order after match");
+		goto fail;
+	}
+	addr[5] = 6;
+	if (wpas_psk_test_order(conf, addr, NULL) < 0) {
+		wpa_printf(MSG_INFO, "Unexpected PSK order for another STA");
+		goto fail;
+	}
+
+	/* PSK bound to another station is not used even if reported */
+	hostapd_wpa_psk_matched(conf, addr, NULL, other->psk);
+	if (wpas_psk_test_order(conf, addr, NULL) < 0) {
+		wpa_printf(MSG_INFO, "Unexpected PSK order for invalid match");
+		goto fail;
+	}
+
+	/* Unknown PSK pointers end the iteration */
+	if (hostapd_get_psk(conf, addr, NULL, addr))
+		goto fail;
+
+	hostapd_config_wpa_psk_changed(&conf->ssid);
+	if (conf->ssid.wpa_psk_index)
+		goto fail;
+
+	/* A bad line in wpa_psk_file leaves no entries with an underived PSK */
+	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	os_memcpy(conf->ssid.ssid, "test", 4);
+	conf->ssid.ssid_len = 4;
+	conf->ssid.wpa_psk_file = os_strdup(fname);
+	f = fopen(fname, "w");
+	if (!conf->ssid.wpa_psk_file || !f)
+		goto fail;
+	fprintf(f, "00:00:00:00:00:00 passphrase\n"
+		"02:00:00:00:00:0x passphrase\n");
+	fclose(f);
+	if (hostapd_setup_wpa_psk(conf) == 0 || conf->ssid.wpa_psk ||
+	    conf->ssid.wpa_psk_index) {
+		wpa_printf(MSG_INFO, "Unexpected PSKs after wpa_psk_file error");
+		goto fail;
+	}
+
+	ret = 0;
+fail:
+	unlink(fname);
+	os_free(conf->ssid.wpa_psk_file);
+	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	hostapd_config_wpa_psk_changed(&conf->ssid);
+	os_free(conf);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "WPA PSK lookup module test failure");
+
+	return ret;
+}
+#endif /* CONFIG_AP */
+
+
 int wpas_module_tests(void)
 {
 	int ret = 0;
@@ -79,6 +623,17 @@ int wpas_module_tests(void)
 	if (wpas_blacklist_module_tests() < 0)
 		ret = -1;
 
+	if (wpas_bss_module_tests() < 0)
+		ret = -1;
+
+	if (wpas_network_selection_module_tests() < 0)
+		ret = -1;
+
+#ifdef CONFIG_AP
+	if (wpas_psk_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_AP */
+
 #ifdef CONFIG_WPS
 	if (wps_module_tests() < 0)
 		ret = -1;